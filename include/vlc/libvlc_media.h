@@ -138,8 +138,55 @@ typedef struct libvlc_media_stats_t
     int         i_sent_packets;
     int         i_sent_bytes;
     float       f_send_bitrate;
+
+    /* Video decoders */
+    int         i_video_frame_threads; /**< threads of frame-threaded decoders */
+    int         i_video_slice_threads; /**< threads of slice-threaded decoders */
 } libvlc_media_stats_t;
 
+/**
+ * Stages of the playback pipeline
+ * \see libvlc_media_get_stats_histogram
+ */
+typedef enum libvlc_media_stats_stage_t
+{
+    /** Duration of each demuxing step */
+    libvlc_media_stats_demux_time = 0,
+    /** Blocks queued to a decoder when one is dequeued */
+    libvlc_media_stats_decoder_fifo_depth,
+    /** Wait of a decoder for each block */
+    libvlc_media_stats_decoder_wait_time,
+    /** Duration of the decoding of each block */
+    libvlc_media_stats_decode_time,
+    /** Fetching and filtering of each decoded picture by the video output */
+    libvlc_media_stats_vout_prepare_picture_time,
+    /** Rendering of the subpictures and conversion of each picture */
+    libvlc_media_stats_vout_render_time,
+    /** Preparation of each picture by the display */
+    libvlc_media_stats_vout_prepare_time,
+    /** Display of each picture */
+    libvlc_media_stats_vout_display_time,
+    /** Audio buffered in the audio output */
+    libvlc_media_stats_aout_latency,
+} libvlc_media_stats_stage_t;
+
+#define LIBVLC_MEDIA_STATS_HISTOGRAM_BUCKETS 24
+
+/**
+ * Distribution of the values measured at a stage of the pipeline
+ *
+ * Durations are in microseconds. The bucket 0 counts the null values, the
+ * bucket i the values from 2^(i-1) to 2^i - 1, and the last bucket also
+ * counts all the larger values.
+ */
+typedef struct libvlc_media_stats_histogram_t
+{
+    uint64_t    i_count; /**< number of values */
+    uint64_t    i_total; /**< sum of the values */
+    uint64_t    i_max;   /**< largest value */
+    uint64_t    buckets[LIBVLC_MEDIA_STATS_HISTOGRAM_BUCKETS];
+} libvlc_media_stats_histogram_t;
+
 typedef struct libvlc_audio_track_t
 {
     unsigned    i_channels;
@@ -623,6 +670,21 @@ LIBVLC_API libvlc_state_t libvlc_media_get_state(
 LIBVLC_API int libvlc_media_get_stats( libvlc_media_t *p_md,
                                            libvlc_media_stats_t *p_stats );
 
+/**
+ * Get the distribution of the values measured at a stage of the pipeline
+ * \param p_md: media descriptor object
+ * \param stage: stage of the pipeline
+ * \param p_histogram: structure that contain the histogram
+ *                     (this structure must be allocated by the caller)
+ * \return true if the statistics are available, false otherwise
+ *
+ * \libvlc_return_bool
+ * \version LibVLC 4.0.0 or later
+ */
+LIBVLC_API int libvlc_media_get_stats_histogram( libvlc_media_t *p_md,
+                                    libvlc_media_stats_stage_t stage,
+                                    libvlc_media_stats_histogram_t *p_histogram );
+
 /* The following method uses libvlc_media_list_t, however, media_list usage is optionnal
  * and this is here for convenience */
 #define VLC_FORWARD_DECLARE_OBJECT(a) struct a
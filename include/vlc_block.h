@@ -229,6 +229,38 @@ static inline block_t *block_Duplicate( const block_t *p_block )
     return p_dup;
 }
 
+/**
+ * Shares the payload of a block.
+ *
+ * Creates a block that refers to the same payload as the given block,
+ * without copying it. The payload is freed when the last of the blocks that
+ * share it is released. The new block is not chained to any block.
+ *
+ * The payload of shared blocks is read-only. block_TryRealloc() and
+ * block_Realloc() copy it as needed, and block_Writable() must be called
+ * before modifying the payload in place. Only the first of the blocks that
+ * prepend data can do so without copying the payload.
+ *
+ * @return the new block on success, NULL on error.
+ */
+VLC_API block_t *block_Share(block_t *) VLC_USED;
+
+/**
+ * Checks whether the payload of a block is shared with other blocks.
+ */
+VLC_API bool block_IsShared(const block_t *) VLC_USED;
+
+/**
+ * Gets a block whose payload can be modified in place.
+ *
+ * If the payload is shared with other blocks, it is copied into a new block,
+ * and the given block is released. Otherwise, the given block is returned.
+ *
+ * @return the writeable block, or NULL on error (the given block is released
+ * in that case).
+ */
+VLC_API block_t *block_Writable(block_t *) VLC_USED;
+
 /**
  * Wraps heap in a block.
  *
@@ -635,6 +667,91 @@ static inline void vlc_fifo_Cleanup(void *fifo)
 }
 #define vlc_fifo_CleanupPush(fifo) vlc_cleanup_push(vlc_fifo_Cleanup, fifo)
 
+/**
+ * @}
+ * \defgroup block_ring Block ring
+ * Lock-free single-producer single-consumer block queue
+ *
+ * A block ring passes blocks from one thread to another thread without
+ * locking, within a fixed capacity. Only one thread at a time may put blocks
+ * in a given ring, and only one thread at a time may get blocks from it.
+ * Threads only sleep (and need a system call) when the ring is empty or full.
+ * @{
+ */
+
+typedef struct block_ring_t block_ring_t;
+
+/**
+ * Creates a block ring.
+ *
+ * @param max capacity of the ring in blocks (rounded up to a power of two)
+ * @return the ring or NULL on memory error
+ */
+VLC_API block_ring_t *block_RingNew(size_t max) VLC_USED VLC_MALLOC;
+
+/**
+ * Destroys a block ring.
+ *
+ * @note Any queued blocks are also destroyed.
+ * @warning No other threads may be using the ring when this function is
+ * called.
+ */
+VLC_API void block_RingRelease(block_ring_t *);
+
+/**
+ * Queues one block at the end of a ring, if there is room for it.
+ *
+ * This function must only be called from the producer thread.
+ *
+ * @param block a single block (not a chain)
+ * @retval true if the block was queued
+ * @retval false if the ring is full (the block is not queued)
+ */
+VLC_API bool block_RingTryPut(block_ring_t *, block_t *block) VLC_USED;
+
+/**
+ * Queues one block at the end of a ring, waiting for room if necessary.
+ *
+ * This function must only be called from the producer thread.
+ * It is not a cancellation point.
+ *
+ * @param block a single block (not a chain)
+ */
+VLC_API void block_RingPut(block_ring_t *, block_t *block);
+
+/**
+ * Dequeues the first block of a ring, if any.
+ *
+ * This function must only be called from the consumer thread.
+ *
+ * @return the first block or NULL if the ring is empty
+ */
+VLC_API block_t *block_RingTryGet(block_ring_t *) VLC_USED;
+
+/**
+ * Dequeues the first block of a ring, waiting for one if necessary.
+ *
+ * This function must only be called from the consumer thread.
+ * It is (always) a cancellation point.
+ *
+ * @return a valid block
+ */
+VLC_API block_t *block_RingGet(block_ring_t *) VLC_USED;
+
+/**
+ * Counts blocks in a ring.
+ *
+ * This can be called from any thread, but the value is only a snapshot.
+ */
+VLC_API size_t block_RingCount(const block_ring_t *) VLC_USED;
+
+/**
+ * Counts bytes in a ring.
+ *
+ * This can be called from any thread, but the value is only a snapshot.
+ */
+VLC_API size_t block_RingSize(const block_ring_t *) VLC_USED;
+
 /** @} */
 
 /** @} */
@@ -42,6 +42,17 @@
 
 typedef struct decoder_cc_desc_t decoder_cc_desc_t;
 
+/**
+ * Multi-threading mode of a video decoder
+ * \see decoder_UpdateThreads
+ */
+enum vlc_decoder_thread_type
+{
+    VLC_DECODER_THREAD_NONE,  /**< single-threaded */
+    VLC_DECODER_THREAD_FRAME, /**< several frames decoded in parallel */
+    VLC_DECODER_THREAD_SLICE, /**< slices of a frame decoded in parallel */
+};
+
 struct decoder_owner_callbacks
 {
     union
@@ -64,6 +75,11 @@ struct decoder_owner_callbacks
             /* Display rate
              * cf. decoder_GetDisplayRate */
             float       (*get_display_rate)( decoder_t * );
+            /* Multi-threading mode
+             * cf. decoder_UpdateThreads */
+            void        (*threads_update)( decoder_t *,
+                                           enum vlc_decoder_thread_type,
+                                           unsigned );
         } video;
         struct
         {
@@ -463,6 +479,21 @@ static inline float decoder_GetDisplayRate( decoder_t *dec )
     return dec->cbs->video.get_display_rate( dec );
 }
 
+/**
+ * This function notifies the owner of the multi-threading mode used by the
+ * decoder module, and of its number of threads.
+ * It is used for statistics only.
+ */
+static inline void decoder_UpdateThreads( decoder_t *dec,
+                                          enum vlc_decoder_thread_type type,
+                                          unsigned count )
+{
+    vlc_assert( dec->fmt_in.i_cat == VIDEO_ES && dec->cbs != NULL );
+
+    if( dec->cbs->video.threads_update != NULL )
+        dec->cbs->video.threads_update( dec, type, count );
+}
+
 /** @} */
 /** @} */
 #endif /* _VLC_CODEC_H */
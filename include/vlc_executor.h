@@ -0,0 +1,154 @@
+/*****************************************************************************
+ * vlc_executor.h: thread pool
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_EXECUTOR_H
+#define VLC_EXECUTOR_H
+
+#include <vlc_list.h>
+
+/**
+ * @defgroup executor Thread pool
+ * @ingroup thread
+ * @{
+ * @file
+ * This file declares a work-stealing thread pool.
+ *
+ * Runnables submitted to an executor are spread over its threads. A thread
+ * which runs out of work steals pending runnables from the other threads, so
+ * that the pool keeps all its threads busy without a single contended queue.
+ *
+ * Each runnable executes with its own interruption context (see
+ * vlc_interrupt_set()), so that it can be aborted by vlc_executor_Cancel()
+ * while it is blocked in an interruptible call.
+ */
+
+typedef struct vlc_executor vlc_executor_t;
+
+/** Default runnable priority */
+#define VLC_EXECUTOR_PRIORITY_NORMAL 0
+/** Priority for work a user is waiting for (thumbnails, etc.) */
+#define VLC_EXECUTOR_PRIORITY_HIGH   10
+/** Priority for background work (preparsing, art fetching, etc.) */
+#define VLC_EXECUTOR_PRIORITY_LOW  (-10)
+
+/**
+ * A unit of work for an executor.
+ *
+ * The structure is owned by the caller, and must remain valid until the
+ * run() callback returns or the runnable is cancelled successfully.
+ */
+struct vlc_runnable
+{
+    /**
+     * Executes the work.
+     *
+     * This is called from one of the executor threads, with an interruption
+     * context of its own.
+     *
+     * \param userdata the userdata field of the runnable
+     */
+    void (*run)(void *userdata);
+    void *userdata;
+
+    /**
+     * Pending runnables of higher priority are executed first.
+     */
+    int priority;
+
+    /* Private to the executor */
+    struct vlc_list node;
+    uint64_t id;
+};
+
+/**
+ * Creates a new executor.
+ *
+ * No threads are started until runnables are submitted. A thread is started
+ * whenever a runnable is submitted while all the started threads are busy,
+ * up to the maximum.
+ *
+ * \param max_threads maximum number of threads of the pool (must be positive)
+ * \param priority scheduling priority of the threads
+ *                 (VLC_THREAD_PRIORITY_*, see vlc_clone())
+ * \return the executor on success, NULL on error
+ */
+VLC_API vlc_executor_t *vlc_executor_New(unsigned max_threads, int priority);
+
+/**
+ * Deletes an executor.
+ *
+ * This waits for the running runnables to complete and joins the threads.
+ *
+ * \warning All submitted runnables must have completed or been cancelled.
+ */
+VLC_API void vlc_executor_Delete(vlc_executor_t *executor);
+
+/**
+ * Gets the process-wide executor.
+ *
+ * The shared executor has up to one thread per CPU, running at output priority
+ * (VLC_THREAD_PRIORITY_OUTPUT). It is meant for short audio and video
+ * processing work: runnables which wait for long, for instance for I/O,
+ * must use an executor of their own.
+ *
+ * It is created on first use, and deleted when the last reference is
+ * released with vlc_executor_Release().
+ *
+ * \return the executor on success, NULL on error
+ */
+VLC_API vlc_executor_t *vlc_executor_Hold(void);
+
+/**
+ * Releases a reference to the process-wide executor.
+ *
+ * \param executor the executor returned by vlc_executor_Hold()
+ */
+VLC_API void vlc_executor_Release(vlc_executor_t *executor);
+
+/**
+ * Submits a runnable for execution.
+ *
+ * \param executor the executor
+ * \param runnable the runnable to execute
+ */
+VLC_API void vlc_executor_Submit(vlc_executor_t *executor,
+                                 struct vlc_runnable *runnable);
+
+/**
+ * Cancels a runnable.
+ *
+ * If the runnable is still pending, it is removed from the executor and will
+ * never be executed. If it is running, its interruption context is killed
+ * (see vlc_interrupt_kill()), and it is up to the run() callback to return
+ * early.
+ *
+ * \param executor the executor
+ * \param runnable the runnable to cancel
+ * The runnable is identified by its submission, not only by its address:
+ * a runnable reusing the memory of a completed one is not mistaken for it.
+ *
+ * \retval true if the runnable was pending and has been removed
+ * \retval false if the runnable is running or has already completed
+ */
+VLC_API bool vlc_executor_Cancel(vlc_executor_t *executor,
+                                 struct vlc_runnable *runnable);
+
+/** @} */
+#endif
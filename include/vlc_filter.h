@@ -279,6 +279,68 @@ VLC_API int filter_Blend( filter_t *, picture_t *p_dst, int i_dst_x, int i_dst_y
  */
 VLC_API void filter_DeleteBlend( filter_t * );
 
+struct vlc_executor;
+
+/** Maximum number of slices run by filter_RunSlices() */
+#define FILTER_SLICES_MAX 16
+
+/**
+ * Slice callback for filter_RunSlices().
+ *
+ * \param opaque the opaque pointer given to filter_RunSlices()
+ * \param slice index of the slice to process
+ * \param slices total number of slices
+ */
+typedef void (*filter_slice_cb)(void *opaque, unsigned slice, unsigned slices);
+
+/**
+ * Processes a picture in horizontal bands, in parallel.
+ *
+ * The picture is split in up to one slice per CPU, of at least min_lines
+ * lines each. Some slices are run on the executor threads, and the others on
+ * the calling thread. This function returns once all the slices have been
+ * processed.
+ *
+ * A slice callback may read anything from the source pictures, including
+ * the lines surrounding its band, but it must only write to the lines of the
+ * destination picture within its band (see filter_GetSliceLines()).
+ *
+ * \param executor executor to run the slices on, or NULL to run them all
+ *                 on the calling thread
+ * \param lines number of lines of the picture (of the first plane)
+ * \param min_lines minimum number of lines per slice
+ * \param cb callback processing one slice
+ * \param opaque data pointer for the callback
+ */
+VLC_API void filter_RunSlices( struct vlc_executor *executor, unsigned lines,
+                               unsigned min_lines, filter_slice_cb cb,
+                               void *opaque );
+
+/**
+ * Computes the band of a slice within a plane.
+ *
+ * Consecutive slices get contiguous bands, which cover the whole plane. Each
+ * band starts on a multiple of the alignment, so that blocks of lines (or
+ * pairs of fields) are never split between two slices.
+ *
+ * \param lines number of lines of the plane
+ * \param align line alignment of the bands (must be positive)
+ * \param slice index of the slice
+ * \param slices total number of slices
+ * \param first first line of the band [OUT]
+ * \param end line after the last line of the band [OUT]
+ */
+static inline void filter_GetSliceLines( unsigned lines, unsigned align,
+                                         unsigned slice, unsigned slices,
+                                         unsigned *first, unsigned *end )
+{
+    unsigned units = (lines + align - 1) / align;
+
+    *first = __MIN(lines, align * (units * slice / slices));
+    *end = (slice + 1 == slices)
+         ? lines : __MIN(lines, align * (units * (slice + 1) / slices));
+}
+
 /**
  * Create a picture_t *(*)( filter_t *, picture_t * ) compatible wrapper
  * using a void (*)( filter_t *, picture_t *, picture_t * ) function
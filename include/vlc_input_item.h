@@ -412,6 +412,65 @@ VLC_API void libvlc_MetadataCancel( libvlc_int_t *, void * );
 /******************
  * Input stats
  ******************/
+
+/**
+ * Stages of the playback pipeline measured by the input statistics
+ */
+enum input_stats_stage
+{
+    INPUT_STATS_DEMUX_TIME, /**< duration of each demux_Demux() call */
+    INPUT_STATS_DECODER_FIFO_DEPTH, /**< blocks queued when one is dequeued */
+    INPUT_STATS_DECODER_WAIT_TIME, /**< wait for each block to decode */
+    INPUT_STATS_DECODE_TIME, /**< duration of the decoding of each block */
+    INPUT_STATS_VOUT_PREPARE_PICTURE_TIME, /**< fetching and filtering of each
+                                                decoded picture */
+    INPUT_STATS_VOUT_RENDER_TIME, /**< rendering of the subpictures and
+                                       conversion of each picture */
+    INPUT_STATS_VOUT_PREPARE_TIME, /**< preparation by the display */
+    INPUT_STATS_VOUT_DISPLAY_TIME, /**< display by the display */
+    INPUT_STATS_AOUT_LATENCY, /**< audio buffered in the output */
+#define INPUT_STATS_STAGE_COUNT (INPUT_STATS_AOUT_LATENCY + 1)
+};
+
+#define INPUT_STATS_HISTOGRAM_BUCKETS 24
+
+/**
+ * Distribution of the values measured at a stage of the pipeline
+ *
+ * Durations are in microseconds. The bucket 0 counts the null values, the
+ * bucket i the values from 2^(i-1) to 2^i - 1, and the last bucket also
+ * counts all the larger values.
+ */
+typedef struct
+{
+    uint64_t i_count; /**< number of values */
+    uint64_t i_total; /**< sum of the values */
+    uint64_t i_max;   /**< largest value */
+    uint64_t buckets[INPUT_STATS_HISTOGRAM_BUCKETS];
+} input_stats_histogram_t;
+
+/**
+ * Estimates a quantile of a histogram.
+ *
+ * \param q quantile, between 0 and 1 (e.g. 0.99 for the 99th percentile)
+ * \return an upper bound of the quantile, within a factor of 2
+ */
+VLC_USED
+static inline uint64_t
+input_stats_histogram_Quantile(const input_stats_histogram_t *h, double q)
+{
+    uint64_t rank = (uint64_t)(q * h->i_count);
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        seen += h->buckets[i];
+        if (seen > rank)
+            return __MIN((UINT64_C(1) << i) - 1, h->i_max);
+    }
+    return h->i_max;
+}
+
 struct input_stats_t
 {
     /* Input */
@@ -437,6 +496,13 @@ struct input_stats_t
     /* Aout */
     int64_t i_played_abuffers;
     int64_t i_lost_abuffers;
+
+    /* Video decoders */
+    int64_t i_video_frame_threads; /* threads of frame-threaded decoders */
+    int64_t i_video_slice_threads; /* threads of slice-threaded decoders */
+
+    /* Pipeline stages, cf. enum input_stats_stage */
+    input_stats_histogram_t stages[INPUT_STATS_STAGE_COUNT];
 };
 
 /**
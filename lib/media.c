@@ -108,6 +108,19 @@ static const libvlc_meta_t vlc_to_libvlc_meta[] =
     [vlc_meta_DiscTotal]    = libvlc_meta_DiscTotal
 };
 
+static_assert(
+    INPUT_STATS_DEMUX_TIME == (int) libvlc_media_stats_demux_time &&
+    INPUT_STATS_DECODER_FIFO_DEPTH == (int) libvlc_media_stats_decoder_fifo_depth &&
+    INPUT_STATS_DECODER_WAIT_TIME == (int) libvlc_media_stats_decoder_wait_time &&
+    INPUT_STATS_DECODE_TIME == (int) libvlc_media_stats_decode_time &&
+    INPUT_STATS_VOUT_PREPARE_PICTURE_TIME == (int) libvlc_media_stats_vout_prepare_picture_time &&
+    INPUT_STATS_VOUT_RENDER_TIME == (int) libvlc_media_stats_vout_render_time &&
+    INPUT_STATS_VOUT_PREPARE_TIME == (int) libvlc_media_stats_vout_prepare_time &&
+    INPUT_STATS_VOUT_DISPLAY_TIME == (int) libvlc_media_stats_vout_display_time &&
+    INPUT_STATS_AOUT_LATENCY == (int) libvlc_media_stats_aout_latency &&
+    INPUT_STATS_HISTOGRAM_BUCKETS == LIBVLC_MEDIA_STATS_HISTOGRAM_BUCKETS,
+    "Mismatch between libvlc_media_stats_stage_t and input_stats_stage" );
+
 static_assert(
     ORIENT_TOP_LEFT     == (int) libvlc_video_orient_top_left &&
     ORIENT_TOP_RIGHT    == (int) libvlc_video_orient_top_right &&
@@ -725,6 +738,8 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
 
     p_stats->i_decoded_video = p_itm_stats->i_decoded_video;
     p_stats->i_decoded_audio = p_itm_stats->i_decoded_audio;
+    p_stats->i_video_frame_threads = p_itm_stats->i_video_frame_threads;
+    p_stats->i_video_slice_threads = p_itm_stats->i_video_slice_threads;
 
     p_stats->i_displayed_pictures = p_itm_stats->i_displayed_pictures;
     p_stats->i_lost_pictures = p_itm_stats->i_lost_pictures;
@@ -740,6 +755,35 @@ int libvlc_media_get_stats( libvlc_media_t *p_md,
     return true;
 }
 
+int libvlc_media_get_stats_histogram( libvlc_media_t *p_md,
+                                      libvlc_media_stats_stage_t stage,
+                                      libvlc_media_stats_histogram_t *p_histogram )
+{
+    input_item_t *item = p_md->p_input_item;
+
+    if( item == NULL || (unsigned)stage >= INPUT_STATS_STAGE_COUNT )
+        return false;
+
+    vlc_mutex_lock( &item->lock );
+
+    input_stats_t *p_itm_stats = item->p_stats;
+    if( p_itm_stats == NULL )
+    {
+        vlc_mutex_unlock( &item->lock );
+        return false;
+    }
+
+    const input_stats_histogram_t *h = &p_itm_stats->stages[stage];
+
+    p_histogram->i_count = h->i_count;
+    p_histogram->i_total = h->i_total;
+    p_histogram->i_max = h->i_max;
+    memcpy( p_histogram->buckets, h->buckets, sizeof (h->buckets) );
+
+    vlc_mutex_unlock( &item->lock );
+    return true;
+}
+
 /**************************************************************************
  * event_manager
  **************************************************************************/
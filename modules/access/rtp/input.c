@@ -46,6 +46,20 @@
 
 #define DEFAULT_MRU (1500u - (20 + 8))
 
+#ifdef HAVE_RECVMMSG
+/* Maximum number of datagrams received per system call */
+# define VLEN 32
+
+static void rtp_dgram_cleanup (void *data)
+{
+    block_t **ring = data;
+
+    for (size_t i = 0; i < VLEN; i++)
+        if (ring[i] != NULL)
+            block_Release (ring[i]);
+}
+#endif
+
 /**
  * Processes a packet received from the RTP socket.
  */
@@ -119,16 +133,24 @@ void *rtp_dgram_thread (void *opaque)
     {
         .iov_len = DEFAULT_MRU,
     };
+#ifndef HAVE_RECVMMSG
     struct msghdr msg =
     {
         .msg_iov = &iov,
         .msg_iovlen = 1,
     };
+#endif
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+#ifdef HAVE_RECVMMSG
+    /* Receive buffers, reallocated only once handed out */
+    block_t *ring[VLEN] = { NULL };
+
+    vlc_cleanup_push (rtp_dgram_cleanup, ring);
+#endif
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -145,6 +167,65 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
+#ifdef HAVE_RECVMMSG
+            struct mmsghdr msgs[VLEN];
+            struct iovec iovecs[VLEN];
+            unsigned count = 0;
+
+            for (; count < VLEN; count++)
+            {
+                if (ring[count] != NULL && ring[count]->i_buffer < iov.iov_len)
+                {   /* MRU was increased */
+                    block_Release (ring[count]);
+                    ring[count] = NULL;
+                }
+                if (ring[count] == NULL)
+                {
+                    ring[count] = block_Alloc (iov.iov_len);
+                    if (unlikely(ring[count] == NULL))
+                        break;
+                }
+
+                iovecs[count].iov_base = ring[count]->p_buffer;
+                iovecs[count].iov_len = iov.iov_len;
+                memset (&msgs[count], 0, sizeof (msgs[count]));
+                msgs[count].msg_hdr.msg_iov = &iovecs[count];
+                msgs[count].msg_hdr.msg_iovlen = 1;
+            }
+
+            if (unlikely(count == 0))
+            {
+                if (iov.iov_len == DEFAULT_MRU)
+                    break; /* we are totallly screwed */
+                iov.iov_len = DEFAULT_MRU;
+                continue; /* retry with shrunk MRU */
+            }
+
+            int recvd = recvmmsg (rtp_fd, msgs, count,
+                                  MSG_DONTWAIT | trunc_flag, NULL);
+            if (recvd == -1 && errno != EAGAIN && errno != EWOULDBLOCK)
+                msg_Warn (demux, "RTP network error: %s",
+                          vlc_strerror_c(errno));
+
+            for (int i = 0; i < recvd; i++)
+            {
+                block_t *block = ring[i];
+                size_t len = msgs[i].msg_len;
+
+                ring[i] = NULL;
+                if (msgs[i].msg_hdr.msg_flags & trunc_flag)
+                {
+                    msg_Err(demux, "%zu bytes packet truncated (MRU was %zu)",
+                            len, iov.iov_len);
+                    block->i_flags |= BLOCK_FLAG_CORRUPTED;
+                    iov.iov_len = len;
+                }
+                else
+                    block->i_buffer = len;
+
+                rtp_process (demux, block);
+            }
+#else
             block_t *block = block_Alloc (iov.iov_len);
             if (unlikely(block == NULL))
             {
@@ -178,6 +259,7 @@ void *rtp_dgram_thread (void *opaque)
                           vlc_strerror_c(errno));
                 block_Release (block);
             }
+#endif
         }
 
     dequeue:
@@ -185,6 +267,10 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TICK_INVALID;
         vlc_restorecancel (canc);
     }
+#ifdef HAVE_RECVMMSG
+    vlc_cleanup_pop ();
+    rtp_dgram_cleanup (ring);
+#endif
     return NULL;
 }
 
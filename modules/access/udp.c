@@ -75,12 +75,23 @@ vlc_module_begin ()
     set_callbacks( Open, Close )
 vlc_module_end ()
 
+#ifdef HAVE_RECVMMSG
+/* Maximum number of datagrams received per system call */
+# define VLEN 32
+#endif
+
 typedef struct
 {
     int fd;
     int timeout;
     size_t mtu;
+#ifdef HAVE_RECVMMSG
+    block_t *ring[VLEN]; /* receive buffers */
+    block_t *overflow[VLEN]; /* overflow buffers of each receive buffer */
+    block_t *queue; /* received datagrams not returned yet */
+#else
     block_t *overflow_block;
+#endif
 } access_sys_t;
 
 /*****************************************************************************
@@ -106,12 +117,22 @@ static int Open( vlc_object_t *p_this )
 
     sys->mtu = 7 * 188;
 
+#ifdef HAVE_RECVMMSG
+    /* The overflow buffers are allocated along with the receive buffers */
+    for (size_t i = 0; i < VLEN; i++)
+    {
+        sys->ring[i] = NULL;
+        sys->overflow[i] = NULL;
+    }
+    sys->queue = NULL;
+#else
     /* Overflow can be max theoretical datagram content less anticipated MTU,
      *  IPv6 headers are larger than IPv4, ignore IPv6 jumbograms
      */
     sys->overflow_block = block_Alloc(65507 - sys->mtu);
     if( unlikely( sys->overflow_block == NULL ) )
         return VLC_ENOMEM;
+#endif
 
     p_access->p_sys = sys;
 
@@ -191,8 +212,19 @@ static void Close( vlc_object_t *p_this )
 {
     stream_t     *p_access = (stream_t*)p_this;
     access_sys_t *sys = p_access->p_sys;
+#ifdef HAVE_RECVMMSG
+    for( size_t i = 0; i < VLEN; i++ )
+    {
+        if( sys->ring[i] != NULL )
+            block_Release( sys->ring[i] );
+        if( sys->overflow[i] != NULL )
+            block_Release( sys->overflow[i] );
+    }
+    block_ChainRelease( sys->queue );
+#else
     if( sys->overflow_block )
         block_Release( sys->overflow_block );
+#endif
 
     net_Close( sys->fd );
 }
@@ -225,6 +257,112 @@ static int Control( stream_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * RecvBatchUDP: receives up to VLEN datagrams at once
+ *****************************************************************************/
+static block_t *RecvBatchUDP(stream_t *access)
+{
+    access_sys_t *sys = access->p_sys;
+    struct mmsghdr msgs[VLEN];
+    struct iovec iovecs[VLEN][2];
+    const size_t mtu = sys->mtu;
+    unsigned count = 0;
+
+    /* Refill the receive buffers that were handed out. Each one spills into
+     * its own overflow buffer, so that no datagram of the batch gets truncated
+     * (see BlockUDP()). */
+    for (; count < VLEN; count++)
+    {
+        block_t *pkt = sys->ring[count];
+        block_t *overflow = sys->overflow[count];
+
+        if (pkt != NULL && pkt->i_buffer < mtu)
+        {   /* MTU was increased */
+            block_Release(pkt);
+            pkt = NULL;
+        }
+        if (pkt == NULL)
+        {
+            pkt = block_Alloc(mtu);
+            sys->ring[count] = pkt;
+            if (unlikely(pkt == NULL))
+                break;
+        }
+        if (overflow == NULL)
+        {
+            overflow = block_Alloc(65507 - mtu);
+            sys->overflow[count] = overflow;
+            if (unlikely(overflow == NULL))
+                break;
+        }
+
+        iovecs[count][0].iov_base = pkt->p_buffer;
+        iovecs[count][0].iov_len = mtu;
+        iovecs[count][1].iov_base = overflow->p_buffer;
+        iovecs[count][1].iov_len = 65507 - mtu;
+        memset(&msgs[count], 0, sizeof (msgs[count]));
+        msgs[count].msg_hdr.msg_iov = iovecs[count];
+        msgs[count].msg_hdr.msg_iovlen = 2;
+    }
+
+    if (unlikely(count == 0))
+    {   /* OOM - dequeue and discard one packet */
+        char dummy;
+        recv(sys->fd, &dummy, 1, 0);
+        return NULL;
+    }
+
+    int n = recvmmsg(sys->fd, msgs, count, MSG_DONTWAIT, NULL);
+    if (n <= 0)
+        return NULL;
+
+    block_t *chain = NULL, **pp = &chain;
+
+    for (int i = 0; i < n; i++)
+    {
+        block_t *pkt = sys->ring[i];
+        size_t len = msgs[i].msg_len;
+
+        sys->ring[i] = NULL;
+
+        if (unlikely(msgs[i].msg_hdr.msg_flags & MSG_TRUNC))
+        {   /* IPv6 jumbogram */
+            msg_Warn(access, "truncated packet received, dropped");
+            block_Release(pkt);
+            continue;
+        }
+
+        /* See BlockUDP() */
+        if (unlikely(len > mtu))
+        {
+            msg_Warn(access, "%zu bytes packet received (MTU was %zu), "
+                     "adjusting mtu", len, mtu);
+            block_t *gather_block = sys->overflow[i];
+
+            sys->overflow[i] = NULL;
+
+            gather_block->i_buffer = len - mtu;
+            pkt->i_buffer = mtu;
+            pkt->p_next = gather_block;
+            pkt = block_ChainGather(pkt);
+            if (unlikely(pkt == NULL))
+                continue;
+
+            if (len > sys->mtu)
+                sys->mtu = len;
+        }
+        else
+            pkt->i_buffer = len;
+
+        *pp = pkt;
+        pp = &pkt->p_next;
+    }
+
+    return chain;
+}
+#endif
+
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
@@ -232,6 +370,35 @@ static block_t *BlockUDP(stream_t *access, bool *restrict eof)
 {
     access_sys_t *sys = access->p_sys;
 
+#ifdef HAVE_RECVMMSG
+    /* Return datagrams from the previous batch first */
+    if (sys->queue == NULL)
+    {
+        struct pollfd ufd[1];
+
+        ufd[0].fd = sys->fd;
+        ufd[0].events = POLLIN;
+
+        switch (vlc_poll_i11e(ufd, 1, sys->timeout))
+        {
+            case 0:
+                msg_Err(access, "receive time-out");
+                *eof = true;
+                /* fall through */
+            case -1:
+                return NULL;
+        }
+
+        sys->queue = RecvBatchUDP(access);
+        if (sys->queue == NULL)
+            return NULL;
+    }
+
+    block_t *pkt = sys->queue;
+    sys->queue = pkt->p_next;
+    pkt->p_next = NULL;
+    return pkt;
+#else
     block_t *pkt = block_Alloc(sys->mtu);
     if (unlikely(pkt == NULL))
     {   /* OOM - dequeue and discard one packet */
@@ -299,4 +466,5 @@ skip:
         pkt->i_buffer = len;
 
     return pkt;
+#endif
 }
@@ -50,6 +50,9 @@
 
 #define MAX_EMPTY_BLOCKS 200
 
+/* Maximum number of packets sent at once */
+#define MAX_BATCH_PACKETS 64
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -70,6 +73,11 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_("Packets due within this time window are sent " \
+                          "together, with a single system call where " \
+                          "supported. 0 sends packets one by one." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -78,6 +86,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "batch", 0, BATCH_TEXT, BATCH_LONGTEXT,
+                                 true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -91,6 +101,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
     NULL
 };
 
@@ -114,13 +125,15 @@ typedef struct
     bool          b_mtu_warning;
     size_t        i_mtu;
 
-    block_fifo_t *p_fifo;
+    block_ring_t *p_ring;
     block_t      *p_buffer;
 
     vlc_thread_t  thread;
 } sout_access_out_sys_t;
 
 #define DEFAULT_PORT 1234
+/* Packets queued for the sending thread, at most */
+#define RING_PACKETS 32768
 
 /*****************************************************************************
  * Open: open the file
@@ -206,14 +219,21 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_handle = i_handle;
     p_sys->i_mtu = var_CreateGetInteger( p_this, "mtu" );
     p_sys->b_mtu_warning = false;
-    p_sys->p_fifo = block_FifoNew();
+    p_sys->p_ring = block_RingNew( RING_PACKETS );
     p_sys->p_buffer = NULL;
 
+    if( unlikely(p_sys->p_ring == NULL) )
+    {
+        net_Close (i_handle);
+        free (p_sys);
+        return VLC_ENOMEM;
+    }
+
     if( vlc_clone( &p_sys->thread, ThreadWrite, p_access,
                            VLC_THREAD_PRIORITY_HIGHEST ) )
     {
         msg_Err( p_access, "cannot spawn sout access thread" );
-        block_FifoRelease( p_sys->p_fifo );
+        block_RingRelease( p_sys->p_ring );
         net_Close (i_handle);
         free (p_sys);
         return VLC_EGENERIC;
@@ -235,7 +255,7 @@ static void Close( vlc_object_t * p_this )
 
     vlc_cancel( p_sys->thread );
     vlc_join( p_sys->thread, NULL );
-    block_FifoRelease( p_sys->p_fifo );
+    block_RingRelease( p_sys->p_ring );
 
     if( p_sys->p_buffer ) block_Release( p_sys->p_buffer );
 
@@ -290,7 +310,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                          now - p_sys->p_buffer->i_dts
                           - p_sys->i_caching );
             }
-            block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+            block_RingPut( p_sys->p_ring, p_sys->p_buffer );
             p_sys->p_buffer = NULL;
         }
 
@@ -332,7 +352,7 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
                              vlc_tick_now() - p_sys->p_buffer->i_dts
                               - p_sys->i_caching );
                 }
-                block_FifoPut( p_sys->p_fifo, p_sys->p_buffer );
+                block_RingPut( p_sys->p_ring, p_sys->p_buffer );
                 p_sys->p_buffer = NULL;
             }
         }
@@ -345,6 +365,67 @@ static ssize_t Write( sout_access_out_t *p_access, block_t *p_buffer )
     return i_len;
 }
 
+/*****************************************************************************
+ * SendPackets: send a batch of packets and release them
+ *****************************************************************************/
+typedef struct
+{
+    block_t  *pp_blocks[MAX_BATCH_PACKETS];
+    unsigned  i_count;
+} udp_batch_t;
+
+static void SendPackets( sout_access_out_t *p_access, udp_batch_t *p_batch )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    const unsigned i_count = p_batch->i_count;
+
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msgs[MAX_BATCH_PACKETS];
+    struct iovec iovecs[MAX_BATCH_PACKETS];
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iovecs[i].iov_base = p_batch->pp_blocks[i]->p_buffer;
+        iovecs[i].iov_len = p_batch->pp_blocks[i]->i_buffer;
+        memset( &msgs[i], 0, sizeof(msgs[i]) );
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i_sent = 0; i_sent < i_count; )
+    {
+        int val = sendmmsg( p_sys->i_handle, &msgs[i_sent],
+                            i_count - i_sent, 0 );
+        if( val == -1 )
+        {
+            /* Skip the failing packet */
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+            val = 1;
+        }
+        i_sent += val;
+    }
+#else
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        block_t *p_pk = p_batch->pp_blocks[i];
+        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
+            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
+    }
+#endif
+
+    for( unsigned i = 0; i < i_count; i++ )
+        block_Release( p_batch->pp_blocks[i] );
+    p_batch->i_count = 0;
+}
+
+static void BatchCleanup( void *data )
+{
+    udp_batch_t *p_batch = data;
+
+    for( unsigned i = 0; i < p_batch->i_count; i++ )
+        block_Release( p_batch->pp_blocks[i] );
+}
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -355,15 +436,32 @@ static void* ThreadWrite( void *data )
     vlc_tick_t i_date_last = -1;
     const unsigned i_group = var_GetInteger( p_access,
                                              SOUT_CFG_PREFIX "group" );
+    const vlc_tick_t i_window = VLC_TICK_FROM_MS(
+                     var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" ) );
     int i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+    vlc_tick_t i_date_waited = VLC_TICK_INVALID;
+    udp_batch_t batch = { .i_count = 0 };
 
+    vlc_cleanup_push( BatchCleanup, &batch );
     for (;;)
     {
-        block_t *p_pk = block_FifoGet( p_sys->p_fifo );
+        /* Do not hold back packets when nothing follows */
+        if( batch.i_count > 0 )
+        {
+            if( block_RingCount( p_sys->p_ring ) == 0 )
+                SendPackets( p_access, &batch );
+        }
+
+        block_t *p_pk = block_RingGet( p_sys->p_ring );
         vlc_tick_t    i_date;
 
         i_date = p_sys->i_caching + p_pk->i_dts;
+
+        /* Timestamps went backwards: the last wait no longer paces anything */
+        if( i_date_waited != VLC_TICK_INVALID && i_date < i_date_waited )
+            i_date_waited = VLC_TICK_INVALID;
+
         if( i_date_last > 0 )
         {
             if( i_date - i_date_last > VLC_TICK_FROM_SEC(2) )
@@ -390,13 +488,24 @@ static void* ThreadWrite( void *data )
         i_to_send--;
         if( !i_to_send || (p_pk->i_flags & BLOCK_FLAG_CLOCK) )
         {
-            vlc_tick_wait( i_date );
+            /* Packets due within the window of the last wait are sent
+             * along, as other packets of a group already are */
+            if( i_date_waited == VLC_TICK_INVALID ||
+                i_date > i_date_waited + i_window )
+            {
+                if( batch.i_count > 0 )
+                    SendPackets( p_access, &batch );
+                vlc_tick_wait( i_date );
+                i_date_waited = i_date;
+            }
             i_to_send = i_group;
         }
-        if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
-            msg_Warn( p_access, "send error: %s", vlc_strerror_c(errno) );
         vlc_cleanup_pop();
 
+        batch.pp_blocks[batch.i_count++] = p_pk;
+        if( i_window == 0 || batch.i_count == MAX_BATCH_PACKETS )
+            SendPackets( p_access, &batch );
+
         if( i_dropped_packets )
         {
             msg_Dbg( p_access, "dropped %i packets", i_dropped_packets );
@@ -413,9 +522,7 @@ static void* ThreadWrite( void *data )
                      i_date );
         }
 #endif
-
-        block_Release( p_pk );
-
     }
+    vlc_cleanup_pop();
     return NULL;
 }
@@ -29,18 +29,21 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_charset.h>
+#include <vlc_cpu.h>
+#include <vlc_executor.h>
 
 #include <vlc_aout.h>
 #include <vlc_filter.h>
 
 #include "equalizer_presets.h"
+#include "equalizer_simd.h"
 
 /* TODO:
- *  - optimize a bit (you can hardly do slower ;)
  *  - add tables for more bands (15 and 32 would be cool), maybe with auto coeffs
  *    computation (not too hard once the Q is found).
  *  - support for external preset
@@ -100,33 +103,25 @@ vlc_module_end ()
 /*****************************************************************************
  * Local prototypes
  *****************************************************************************/
-typedef struct
-{
-    /* Filter static config */
-    int i_band;
-    float *f_alpha;
-    float *f_beta;
-    float *f_gamma;
 
-    /* Filter dyn config */
-    float *f_amp;   /* Per band amp */
-    float f_gamp;   /* Global preamp */
-    bool b_2eqz;
+/* Minimum buffer length to filter groups of channels in parallel */
+#define EQZ_PARALLEL_SAMPLES 256
 
-    /* Filter state */
-    float x[32][2];
-    float y[32][128][2];
+typedef struct
+{
+    eqz_state_t eqz;
+    eqz_filter_group_t filter;
 
-    /* Second filter state */
-    float x2[32][2];
-    float y2[32][128][2];
+    /* Parallel filtering */
+    vlc_executor_t *executor;
+    float *scratch;
+    size_t scratch_size;
 
     vlc_mutex_t lock;
 } filter_sys_t;
 
 static block_t *DoWork( filter_t *, block_t * );
 
-#define EQZ_IN_FACTOR (0.25f)
 static int  EqzInit( filter_t *, int );
 static void EqzFilter( filter_t *, float *, float *, int, int );
 static void EqzClean( filter_t * );
@@ -148,6 +143,10 @@ static int TwoPassCallback( vlc_object_t *, char const *, vlc_value_t,
 static int Open( vlc_object_t *p_this )
 {
     filter_t     *p_filter = (filter_t *)p_this;
+    unsigned i_channels = aout_FormatNbChannels( &p_filter->fmt_in.audio );
+
+    if( i_channels > EQZ_CHANNELS_MAX )
+        return VLC_EGENERIC;
 
     /* Allocate structure */
     filter_sys_t *p_sys = p_filter->p_sys = malloc( sizeof( *p_sys ) );
@@ -162,6 +161,21 @@ static int Open( vlc_object_t *p_this )
         return VLC_EGENERIC;
     }
 
+    p_sys->filter = EqzGetFilterGroup();
+
+    /* Groups of channels are independent: filter them on several threads if
+     * there are enough of them. The calling thread filters groups too, and
+     * may wait for the other threads, so they run at the audio priority. */
+    const unsigned i_groups = ( i_channels + EQZ_LANES - 1 ) / EQZ_LANES;
+    const unsigned i_threads = __MIN( i_groups, vlc_GetCPUCount() );
+
+    p_sys->executor = NULL;
+    if( i_threads > 1 )
+        p_sys->executor = vlc_executor_New( i_threads - 1,
+                                            VLC_THREAD_PRIORITY_AUDIO );
+    p_sys->scratch = NULL;
+    p_sys->scratch_size = 0;
+
     p_filter->fmt_in.audio.i_format = VLC_CODEC_FL32;
     aout_FormatPrepare(&p_filter->fmt_in.audio);
     p_filter->fmt_out.audio = p_filter->fmt_in.audio;
@@ -179,6 +193,9 @@ static void Close( vlc_object_t *p_this )
     filter_sys_t *p_sys = p_filter->p_sys;
 
     EqzClean( p_filter );
+    if( p_sys->executor != NULL )
+        vlc_executor_Delete( p_sys->executor );
+    free( p_sys->scratch );
     vlc_mutex_destroy( &p_sys->lock );
     free( p_sys );
 }
@@ -289,53 +306,53 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     EqzCoeffs( i_rate, 1.0f, b_vlcFreqs, &cfg );
 
     /* Create the static filter config */
-    p_sys->i_band = cfg.i_band;
-    p_sys->f_alpha = vlc_alloc( p_sys->i_band, sizeof(float) );
-    p_sys->f_beta  = vlc_alloc( p_sys->i_band, sizeof(float) );
-    p_sys->f_gamma = vlc_alloc( p_sys->i_band, sizeof(float) );
-    if( !p_sys->f_alpha || !p_sys->f_beta || !p_sys->f_gamma )
+    p_sys->eqz.i_band = cfg.i_band;
+    p_sys->eqz.f_alpha = vlc_alloc( p_sys->eqz.i_band, sizeof(float) );
+    p_sys->eqz.f_beta  = vlc_alloc( p_sys->eqz.i_band, sizeof(float) );
+    p_sys->eqz.f_gamma = vlc_alloc( p_sys->eqz.i_band, sizeof(float) );
+    if( !p_sys->eqz.f_alpha || !p_sys->eqz.f_beta || !p_sys->eqz.f_gamma )
         goto error;
 
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < p_sys->eqz.i_band; i++ )
     {
-        p_sys->f_alpha[i] = cfg.band[i].f_alpha;
-        p_sys->f_beta[i]  = cfg.band[i].f_beta;
-        p_sys->f_gamma[i] = cfg.band[i].f_gamma;
+        p_sys->eqz.f_alpha[i] = cfg.band[i].f_alpha;
+        p_sys->eqz.f_beta[i]  = cfg.band[i].f_beta;
+        p_sys->eqz.f_gamma[i] = cfg.band[i].f_gamma;
     }
 
     /* Filter dyn config */
-    p_sys->b_2eqz = false;
-    p_sys->f_gamp = 1.0f;
-    p_sys->f_amp  = vlc_alloc( p_sys->i_band, sizeof(float) );
-    if( !p_sys->f_amp )
+    p_sys->eqz.b_2eqz = false;
+    p_sys->eqz.f_gamp = 1.0f;
+    p_sys->eqz.f_amp  = vlc_alloc( p_sys->eqz.i_band, sizeof(float) );
+    if( !p_sys->eqz.f_amp )
         goto error;
 
-    for( i = 0; i < p_sys->i_band; i++ )
+    for( i = 0; i < p_sys->eqz.i_band; i++ )
     {
-        p_sys->f_amp[i] = 0.0f;
+        p_sys->eqz.f_amp[i] = 0.0f;
     }
 
     /* Filter state */
-    for( ch = 0; ch < 32; ch++ )
+    for( ch = 0; ch < EQZ_CHANNELS_MAX; ch++ )
     {
-        p_sys->x[ch][0]  =
-        p_sys->x[ch][1]  =
-        p_sys->x2[ch][0] =
-        p_sys->x2[ch][1] = 0.0f;
+        p_sys->eqz.x[0][ch]  =
+        p_sys->eqz.x[1][ch]  =
+        p_sys->eqz.x2[0][ch] =
+        p_sys->eqz.x2[1][ch] = 0.0f;
 
-        for( i = 0; i < p_sys->i_band; i++ )
+        for( i = 0; i < p_sys->eqz.i_band; i++ )
         {
-            p_sys->y[ch][i][0]  =
-            p_sys->y[ch][i][1]  =
-            p_sys->y2[ch][i][0] =
-            p_sys->y2[ch][i][1] = 0.0f;
+            p_sys->eqz.y[i][0][ch]  =
+            p_sys->eqz.y[i][1][ch]  =
+            p_sys->eqz.y2[i][0][ch] =
+            p_sys->eqz.y2[i][1][ch] = 0.0f;
         }
     }
 
     var_Create( p_aout, "equalizer-bands", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
     var_Create( p_aout, "equalizer-preset", VLC_VAR_STRING | VLC_VAR_DOINHERIT );
 
-    p_sys->b_2eqz = var_CreateGetBool( p_aout, "equalizer-2pass" );
+    p_sys->eqz.b_2eqz = var_CreateGetBool( p_aout, "equalizer-2pass" );
 
     var_Create( p_aout, "equalizer-preamp", VLC_VAR_FLOAT | VLC_VAR_DOINHERIT );
 
@@ -356,7 +373,7 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     {
         msg_Err(p_filter, "No preset selected");
         free( val2.psz_string );
-        free( p_sys->f_amp );
+        free( p_sys->eqz.f_amp );
         i_ret = VLC_EGENERIC;
         goto error;
     }
@@ -369,81 +386,51 @@ static int EqzInit( filter_t *p_filter, int i_rate )
     var_AddCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
     msg_Dbg( p_filter, "equalizer loaded for %d Hz with %d bands %d pass",
-                        i_rate, p_sys->i_band, p_sys->b_2eqz ? 2 : 1 );
-    for( i = 0; i < p_sys->i_band; i++ )
+                        i_rate, p_sys->eqz.i_band, p_sys->eqz.b_2eqz ? 2 : 1 );
+    for( i = 0; i < p_sys->eqz.i_band; i++ )
     {
         msg_Dbg( p_filter, "   %.2f Hz -> factor:%f alpha:%f beta:%f gamma:%f",
-                 cfg.band[i].f_frequency, p_sys->f_amp[i],
-                 p_sys->f_alpha[i], p_sys->f_beta[i], p_sys->f_gamma[i]);
+                 cfg.band[i].f_frequency, p_sys->eqz.f_amp[i],
+                 p_sys->eqz.f_alpha[i], p_sys->eqz.f_beta[i], p_sys->eqz.f_gamma[i]);
     }
     return VLC_SUCCESS;
 
 error:
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
+    free( p_sys->eqz.f_alpha );
+    free( p_sys->eqz.f_beta );
+    free( p_sys->eqz.f_gamma );
     return i_ret;
 }
 
+static bool EqzScratch( filter_sys_t *p_sys, size_t i_size )
+{
+    if( i_size > p_sys->scratch_size )
+    {
+        float *scratch = vlc_alloc( i_size, sizeof (float) );
+        if( unlikely(scratch == NULL) )
+            return false;
+        free( p_sys->scratch );
+        p_sys->scratch = scratch;
+        p_sys->scratch_size = i_size;
+    }
+    return true;
+}
+
 static void EqzFilter( filter_t *p_filter, float *out, float *in,
                        int i_samples, int i_channels )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    int i, ch, j;
 
     vlc_mutex_lock( &p_sys->lock );
-    for( i = 0; i < i_samples; i++ )
+    if( p_sys->executor != NULL && i_samples >= EQZ_PARALLEL_SAMPLES
+     && EqzScratch( p_sys, EqzScratchSize( i_samples, i_channels ) ) )
+        EqzFilterParallel( &p_sys->eqz, p_sys->filter, p_sys->executor,
+                           p_sys->scratch, out, in, i_samples, i_channels );
+    else
     {
-        for( ch = 0; ch < i_channels; ch++ )
-        {
-            const float x = in[ch];
-            float o = 0.0f;
-
-            for( j = 0; j < p_sys->i_band; j++ )
-            {
-                float y = p_sys->f_alpha[j] * ( x - p_sys->x[ch][1] ) +
-                          p_sys->f_gamma[j] * p_sys->y[ch][j][0] -
-                          p_sys->f_beta[j]  * p_sys->y[ch][j][1];
-
-                p_sys->y[ch][j][1] = p_sys->y[ch][j][0];
-                p_sys->y[ch][j][0] = y;
-
-                o += y * p_sys->f_amp[j];
-            }
-            p_sys->x[ch][1] = p_sys->x[ch][0];
-            p_sys->x[ch][0] = x;
-
-            /* Second filter */
-            if( p_sys->b_2eqz )
-            {
-                const float x2 = EQZ_IN_FACTOR * x + o;
-                o = 0.0f;
-                for( j = 0; j < p_sys->i_band; j++ )
-                {
-                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[ch][1] ) +
-                              p_sys->f_gamma[j] * p_sys->y2[ch][j][0] -
-                              p_sys->f_beta[j]  * p_sys->y2[ch][j][1];
-
-                    p_sys->y2[ch][j][1] = p_sys->y2[ch][j][0];
-                    p_sys->y2[ch][j][0] = y;
-
-                    o += y * p_sys->f_amp[j];
-                }
-                p_sys->x2[ch][1] = p_sys->x2[ch][0];
-                p_sys->x2[ch][0] = x2;
-
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
-            }
-            else
-            {
-                /* We add source PCM + filtered PCM */
-                out[ch] = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
-            }
-        }
-
-        in  += i_channels;
-        out += i_channels;
+        for( int c = 0; c < i_channels; c += EQZ_LANES )
+            p_sys->filter( &p_sys->eqz, out + c, i_channels, in, i_samples,
+                           i_channels, c );
     }
     vlc_mutex_unlock( &p_sys->lock );
 }
@@ -458,11 +445,11 @@ static void EqzClean( filter_t *p_filter )
     var_DelCallback( p_aout, "equalizer-preamp", PreampCallback, p_sys );
     var_DelCallback( p_aout, "equalizer-2pass", TwoPassCallback, p_sys );
 
-    free( p_sys->f_alpha );
-    free( p_sys->f_beta );
-    free( p_sys->f_gamma );
+    free( p_sys->eqz.f_alpha );
+    free( p_sys->eqz.f_beta );
+    free( p_sys->eqz.f_gamma );
 
-    free( p_sys->f_amp );
+    free( p_sys->eqz.f_amp );
 }
 
 
@@ -528,7 +515,7 @@ static int PreampCallback( vlc_object_t *p_this, char const *psz_cmd,
         preamp = 10.f;
 
     vlc_mutex_lock( &p_sys->lock );
-    p_sys->f_gamp = preamp;
+    p_sys->eqz.f_gamp = preamp;
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -543,7 +530,7 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
 
     /* Same thing for bands */
     vlc_mutex_lock( &p_sys->lock );
-    while( i < p_sys->i_band )
+    while( i < p_sys->eqz.i_band )
     {
         char *next;
         /* Read dB -20/20 */
@@ -551,14 +538,14 @@ static int BandsCallback( vlc_object_t *p_this, char const *psz_cmd,
         if( next == p || isnan( f ) )
             break; /* no conversion */
 
-        p_sys->f_amp[i++] = EqzConvertdB( f );
+        p_sys->eqz.f_amp[i++] = EqzConvertdB( f );
 
         if( *next == '\0' )
             break; /* end of line */
         p = &next[1];
     }
-    while( i < p_sys->i_band )
-        p_sys->f_amp[i++] = EqzConvertdB( 0.f );
+    while( i < p_sys->eqz.i_band )
+        p_sys->eqz.f_amp[i++] = EqzConvertdB( 0.f );
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
@@ -569,7 +556,7 @@ static int TwoPassCallback( vlc_object_t *p_this, char const *psz_cmd,
     filter_sys_t *p_sys = p_data;
 
     vlc_mutex_lock( &p_sys->lock );
-    p_sys->b_2eqz = newval.b_bool;
+    p_sys->eqz.b_2eqz = newval.b_bool;
     vlc_mutex_unlock( &p_sys->lock );
     return VLC_SUCCESS;
 }
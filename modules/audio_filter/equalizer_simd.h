@@ -0,0 +1,351 @@
+/*****************************************************************************
+ * equalizer_simd.h: equalizer filtering kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_EQUALIZER_SIMD_H
+#define VLC_EQUALIZER_SIMD_H
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <vlc_cpu.h>
+#include <vlc_filter.h>
+
+#include "equalizer_presets.h"
+
+/*
+ * The channels are filtered by groups of EQZ_LANES. The SIMD variant filters
+ * the channels of a group at once, in the same order of operations as the C
+ * reference, so that the output is bit-identical. Groups are independent, so
+ * they can also be filtered in parallel.
+ */
+
+#define EQZ_CHANNELS_MAX 32
+/* Channels filtered together by the SIMD code */
+#define EQZ_LANES 4
+#define EQZ_GROUPS_MAX (EQZ_CHANNELS_MAX / EQZ_LANES)
+
+#define EQZ_IN_FACTOR (0.25f)
+
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <xmmintrin.h>
+# define EQZ_SIMD 1
+# define EQZ_SIMD_TARGET VLC_SSE
+# define eqz_CPU_SIMD() vlc_CPU_SSE()
+typedef __m128 eqz_v;
+# define eqz_load(p) _mm_loadu_ps(p)
+# define eqz_store(p, v) _mm_storeu_ps(p, v)
+# define eqz_dup(f) _mm_set1_ps(f)
+# define eqz_add(a, b) _mm_add_ps(a, b)
+# define eqz_sub(a, b) _mm_sub_ps(a, b)
+# define eqz_mul(a, b) _mm_mul_ps(a, b)
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define EQZ_SIMD 1
+# define EQZ_SIMD_TARGET
+# define eqz_CPU_SIMD() vlc_CPU_ARM_NEON()
+typedef float32x4_t eqz_v;
+# define eqz_load(p) vld1q_f32(p)
+# define eqz_store(p, v) vst1q_f32(p, v)
+# define eqz_dup(f) vdupq_n_f32(f)
+# define eqz_add(a, b) vaddq_f32(a, b)
+# define eqz_sub(a, b) vsubq_f32(a, b)
+# define eqz_mul(a, b) vmulq_f32(a, b)
+#endif
+
+typedef struct
+{
+    /* Filter static config */
+    int i_band;
+    float *f_alpha;
+    float *f_beta;
+    float *f_gamma;
+
+    /* Filter dyn config */
+    float *f_amp;   /* Per band amp */
+    float f_gamp;   /* Global preamp */
+    bool b_2eqz;
+
+    /* Filter state, channel-minor so that channels can be filtered
+     * together */
+    float x[2][EQZ_CHANNELS_MAX];
+    float y[EQZ_BANDS_MAX][2][EQZ_CHANNELS_MAX];
+
+    /* Second filter state */
+    float x2[2][EQZ_CHANNELS_MAX];
+    float y2[EQZ_BANDS_MAX][2][EQZ_CHANNELS_MAX];
+} eqz_state_t;
+
+/**
+ * Filters the channels [c, c + EQZ_LANES) of an interleaved buffer.
+ *
+ * The output samples of consecutive frames are pitch floats apart.
+ */
+typedef void (*eqz_filter_group_t)(eqz_state_t *, float *out, size_t pitch,
+                                   const float *in, int i_samples,
+                                   int i_channels, int c);
+
+static inline void EqzFilterGroupC( eqz_state_t *p_sys, float *out,
+                                    size_t pitch, const float *in,
+                                    int i_samples, int i_channels, int c )
+{
+    const int i_end = __MIN( c + EQZ_LANES, i_channels );
+
+    for( int ch = c; ch < i_end; ch++ )
+    {
+        const float *p_in = in + ch;
+        float *p_out = out + ch - c;
+
+        for( int i = 0; i < i_samples; i++ )
+        {
+            const float x = *p_in;
+            float o = 0.0f;
+
+            for( int j = 0; j < p_sys->i_band; j++ )
+            {
+                float y = p_sys->f_alpha[j] * ( x - p_sys->x[1][ch] ) +
+                          p_sys->f_gamma[j] * p_sys->y[j][0][ch] -
+                          p_sys->f_beta[j]  * p_sys->y[j][1][ch];
+
+                p_sys->y[j][1][ch] = p_sys->y[j][0][ch];
+                p_sys->y[j][0][ch] = y;
+
+                o += y * p_sys->f_amp[j];
+            }
+            p_sys->x[1][ch] = p_sys->x[0][ch];
+            p_sys->x[0][ch] = x;
+
+            /* Second filter */
+            if( p_sys->b_2eqz )
+            {
+                const float x2 = EQZ_IN_FACTOR * x + o;
+                o = 0.0f;
+                for( int j = 0; j < p_sys->i_band; j++ )
+                {
+                    float y = p_sys->f_alpha[j] * ( x2 - p_sys->x2[1][ch] ) +
+                              p_sys->f_gamma[j] * p_sys->y2[j][0][ch] -
+                              p_sys->f_beta[j]  * p_sys->y2[j][1][ch];
+
+                    p_sys->y2[j][1][ch] = p_sys->y2[j][0][ch];
+                    p_sys->y2[j][0][ch] = y;
+
+                    o += y * p_sys->f_amp[j];
+                }
+                p_sys->x2[1][ch] = p_sys->x2[0][ch];
+                p_sys->x2[0][ch] = x2;
+
+                /* We add source PCM + filtered PCM */
+                *p_out = p_sys->f_gamp * p_sys->f_gamp *( EQZ_IN_FACTOR * x2 + o );
+            }
+            else
+            {
+                /* We add source PCM + filtered PCM */
+                *p_out = p_sys->f_gamp *( EQZ_IN_FACTOR * x + o );
+            }
+
+            p_in  += i_channels;
+            p_out += pitch;
+        }
+    }
+}
+
+#ifdef EQZ_SIMD
+/* Runs all the bands of one pass on EQZ_LANES channels at once. The order of
+ * the operations is the same as in the C code, so is the output. */
+EQZ_SIMD_TARGET
+static inline eqz_v EqzPassSIMD( float (*x)[EQZ_CHANNELS_MAX],
+                                 float (*y)[2][EQZ_CHANNELS_MAX], int c,
+                                 eqz_v in, int i_band, const eqz_v *alpha,
+                                 const eqz_v *beta, const eqz_v *gamma,
+                                 const eqz_v *amp )
+{
+    const eqz_v dx = eqz_sub( in, eqz_load( &x[1][c] ) );
+    eqz_v o = eqz_dup( 0.0f );
+
+    for( int j = 0; j < i_band; j++ )
+    {
+        const eqz_v y0 = eqz_load( &y[j][0][c] );
+        const eqz_v y1 = eqz_load( &y[j][1][c] );
+        const eqz_v v = eqz_sub( eqz_add( eqz_mul( alpha[j], dx ),
+                                          eqz_mul( gamma[j], y0 ) ),
+                                 eqz_mul( beta[j], y1 ) );
+
+        eqz_store( &y[j][1][c], y0 );
+        eqz_store( &y[j][0][c], v );
+        o = eqz_add( o, eqz_mul( v, amp[j] ) );
+    }
+    eqz_store( &x[1][c], eqz_load( &x[0][c] ) );
+    eqz_store( &x[0][c], in );
+    return o;
+}
+
+EQZ_SIMD_TARGET
+static inline void EqzFilterGroupSIMD( eqz_state_t *p_sys, float *out,
+                                       size_t pitch, const float *in,
+                                       int i_samples, int i_channels, int c )
+{
+    const int i_band = p_sys->i_band;
+    const int n = __MIN( EQZ_LANES, i_channels - c );
+    eqz_v alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX];
+    eqz_v gamma[EQZ_BANDS_MAX], amp[EQZ_BANDS_MAX];
+
+    for( int j = 0; j < i_band; j++ )
+    {
+        alpha[j] = eqz_dup( p_sys->f_alpha[j] );
+        beta[j]  = eqz_dup( p_sys->f_beta[j] );
+        gamma[j] = eqz_dup( p_sys->f_gamma[j] );
+        amp[j]   = eqz_dup( p_sys->f_amp[j] );
+    }
+
+    const eqz_v in_factor = eqz_dup( EQZ_IN_FACTOR );
+    const eqz_v gamp = eqz_dup( p_sys->f_gamp );
+    const eqz_v gamp2 = eqz_dup( p_sys->f_gamp * p_sys->f_gamp );
+
+    in += c;
+    for( int i = 0; i < i_samples; i++ )
+    {
+        /* Unused lanes run on silence, and on the state of unused channels */
+        float buf[EQZ_LANES] = { 0.f, 0.f, 0.f, 0.f };
+        eqz_v x, o;
+
+        if( likely(n == EQZ_LANES) )
+            x = eqz_load( in );
+        else
+        {
+            memcpy( buf, in, n * sizeof (float) );
+            x = eqz_load( buf );
+        }
+
+        o = EqzPassSIMD( p_sys->x, p_sys->y, c, x, i_band,
+                         alpha, beta, gamma, amp );
+
+        if( p_sys->b_2eqz )
+        {
+            const eqz_v x2 = eqz_add( eqz_mul( in_factor, x ), o );
+
+            o = EqzPassSIMD( p_sys->x2, p_sys->y2, c, x2, i_band,
+                             alpha, beta, gamma, amp );
+            o = eqz_mul( gamp2, eqz_add( eqz_mul( in_factor, x2 ), o ) );
+        }
+        else
+            o = eqz_mul( gamp, eqz_add( eqz_mul( in_factor, x ), o ) );
+
+        if( likely(n == EQZ_LANES) )
+            eqz_store( out, o );
+        else
+        {
+            eqz_store( buf, o );
+            memcpy( out, buf, n * sizeof (float) );
+        }
+
+        in  += i_channels;
+        out += pitch;
+    }
+}
+#endif
+
+/**
+ * Gets the best group filtering variant for the running CPU.
+ */
+static inline eqz_filter_group_t EqzGetFilterGroup( void )
+{
+#ifdef EQZ_SIMD
+    if( eqz_CPU_SIMD() )
+        return EqzFilterGroupSIMD;
+#endif
+    return EqzFilterGroupC;
+}
+
+/**
+ * Size in floats of the scratch buffer for EqzFilterParallel().
+ */
+static inline size_t EqzScratchSize( int i_samples, int i_channels )
+{
+    const size_t i_groups = ( i_channels + EQZ_LANES - 1 ) / EQZ_LANES;
+
+    return i_groups * i_samples * EQZ_LANES;
+}
+
+struct eqz_parallel
+{
+    eqz_state_t *p_sys;
+    eqz_filter_group_t filter;
+    float *scratch;
+    const float *in;
+    int i_samples;
+    int i_channels;
+};
+
+/* Each group is filtered into its own part of the scratch buffer, so that
+ * threads do not write to the same cache lines. */
+static inline void EqzFilterSlice( void *opaque, unsigned slice,
+                                   unsigned slices )
+{
+    const struct eqz_parallel *par = opaque;
+    const unsigned i_groups = ( par->i_channels + EQZ_LANES - 1 ) / EQZ_LANES;
+    unsigned first, end;
+
+    filter_GetSliceLines( i_groups, 1, slice, slices, &first, &end );
+
+    for( unsigned g = first; g < end; g++ )
+        par->filter( par->p_sys,
+                     par->scratch + g * par->i_samples * EQZ_LANES,
+                     EQZ_LANES, par->in, par->i_samples, par->i_channels,
+                     g * EQZ_LANES );
+}
+
+/**
+ * Filters the groups of channels of an interleaved buffer in parallel.
+ *
+ * \param executor executor to run the groups on
+ * \param scratch buffer of EqzScratchSize() floats
+ * \param out output buffer, which may be the same as the input buffer
+ */
+static inline void EqzFilterParallel( eqz_state_t *p_sys,
+                                      eqz_filter_group_t filter,
+                                      struct vlc_executor *executor,
+                                      float *scratch, float *out,
+                                      const float *in, int i_samples,
+                                      int i_channels )
+{
+    struct eqz_parallel par = {
+        .p_sys = p_sys,
+        .filter = filter,
+        .scratch = scratch,
+        .in = in,
+        .i_samples = i_samples,
+        .i_channels = i_channels,
+    };
+    const unsigned i_groups = ( i_channels + EQZ_LANES - 1 ) / EQZ_LANES;
+
+    filter_RunSlices( executor, i_groups, 1, EqzFilterSlice, &par );
+
+    for( unsigned g = 0; g < i_groups; g++ )
+    {
+        const int c = g * EQZ_LANES;
+        const size_t n = __MIN( EQZ_LANES, i_channels - c );
+        const float *src = scratch + g * i_samples * EQZ_LANES;
+
+        for( int i = 0; i < i_samples; i++ )
+            memcpy( out + i * i_channels + c, src + i * EQZ_LANES,
+                    n * sizeof (float) );
+    }
+}
+
+#endif
@@ -0,0 +1,622 @@
+/*****************************************************************************
+ * pcm_simd.h: vectorised PCM sample kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_PCM_SIMD_H
+#define VLC_PCM_SIMD_H
+
+#include <stdint.h>
+#include <math.h>
+
+#include <vlc_cpu.h>
+
+/*
+ * Each kernel has a C reference implementation, and SIMD variants which
+ * produce bit-identical results. The pcm_Get*() functions return the best
+ * variant for the running CPU.
+ *
+ * Conversions which narrow the samples may operate in place.
+ */
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+ && defined(HAVE_SSE2_INTRINSICS)
+# define PCM_SIMD_X86 1
+# include <immintrin.h>
+# define PCM_SSE2 __attribute__ ((__target__ ("sse2")))
+# define PCM_AVX  __attribute__ ((__target__ ("avx")))
+# define PCM_AVX2 __attribute__ ((__target__ ("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define PCM_SIMD_NEON 1
+# include <arm_neon.h>
+#endif
+
+typedef void (*pcm_amplify_fl32_t)(float *, size_t, float);
+typedef void (*pcm_amplify_fl64_t)(double *, size_t, double);
+typedef void (*pcm_amplify_s16_t)(int16_t *, size_t, int);
+typedef void (*pcm_s16_fl32_t)(float *, const int16_t *, size_t);
+typedef void (*pcm_fl32_s16_t)(int16_t *, const float *, size_t);
+typedef void (*pcm_s32_fl32_t)(float *, const int32_t *, size_t);
+typedef void (*pcm_fl32_s32_t)(int32_t *, const float *, size_t);
+
+/*** Gain ***/
+
+static inline void pcm_amplify_fl32_c(float *p, size_t n, float gain)
+{
+    for (size_t i = 0; i < n; i++)
+        p[i] *= gain;
+}
+
+static inline void pcm_amplify_fl64_c(double *p, size_t n, double gain)
+{
+    for (size_t i = 0; i < n; i++)
+        p[i] *= gain;
+}
+
+/**
+ * Amplifies signed 16-bits samples.
+ * \param mult gain in 8.8 fixed point format
+ */
+static inline void pcm_amplify_s16_c(int16_t *p, size_t n, int mult)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        int_fast32_t s = (p[i] * (int_fast32_t)mult) >> 8;
+        if (s > INT16_MAX)
+            s = INT16_MAX;
+        else
+        if (s < INT16_MIN)
+            s = INT16_MIN;
+        p[i] = s;
+    }
+}
+
+#ifdef PCM_SIMD_X86
+PCM_SSE2
+static inline void pcm_amplify_fl32_sse2(float *p, size_t n, float gain)
+{
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128 a = _mm_loadu_ps(p + i);
+        __m128 b = _mm_loadu_ps(p + i + 4);
+        _mm_storeu_ps(p + i, _mm_mul_ps(a, g));
+        _mm_storeu_ps(p + i + 4, _mm_mul_ps(b, g));
+    }
+    for (; i < n; i++)
+        p[i] *= gain;
+}
+
+PCM_AVX
+static inline void pcm_amplify_fl32_avx(float *p, size_t n, float gain)
+{
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 a = _mm256_loadu_ps(p + i);
+        __m256 b = _mm256_loadu_ps(p + i + 8);
+        _mm256_storeu_ps(p + i, _mm256_mul_ps(a, g));
+        _mm256_storeu_ps(p + i + 8, _mm256_mul_ps(b, g));
+    }
+    for (; i < n; i++)
+        p[i] *= gain;
+}
+
+PCM_SSE2
+static inline void pcm_amplify_fl64_sse2(double *p, size_t n, double gain)
+{
+    const __m128d g = _mm_set1_pd(gain);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128d a = _mm_loadu_pd(p + i);
+        __m128d b = _mm_loadu_pd(p + i + 2);
+        _mm_storeu_pd(p + i, _mm_mul_pd(a, g));
+        _mm_storeu_pd(p + i + 2, _mm_mul_pd(b, g));
+    }
+    for (; i < n; i++)
+        p[i] *= gain;
+}
+
+PCM_AVX
+static inline void pcm_amplify_fl64_avx(double *p, size_t n, double gain)
+{
+    const __m256d g = _mm256_set1_pd(gain);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256d a = _mm256_loadu_pd(p + i);
+        __m256d b = _mm256_loadu_pd(p + i + 4);
+        _mm256_storeu_pd(p + i, _mm256_mul_pd(a, g));
+        _mm256_storeu_pd(p + i + 4, _mm256_mul_pd(b, g));
+    }
+    for (; i < n; i++)
+        p[i] *= gain;
+}
+
+/* The multiplier must fit in 16 bits, see pcm_GetAmplifyS16(). */
+PCM_SSE2
+static inline void pcm_amplify_s16_sse2(int16_t *p, size_t n, int mult)
+{
+    const __m128i m = _mm_set1_epi16(mult);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i lo = _mm_mullo_epi16(x, m);
+        __m128i hi = _mm_mulhi_epi16(x, m);
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+        _mm_storeu_si128((__m128i *)(p + i), _mm_packs_epi32(a, b));
+    }
+    pcm_amplify_s16_c(p + i, n - i, mult);
+}
+
+PCM_AVX2
+static inline void pcm_amplify_s16_avx2(int16_t *p, size_t n, int mult)
+{
+    const __m256i m = _mm256_set1_epi16(mult);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i lo = _mm256_mullo_epi16(x, m);
+        __m256i hi = _mm256_mulhi_epi16(x, m);
+        /* Unpacking and packing within lanes preserves the order. */
+        __m256i a = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 8);
+        __m256i b = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 8);
+        _mm256_storeu_si256((__m256i *)(p + i), _mm256_packs_epi32(a, b));
+    }
+    pcm_amplify_s16_c(p + i, n - i, mult);
+}
+#endif
+
+#ifdef PCM_SIMD_NEON
+static inline void pcm_amplify_fl32_neon(float *p, size_t n, float gain)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        float32x4_t a = vld1q_f32(p + i);
+        float32x4_t b = vld1q_f32(p + i + 4);
+        vst1q_f32(p + i, vmulq_n_f32(a, gain));
+        vst1q_f32(p + i + 4, vmulq_n_f32(b, gain));
+    }
+    for (; i < n; i++)
+        p[i] *= gain;
+}
+
+static inline void pcm_amplify_s16_neon(int16_t *p, size_t n, int mult)
+{
+    const int16x4_t m = vdup_n_s16(mult);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t x = vld1q_s16(p + i);
+        int32x4_t a = vmull_s16(vget_low_s16(x), m);
+        int32x4_t b = vmull_s16(vget_high_s16(x), m);
+        vst1q_s16(p + i, vcombine_s16(vqshrn_n_s32(a, 8),
+                                      vqshrn_n_s32(b, 8)));
+    }
+    pcm_amplify_s16_c(p + i, n - i, mult);
+}
+#endif
+
+static inline pcm_amplify_fl32_t pcm_GetAmplifyFL32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX())
+        return pcm_amplify_fl32_avx;
+    if (vlc_CPU_SSE2())
+        return pcm_amplify_fl32_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        return pcm_amplify_fl32_neon;
+#endif
+    return pcm_amplify_fl32_c;
+}
+
+static inline pcm_amplify_fl64_t pcm_GetAmplifyFL64(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX())
+        return pcm_amplify_fl64_avx;
+    if (vlc_CPU_SSE2())
+        return pcm_amplify_fl64_sse2;
+#endif
+    return pcm_amplify_fl64_c;
+}
+
+static inline pcm_amplify_s16_t pcm_GetAmplifyS16(int mult)
+{
+    if (mult < INT16_MIN || mult > INT16_MAX)
+        return pcm_amplify_s16_c;
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_amplify_s16_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_amplify_s16_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        return pcm_amplify_s16_neon;
+#endif
+    return pcm_amplify_s16_c;
+}
+
+/*** Format conversions ***/
+
+static inline void pcm_s16_fl32_c(float *dst, const int16_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {   /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.i = src[i] + 0x43c00000;
+        dst[i] = u.f - 384.f;
+    }
+}
+
+static inline void pcm_fl32_s16_c(int16_t *dst, const float *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {   /* This is Walken's trick based on IEEE float format. */
+        union { float f; int32_t i; } u;
+        u.f = src[i] + 384.f;
+        if (u.i > 0x43c07fff)
+            dst[i] = 32767;
+        else if (u.i < 0x43bf8000)
+            dst[i] = -32768;
+        else
+            dst[i] = u.i - 0x43c00000;
+    }
+}
+
+static inline void pcm_s32_fl32_c(float *dst, const int32_t *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (float)src[i] / 2147483648.f;
+}
+
+static inline void pcm_fl32_s32_c(int32_t *dst, const float *src, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        float s = src[i] * 2147483648.f;
+        if (s >= 2147483647.f)
+            dst[i] = 2147483647;
+        else
+        if (s <= -2147483648.f)
+            dst[i] = -2147483648;
+        else
+            dst[i] = lroundf(s);
+    }
+}
+
+#ifdef PCM_SIMD_X86
+PCM_SSE2
+static inline void pcm_s16_fl32_sse2(float *dst, const int16_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        /* Sign extension */
+        __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(a), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+    }
+    pcm_s16_fl32_c(dst + i, src + i, n - i);
+}
+
+PCM_AVX2
+static inline void pcm_s16_fl32_avx2(float *dst, const int16_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 32768.f);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i y = _mm_loadu_si128((const __m128i *)(src + i + 8));
+        __m256 a = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(x));
+        __m256 b = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(y));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(a, scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(b, scale));
+    }
+    pcm_s16_fl32_c(dst + i, src + i, n - i);
+}
+
+/* The destination may alias the source. */
+PCM_SSE2
+static inline void pcm_fl32_s16_sse2(int16_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(32768.f);
+    const __m128 max = _mm_set1_ps(32767.f);
+    const __m128 min = _mm_set1_ps(-32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        a = _mm_max_ps(_mm_min_ps(a, max), min);
+        b = _mm_max_ps(_mm_min_ps(b, max), min);
+        /* Round to nearest even, as the reference */
+        _mm_storeu_si128((__m128i *)(dst + i),
+                         _mm_packs_epi32(_mm_cvtps_epi32(a),
+                                         _mm_cvtps_epi32(b)));
+    }
+    pcm_fl32_s16_c(dst + i, src + i, n - i);
+}
+
+PCM_AVX2
+static inline void pcm_fl32_s16_avx2(int16_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(32768.f);
+    const __m256 max = _mm256_set1_ps(32767.f);
+    const __m256 min = _mm256_set1_ps(-32768.f);
+    size_t i = 0;
+
+    for (; i + 16 <= n; i += 16)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+        a = _mm256_max_ps(_mm256_min_ps(a, max), min);
+        b = _mm256_max_ps(_mm256_min_ps(b, max), min);
+
+        __m256i x = _mm256_packs_epi32(_mm256_cvtps_epi32(a),
+                                       _mm256_cvtps_epi32(b));
+        /* Packing interleaves the lanes: restore the order. */
+        x = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i *)(dst + i), x);
+    }
+    pcm_fl32_s16_c(dst + i, src + i, n - i);
+}
+
+/* The destination may alias the source. */
+PCM_SSE2
+static inline void pcm_s32_fl32_sse2(float *dst, const int32_t *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+    }
+    pcm_s32_fl32_c(dst + i, src + i, n - i);
+}
+
+PCM_AVX2
+static inline void pcm_s32_fl32_avx2(float *dst, const int32_t *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(1.f / 2147483648.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+    }
+    pcm_s32_fl32_c(dst + i, src + i, n - i);
+}
+
+/* The destination may alias the source. */
+PCM_SSE2
+static inline void pcm_fl32_s32_sse2(int32_t *dst, const float *src, size_t n)
+{
+    const __m128 scale = _mm_set1_ps(2147483648.f);
+    const __m128 half = _mm_set1_ps(.5f);
+    const __m128 mhalf = _mm_set1_ps(-.5f);
+    const __m128 max = _mm_set1_ps(2147483647.f);
+    const __m128 min = _mm_set1_ps(-2147483648.f);
+    const __m128i imax = _mm_set1_epi32(INT32_MAX);
+    const __m128i imin = _mm_set1_epi32(INT32_MIN);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128i t = _mm_cvttps_epi32(s);
+        /* Round half away from zero, as lroundf() */
+        __m128 d = _mm_sub_ps(s, _mm_cvtepi32_ps(t));
+        t = _mm_sub_epi32(t, _mm_castps_si128(_mm_cmpge_ps(d, half)));
+        t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmple_ps(d, mhalf)));
+
+        __m128i hi = _mm_castps_si128(_mm_cmpge_ps(s, max));
+        __m128i lo = _mm_castps_si128(_mm_cmple_ps(s, min));
+        t = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(hi, lo), t),
+                         _mm_or_si128(_mm_and_si128(hi, imax),
+                                      _mm_and_si128(lo, imin)));
+        _mm_storeu_si128((__m128i *)(dst + i), t);
+    }
+    pcm_fl32_s32_c(dst + i, src + i, n - i);
+}
+
+PCM_AVX2
+static inline void pcm_fl32_s32_avx2(int32_t *dst, const float *src, size_t n)
+{
+    const __m256 scale = _mm256_set1_ps(2147483648.f);
+    const __m256 half = _mm256_set1_ps(.5f);
+    const __m256 mhalf = _mm256_set1_ps(-.5f);
+    const __m256 max = _mm256_set1_ps(2147483647.f);
+    const __m256 min = _mm256_set1_ps(-2147483648.f);
+    const __m256i imax = _mm256_set1_epi32(INT32_MAX);
+    const __m256i imin = _mm256_set1_epi32(INT32_MIN);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256i t = _mm256_cvttps_epi32(s);
+        __m256 d = _mm256_sub_ps(s, _mm256_cvtepi32_ps(t));
+        t = _mm256_sub_epi32(t, _mm256_castps_si256(
+                                   _mm256_cmp_ps(d, half, _CMP_GE_OQ)));
+        t = _mm256_add_epi32(t, _mm256_castps_si256(
+                                   _mm256_cmp_ps(d, mhalf, _CMP_LE_OQ)));
+
+        __m256 hi = _mm256_cmp_ps(s, max, _CMP_GE_OQ);
+        __m256 lo = _mm256_cmp_ps(s, min, _CMP_LE_OQ);
+        t = _mm256_blendv_epi8(t, imax, _mm256_castps_si256(hi));
+        t = _mm256_blendv_epi8(t, imin, _mm256_castps_si256(lo));
+        _mm256_storeu_si256((__m256i *)(dst + i), t);
+    }
+    pcm_fl32_s32_c(dst + i, src + i, n - i);
+}
+#endif
+
+#ifdef PCM_SIMD_NEON
+static inline void pcm_s16_fl32_neon(float *dst, const int16_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t x = vld1q_s16(src + i);
+        float32x4_t a = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+        float32x4_t b = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+        vst1q_f32(dst + i, vmulq_n_f32(a, 1.f / 32768.f));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(b, 1.f / 32768.f));
+    }
+    pcm_s16_fl32_c(dst + i, src + i, n - i);
+}
+
+static inline void pcm_s32_fl32_neon(float *dst, const int32_t *src, size_t n)
+{
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4_t a = vcvtq_f32_s32(vld1q_s32(src + i));
+        vst1q_f32(dst + i, vmulq_n_f32(a, 1.f / 2147483648.f));
+    }
+    pcm_s32_fl32_c(dst + i, src + i, n - i);
+}
+
+# ifdef __aarch64__
+/* ARMv7 lacks the rounding conversions: use the C versions there. */
+static inline void pcm_fl32_s16_neon(int16_t *dst, const float *src, size_t n)
+{
+    const float32x4_t max = vdupq_n_f32(32767.f);
+    const float32x4_t min = vdupq_n_f32(-32768.f);
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8)
+    {
+        float32x4_t a = vmulq_n_f32(vld1q_f32(src + i), 32768.f);
+        float32x4_t b = vmulq_n_f32(vld1q_f32(src + i + 4), 32768.f);
+        a = vmaxq_f32(vminq_f32(a, max), min);
+        b = vmaxq_f32(vminq_f32(b, max), min);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+                                        vqmovn_s32(vcvtnq_s32_f32(b))));
+    }
+    pcm_fl32_s16_c(dst + i, src + i, n - i);
+}
+
+static inline void pcm_fl32_s32_neon(int32_t *dst, const float *src, size_t n)
+{
+    size_t i = 0;
+
+    /* Rounds half away from zero, and saturates, as the reference. */
+    for (; i + 4 <= n; i += 4)
+        vst1q_s32(dst + i,
+                  vcvtaq_s32_f32(vmulq_n_f32(vld1q_f32(src + i),
+                                             2147483648.f)));
+    pcm_fl32_s32_c(dst + i, src + i, n - i);
+}
+# endif
+#endif
+
+static inline pcm_s16_fl32_t pcm_GetS16ToFL32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_s16_fl32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_s16_fl32_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        return pcm_s16_fl32_neon;
+#endif
+    return pcm_s16_fl32_c;
+}
+
+static inline pcm_fl32_s16_t pcm_GetFL32ToS16(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_fl32_s16_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_fl32_s16_sse2;
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    if (vlc_CPU_ARM_NEON())
+        return pcm_fl32_s16_neon;
+#endif
+    return pcm_fl32_s16_c;
+}
+
+static inline pcm_s32_fl32_t pcm_GetS32ToFL32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_s32_fl32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_s32_fl32_sse2;
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        return pcm_s32_fl32_neon;
+#endif
+    return pcm_s32_fl32_c;
+}
+
+static inline pcm_fl32_s32_t pcm_GetFL32ToS32(void)
+{
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_AVX2())
+        return pcm_fl32_s32_avx2;
+    if (vlc_CPU_SSE2())
+        return pcm_fl32_s32_sse2;
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    if (vlc_CPU_ARM_NEON())
+        return pcm_fl32_s32_neon;
+#endif
+    return pcm_fl32_s32_c;
+}
+
+#endif
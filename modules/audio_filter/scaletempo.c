@@ -31,12 +31,20 @@
 #include <vlc_plugin.h>
 #include <vlc_aout.h>
 #include <vlc_atomic.h>
+#include <vlc_cpu.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 
 #include <string.h> /* for memset */
 #include <limits.h> /* form INT_MIN */
 
+#if defined(HAVE_SSE2_INTRINSICS)
+# include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+# include <arm_neon.h>
+# define SCALETEMPO_NEON 1
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -129,6 +137,7 @@ typedef struct
     void     *buf_pre_corr;
     void     *table_window;
     unsigned(*best_overlap_offset)( filter_t *p_filter );
+    float   (*dot_product)( const float *, const float *, size_t );
 #ifdef PITCH_SHIFTER
     /* pitch */
     filter_t * resampler;
@@ -136,6 +145,97 @@ typedef struct
 #endif
 } filter_sys_t;
 
+/*****************************************************************************
+ * dot_product: correlation of the overlap with one search position
+ *****************************************************************************
+ * The vectorized versions sum in a different order, so that their results may
+ * differ slightly from the C version. This only matters when two offsets
+ * correlate equally well.
+ *****************************************************************************/
+static float dot_product_c( const float *a, const float *b, size_t n )
+{
+    float corr = 0;
+
+    for( size_t i = 0; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+#if defined(HAVE_SSE2_INTRINSICS)
+VLC_SSE
+static float dot_product_sse( const float *a, const float *b, size_t n )
+{
+    /* Two accumulators, to hide the latency of the additions */
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    size_t i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        acc0 = _mm_add_ps( acc0, _mm_mul_ps( _mm_loadu_ps( a + i ),
+                                             _mm_loadu_ps( b + i ) ) );
+        acc1 = _mm_add_ps( acc1, _mm_mul_ps( _mm_loadu_ps( a + i + 4 ),
+                                             _mm_loadu_ps( b + i + 4 ) ) );
+    }
+    acc0 = _mm_add_ps( acc0, acc1 );
+    acc0 = _mm_add_ps( acc0, _mm_movehl_ps( acc0, acc0 ) );
+    acc0 = _mm_add_ss( acc0, _mm_shuffle_ps( acc0, acc0, 1 ) );
+
+    float corr = _mm_cvtss_f32( acc0 );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+
+__attribute__((__target__("avx")))
+static float dot_product_avx( const float *a, const float *b, size_t n )
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+
+    for( ; i + 16 <= n; i += 16 )
+    {
+        acc0 = _mm256_add_ps( acc0, _mm256_mul_ps( _mm256_loadu_ps( a + i ),
+                                                   _mm256_loadu_ps( b + i ) ) );
+        acc1 = _mm256_add_ps( acc1,
+                              _mm256_mul_ps( _mm256_loadu_ps( a + i + 8 ),
+                                             _mm256_loadu_ps( b + i + 8 ) ) );
+    }
+    acc0 = _mm256_add_ps( acc0, acc1 );
+
+    __m128 sum = _mm_add_ps( _mm256_castps256_ps128( acc0 ),
+                             _mm256_extractf128_ps( acc0, 1 ) );
+    sum = _mm_add_ps( sum, _mm_movehl_ps( sum, sum ) );
+    sum = _mm_add_ss( sum, _mm_shuffle_ps( sum, sum, 1 ) );
+
+    float corr = _mm_cvtss_f32( sum );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
+#ifdef SCALETEMPO_NEON
+static float dot_product_neon( const float *a, const float *b, size_t n )
+{
+    float32x4_t acc0 = vdupq_n_f32( 0.f ), acc1 = vdupq_n_f32( 0.f );
+    size_t i = 0;
+
+    for( ; i + 8 <= n; i += 8 )
+    {
+        acc0 = vmlaq_f32( acc0, vld1q_f32( a + i ), vld1q_f32( b + i ) );
+        acc1 = vmlaq_f32( acc1, vld1q_f32( a + i + 4 ),
+                          vld1q_f32( b + i + 4 ) );
+    }
+    acc0 = vaddq_f32( acc0, acc1 );
+
+    float32x2_t sum = vadd_f32( vget_low_f32( acc0 ), vget_high_f32( acc0 ) );
+    float corr = vget_lane_f32( vpadd_f32( sum, sum ), 0 );
+    for( ; i < n; i++ )
+        corr += a[i] * b[i];
+    return corr;
+}
+#endif
+
 /*****************************************************************************
  * best_overlap_offset: calculate best offset for overlap
  *****************************************************************************/
@@ -146,6 +246,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
     float best_corr = INT_MIN;
     unsigned best_off = 0;
     unsigned i, off;
+    const size_t samples = p->samples_overlap - p->samples_per_frame;
 
     pw  = p->table_window;
     po  = p->buf_overlap;
@@ -157,12 +258,7 @@ static unsigned best_overlap_offset_float( filter_t *p_filter )
 
     search_start = (float *)p->buf_queue + p->samples_per_frame;
     for( off = 0; off < p->frames_search; off++ ) {
-      float corr = 0;
-      float *ps = search_start;
-      ppc = p->buf_pre_corr;
-      for( i = p->samples_per_frame; i < p->samples_overlap; i++ ) {
-        corr += *ppc++ * *ps++;
-      }
+      float corr = p->dot_product( p->buf_pre_corr, search_start, samples );
       if( corr > best_corr ) {
         best_corr = corr;
         best_off  = off;
@@ -444,6 +540,17 @@ static int Open( vlc_object_t *p_this )
     p_sys->bytes_to_slide = 0;
     p_sys->frames_stride_error = 0;
 
+    p_sys->dot_product = dot_product_c;
+#if defined(HAVE_SSE2_INTRINSICS)
+    if( vlc_CPU_AVX() )
+        p_sys->dot_product = dot_product_avx;
+    else if( vlc_CPU_SSE() )
+        p_sys->dot_product = dot_product_sse;
+#elif defined(SCALETEMPO_NEON)
+    if( vlc_CPU_ARM_NEON() )
+        p_sys->dot_product = dot_product_neon;
+#endif
+
     if( reinit_buffers( p_filter ) != VLC_SUCCESS )
     {
         Close( p_this );
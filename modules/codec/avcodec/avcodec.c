@@ -52,6 +52,12 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+#if defined(FF_THREAD_FRAME)
+static const int  thread_type_list[] = { 0, 1, 2 };
+static const char *const thread_type_list_text[] =
+  { N_("Automatic"), N_("Frame"), N_("Slice") };
+#endif
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -135,6 +141,13 @@ vlc_module_begin ()
 #if defined(FF_THREAD_FRAME)
     add_obsolete_integer( "ffmpeg-threads" ) /* removed since 2.1.0 */
     add_integer( "avcodec-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "avcodec-thread-type", 0, THREAD_TYPE_TEXT,
+                 THREAD_TYPE_LONGTEXT, true )
+        change_integer_list( thread_type_list, thread_type_list_text )
+    add_integer_with_range( "avcodec-thread-budget", 0, 0, 1024,
+                            THREAD_BUDGET_TEXT, THREAD_BUDGET_LONGTEXT, true )
+    add_integer_with_range( "avcodec-thread-max", 0, 0, 1024,
+                            THREAD_MAX_TEXT, THREAD_MAX_LONGTEXT, true )
 #endif
     add_string( "avcodec-options", NULL, AV_OPTIONS_TEXT, AV_OPTIONS_LONGTEXT, true )
 
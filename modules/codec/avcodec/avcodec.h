@@ -115,6 +115,22 @@ int ffmpeg_OpenCodec( decoder_t *p_dec, AVCodecContext *, const AVCodec * );
 #define THREADS_TEXT N_( "Threads" )
 #define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
 
+#define THREAD_TYPE_TEXT N_( "Threading mode" )
+#define THREAD_TYPE_LONGTEXT N_( "Frame threading decodes several frames " \
+    "at once and scales better, slice threading decodes the slices of a " \
+    "frame at once and adds no latency." )
+
+#define THREAD_BUDGET_TEXT N_( "Decoding threads budget" )
+#define THREAD_BUDGET_LONGTEXT N_( "Maximum number of threads used by all " \
+    "the video decoders of the process together, so that concurrent " \
+    "inputs do not overload the CPUs. Each decoder gets at least one " \
+    "thread. 0 means twice the number of CPUs." )
+
+#define THREAD_MAX_TEXT N_( "Maximum threads per decoder" )
+#define THREAD_MAX_LONGTEXT N_( "Maximum number of threads of a video " \
+    "decoder. 0 means the most that libavcodec copes with for the codec: " \
+    "32 for HEVC and VP9, 16 otherwise." )
+
 /*
  * Encoder options
  */
@@ -107,6 +107,9 @@ typedef struct
     int profile;
     int level;
 
+    /* Threads reserved from the process-wide budget */
+    unsigned i_threads;
+
     vlc_sem_t sem_mt;
 } decoder_sys_t;
 
@@ -136,6 +139,82 @@ static uint32_t ffmpeg_CodecTag( vlc_fourcc_t fcc )
     return p[0] | (p[1] << 8) | (p[2] << 16) | (p[3] << 24);
 }
 
+/*****************************************************************************
+ * Threading policy
+ *****************************************************************************/
+
+/* Threads reserved by all the video decoders of the process */
+static vlc_mutex_t thread_budget_lock = VLC_STATIC_MUTEX;
+static unsigned thread_budget_used = 0;
+
+/**
+ * Returns the number of threads a decoder would like to use.
+ */
+static unsigned GetThreadCount( decoder_t *p_dec, const AVCodec *p_codec )
+{
+    const video_format_t *fmt = &p_dec->fmt_in.video;
+    unsigned i_max = var_InheritInteger( p_dec, "avcodec-thread-max" );
+
+    /* Most threads libavcodec copes with */
+    if( i_max == 0 )
+        switch( p_codec->id )
+        {
+            case AV_CODEC_ID_HEVC:
+            case AV_CODEC_ID_VP9:
+                i_max = 32;
+                break;
+            default:
+                i_max = 16;
+                break;
+        }
+
+    int64_t i_count = var_InheritInteger( p_dec, "avcodec-threads" );
+    if( i_count > 0 )
+        return __MIN( i_count, i_max );
+
+    i_count = vlc_GetCPUCount();
+    if( i_count > 1 )
+        i_count++;
+
+    /* Small pictures give the threads too little work: allow about one
+     * thread per 16th of 1080p, and at least 4 */
+    const uint64_t i_pixels = (uint64_t)fmt->i_width * fmt->i_height;
+    if( i_pixels > 0 )
+        i_max = __MIN( i_max, __MAX( i_pixels / (1920 * 1080 / 16), 4 ) );
+#if VLC_WINSTORE_APP
+    i_max = __MIN( i_max, 6 );
+#endif
+    return __MIN( i_count, i_max );
+}
+
+/**
+ * Reserves up to i_count threads from the process-wide budget.
+ *
+ * \return the number of reserved threads, at least one
+ */
+static unsigned ReserveThreads( decoder_t *p_dec, unsigned i_count )
+{
+    unsigned i_budget = var_InheritInteger( p_dec, "avcodec-thread-budget" );
+    if( i_budget == 0 )
+        i_budget = 2 * vlc_GetCPUCount();
+
+    vlc_mutex_lock( &thread_budget_lock );
+    unsigned i_left = i_budget > thread_budget_used
+                    ? i_budget - thread_budget_used : 0;
+    i_count = __MIN( i_count, __MAX( i_left, 1 ) );
+    thread_budget_used += i_count;
+    vlc_mutex_unlock( &thread_budget_lock );
+    return i_count;
+}
+
+static void ReleaseThreads( unsigned i_count )
+{
+    vlc_mutex_lock( &thread_budget_lock );
+    assert( thread_budget_used >= i_count );
+    thread_budget_used -= i_count;
+    vlc_mutex_unlock( &thread_budget_lock );
+}
+
 /*****************************************************************************
  * Local Functions
  *****************************************************************************/
@@ -485,25 +564,36 @@ static int OpenVideoCodec( decoder_t *p_dec )
     if( ret < 0 )
         return ret;
 
+    enum vlc_decoder_thread_type thread_type = VLC_DECODER_THREAD_NONE;
+
     switch( ctx->active_thread_type )
     {
         case FF_THREAD_FRAME:
             msg_Dbg( p_dec, "using frame thread mode with %d threads",
                      ctx->thread_count );
+            thread_type = VLC_DECODER_THREAD_FRAME;
             break;
         case FF_THREAD_SLICE:
             msg_Dbg( p_dec, "using slice thread mode with %d threads",
                      ctx->thread_count );
+            thread_type = VLC_DECODER_THREAD_SLICE;
             break;
         case 0:
             if( ctx->thread_count > 1 )
                 msg_Warn( p_dec, "failed to enable threaded decoding" );
+            /* Give the threads back to the other decoders */
+            if( p_sys->i_threads > 1 )
+            {
+                ReleaseThreads( p_sys->i_threads - 1 );
+                p_sys->i_threads = 1;
+            }
             break;
         default:
             msg_Warn( p_dec, "using unknown thread mode with %d threads",
                       ctx->thread_count );
             break;
     }
+    decoder_UpdateThreads( p_dec, thread_type, ctx->thread_count );
     return 0;
 }
 
@@ -606,24 +696,17 @@ int InitVideoDec( vlc_object_t *obj )
     p_context->opaque = p_dec;
     p_context->reordered_opaque = 0;
 
-    int i_thread_count = var_InheritInteger( p_dec, "avcodec-threads" );
-    if( i_thread_count <= 0 )
+    switch( var_InheritInteger( p_dec, "avcodec-thread-type" ) )
     {
-        i_thread_count = vlc_GetCPUCount();
-        if( i_thread_count > 1 )
-            i_thread_count++;
-
-        //FIXME: take in count the decoding time
-#if VLC_WINSTORE_APP
-        i_thread_count = __MIN( i_thread_count, 6 );
-#else
-        i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 10 : 6 );
-#endif
+        case 1:
+            p_context->thread_type = FF_THREAD_FRAME;
+            break;
+        case 2:
+            p_context->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            break;
     }
-    i_thread_count = __MIN( i_thread_count, p_codec->id == AV_CODEC_ID_HEVC ? 32 : 16 );
-    msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
-    p_context->thread_count = i_thread_count;
-    p_context->thread_safe_callbacks = true;
 
     switch( p_codec->id )
     {
@@ -645,6 +728,19 @@ int InitVideoDec( vlc_object_t *obj )
             break;
     }
 
+    unsigned i_thread_count = 1;
+    if( p_context->thread_type != 0 )
+        i_thread_count = GetThreadCount( p_dec, p_codec );
+    p_sys->i_threads = ReserveThreads( p_dec, i_thread_count );
+    if( p_sys->i_threads < i_thread_count )
+        msg_Dbg( p_dec, "allowing %u thread(s) for decoding, %u wanted",
+                 p_sys->i_threads, i_thread_count );
+    else
+        msg_Dbg( p_dec, "allowing %u thread(s) for decoding",
+                 p_sys->i_threads );
+    p_context->thread_count = p_sys->i_threads;
+    p_context->thread_safe_callbacks = true;
+
     if( p_context->thread_type & FF_THREAD_FRAME )
         p_dec->i_extra_picture_buffers = 2 * p_context->thread_count;
 
@@ -680,6 +776,7 @@ int InitVideoDec( vlc_object_t *obj )
     /* ***** Open the codec ***** */
     if( OpenVideoCodec( p_dec ) < 0 )
     {
+        ReleaseThreads( p_sys->i_threads );
         vlc_sem_destroy( &p_sys->sem_mt );
         free( p_sys );
         avcodec_free_context( &p_context );
@@ -1377,6 +1474,7 @@ void EndVideoDec( vlc_object_t *obj )
     if( p_sys->p_va )
         vlc_va_Delete( p_sys->p_va, &hwaccel_context );
 
+    ReleaseThreads( p_sys->i_threads );
     vlc_sem_destroy( &p_sys->sem_mt );
     free( p_sys );
 }
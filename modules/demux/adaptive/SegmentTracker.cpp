@@ -87,6 +87,7 @@ SegmentTracker::SegmentTracker(AbstractAdaptationLogic *logic_, BaseAdaptationSe
     setAdaptationLogic(logic_);
     adaptationSet = adaptSet;
     format = StreamFormat::UNSUPPORTED;
+    prefetchCount = 0;
 }
 
 SegmentTracker::~SegmentTracker()
@@ -127,6 +128,7 @@ bool SegmentTracker::segmentsListReady() const
 
 void SegmentTracker::reset()
 {
+    releasePrefetchedChunks();
     notify(SegmentTrackerEvent(curRepresentation, NULL));
     curRepresentation = NULL;
     init_sent = false;
@@ -165,6 +167,7 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
 
     if(rep != curRepresentation)
     {
+        releasePrefetchedChunks();
         notify(SegmentTrackerEvent(curRepresentation, rep));
         prevRep = curRepresentation;
         curRepresentation = rep;
@@ -246,7 +249,9 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
         initializing = false;
     }
 
-    SegmentChunk *chunk = segment->toChunk(next, rep, connManager);
+    SegmentChunk *chunk = getPrefetchedChunk(next);
+    if(!chunk)
+        chunk = segment->toChunk(next, rep, connManager);
 
     /* Notify new segment length for stats / logic */
     if(chunk)
@@ -273,11 +278,66 @@ SegmentChunk * SegmentTracker::getNextChunk(bool switch_allowed,
     {
         curNumber = next;
         next++;
+        prefetchChunks(rep, connManager);
     }
 
     return chunk;
 }
 
+void SegmentTracker::setPrefetchCount(unsigned count)
+{
+    prefetchCount = count;
+}
+
+SegmentChunk * SegmentTracker::getPrefetchedChunk(uint64_t number)
+{
+    if(prefetched.empty())
+        return NULL;
+
+    if(prefetched.front().number == number)
+    {
+        SegmentChunk *chunk = prefetched.front().chunk;
+        prefetched.pop_front();
+        return chunk;
+    }
+
+    /* Out of sequence (seek, gap), drop look-ahead */
+    releasePrefetchedChunks();
+    return NULL;
+}
+
+void SegmentTracker::prefetchChunks(BaseRepresentation *rep, AbstractConnectionManager *connManager)
+{
+    /* Live segments beyond the current one might not be available yet */
+    if(rep->getPlaylist()->isLive())
+        return;
+
+    uint64_t number = prefetched.empty() ? next : prefetched.back().number + 1;
+    while(prefetched.size() < prefetchCount)
+    {
+        bool b_gap = false;
+        ISegment *segment = rep->getNextSegment(BaseRepresentation::INFOTYPE_MEDIA,
+                                                number, &number, &b_gap);
+        if(!segment)
+            break;
+
+        SegmentChunk *chunk = segment->toChunk(number, rep, connManager);
+        if(!chunk)
+            break;
+
+        prefetched.push_back(PrefetchedChunk(chunk, number));
+        number++;
+    }
+}
+
+void SegmentTracker::releasePrefetchedChunks()
+{
+    std::list<PrefetchedChunk>::const_iterator it;
+    for(it = prefetched.begin(); it != prefetched.end(); ++it)
+        delete (*it).chunk;
+    prefetched.clear();
+}
+
 bool SegmentTracker::setPositionByTime(vlc_tick_t time, bool restarted, bool tryonly)
 {
     uint64_t segnumber;
@@ -303,6 +363,7 @@ void SegmentTracker::setPositionByNumber(uint64_t segnumber, bool restarted)
         index_sent = false;
         init_sent = false;
     }
+    releasePrefetchedChunks();
     curNumber = next = segnumber;
 }
 
@@ -127,10 +127,14 @@ namespace adaptive
             void notifyBufferingLevel(vlc_tick_t, vlc_tick_t, vlc_tick_t) const;
             void registerListener(SegmentTrackerListenerInterface *);
             void updateSelected();
+            void setPrefetchCount(unsigned);
 
         private:
             void setAdaptationLogic(AbstractAdaptationLogic *);
             void notify(const SegmentTrackerEvent &) const;
+            SegmentChunk * getPrefetchedChunk(uint64_t);
+            void prefetchChunks(BaseRepresentation *, AbstractConnectionManager *);
+            void releasePrefetchedChunks();
             bool first;
             bool initializing;
             bool index_sent;
@@ -142,6 +146,18 @@ namespace adaptive
             BaseAdaptationSet *adaptationSet;
             BaseRepresentation *curRepresentation;
             std::list<SegmentTrackerListenerInterface *> listeners;
+            /* Look-ahead: next media chunks of curRepresentation, in order,
+             * already scheduled for download */
+            class PrefetchedChunk
+            {
+                public:
+                    PrefetchedChunk(SegmentChunk *c, uint64_t n)
+                        : chunk(c), number(n) {}
+                    SegmentChunk *chunk;
+                    uint64_t number;
+            };
+            std::list<PrefetchedChunk> prefetched;
+            unsigned prefetchCount;
     };
 }
 
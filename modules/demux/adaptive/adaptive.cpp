@@ -76,6 +76,13 @@ static void Close   (vlc_object_t *);
 #define ADAPT_ACCESS_TEXT N_("Use regular HTTP modules")
 #define ADAPT_ACCESS_LONGTEXT N_("Connect using HTTP access instead of custom HTTP code")
 
+#define ADAPT_THREADS_TEXT N_("Download threads")
+#define ADAPT_THREADS_LONGTEXT N_("Number of segments downloaded in parallel")
+
+#define ADAPT_PREFETCH_TEXT N_("Segments look-ahead")
+#define ADAPT_PREFETCH_LONGTEXT N_("Number of next segments to download in " \
+                                   "advance for each stream (non live only)")
+
 static const AbstractAdaptationLogic::LogicType pi_logics[] = {
                                 AbstractAdaptationLogic::Default,
                                 AbstractAdaptationLogic::Predictive,
@@ -122,6 +129,10 @@ vlc_module_begin ()
                      ADAPT_HEIGHT_TEXT, ADAPT_HEIGHT_TEXT, false )
         add_integer( "adaptive-bw",     250, ADAPT_BW_TEXT,     ADAPT_BW_LONGTEXT,     false )
         add_bool   ( "adaptive-use-access", false, ADAPT_ACCESS_TEXT, ADAPT_ACCESS_LONGTEXT, true );
+        add_integer_with_range( "adaptive-download-threads", 1, 1, 8,
+                                ADAPT_THREADS_TEXT, ADAPT_THREADS_LONGTEXT, true )
+        add_integer_with_range( "adaptive-prefetch", 0, 0, 8,
+                                ADAPT_PREFETCH_TEXT, ADAPT_PREFETCH_LONGTEXT, true )
         set_callbacks( Open, Close )
 vlc_module_end ()
 
@@ -29,43 +29,47 @@
 
 using namespace adaptive::http;
 
-Downloader::Downloader()
+Downloader::Downloader(unsigned threads)
 {
     vlc_mutex_init(&lock);
     vlc_cond_init(&waitcond);
+    vlc_cond_init(&updatedcond);
     killed = false;
-    thread_handle_valid = false;
+    thread_count = threads ? threads : 1;
 }
 
 bool Downloader::start()
 {
-    if(!thread_handle_valid &&
-       vlc_clone(&thread_handle, downloaderThread,
-                 static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+    while(thread_handles.size() < thread_count)
     {
-        return false;
+        vlc_thread_t thread_handle;
+        if(vlc_clone(&thread_handle, downloaderThread,
+                     static_cast<void *>(this), VLC_THREAD_PRIORITY_INPUT))
+            break;
+        thread_handles.push_back(thread_handle);
     }
-    thread_handle_valid = true;
-    return true;
+    return !thread_handles.empty();
 }
 
 Downloader::~Downloader()
 {
     vlc_mutex_lock( &lock );
     killed = true;
-    vlc_cond_signal(&waitcond);
+    vlc_cond_broadcast(&waitcond);
     vlc_mutex_unlock( &lock );
 
-    if(thread_handle_valid)
-        vlc_join(thread_handle, NULL);
+    std::vector<vlc_thread_t>::const_iterator it;
+    for(it = thread_handles.begin(); it != thread_handles.end(); ++it)
+        vlc_join(*it, NULL);
     vlc_mutex_destroy(&lock);
     vlc_cond_destroy(&waitcond);
+    vlc_cond_destroy(&updatedcond);
 }
 void Downloader::schedule(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
     source->hold();
-    chunks.push_back(source);
+    queues[source->sourceid].push_back(source);
     vlc_cond_signal(&waitcond);
     vlc_mutex_unlock(&lock);
 }
@@ -73,8 +77,11 @@ void Downloader::schedule(HTTPChunkBufferedSource *source)
 void Downloader::cancel(HTTPChunkBufferedSource *source)
 {
     vlc_mutex_lock(&lock);
+    /* wait for the worker to finish its current read */
+    while(isDownloading(source))
+        vlc_cond_wait(&updatedcond, &lock);
     source->release();
-    chunks.remove(source);
+    remove(source);
     vlc_mutex_unlock(&lock);
 }
 
@@ -93,27 +100,82 @@ void Downloader::DownloadSource(HTTPChunkBufferedSource *source)
         source->bufferize(HTTPChunkSource::CHUNK_SIZE);
 }
 
+bool Downloader::isDownloading(const HTTPChunkBufferedSource *source) const
+{
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = current.begin(); it != current.end(); ++it)
+        if(*it == source)
+            return true;
+    return false;
+}
+
+void Downloader::remove(HTTPChunkBufferedSource *source)
+{
+    std::map<ID, std::list<HTTPChunkBufferedSource *> >::iterator it =
+            queues.find(source->sourceid);
+    if(it == queues.end())
+        return;
+    (*it).second.remove(source);
+    if((*it).second.empty())
+        queues.erase(it);
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource(const std::list<HTTPChunkBufferedSource *> &queue) const
+{
+    /* Oldest source that no other worker is downloading */
+    std::list<HTTPChunkBufferedSource *>::const_iterator it;
+    for(it = queue.begin(); it != queue.end(); ++it)
+        if(!isDownloading(*it))
+            return *it;
+    return NULL;
+}
+
+HTTPChunkBufferedSource * Downloader::getNextSource()
+{
+    /* Take from the streams queues in turn, starting after the last served,
+     * so that a stream with many queued segments does not starve others */
+    std::map<ID, std::list<HTTPChunkBufferedSource *> >::const_iterator start =
+            queues.upper_bound(lastqueue);
+    std::map<ID, std::list<HTTPChunkBufferedSource *> >::const_iterator it = start;
+    for(size_t i = 0; i < queues.size(); i++, ++it)
+    {
+        if(it == queues.end())
+            it = queues.begin();
+        HTTPChunkBufferedSource *source = getNextSource((*it).second);
+        if(source)
+        {
+            lastqueue = (*it).first;
+            return source;
+        }
+    }
+    return NULL;
+}
+
 void Downloader::Run()
 {
     vlc_mutex_lock(&lock);
     while(1)
     {
-        while(chunks.empty() && !killed)
+        HTTPChunkBufferedSource *source;
+        while((source = getNextSource()) == NULL && !killed)
             vlc_cond_wait(&waitcond, &lock);
 
         if(killed)
             break;
 
-        if(!chunks.empty())
+        current.push_back(source);
+        vlc_mutex_unlock(&lock);
+
+        DownloadSource(source);
+
+        vlc_mutex_lock(&lock);
+        current.remove(source);
+        if(source->isDone())
         {
-            HTTPChunkBufferedSource *source = chunks.front();
-            DownloadSource(source);
-            if(source->isDone())
-            {
-                chunks.pop_front();
-                source->release();
-            }
+            remove(source);
+            source->release();
         }
+        vlc_cond_broadcast(&updatedcond);
     }
     vlc_mutex_unlock(&lock);
 }
@@ -21,9 +21,12 @@
 #define DOWNLOADER_HPP
 
 #include "Chunk.h"
+#include "../ID.hpp"
 
 #include <vlc_common.h>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace adaptive
 {
@@ -34,7 +37,7 @@ namespace adaptive
         class Downloader
         {
             public:
-                Downloader();
+                Downloader(unsigned = 1);
                 ~Downloader();
                 bool start();
                 void schedule(HTTPChunkBufferedSource *);
@@ -44,12 +47,20 @@ namespace adaptive
                 static void * downloaderThread(void *);
                 void Run();
                 void DownloadSource(HTTPChunkBufferedSource *);
-                vlc_thread_t thread_handle;
+                HTTPChunkBufferedSource * getNextSource();
+                HTTPChunkBufferedSource * getNextSource(const std::list<HTTPChunkBufferedSource *> &) const;
+                void remove(HTTPChunkBufferedSource *);
+                bool isDownloading(const HTTPChunkBufferedSource *) const;
+                std::vector<vlc_thread_t> thread_handles;
+                unsigned     thread_count;
                 vlc_mutex_t  lock;
                 vlc_cond_t   waitcond;
-                bool         thread_handle_valid;
+                vlc_cond_t   updatedcond;
                 bool         killed;
-                std::list<HTTPChunkBufferedSource *> chunks;
+                /* queued sources of each stream, served in turn */
+                std::map<ID, std::list<HTTPChunkBufferedSource *> > queues;
+                ID           lastqueue; /* stream served last */
+                std::list<HTTPChunkBufferedSource *> current; /* being downloaded */
         };
 
     }
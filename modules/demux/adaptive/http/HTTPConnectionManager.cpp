@@ -62,7 +62,7 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, Abstra
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    downloader = new (std::nothrow) Downloader(var_InheritInteger(p_object, "adaptive-download-threads"));
     downloader->start();
     factory = factory_;
 }
@@ -71,7 +71,7 @@ HTTPConnectionManager::HTTPConnectionManager    (vlc_object_t *p_object_, AuthSt
     : AbstractConnectionManager( p_object_ )
 {
     vlc_mutex_init(&lock);
-    downloader = new (std::nothrow) Downloader();
+    downloader = new (std::nothrow) Downloader(var_InheritInteger(p_object, "adaptive-download-threads"));
     downloader->start();
     factory = new ConnectionFactory(storage);
 }
@@ -33,6 +33,8 @@
 #include "../http/Chunk.h"
 #include "../tools/Debug.hpp"
 
+#include <algorithm>
+
 using namespace adaptive::logic;
 using namespace adaptive;
 
@@ -42,9 +44,8 @@ RateBasedAdaptationLogic::RateBasedAdaptationLogic  (vlc_object_t *p_obj_) :
                           currentBps(0)
 {
     usedBps = 0;
-    dllength = 0;
     p_obj = p_obj_;
-    dlsize = 0;
+    dlwindowstart = VLC_TICK_INVALID;
     vlc_mutex_init(&lock);
 }
 
@@ -78,20 +79,73 @@ BaseRepresentation *RateBasedAdaptationLogic::getNextRepresentation(BaseAdaptati
     return rep;
 }
 
+vlc_tick_t RateBasedAdaptationLogic::getActiveTime(std::vector<DownloadInterval> &intervals)
+{
+    /* Length of the union of the intervals */
+    std::sort(intervals.begin(), intervals.end());
+
+    vlc_tick_t active = 0;
+    vlc_tick_t end = VLC_TICK_INVALID;
+    std::vector<DownloadInterval>::const_iterator it;
+    for(it = intervals.begin(); it != intervals.end(); ++it)
+    {
+        if(end == VLC_TICK_INVALID || (*it).start >= end)
+        {
+            active += (*it).end - (*it).start;
+            end = (*it).end;
+        }
+        else if((*it).end > end)
+        {
+            active += (*it).end - end;
+            end = (*it).end;
+        }
+    }
+    return active;
+}
+
 void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, vlc_tick_t time)
 {
-    if(unlikely(time == 0))
+    if(unlikely(time <= 0))
         return;
-    /* Accumulate up to observation window */
-    dllength += time;
-    dlsize += size;
 
+    /* Downloads can complete concurrently */
+    vlc_mutex_lock(&lock);
+
+    DownloadInterval interval;
+    interval.end = vlc_tick_now();
+    interval.start = interval.end - time;
+    interval.size = size;
+
+    /* Only account for the part after the previous observation window,
+     * assuming a steady rate over the download */
+    if(dlwindowstart != VLC_TICK_INVALID && interval.start < dlwindowstart)
+    {
+        if(interval.end <= dlwindowstart)
+        {
+            vlc_mutex_unlock(&lock);
+            return;
+        }
+        interval.size = size * (interval.end - dlwindowstart) / time;
+        interval.start = dlwindowstart;
+    }
+    dlintervals.push_back(interval);
+
+    /* Accumulate up to observation window. Parallel downloads overlap,
+     * so the rate is the total size over the time any of them was active */
+    const vlc_tick_t dllength = getActiveTime(dlintervals);
     if(dllength < VLC_TICK_FROM_MS(250))
+    {
+        vlc_mutex_unlock(&lock);
         return;
+    }
+
+    size_t dlsize = 0;
+    std::vector<DownloadInterval>::const_iterator it;
+    for(it = dlintervals.begin(); it != dlintervals.end(); ++it)
+        dlsize += (*it).size;
 
     const size_t bps = CLOCK_FREQ * dlsize * 8 / dllength;
 
-    vlc_mutex_lock(&lock);
     bpsAvg = average.push(bps);
 
 //    BwDebug(msg_Dbg(p_obj, "alpha1 %lf alpha0 %lf dmax %ld ds %ld", alpha,
@@ -100,7 +154,8 @@ void RateBasedAdaptationLogic::updateDownloadRate(const ID &, size_t size, vlc_t
                             bps / 8000, bpsAvg / 8000));
 
     currentBps = bpsAvg * 3/4;
-    dlsize = dllength = 0;
+    dlintervals.clear();
+    dlwindowstart = interval.end;
 
     BwDebug(msg_Info(p_obj, "Current bandwidth %zu KiB/s using %u%%",
                     (bpsAvg / 8000), (bpsAvg) ? (unsigned)(usedBps * 100.0 / bpsAvg) : 0));
@@ -28,6 +28,8 @@
 #include "AbstractAdaptationLogic.h"
 #include "../tools/MovingAverage.hpp"
 
+#include <vector>
+
 namespace adaptive
 {
     namespace logic
@@ -44,6 +46,20 @@ namespace adaptive
                 virtual void trackerEvent(const SegmentTrackerEvent &); /* reimpl */
 
             private:
+                /* Download reported over an observation window */
+                struct DownloadInterval
+                {
+                    vlc_tick_t start;
+                    vlc_tick_t end;
+                    size_t     size;
+                    bool operator<(const DownloadInterval &other) const
+                    {
+                        return start < other.start;
+                    }
+                };
+
+                static vlc_tick_t getActiveTime(std::vector<DownloadInterval> &);
+
                 size_t                  bpsAvg;
                 size_t                  currentBps;
                 size_t                  usedBps;
@@ -51,8 +67,8 @@ namespace adaptive
 
                 MovingAverage<size_t>   average;
 
-                size_t                  dlsize;
-                vlc_tick_t              dllength;
+                std::vector<DownloadInterval> dlintervals;
+                vlc_tick_t              dlwindowstart;
 
                 vlc_mutex_t             lock;
         };
@@ -34,6 +34,7 @@
 #include <vlc_access.h>    /* DVB-specific things */
 #include <vlc_demux.h>
 #include <vlc_input.h>
+#include <vlc_atomic.h>
 
 #include "ts_pid.h"
 #include "ts_streams.h"
@@ -118,6 +119,12 @@ static void Close ( vlc_object_t * );
 #define TS_SKIP_GHOST_PROGRAM_TEXT "Only create ES on program sending data"
 #define TS_OFFSETFIX_TEXT   "Try to fix too early PCR (or late DTS)"
 
+#define BATCH_TEXT N_("Batched packet reading")
+#define BATCH_LONGTEXT N_("Number of TS packets read from the stream at " \
+    "once. Packets are then handed out without any further copy or " \
+    "allocation, but a packet kept for long holds its whole batch in " \
+    "memory. 0 reads packets one by one.")
+
 #define PCR_TEXT N_("Trust in-stream PCR")
 #define PCR_LONGTEXT N_("Use the stream PCR as a reference.")
 
@@ -159,6 +166,8 @@ vlc_module_begin ()
     add_bool( "ts-pmtfix-waitdata", true, TS_SKIP_GHOST_PROGRAM_TEXT, NULL, true )
     add_bool( "ts-patfix", true, TS_PATFIX_TEXT, NULL, true )
     add_bool( "ts-pcr-offsetfix", true, TS_OFFSETFIX_TEXT, NULL, true )
+    add_integer_with_range( "ts-batch-read", 0, 0, 1024,
+                            BATCH_TEXT, BATCH_LONGTEXT, true )
 
     add_obsolete_bool( "ts-silent" );
 
@@ -192,6 +201,9 @@ static bool GatherSectionsData( demux_t *p_demux, ts_pid_t *, block_t *, size_t
 static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_prg, stime_t i_pcr );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
+static void ReadTSPacketFlush( demux_sys_t *p_sys );
+static uint64_t TsStreamTell( demux_sys_t *p_sys );
+static int TsStreamSeek( demux_sys_t *p_sys, uint64_t i_pos );
 static int SeekToTime( demux_t *p_demux, const ts_pmt_t *, stime_t time );
 static void ReadyQueuesPostSeek( demux_t *p_demux );
 static void PCRHandle( demux_t *p_demux, ts_pid_t *, stime_t );
@@ -400,6 +412,10 @@ static int Open( vlc_object_t *p_this )
     p_sys->i_packet_size = i_packet_size;
     p_sys->i_packet_header_size = i_packet_header_size;
     p_sys->i_ts_read = 50;
+    p_sys->batch.i_packets = var_InheritInteger( p_demux, "ts-batch-read" );
+    p_sys->batch.p_chunk = NULL;
+    p_sys->batch.i_offset = 0;
+    p_sys->batch.i_synced = 0;
     p_sys->csa = NULL;
     p_sys->b_start_record = false;
 
@@ -582,6 +598,8 @@ static void Close( vlc_object_t *p_this )
 
     vlc_mutex_destroy( &p_sys->csa_lock );
 
+    ReadTSPacketFlush( p_sys );
+
     /* Release all non default pids */
     ts_pid_list_Release( p_demux, &p_sys->pids );
 
@@ -666,6 +684,18 @@ static int Demux( demux_t *p_demux )
 
         /* Parse the TS packet */
         ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
+
+        /* Emulate HW filter before any processing. Only packets without
+         * adaptation field nor scrambling state change are dropped here,
+         * as they only carry payload of the unselected ES */
+        if( ts_pid_IsIgnored( &p_sys->pids, p_pid->i_pid ) &&
+            p_pid->type == TYPE_STREAM && !(p_pid->i_flags & FLAG_FILTERED) &&
+            p_sys->es_creation == CREATE_ES &&
+            (p_pkt->p_buffer[3] & 0xE0) == 0 && !SCRAMBLED(*p_pid) )
+        {
+            block_Release( p_pkt );
+            continue;
+        }
         if( !SEEN(p_pid) )
         {
             if( p_pid->type == TYPE_FREE )
@@ -723,6 +753,7 @@ static int Demux( demux_t *p_demux )
             if( !p_sys->b_access_control && !(p_pid->i_flags & FLAG_FILTERED) )
             {
                 /* That packet is for an unselected ES, don't waste time/memory gathering its data */
+                ts_pid_SetIgnored( &p_sys->pids, p_pid, true );
                 block_Release( p_pkt );
                 continue;
             }
@@ -950,7 +981,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( (i64 = stream_Size( p_sys->stream) ) > 0 )
         {
-            uint64_t offset = vlc_stream_Tell( p_sys->stream );
+            uint64_t offset = TsStreamTell( p_sys );
             *pf = (double)offset / (double)i64;
             return VLC_SUCCESS;
         }
@@ -997,7 +1028,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         i64 = stream_Size( p_sys->stream );
         if( i64 > 0 &&
-            vlc_stream_Seek( p_sys->stream, (int64_t)(i64 * f) ) == VLC_SUCCESS )
+            TsStreamSeek( p_sys, (int64_t)(i64 * f) ) == VLC_SUCCESS )
         {
             ReadyQueuesPostSeek( p_demux );
             return VLC_SUCCESS;
@@ -1723,12 +1754,224 @@ static bool PushPESBlock( demux_t *p_demux, ts_pid_t *pid, block_t *p_pkt, bool
     return b_ret;
 }
 
+/*****************************************************************************
+ * Batched packet reading:
+ *  Packets are read by chunks of ts-batch-read packets, and handed out as
+ *  blocks pointing inside the chunk, which stays alive until all of them
+ *  have been released.
+ *  A single packet held downstream, typically the start of a PES of a low
+ *  bitrate PID waiting for its end, thus pins its whole chunk: at most
+ *  1024 * 192 bytes per packet held. PES spanning several packets are
+ *  gathered into a new block, so this mostly lasts until the PES is
+ *  complete.
+ *****************************************************************************/
+struct ts_packet_view_t
+{
+    block_t            self;
+    ts_packet_chunk_t *p_chunk;
+};
+
+struct ts_packet_chunk_t
+{
+    vlc_atomic_rc_t rc;
+    uint8_t        *p_data;
+    size_t          i_size;     /* bytes read */
+    size_t          i_capacity;
+    unsigned        i_views;    /* packet blocks handed out */
+    struct ts_packet_view_t views[];
+};
+
+static void PacketChunkRelease( ts_packet_chunk_t *p_chunk )
+{
+    if( vlc_atomic_rc_dec( &p_chunk->rc ) )
+        free( p_chunk );
+}
+
+static void PacketViewRelease( block_t *p_block )
+{
+    struct ts_packet_view_t *p_view =
+            container_of( p_block, struct ts_packet_view_t, self );
+    PacketChunkRelease( p_view->p_chunk );
+}
+
+static const struct vlc_block_callbacks packet_view_cbs =
+{
+    PacketViewRelease,
+};
+
+static ts_packet_chunk_t * PacketChunkNew( unsigned i_packets, size_t i_packet_size )
+{
+    ts_packet_chunk_t *p_chunk = malloc( sizeof(*p_chunk) + i_packets *
+                                         (sizeof(p_chunk->views[0]) + i_packet_size) );
+    if( unlikely(p_chunk == NULL) )
+        return NULL;
+    vlc_atomic_rc_init( &p_chunk->rc );
+    p_chunk->p_data = (uint8_t *) &p_chunk->views[i_packets];
+    p_chunk->i_size = 0;
+    p_chunk->i_capacity = i_packets * i_packet_size;
+    p_chunk->i_views = 0;
+    return p_chunk;
+}
+
+static void ReadTSPacketFlush( demux_sys_t *p_sys )
+{
+    if( p_sys->batch.p_chunk )
+        PacketChunkRelease( p_sys->batch.p_chunk );
+    p_sys->batch.p_chunk = NULL;
+    p_sys->batch.i_offset = 0;
+    p_sys->batch.i_synced = 0;
+}
+
+/* Logical stream position, ie. minus what is buffered and not yet demuxed */
+static uint64_t TsStreamTell( demux_sys_t *p_sys )
+{
+    uint64_t i_pos = vlc_stream_Tell( p_sys->stream );
+    if( p_sys->batch.p_chunk )
+        i_pos -= p_sys->batch.p_chunk->i_size - p_sys->batch.i_offset;
+    return i_pos;
+}
+
+static int TsStreamSeek( demux_sys_t *p_sys, uint64_t i_pos )
+{
+    ReadTSPacketFlush( p_sys );
+    return vlc_stream_Seek( p_sys->stream, i_pos );
+}
+
+/* Ensures at least i_min unread bytes are buffered */
+static bool ReadTSPacketChunk( demux_t *p_demux, size_t i_min )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_packet_chunk_t *p_chunk = p_sys->batch.p_chunk;
+    size_t i_left = p_chunk ? p_chunk->i_size - p_sys->batch.i_offset : 0;
+
+    if( i_left >= i_min )
+        return true;
+
+    /* Batching was turned off (see ts_psi.c) and chunk is drained */
+    if( p_sys->batch.i_packets == 0 )
+    {
+        ReadTSPacketFlush( p_sys );
+        return false;
+    }
+
+    if( p_chunk == NULL || p_chunk->i_capacity - p_sys->batch.i_offset < i_min )
+    {
+        /* Not enough room left, move the unread tail to a new chunk */
+        ts_packet_chunk_t *p_new = PacketChunkNew( __MAX(p_sys->batch.i_packets, 4),
+                                                   p_sys->i_packet_size );
+        if( unlikely(p_new == NULL) )
+            return false;
+        if( i_left )
+            memcpy( p_new->p_data, &p_chunk->p_data[p_sys->batch.i_offset], i_left );
+        p_new->i_size = i_left;
+        if( p_chunk )
+            PacketChunkRelease( p_chunk );
+        p_sys->batch.p_chunk = p_chunk = p_new;
+        p_sys->batch.i_offset = 0;
+        p_sys->batch.i_synced = 0;
+    }
+
+    /* Only wait for what is required, so that live streams are not delayed */
+    do
+    {
+        ssize_t i_read = vlc_stream_ReadPartial( p_sys->stream,
+                                                 &p_chunk->p_data[p_chunk->i_size],
+                                                 p_chunk->i_capacity - p_chunk->i_size );
+        if( i_read <= 0 )
+            return false;
+        p_chunk->i_size += i_read;
+    } while( p_chunk->i_size - p_sys->batch.i_offset < i_min );
+
+    return true;
+}
+
+static block_t* ReadTSPacketBatched( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const size_t i_packet_size = p_sys->i_packet_size;
+    const unsigned i_header = p_sys->i_packet_header_size;
+
+    if( !ReadTSPacketChunk( p_demux, i_packet_size ) )
+    {
+        msg_Dbg( p_demux, "EOF at %"PRIu64, TsStreamTell( p_sys ) );
+        return NULL;
+    }
+
+    ts_packet_chunk_t *p_chunk = p_sys->batch.p_chunk;
+
+    /* Check sync bytes of all buffered packets at once */
+    if( p_sys->batch.i_offset >= p_sys->batch.i_synced )
+    {
+        size_t i_pos = p_sys->batch.i_offset;
+        while( i_pos + i_packet_size <= p_chunk->i_size &&
+               p_chunk->p_data[i_pos + i_header] == 0x47 )
+            i_pos += i_packet_size;
+        p_sys->batch.i_synced = i_pos;
+    }
+
+    if( p_sys->batch.i_offset == p_sys->batch.i_synced )
+    {
+        msg_Warn( p_demux, "lost synchro" );
+        for( ;; )
+        {
+            if( !ReadTSPacketChunk( p_demux, i_packet_size + i_header + 1 ) )
+            {
+                msg_Dbg( p_demux, "eof ?" );
+                return NULL;
+            }
+            p_chunk = p_sys->batch.p_chunk;
+
+            const uint8_t *p_peek = &p_chunk->p_data[p_sys->batch.i_offset];
+            size_t i_peek = p_chunk->i_size - p_sys->batch.i_offset;
+            size_t i_skip = 0;
+
+            while( i_skip + i_header + i_packet_size < i_peek )
+            {
+                if( p_peek[i_skip + i_header] == 0x47 &&
+                    p_peek[i_skip + i_header + i_packet_size] == 0x47 )
+                    break;
+                i_skip++;
+            }
+            msg_Dbg( p_demux, "skipping %zu bytes of garbage", i_skip );
+            p_sys->batch.i_offset += i_skip;
+
+            if( i_skip + i_header + i_packet_size < i_peek )
+                break;
+        }
+        p_sys->batch.i_synced = p_sys->batch.i_offset + i_packet_size;
+    }
+
+    /* Hand out the packet without copy */
+    assert( p_chunk->i_views < p_chunk->i_capacity / i_packet_size );
+    struct ts_packet_view_t *p_view = &p_chunk->views[p_chunk->i_views++];
+    p_view->p_chunk = p_chunk;
+    vlc_atomic_rc_inc( &p_chunk->rc );
+
+    block_t *p_pkt = block_Init( &p_view->self, &packet_view_cbs,
+                                 &p_chunk->p_data[p_sys->batch.i_offset],
+                                 i_packet_size );
+    p_sys->batch.i_offset += i_packet_size;
+
+    /* Skip header (BluRay streams), see ReadTSPacket */
+    p_pkt->p_buffer += i_header;
+    p_pkt->i_buffer -= i_header;
+    return p_pkt;
+}
+
 static block_t* ReadTSPacket( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
     block_t     *p_pkt;
 
+    if( p_sys->batch.i_packets > 0 || p_sys->batch.p_chunk )
+    {
+        p_pkt = ReadTSPacketBatched( p_demux );
+        if( p_pkt || p_sys->batch.i_packets > 0 )
+            return p_pkt;
+        /* batching was turned off and all buffered packets are consumed */
+    }
+
     /* Get a new TS packet */
     if( !( p_pkt = vlc_stream_Block( p_sys->stream, p_sys->i_packet_size ) ) )
     {
@@ -1906,13 +2149,13 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
 
     /* Deal with common but worst binary search case */
     if( p_pmt->pcr.i_first == i_scaledtime && p_sys->b_canseek )
-        return vlc_stream_Seek( p_sys->stream, 0 );
+        return TsStreamSeek( p_sys, 0 );
 
     const int64_t i_stream_size = stream_Size( p_sys->stream );
     if( !p_sys->b_canfastseek || i_stream_size < p_sys->i_packet_size )
         return VLC_EGENERIC;
 
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsStreamTell( p_sys );
 
     /* Find the time position by using binary search algorithm. */
     uint64_t i_head_pos = 0;
@@ -1928,7 +2171,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
         uint64_t i_div = i_splitpos % p_sys->i_packet_size;
         i_splitpos -= i_div;
 
-        if ( vlc_stream_Seek( p_sys->stream, i_splitpos ) != VLC_SUCCESS )
+        if ( TsStreamSeek( p_sys, i_splitpos ) != VLC_SUCCESS )
             break;
 
         uint64_t i_pos = i_splitpos;
@@ -1942,7 +2185,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
                 break;
             }
             else
-                i_pos = vlc_stream_Tell( p_sys->stream );
+                i_pos = TsStreamTell( p_sys );
 
             int i_pid = PIDGet( p_pkt );
             ts_pid_t *p_pid = GetPID(p_sys, i_pid);
@@ -1999,7 +2242,7 @@ static int SeekToTime( demux_t *p_demux, const ts_pmt_t *p_pmt, stime_t i_scaled
     if( !b_found )
     {
         msg_Dbg( p_demux, "Seek():cannot find a time position." );
-        vlc_stream_Seek( p_sys->stream, i_initial_pos );
+        TsStreamSeek( p_sys, i_initial_pos );
         return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
@@ -2080,7 +2323,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
                         if( b_end )
                         {
                             p_pmt->i_last_dts = *pi_pcr;
-                            p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                            p_pmt->i_last_dts_byte = TsStreamTell( p_sys );
                         }
                         /* Start, only keep first */
                         else if( b_pcrresult && p_pmt->pcr.i_first == -1 )
@@ -2108,7 +2351,7 @@ static int ProbeChunk( demux_t *p_demux, int i_program, bool b_end, stime_t *pi_
 int ProbeStart( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsStreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = 0;
@@ -2121,7 +2364,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
         i_pos = p_sys->i_packet_size * i_probe_count;
         i_pos = __MIN( i_pos, i_stream_size );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TsStreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, false, &i_pcr, &b_found );
@@ -2131,7 +2374,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
     } while( i_pos < i_stream_size && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TsStreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2140,7 +2383,7 @@ int ProbeStart( demux_t *p_demux, int i_program )
 int ProbeEnd( demux_t *p_demux, int i_program )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    const uint64_t i_initial_pos = vlc_stream_Tell( p_sys->stream );
+    const uint64_t i_initial_pos = TsStreamTell( p_sys );
     int64_t i_stream_size = stream_Size( p_sys->stream );
 
     int i_probe_count = PROBE_CHUNK_COUNT;
@@ -2153,7 +2396,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
         i_pos = i_stream_size - (p_sys->i_packet_size * i_probe_count);
         i_pos = __MAX( i_pos, 0 );
 
-        if( vlc_stream_Seek( p_sys->stream, i_pos ) )
+        if( TsStreamSeek( p_sys, i_pos ) )
             return VLC_EGENERIC;
 
         ProbeChunk( p_demux, i_program, true, &i_pcr, &b_found );
@@ -2163,7 +2406,7 @@ int ProbeEnd( demux_t *p_demux, int i_program )
     } while( i_pos > 0 && !b_found &&
              i_probe_count < PROBE_MAX );
 
-    if( vlc_stream_Seek( p_sys->stream, i_initial_pos ) )
+    if( TsStreamSeek( p_sys, i_initial_pos ) )
         return VLC_EGENERIC;
 
     return (b_found) ? VLC_SUCCESS : VLC_EGENERIC;
@@ -2214,14 +2457,14 @@ static void ProgramSetPCR( demux_t *p_demux, ts_pmt_t *p_pmt, stime_t i_pcr )
         es_out_Control( p_demux->out, ES_OUT_SET_GROUP_PCR, p_pmt->i_number, FROM_SCALE(i_pcr) );
         /* growing files/named fifo handling */
         if( p_sys->b_access_control == false &&
-            vlc_stream_Tell( p_sys->stream ) > p_pmt->i_last_dts_byte )
+            TsStreamTell( p_sys ) > p_pmt->i_last_dts_byte )
         {
             if( p_pmt->i_last_dts_byte == 0 ) /* first run */
                 p_pmt->i_last_dts_byte = stream_Size( p_sys->stream );
             else
             {
                 p_pmt->i_last_dts = i_pcr;
-                p_pmt->i_last_dts_byte = vlc_stream_Tell( p_sys->stream );
+                p_pmt->i_last_dts_byte = TsStreamTell( p_sys );
             }
         }
     }
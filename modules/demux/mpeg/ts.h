@@ -24,6 +24,7 @@
     typedef struct arib_instance_t arib_instance_t;
 #endif
 typedef struct csa_t csa_t;
+typedef struct ts_packet_chunk_t ts_packet_chunk_t;
 
 #define TS_USER_PMT_NUMBER (0)
 
@@ -70,6 +71,15 @@ struct demux_sys_t
     /* how many TS packet we read at once */
     unsigned    i_ts_read;
 
+    /* Batched packet reading (see ReadTSPacket), disabled if i_packets is 0 */
+    struct
+    {
+        unsigned           i_packets;
+        ts_packet_chunk_t *p_chunk;
+        size_t             i_offset; /* start of the next packet in chunk */
+        size_t             i_synced; /* sync bytes are checked up to there */
+    } batch;
+
     bool        b_cc_check;
     bool        b_ignore_time_for_positions;
 
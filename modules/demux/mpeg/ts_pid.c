@@ -42,8 +42,11 @@ void ts_pid_list_Init( ts_pid_list_t *p_list )
     p_list->pp_all = NULL;
     p_list->i_all = 0;
     p_list->i_all_alloc = 0;
-    p_list->i_last_pid = 0;
-    p_list->p_last = NULL;
+    memset( p_list->index, 0, sizeof(p_list->index) );
+    memset( p_list->ignored, 0, sizeof(p_list->ignored) );
+    p_list->index[0] = &p_list->pat;
+    p_list->index[0x1FFB] = &p_list->base_si;
+    p_list->index[0x1FFF] = &p_list->dummy;
 }
 
 void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
@@ -62,100 +65,65 @@ void ts_pid_list_Release( demux_t *p_demux, ts_pid_list_t *p_list )
     free( p_list->pp_all );
 }
 
-struct searchkey
+ts_pid_t * ts_pid_Add( ts_pid_list_t *p_list, uint16_t i_pid )
 {
-    int16_t i_pid;
-    ts_pid_t *const *pp_last;
-};
+    assert( p_list->index[i_pid] == NULL );
 
-static int ts_bsearch_searchkey_Compare( const void *key, const void *other )
-{
-    struct searchkey *p_key = (void *)key;
-    ts_pid_t *const *pp_pid = other;
-
-    ts_pid_t *p_pid = *pp_pid;
-    p_key->pp_last = other;
-    return ( p_key->i_pid >= p_pid->i_pid ) ? p_key->i_pid - p_pid->i_pid : -1;
-}
-
-ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
-{
-    switch( i_pid )
+    if( p_list->i_all >= p_list->i_all_alloc )
     {
-        case 0:
-            return &p_list->pat;
-        case 0x1FFB:
-            return &p_list->base_si;
-        case 0x1FFF:
-            return &p_list->dummy;
-        default:
-            if( p_list->i_last_pid == i_pid )
-                return p_list->p_last;
-        break;
+        ts_pid_t **p_realloc = realloc( p_list->pp_all,
+                                        (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
+        if( !p_realloc )
+        {
+            abort();
+            //return NULL;
+        }
+        p_list->pp_all = p_realloc;
+        p_list->i_all_alloc += PID_ALLOC_CHUNK;
     }
 
-    size_t i_index = 0;
-    ts_pid_t *p_pid = NULL;
-
-    if( p_list->pp_all )
+    ts_pid_t *p_pid = calloc( 1, sizeof(*p_pid) );
+    if( !p_pid )
     {
-        struct searchkey pidkey;
-        pidkey.i_pid = i_pid;
-        pidkey.pp_last = NULL;
-
-        ts_pid_t **pp_pidk = bsearch( &pidkey, p_list->pp_all, p_list->i_all,
-                                      sizeof(ts_pid_t *), ts_bsearch_searchkey_Compare );
-        if ( pp_pidk )
-            p_pid = *pp_pidk;
-        else
-            i_index = (pidkey.pp_last - p_list->pp_all); /* Last visited index */
+        abort();
+        //return NULL;
     }
 
-    if( p_pid == NULL )
-    {
-        if( p_list->i_all >= p_list->i_all_alloc )
-        {
-            ts_pid_t **p_realloc = realloc( p_list->pp_all,
-                                            (p_list->i_all_alloc + PID_ALLOC_CHUNK) * sizeof(ts_pid_t *) );
-            if( !p_realloc )
-            {
-                abort();
-                //return NULL;
-            }
-            p_list->pp_all = p_realloc;
-            p_list->i_all_alloc += PID_ALLOC_CHUNK;
-        }
+    p_pid->i_cc  = 0xff;
+    p_pid->i_pid = i_pid;
 
-        p_pid = calloc( 1, sizeof(*p_pid) );
-        if( !p_pid )
-        {
-            abort();
-            //return NULL;
-        }
+    /* Keep the list sorted for ts_pid_Next() */
+    int i_index = p_list->i_all;
+    while( i_index > 0 && p_list->pp_all[i_index - 1]->i_pid > i_pid )
+        i_index--;
 
-        p_pid->i_cc  = 0xff;
-        p_pid->i_pid = i_pid;
+    memmove( &p_list->pp_all[i_index + 1],
+             &p_list->pp_all[i_index],
+             (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
 
-        /* Do insertion based on last bsearch mid point */
-        if( p_list->i_all )
-        {
-            if( p_list->pp_all[i_index]->i_pid < i_pid )
-                i_index++;
+    p_list->pp_all[i_index] = p_pid;
+    p_list->i_all++;
+    p_list->index[i_pid] = p_pid;
 
-            memmove( &p_list->pp_all[i_index + 1],
-                    &p_list->pp_all[i_index],
-                    (p_list->i_all - i_index) * sizeof(ts_pid_t *) );
-        }
+    return p_pid;
+}
 
-        p_list->pp_all[i_index] = p_pid;
-        p_list->i_all++;
+void ts_pid_SetIgnored( ts_pid_list_t *p_list, ts_pid_t *p_pid, bool b_ignored )
+{
+    const uint32_t i_mask = UINT32_C(1) << (p_pid->i_pid % 32);
+    uint32_t *p_word = &p_list->ignored[p_pid->i_pid / 32];
 
+    if( b_ignored )
+    {
+        *p_word |= i_mask;
+    }
+    else if( *p_word & i_mask )
+    {
+        *p_word &= ~i_mask;
+        /* packets were skipped, continuity must restart */
+        p_pid->i_cc = 0xff;
+        p_pid->i_dup = 0;
     }
-
-    p_list->p_last = p_pid;
-    p_list->i_last_pid = i_pid;
-
-    return p_pid;
 }
 
 ts_pid_t * ts_pid_Next( ts_pid_list_t *p_list, ts_pid_next_context_t *p_ctx )
@@ -314,6 +282,9 @@ void PIDRelease( demux_t *p_demux, ts_pid_t *pid )
 
 int UpdateHWFilter( demux_sys_t *p_sys, ts_pid_t *p_pid )
 {
+    if( p_pid->i_flags & FLAG_FILTERED )
+        ts_pid_SetIgnored( &p_sys->pids, p_pid, false );
+
     if( !p_sys->b_access_control )
         return VLC_EGENERIC;
 
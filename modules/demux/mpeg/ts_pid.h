@@ -21,6 +21,8 @@
 
 #include "ts_pid_fwd.h"
 
+#include <assert.h>
+
 #define MIN_ES_PID 4    /* Should be 32.. broken muxers */
 #define MAX_ES_PID 8190
 
@@ -84,27 +86,46 @@ struct ts_pid_t
 
 };
 
+#define TS_PID_COUNT 8192
+
 struct ts_pid_list_t
 {
     ts_pid_t   pat;
     ts_pid_t   dummy;
     ts_pid_t   base_si;
-    /* all non commons ones, dynamically allocated */
+    /* all non commons ones, dynamically allocated, sorted by pid */
     ts_pid_t **pp_all;
     int        i_all;
     int        i_all_alloc;
-    /* last recently used */
-    uint16_t   i_last_pid;
-    ts_pid_t  *p_last;
-
+    /* direct lookup of all known pids */
+    ts_pid_t  *index[TS_PID_COUNT];
+    /* pids whose packets can be dropped right away */
+    uint32_t   ignored[TS_PID_COUNT / 32];
 };
 
 /* opacified pid list */
 void ts_pid_list_Init( ts_pid_list_t * );
 void ts_pid_list_Release( demux_t *, ts_pid_list_t * );
 
+ts_pid_t * ts_pid_Add( ts_pid_list_t *, uint16_t i_pid );
+
 /* creates missing pid on the fly */
-ts_pid_t * ts_pid_Get( ts_pid_list_t *, uint16_t i_pid );
+static inline ts_pid_t * ts_pid_Get( ts_pid_list_t *p_list, uint16_t i_pid )
+{
+    assert( i_pid < TS_PID_COUNT );
+    ts_pid_t *p_pid = p_list->index[i_pid];
+    if( likely(p_pid != NULL) )
+        return p_pid;
+    return ts_pid_Add( p_list, i_pid );
+}
+
+/* Emulated HW filter for unselected pids, see Demux() */
+void ts_pid_SetIgnored( ts_pid_list_t *, ts_pid_t *, bool );
+
+static inline bool ts_pid_IsIgnored( const ts_pid_list_t *p_list, uint16_t i_pid )
+{
+    return p_list->ignored[i_pid / 32] & (UINT32_C(1) << (i_pid % 32));
+}
 
 /* returns NULL on end. requires context */
 typedef struct
@@ -2046,6 +2046,10 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_dvbpsipmt )
                 {
                     p_sys->arib.b25stream = vlc_stream_FilterNew( p_demux->s, "aribcam" );
                     p_sys->stream = ( p_sys->arib.b25stream ) ? p_sys->arib.b25stream : p_demux->s;
+                    /* Data already batched bypasses the filter, stop batching
+                     * once drained (see ReadTSPacket) */
+                    if( p_sys->arib.b25stream )
+                        p_sys->batch.i_packets = 0;
                 }
             }
         }
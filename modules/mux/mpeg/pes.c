@@ -289,6 +289,18 @@ static inline int PESHeader( uint8_t *p_hdr, int64_t i_pts, int64_t i_dts,
     }
 }
 
+/** ESPrepend, make room for data before the elementary stream data
+ * The data goes to the header block if there is one, rather than to the
+ * (read-only) ES block.
+ */
+static uint8_t *ESPrepend( block_t **pp_es, block_t **pp_head, size_t i_size )
+{
+    block_t **pp_block = ( *pp_head != NULL ) ? pp_head : pp_es;
+
+    *pp_block = block_Realloc( *pp_block, i_size, (*pp_block)->i_buffer );
+    return (*pp_block)->p_buffer;
+}
+
 /** EStoPES, encapsulate an elementary stream block into PES packet(s)
  * each with a maximal payload size of @i_max_pes_size@.
  *
@@ -304,6 +316,11 @@ static inline int PESHeader( uint8_t *p_hdr, int64_t i_pts, int64_t i_dts,
  * If the last condition is not met, a single PES packet is produced
  * which is not unbounded in length.
  *
+ * If the payload of the ES block is shared (see block_Share()) and fits in
+ * a single PES packet, the PES header and any other inserted data go to a
+ * block of their own, flagged with BLOCK_FLAG_PES_HEADER and followed by
+ * the ES block, rather than to a copy of the payload.
+ *
  * \param i_stream_id stream id as follows:
  *                     - 0x00   - 0xff   : normal stream_id as per Table 2-18
  *                     - 0xfd00 - 0xfd7f : stream_id_extension = low 7 bits
@@ -324,6 +341,7 @@ void EStoPES ( block_t **pp_pes,
 {
     block_t *p_es = *pp_pes;
     block_t *p_pes = NULL;
+    block_t *p_head = NULL;
 
     uint8_t *p_data;
     int     i_size;
@@ -344,6 +362,18 @@ void EStoPES ( block_t **pp_pes,
         i_max_pes_size = PES_PAYLOAD_SIZE_MAX;
     }
 
+    p_es->i_flags &= ~BLOCK_FLAG_PES_HEADER;
+
+    /* Copying a shared payload would cost more than what sharing it saved.
+     * With a single PES, it is not needed: inserted data go before it. */
+    if( block_IsShared( p_es ) && p_es->i_buffer > 0 &&
+        p_es->i_buffer + p_fmt->i_extra + 6 <= (size_t)i_max_pes_size )
+    {
+        p_head = block_Alloc( 0 );
+        if( p_head != NULL )
+            block_CopyProperties( p_head, p_es );
+    }
+
     if( ( p_fmt->i_codec == VLC_CODEC_MP4V ||
           p_fmt->i_codec == VLC_CODEC_H264 ||
           p_fmt->i_codec == VLC_CODEC_HEVC) &&
@@ -351,34 +381,36 @@ void EStoPES ( block_t **pp_pes,
     {
         /* For MPEG4 video, add VOL before I-frames,
            for H264 add SPS/PPS before keyframes*/
-        p_es = block_Realloc( p_es, p_fmt->i_extra, p_es->i_buffer );
-
-        memcpy( p_es->p_buffer, p_fmt->p_extra, p_fmt->i_extra );
+        memcpy( ESPrepend( &p_es, &p_head, p_fmt->i_extra ),
+                p_fmt->p_extra, p_fmt->i_extra );
     }
 
     if( p_fmt->i_codec == VLC_CODEC_H264 )
     {
+        /* Check the first NAL, which may be in the inserted data */
+        const block_t *p_nal = ( p_head != NULL && p_head->i_buffer > 0 )
+                               ? p_head : p_es;
         unsigned offset=2;
-        while(offset < p_es->i_buffer )
+        while(offset < p_nal->i_buffer )
         {
-            if( p_es->p_buffer[offset-2] == 0 &&
-                p_es->p_buffer[offset-1] == 0 &&
-                p_es->p_buffer[offset] == 1 )
+            if( p_nal->p_buffer[offset-2] == 0 &&
+                p_nal->p_buffer[offset-1] == 0 &&
+                p_nal->p_buffer[offset] == 1 )
                 break;
             offset++;
         }
         offset++;
-        if( offset+4 <= p_es->i_buffer &&
-            ((p_es->p_buffer[offset] & 0x1f) != 9) ) /* Not AUD */
+        if( offset+4 <= p_nal->i_buffer &&
+            ((p_nal->p_buffer[offset] & 0x1f) != 9) ) /* Not AUD */
         {
             /* Make similar AUD as libavformat does */
-            p_es = block_Realloc( p_es, 6, p_es->i_buffer );
-            p_es->p_buffer[0] = 0x00;
-            p_es->p_buffer[1] = 0x00;
-            p_es->p_buffer[2] = 0x00;
-            p_es->p_buffer[3] = 0x01;
-            p_es->p_buffer[4] = 0x09; /* FIXME: primary_pic_type from SPS/PPS */
-            p_es->p_buffer[5] = 0xf0;
+            uint8_t *p_aud = ESPrepend( &p_es, &p_head, 6 );
+            p_aud[0] = 0x00;
+            p_aud[1] = 0x00;
+            p_aud[2] = 0x00;
+            p_aud[3] = 0x01;
+            p_aud[4] = 0x09; /* FIXME: primary_pic_type from SPS/PPS */
+            p_aud[5] = 0xf0;
         }
 
     }
@@ -392,6 +424,8 @@ void EStoPES ( block_t **pp_pes,
 
     i_size = p_es->i_buffer;
     p_data = p_es->p_buffer;
+    if( p_head != NULL )
+        i_size += p_head->i_buffer;
 
     do
     {
@@ -402,6 +436,17 @@ void EStoPES ( block_t **pp_pes,
         i_dts = 0; // only first PES has a dts/pts
         i_pts = 0;
 
+        if( p_head )
+        {
+            /* Single PES: the ES block follows the header block as is */
+            p_head = block_Realloc( p_head, i_pes_header, p_head->i_buffer );
+            memcpy( p_head->p_buffer, header, i_pes_header );
+            p_head->i_flags |= BLOCK_FLAG_PES_HEADER;
+            p_head->p_next = p_es;
+            *pp_pes = p_head;
+            break;
+        }
+
         if( p_es )
         {
             p_es = block_Realloc( p_es, i_pes_header, p_es->i_buffer );
@@ -445,6 +490,13 @@ void EStoPES ( block_t **pp_pes,
         p_pes->i_dts = i_block_dts;
         p_pes->i_length = i_length;
 
+        if( p_pes->i_flags & BLOCK_FLAG_PES_HEADER )
+        {   /* The length is accounted for in the header block */
+            p_pes = p_pes->p_next;
+            p_pes->i_dts = i_block_dts;
+            p_pes->i_length = 0;
+        }
+
         i_block_dts += i_length;
         p_pes = p_pes->p_next;
     }
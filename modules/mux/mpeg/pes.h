@@ -34,6 +34,10 @@
 
 #define PES_PAYLOAD_SIZE_MAX 65500
 
+/* The PES continues with the payload of the next block
+ * (the TS muxer uses the first private flag) */
+#define BLOCK_FLAG_PES_HEADER (2 << BLOCK_FLAG_PRIVATE_SHIFT)
+
 void EStoPES ( block_t **pp_pes,
                    const es_format_t *p_fmt, int i_stream_id,
                    int b_mpeg2, int b_data_alignment, int i_header_size,
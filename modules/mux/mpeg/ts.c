@@ -1162,6 +1162,10 @@ static block_t *Encap_J2K( block_t *p_data, const es_format_t *p_fmt )
     {
         p_data->p_buffer += (i_offset - 38);
         p_data->i_buffer -= (i_offset - 38);
+        /* The header overwrites the skipped boxes */
+        p_data = block_Writable( p_data );
+        if( unlikely(!p_data) )
+            return NULL;
     }
 
     const int profile = j2k_get_profile( p_fmt->video.i_visible_width,
@@ -1472,17 +1476,24 @@ static bool MuxStreams(sout_mux_t *p_mux )
         for (block_t *p_pes = p_stream->state.chain_pes.p_first; p_pes != NULL;
              p_pes = p_pes->p_next )
         {
+            const block_t *p_head = p_pes;
             int i_size = p_pes->i_buffer;
+            if( p_head->i_flags & BLOCK_FLAG_PES_HEADER )
+            {
+                /* Count the payload block with its header */
+                p_pes = p_pes->p_next;
+                i_size += p_pes->i_buffer;
+            }
             vlc_tick_t i_frag = p_pcr_stream->state.i_pes_dts +
-                             p_pcr_stream->state.i_pes_length - p_pes->i_dts;
-            if( p_pes->i_length > i_frag )
+                             p_pcr_stream->state.i_pes_length - p_head->i_dts;
+            if( p_head->i_length > i_frag )
             {
                 if( i_frag < 0 )
                 {
                     /* Next stream */
                     break;
                 }
-                i_size = p_pes->i_buffer * i_frag / p_pes->i_length;
+                i_size = i_size * i_frag / p_head->i_length;
             }
             i_packet_count += ( i_size + 183 ) / 184;
         }
@@ -1825,6 +1836,10 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
 {
     VLC_UNUSED(p_mux);
     block_t *p_pes = p_stream->state.chain_pes.p_first;
+    /* The PES header may be in a block of its own, before the payload */
+    block_t *p_body = ( p_pes->i_flags & BLOCK_FLAG_PES_HEADER )
+                      ? p_pes->p_next : NULL;
+    int i_pes_size = p_pes->i_buffer + ( p_body ? p_body->i_buffer : 0 );
 
     bool b_new_pes = false;
     bool b_adaptation_field = false;
@@ -1835,7 +1850,7 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     {
         b_new_pes = true;
     }
-    int i_payload = __MIN( (int)p_pes->i_buffer - p_stream->state.i_pes_used,
+    int i_payload = __MIN( i_pes_size - p_stream->state.i_pes_used,
                        i_payload_max );
 
     if( b_pcr || i_payload < i_payload_max )
@@ -1890,17 +1905,30 @@ static block_t *TSNew( sout_mux_t *p_mux, sout_input_sys_t *p_stream,
     }
 
     /* copy payload */
-    memcpy( &p_ts->p_buffer[188 - i_payload],
-            &p_pes->p_buffer[p_stream->state.i_pes_used], i_payload );
+    uint8_t *p_dst = &p_ts->p_buffer[188 - i_payload];
+    int i_used = p_stream->state.i_pes_used;
+    int i_copy = i_payload;
+    if( i_used < (int)p_pes->i_buffer )
+    {
+        int i_part = __MIN( i_copy, (int)p_pes->i_buffer - i_used );
+        memcpy( p_dst, &p_pes->p_buffer[i_used], i_part );
+        p_dst += i_part;
+        i_used += i_part;
+        i_copy -= i_part;
+    }
+    if( i_copy > 0 )
+        memcpy( p_dst, &p_body->p_buffer[i_used - p_pes->i_buffer], i_copy );
 
     p_stream->state.i_pes_used += i_payload;
     p_stream->state.i_pes_dts = p_pes->i_dts + p_pes->i_length *
-        p_stream->state.i_pes_used / p_pes->i_buffer;
-    p_stream->state.i_pes_length -= p_pes->i_length * i_payload / p_pes->i_buffer;
+        p_stream->state.i_pes_used / i_pes_size;
+    p_stream->state.i_pes_length -= p_pes->i_length * i_payload / i_pes_size;
 
-    if( p_stream->state.i_pes_used >= (int)p_pes->i_buffer )
+    if( p_stream->state.i_pes_used >= i_pes_size )
     {
         block_Release(BufferChainGet( &p_stream->state.chain_pes ));
+        if( p_body )
+            block_Release(BufferChainGet( &p_stream->state.chain_pes ));
 
         p_pes = p_stream->state.chain_pes.p_first;
         p_stream->state.i_pes_length = 0;
@@ -174,7 +174,9 @@ static int Send( sout_stream_t *p_stream, void *id, block_t *p_buffer )
 
         p_buffer->p_next = NULL;
 
-        if( id != NULL && p_buffer->i_buffer > 0 )
+        /* Decoders may modify their input in place */
+        if( id != NULL && p_buffer->i_buffer > 0
+         && (p_buffer = block_Writable( p_buffer )) != NULL )
         {
             if( p_buffer->i_dts == VLC_TICK_INVALID )
                 p_buffer->i_dts = 0;
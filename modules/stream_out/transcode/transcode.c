@@ -720,6 +720,11 @@ static int Send( sout_stream_t *p_stream, void *_id, block_t *p_buffer )
             goto error;
     }
 
+    /* Decoders may modify their input in place */
+    p_buffer = block_Writable( p_buffer );
+    if( p_buffer == NULL )
+        return VLC_ENOMEM;
+
     int i_ret;
     switch( id->p_decoder->fmt_in.i_cat )
     {
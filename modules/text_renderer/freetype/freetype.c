@@ -69,6 +69,7 @@
 #include "platform_fonts.h"
 #include "freetype.h"
 #include "text_layout.h"
+#include "glyph_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -114,6 +115,10 @@ static void Destroy( vlc_object_t * );
 #define YUVP_LONGTEXT N_("This renders the font using \"paletized YUV\". " \
   "This option is only needed if you want to encode into DVB subtitles" )
 
+#define CACHE_SIZE_TEXT N_("Glyph cache size (kB)")
+#define CACHE_SIZE_LONGTEXT N_("Memory used to keep the rendered glyphs " \
+  "and the shaped text between subtitles. 0 disables the cache." )
+
 static const int pi_color_values[] = {
   0x00000000, 0x00808080, 0x00C0C0C0, 0x00FFFFFF, 0x00800000,
   0x00FF0000, 0x00FF00FF, 0x00FFFF00, 0x00808000, 0x00008000, 0x00008080,
@@ -210,6 +215,8 @@ vlc_module_begin ()
 
     add_bool( "freetype-yuvp", false, YUVP_TEXT,
               YUVP_LONGTEXT, true )
+    add_integer_with_range( "freetype-cache-size", 4096, 0, 262144,
+                            CACHE_SIZE_TEXT, CACHE_SIZE_LONGTEXT, true )
 
 #ifdef HAVE_FRIBIDI
     add_integer_with_range( "freetype-text-direction", 0, 0, 2, TEXT_DIRECTION_TEXT,
@@ -1422,6 +1429,10 @@ static int Create( vlc_object_t *p_this )
         p_sys->p_stroker = NULL;
     }
 
+    int i_cache_size = var_InheritInteger( p_filter, "freetype-cache-size" );
+    if( i_cache_size > 0 )
+        p_sys->p_glyph_cache = glyph_cache_New( (size_t)i_cache_size * 1024 );
+
     /* Dictionnaries for fonts and families */
     vlc_dictionary_init( &p_sys->face_map, 50 );
     vlc_dictionary_init( &p_sys->family_map, 50 );
@@ -1547,6 +1558,20 @@ static void Destroy( vlc_object_t *p_this )
     DumpDictionary( p_filter, &p_sys->fallback_map, true, -1 );
 #endif
 
+    if( p_sys->p_glyph_cache )
+    {
+        glyph_cache_stats_t stats;
+        glyph_cache_GetStats( p_sys->p_glyph_cache, &stats );
+        msg_Dbg( p_filter, "glyph cache: glyphs %"PRIu64"/%"PRIu64", "
+                 "bitmaps %"PRIu64"/%"PRIu64", runs %"PRIu64"/%"PRIu64" "
+                 "hits/misses, %"PRIu64" evictions, %zu/%zu kB",
+                 stats.glyphs.i_hits, stats.glyphs.i_misses,
+                 stats.bitmaps.i_hits, stats.bitmaps.i_misses,
+                 stats.runs.i_hits, stats.runs.i_misses, stats.i_evictions,
+                 stats.i_size / 1024, stats.i_max_size / 1024 );
+        glyph_cache_Delete( p_sys->p_glyph_cache );
+    }
+
     /* Text styles */
     text_style_Delete( p_sys->p_default_style );
     text_style_Delete( p_sys->p_forced_style );
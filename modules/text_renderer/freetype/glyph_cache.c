@@ -0,0 +1,523 @@
+/*****************************************************************************
+ * glyph_cache.c : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run cache
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_list.h>
+
+#include "glyph_cache.h"
+
+enum entry_type
+{
+    ENTRY_GLYPH,
+    ENTRY_BITMAP,
+    ENTRY_RUN,
+};
+
+/* Keys are compared as bytes, so they are zeroed before being filled */
+typedef struct
+{
+    int               i_type;
+    glyph_cache_key_t glyph;
+} glyph_key_t;
+
+typedef struct
+{
+    int               i_type;
+    glyph_cache_key_t glyph;
+    int               i_bitmap;
+    FT_Pos            i_x;      /* fractional part of the origin */
+    FT_Pos            i_y;
+} bitmap_key_t;
+
+/* followed by the text of the run */
+typedef struct
+{
+    int               i_type;
+    FT_Face           p_face;
+    unsigned          i_direction;
+    unsigned          i_script;
+} run_key_t;
+
+typedef struct glyph_cache_entry_t glyph_cache_entry_t;
+struct glyph_cache_entry_t
+{
+    struct vlc_list      node;      /* in the LRU list, most recent first */
+    glyph_cache_entry_t *p_next;    /* in the hash bucket */
+    uint32_t             i_hash;
+    size_t               i_size;    /* accounted bytes */
+
+    union
+    {
+        struct
+        {
+            FT_Glyph  p_glyph;
+            FT_Glyph  p_outline;
+            FT_Vector advance;
+        } glyph;
+        FT_Glyph p_bitmap;
+        struct
+        {
+            glyph_cache_shaped_t *p_glyphs;
+            unsigned              i_count;
+        } run;
+    } u;
+
+    size_t               i_key;
+    unsigned char        key[];
+};
+
+struct glyph_cache_t
+{
+    struct vlc_list       lru;
+    glyph_cache_entry_t **pp_buckets;
+    unsigned              i_buckets;  /* power of two */
+    glyph_cache_stats_t   stats;
+};
+
+#define INITIAL_BUCKETS 256
+
+static uint32_t Hash( uint32_t i_hash, const void *p_data, size_t i_size )
+{
+    const unsigned char *p = p_data;
+
+    /* FNV-1a */
+    for( size_t i = 0; i < i_size; i++ )
+        i_hash = ( i_hash ^ p[i] ) * 16777619;
+    return i_hash;
+}
+
+static size_t GlyphSize( FT_Glyph p_glyph )
+{
+    if( !p_glyph )
+        return 0;
+
+    switch( p_glyph->format )
+    {
+        case FT_GLYPH_FORMAT_BITMAP:
+        {
+            const FT_Bitmap *p_bitmap = &((FT_BitmapGlyph)p_glyph)->bitmap;
+            return sizeof( FT_BitmapGlyphRec )
+                 + (size_t)p_bitmap->rows * abs( p_bitmap->pitch );
+        }
+        case FT_GLYPH_FORMAT_OUTLINE:
+        {
+            const FT_Outline *p_outline = &((FT_OutlineGlyph)p_glyph)->outline;
+            return sizeof( FT_OutlineGlyphRec )
+                 + p_outline->n_points * ( sizeof( FT_Vector ) + 1 )
+                 + p_outline->n_contours * sizeof( short );
+        }
+        default:
+            return sizeof( FT_GlyphRec );
+    }
+}
+
+static void FreeEntry( glyph_cache_entry_t *p_entry )
+{
+    int i_type;
+
+    memcpy( &i_type, p_entry->key, sizeof( i_type ) );
+    switch( i_type )
+    {
+        case ENTRY_GLYPH:
+            FT_Done_Glyph( p_entry->u.glyph.p_glyph );
+            if( p_entry->u.glyph.p_outline )
+                FT_Done_Glyph( p_entry->u.glyph.p_outline );
+            break;
+        case ENTRY_BITMAP:
+            FT_Done_Glyph( p_entry->u.p_bitmap );
+            break;
+        case ENTRY_RUN:
+            free( p_entry->u.run.p_glyphs );
+            break;
+    }
+    free( p_entry );
+}
+
+static glyph_cache_entry_t *NewEntry( const void *p_key, size_t i_key,
+                                      const void *p_data, size_t i_data )
+{
+    glyph_cache_entry_t *p_entry = malloc( sizeof( *p_entry ) + i_key + i_data );
+    if( unlikely( !p_entry ) )
+        return NULL;
+
+    memcpy( p_entry->key, p_key, i_key );
+    if( i_data )
+        memcpy( &p_entry->key[i_key], p_data, i_data );
+    p_entry->i_key = i_key + i_data;
+    p_entry->i_hash = Hash( Hash( 2166136261u, p_key, i_key ), p_data, i_data );
+    p_entry->i_size = sizeof( *p_entry ) + p_entry->i_key;
+    return p_entry;
+}
+
+static glyph_cache_entry_t **Bucket( glyph_cache_t *p_cache, uint32_t i_hash )
+{
+    return &p_cache->pp_buckets[ i_hash & ( p_cache->i_buckets - 1 ) ];
+}
+
+/* The key is given in two parts, to look runs up without copying them */
+static glyph_cache_entry_t *Find( glyph_cache_t *p_cache,
+                                  const void *p_key, size_t i_key,
+                                  const void *p_data, size_t i_data )
+{
+    const uint32_t i_hash = Hash( Hash( 2166136261u, p_key, i_key ),
+                                  p_data, i_data );
+
+    for( glyph_cache_entry_t *p_entry = *Bucket( p_cache, i_hash );
+         p_entry != NULL; p_entry = p_entry->p_next )
+    {
+        if( p_entry->i_hash == i_hash && p_entry->i_key == i_key + i_data
+         && !memcmp( p_entry->key, p_key, i_key )
+         && ( !i_data || !memcmp( &p_entry->key[i_key], p_data, i_data ) ) )
+            return p_entry;
+    }
+    return NULL;
+}
+
+static glyph_cache_entry_t *Lookup( glyph_cache_t *p_cache,
+                                    glyph_cache_counter_t *p_counter,
+                                    const void *p_key, size_t i_key,
+                                    const void *p_data, size_t i_data )
+{
+    glyph_cache_entry_t *p_entry = Find( p_cache, p_key, i_key, p_data, i_data );
+    if( !p_entry )
+    {
+        p_counter->i_misses++;
+        return NULL;
+    }
+
+    p_counter->i_hits++;
+    vlc_list_remove( &p_entry->node );
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    return p_entry;
+}
+
+static void Remove( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_entry_t **pp = Bucket( p_cache, p_entry->i_hash );
+
+    while( *pp != p_entry )
+        pp = &(*pp)->p_next;
+    *pp = p_entry->p_next;
+
+    vlc_list_remove( &p_entry->node );
+    p_cache->stats.i_entries--;
+    p_cache->stats.i_size -= p_entry->i_size;
+    FreeEntry( p_entry );
+}
+
+static void Grow( glyph_cache_t *p_cache )
+{
+    const unsigned i_buckets = p_cache->i_buckets * 2;
+    glyph_cache_entry_t **pp_buckets = calloc( i_buckets, sizeof( *pp_buckets ) );
+    if( unlikely( !pp_buckets ) )
+        return; /* longer chains */
+
+    for( unsigned i = 0; i < p_cache->i_buckets; i++ )
+        for( glyph_cache_entry_t *p_entry = p_cache->pp_buckets[i], *p_next;
+             p_entry != NULL; p_entry = p_next )
+        {
+            glyph_cache_entry_t **pp =
+                &pp_buckets[ p_entry->i_hash & ( i_buckets - 1 ) ];
+
+            p_next = p_entry->p_next;
+            p_entry->p_next = *pp;
+            *pp = p_entry;
+        }
+
+    free( p_cache->pp_buckets );
+    p_cache->pp_buckets = pp_buckets;
+    p_cache->i_buckets = i_buckets;
+}
+
+/* Takes the ownership of the entry */
+static void Insert( glyph_cache_t *p_cache, glyph_cache_entry_t *p_entry )
+{
+    glyph_cache_stats_t *p_stats = &p_cache->stats;
+
+    if( p_entry->i_size > p_stats->i_max_size
+     || Find( p_cache, p_entry->key, p_entry->i_key, NULL, 0 ) )
+    {
+        FreeEntry( p_entry );
+        return;
+    }
+
+    /* Evict the least recently used entries */
+    while( p_stats->i_size + p_entry->i_size > p_stats->i_max_size )
+    {
+        Remove( p_cache, vlc_list_last_entry_or_null( &p_cache->lru,
+                                                      glyph_cache_entry_t,
+                                                      node ) );
+        p_stats->i_evictions++;
+    }
+
+    if( p_stats->i_entries >= p_cache->i_buckets )
+        Grow( p_cache );
+
+    glyph_cache_entry_t **pp = Bucket( p_cache, p_entry->i_hash );
+    p_entry->p_next = *pp;
+    *pp = p_entry;
+    vlc_list_prepend( &p_entry->node, &p_cache->lru );
+    p_stats->i_entries++;
+    p_stats->i_size += p_entry->i_size;
+}
+
+glyph_cache_t *glyph_cache_New( size_t i_max_size )
+{
+    glyph_cache_t *p_cache = malloc( sizeof( *p_cache ) );
+    if( unlikely( !p_cache ) )
+        return NULL;
+
+    p_cache->i_buckets = INITIAL_BUCKETS;
+    p_cache->pp_buckets = calloc( p_cache->i_buckets,
+                                  sizeof( *p_cache->pp_buckets ) );
+    if( unlikely( !p_cache->pp_buckets ) )
+    {
+        free( p_cache );
+        return NULL;
+    }
+
+    vlc_list_init( &p_cache->lru );
+    memset( &p_cache->stats, 0, sizeof( p_cache->stats ) );
+    p_cache->stats.i_max_size = i_max_size;
+    return p_cache;
+}
+
+void glyph_cache_Delete( glyph_cache_t *p_cache )
+{
+    glyph_cache_entry_t *p_entry;
+
+    vlc_list_foreach( p_entry, &p_cache->lru, node )
+        FreeEntry( p_entry );
+    free( p_cache->pp_buckets );
+    free( p_cache );
+}
+
+static void GlyphKey( glyph_key_t *p_key, const glyph_cache_key_t *p_glyph )
+{
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->i_type = ENTRY_GLYPH;
+    p_key->glyph.p_face = p_glyph->p_face;
+    p_key->glyph.i_index = p_glyph->i_index;
+    p_key->glyph.i_flags = p_glyph->i_flags;
+    p_key->glyph.i_radius = p_glyph->i_radius;
+}
+
+int glyph_cache_GetGlyph( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                          FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                          FT_Vector *p_advance )
+{
+    glyph_key_t key;
+    GlyphKey( &key, p_key );
+
+    glyph_cache_entry_t *p_entry = Lookup( p_cache, &p_cache->stats.glyphs,
+                                           &key, sizeof( key ), NULL, 0 );
+    *pp_glyph = NULL;
+    *pp_outline = NULL;
+    if( !p_entry )
+        return VLC_EGENERIC;
+
+    if( FT_Glyph_Copy( p_entry->u.glyph.p_glyph, pp_glyph ) )
+    {
+        *pp_glyph = NULL;
+        return VLC_ENOMEM;
+    }
+
+    if( p_entry->u.glyph.p_outline
+     && FT_Glyph_Copy( p_entry->u.glyph.p_outline, pp_outline ) )
+    {
+        FT_Done_Glyph( *pp_glyph );
+        *pp_glyph = NULL;
+        *pp_outline = NULL;
+        return VLC_ENOMEM;
+    }
+
+    *p_advance = p_entry->u.glyph.advance;
+    return VLC_SUCCESS;
+}
+
+void glyph_cache_PutGlyph( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                           FT_Glyph p_glyph, FT_Glyph p_outline,
+                           const FT_Vector *p_advance )
+{
+    glyph_key_t key;
+    GlyphKey( &key, p_key );
+
+    glyph_cache_entry_t *p_entry = NewEntry( &key, sizeof( key ), NULL, 0 );
+    if( unlikely( !p_entry ) )
+        return;
+
+    if( FT_Glyph_Copy( p_glyph, &p_entry->u.glyph.p_glyph ) )
+    {
+        free( p_entry );
+        return;
+    }
+    p_entry->u.glyph.p_outline = NULL;
+    if( p_outline && FT_Glyph_Copy( p_outline, &p_entry->u.glyph.p_outline ) )
+    {
+        FT_Done_Glyph( p_entry->u.glyph.p_glyph );
+        free( p_entry );
+        return;
+    }
+    p_entry->u.glyph.advance = *p_advance;
+    p_entry->i_size += GlyphSize( p_glyph ) + GlyphSize( p_outline );
+
+    Insert( p_cache, p_entry );
+}
+
+static void BitmapKey( bitmap_key_t *p_key, const glyph_cache_key_t *p_glyph,
+                       enum glyph_cache_bitmap i_type, const FT_Vector *p_origin )
+{
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->i_type = ENTRY_BITMAP;
+    p_key->glyph.p_face = p_glyph->p_face;
+    p_key->glyph.i_index = p_glyph->i_index;
+    p_key->glyph.i_flags = p_glyph->i_flags;
+    p_key->glyph.i_radius = p_glyph->i_radius;
+    p_key->i_bitmap = i_type;
+    p_key->i_x = p_origin->x & 63;
+    p_key->i_y = p_origin->y & 63;
+}
+
+FT_Glyph glyph_cache_GetBitmap( glyph_cache_t *p_cache,
+                                const glyph_cache_key_t *p_key,
+                                enum glyph_cache_bitmap i_type,
+                                const FT_Vector *p_origin )
+{
+    bitmap_key_t key;
+    BitmapKey( &key, p_key, i_type, p_origin );
+
+    glyph_cache_entry_t *p_entry = Lookup( p_cache, &p_cache->stats.bitmaps,
+                                           &key, sizeof( key ), NULL, 0 );
+    FT_Glyph p_bitmap;
+    if( !p_entry || FT_Glyph_Copy( p_entry->u.p_bitmap, &p_bitmap ) )
+        return NULL;
+
+    /* The cached bitmap was rendered at the fractional part of the origin */
+    ((FT_BitmapGlyph)p_bitmap)->left += FT_FLOOR( p_origin->x );
+    ((FT_BitmapGlyph)p_bitmap)->top += FT_FLOOR( p_origin->y );
+    return p_bitmap;
+}
+
+void glyph_cache_PutBitmap( glyph_cache_t *p_cache,
+                            const glyph_cache_key_t *p_key,
+                            enum glyph_cache_bitmap i_type,
+                            const FT_Vector *p_origin, FT_Glyph p_bitmap )
+{
+    if( p_bitmap->format != FT_GLYPH_FORMAT_BITMAP )
+        return;
+
+    bitmap_key_t key;
+    BitmapKey( &key, p_key, i_type, p_origin );
+
+    glyph_cache_entry_t *p_entry = NewEntry( &key, sizeof( key ), NULL, 0 );
+    if( unlikely( !p_entry ) )
+        return;
+
+    if( FT_Glyph_Copy( p_bitmap, &p_entry->u.p_bitmap ) )
+    {
+        free( p_entry );
+        return;
+    }
+    ((FT_BitmapGlyph)p_entry->u.p_bitmap)->left -= FT_FLOOR( p_origin->x );
+    ((FT_BitmapGlyph)p_entry->u.p_bitmap)->top -= FT_FLOOR( p_origin->y );
+    p_entry->i_size += GlyphSize( p_bitmap );
+
+    Insert( p_cache, p_entry );
+}
+
+static void RunKey( run_key_t *p_key, FT_Face p_face,
+                    unsigned i_direction, unsigned i_script )
+{
+    memset( p_key, 0, sizeof( *p_key ) );
+    p_key->i_type = ENTRY_RUN;
+    p_key->p_face = p_face;
+    p_key->i_direction = i_direction;
+    p_key->i_script = i_script;
+}
+
+glyph_cache_shaped_t *glyph_cache_GetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                          unsigned i_direction, unsigned i_script,
+                                          const uni_char_t *p_text, size_t i_length,
+                                          unsigned *pi_count )
+{
+    run_key_t key;
+    RunKey( &key, p_face, i_direction, i_script );
+
+    glyph_cache_entry_t *p_entry = Lookup( p_cache, &p_cache->stats.runs,
+                                           &key, sizeof( key ),
+                                           p_text, i_length * sizeof( *p_text ) );
+    if( !p_entry )
+        return NULL;
+
+    glyph_cache_shaped_t *p_glyphs = vlc_alloc( p_entry->u.run.i_count,
+                                                sizeof( *p_glyphs ) );
+    if( unlikely( !p_glyphs ) )
+        return NULL;
+
+    memcpy( p_glyphs, p_entry->u.run.p_glyphs,
+            p_entry->u.run.i_count * sizeof( *p_glyphs ) );
+    *pi_count = p_entry->u.run.i_count;
+    return p_glyphs;
+}
+
+void glyph_cache_PutRun( glyph_cache_t *p_cache, FT_Face p_face,
+                         unsigned i_direction, unsigned i_script,
+                         const uni_char_t *p_text, size_t i_length,
+                         const glyph_cache_shaped_t *p_glyphs, unsigned i_count )
+{
+    run_key_t key;
+    RunKey( &key, p_face, i_direction, i_script );
+
+    glyph_cache_entry_t *p_entry = NewEntry( &key, sizeof( key ),
+                                             p_text, i_length * sizeof( *p_text ) );
+    if( unlikely( !p_entry ) )
+        return;
+
+    p_entry->u.run.p_glyphs = vlc_alloc( i_count, sizeof( *p_glyphs ) );
+    if( unlikely( !p_entry->u.run.p_glyphs ) )
+    {
+        free( p_entry );
+        return;
+    }
+    memcpy( p_entry->u.run.p_glyphs, p_glyphs, i_count * sizeof( *p_glyphs ) );
+    p_entry->u.run.i_count = i_count;
+    p_entry->i_size += i_count * sizeof( *p_glyphs );
+
+    Insert( p_cache, p_entry );
+}
+
+void glyph_cache_GetStats( const glyph_cache_t *p_cache,
+                           glyph_cache_stats_t *p_stats )
+{
+    *p_stats = p_cache->stats;
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************
+ * glyph_cache.h : Glyph and shaped run cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_FREETYPE_GLYPH_CACHE_H
+#define VLC_FREETYPE_GLYPH_CACHE_H
+
+/** \ingroup freetype
+ * @{
+ * \file
+ * Glyph and shaped run cache
+ *
+ * Subtitles render the same text again and again: on every frame for
+ * karaoke and scrolling effects, and for every identical line. This least
+ * recently used cache keeps the loaded glyph outlines, their bitmaps and
+ * the result of the shaping of text runs, up to a memory budget.
+ *
+ * A face is loaded for a single size (see LoadFace()), so the face
+ * identifies both the font and its size in the keys.
+ *
+ * The cache hands out copies that the caller owns, so entries can be
+ * evicted at any time. It is not thread-safe: it belongs to one filter.
+ */
+
+#include "freetype.h"
+
+typedef struct glyph_cache_t glyph_cache_t;
+
+/* Synthesized styles of a glyph */
+#define GLYPH_CACHE_BOLD     0x1
+#define GLYPH_CACHE_ITALIC   0x2
+#define GLYPH_CACHE_OUTLINE  0x4
+
+/**
+ * Identifies a glyph outline, as loaded and styled by LoadGlyphs()
+ */
+typedef struct
+{
+    FT_Face   p_face;           /*!< face, of a single size */
+    FT_UInt   i_index;          /*!< glyph index */
+    unsigned  i_flags;          /*!< GLYPH_CACHE_* synthesized styles */
+    FT_Fixed  i_radius;         /*!< stroker radius, with GLYPH_CACHE_OUTLINE */
+} glyph_cache_key_t;
+
+/**
+ * Bitmaps rendered from a glyph outline
+ */
+enum glyph_cache_bitmap
+{
+    GLYPH_CACHE_BITMAP_GLYPH,
+    GLYPH_CACHE_BITMAP_OUTLINE,
+    GLYPH_CACHE_BITMAP_SHADOW,
+};
+
+/**
+ * A shaped glyph. Offsets and advances are 26.6 values.
+ */
+typedef struct
+{
+    unsigned int i_index;       /*!< glyph index */
+    unsigned int i_cluster;     /*!< index of the source character in the run */
+    int          i_x_offset;
+    int          i_y_offset;
+    int          i_x_advance;
+    int          i_y_advance;
+} glyph_cache_shaped_t;
+
+typedef struct
+{
+    uint64_t i_hits;
+    uint64_t i_misses;
+} glyph_cache_counter_t;
+
+typedef struct
+{
+    glyph_cache_counter_t glyphs;   /*!< outlines */
+    glyph_cache_counter_t bitmaps;
+    glyph_cache_counter_t runs;     /*!< shaped runs */
+    uint64_t i_evictions;
+    unsigned i_entries;
+    size_t   i_size;                /*!< bytes used by the entries */
+    size_t   i_max_size;
+} glyph_cache_stats_t;
+
+/**
+ * Creates a cache.
+ *
+ * \param i_max_size memory budget in bytes
+ * \return the cache, or NULL on error
+ */
+glyph_cache_t *glyph_cache_New( size_t i_max_size );
+void glyph_cache_Delete( glyph_cache_t *p_cache );
+
+/**
+ * Looks up a glyph outline.
+ *
+ * \param pp_glyph copy of the glyph outline, NULL on miss [OUT]
+ * \param pp_outline copy of the stroked outline, or NULL if there is none [OUT]
+ * \param p_advance advance of the glyph, in 26.6 [OUT]
+ * \return VLC_SUCCESS on hit, or an error code
+ */
+int glyph_cache_GetGlyph( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                          FT_Glyph *pp_glyph, FT_Glyph *pp_outline,
+                          FT_Vector *p_advance );
+
+/**
+ * Stores copies of a glyph outline and of its stroked outline, if any.
+ */
+void glyph_cache_PutGlyph( glyph_cache_t *p_cache, const glyph_cache_key_t *p_key,
+                           FT_Glyph p_glyph, FT_Glyph p_outline,
+                           const FT_Vector *p_advance );
+
+/**
+ * Looks up the bitmap of a glyph rendered at a pen position.
+ *
+ * Rendering only depends on the fractional part of the position, the
+ * integer part moves the bitmap.
+ *
+ * \param p_origin the pen position passed to FT_Glyph_To_Bitmap(), in 26.6
+ * \return a copy of the bitmap glyph, or NULL on miss
+ */
+FT_Glyph glyph_cache_GetBitmap( glyph_cache_t *p_cache,
+                                const glyph_cache_key_t *p_key,
+                                enum glyph_cache_bitmap i_type,
+                                const FT_Vector *p_origin );
+
+/**
+ * Stores a copy of a bitmap glyph rendered at the pen position \p p_origin.
+ */
+void glyph_cache_PutBitmap( glyph_cache_t *p_cache,
+                            const glyph_cache_key_t *p_key,
+                            enum glyph_cache_bitmap i_type,
+                            const FT_Vector *p_origin, FT_Glyph p_bitmap );
+
+/**
+ * Looks up the shaping of a text run.
+ *
+ * \param i_direction text direction, as given to the shaper
+ * \param i_script script, as given to the shaper
+ * \param pi_count number of shaped glyphs [OUT]
+ * \return an array of shaped glyphs to free(), or NULL on miss
+ */
+glyph_cache_shaped_t *glyph_cache_GetRun( glyph_cache_t *p_cache, FT_Face p_face,
+                                          unsigned i_direction, unsigned i_script,
+                                          const uni_char_t *p_text, size_t i_length,
+                                          unsigned *pi_count );
+
+/**
+ * Stores a copy of the shaping of a text run.
+ */
+void glyph_cache_PutRun( glyph_cache_t *p_cache, FT_Face p_face,
+                         unsigned i_direction, unsigned i_script,
+                         const uni_char_t *p_text, size_t i_length,
+                         const glyph_cache_shaped_t *p_glyphs, unsigned i_count );
+
+void glyph_cache_GetStats( const glyph_cache_t *p_cache,
+                           glyph_cache_stats_t *p_stats );
+
+/** @} */
+
+#endif
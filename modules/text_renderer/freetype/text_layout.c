@@ -64,6 +64,7 @@
 #include "freetype.h"
 #include "text_layout.h"
 #include "platform_fonts.h"
+#include "glyph_cache.h"
 
 #include <stdlib.h>
 
@@ -107,10 +108,7 @@ typedef struct run_desc_t
 #ifdef HAVE_HARFBUZZ
     hb_script_t                 script;
     hb_direction_t              direction;
-    hb_font_t                  *p_hb_font;
-    hb_buffer_t                *p_buffer;
-    hb_glyph_info_t            *p_glyph_infos;
-    hb_glyph_position_t        *p_glyph_positions;
+    glyph_cache_shaped_t       *p_glyphs;
     unsigned int                i_glyph_count;
 #endif
 
@@ -131,6 +129,7 @@ typedef struct glyph_bitmaps_t
     int      i_y_offset;
     int      i_x_advance;
     int      i_y_advance;
+    glyph_cache_key_t cache_key;
 } glyph_bitmaps_t;
 
 typedef struct paragraph_t
@@ -731,6 +730,97 @@ static int ItemizeParagraph( filter_t *p_filter, paragraph_t *p_paragraph )
 }
 
 #ifdef HAVE_HARFBUZZ
+/**
+ * Shape a run using HarfBuzz, or get its shaping from the glyph cache.
+ * The glyphs are in visual order, as HarfBuzz returns them.
+ */
+static int ShapeRunHarfBuzz( filter_t *p_filter, const paragraph_t *p_paragraph,
+                             run_desc_t *p_run )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    glyph_cache_t *p_cache = p_sys->p_glyph_cache;
+    const uni_char_t *p_text = p_paragraph->p_code_points + p_run->i_start_offset;
+    const int i_length = p_run->i_end_offset - p_run->i_start_offset;
+
+    if( p_cache )
+    {
+        p_run->p_glyphs = glyph_cache_GetRun( p_cache, p_run->p_face,
+                                              p_run->direction, p_run->script,
+                                              p_text, i_length,
+                                              &p_run->i_glyph_count );
+        if( p_run->p_glyphs )
+            return VLC_SUCCESS;
+    }
+
+    hb_font_t *p_hb_font = hb_ft_font_create( p_run->p_face, 0 );
+    if( !p_hb_font )
+    {
+        msg_Err( p_filter, "ShapeRunHarfBuzz(): hb_ft_font_create() error" );
+        return VLC_EGENERIC;
+    }
+
+    hb_buffer_t *p_buffer = hb_buffer_create();
+    if( !p_buffer )
+    {
+        msg_Err( p_filter, "ShapeRunHarfBuzz(): hb_buffer_create() error" );
+        hb_font_destroy( p_hb_font );
+        return VLC_EGENERIC;
+    }
+
+    hb_buffer_set_direction( p_buffer, p_run->direction );
+    hb_buffer_set_script( p_buffer, p_run->script );
+#ifdef __OS2__
+    hb_buffer_add_utf16( p_buffer, p_text, i_length, 0, i_length );
+#else
+    hb_buffer_add_utf32( p_buffer, p_text, i_length, 0, i_length );
+#endif
+    hb_shape( p_hb_font, p_buffer, 0, 0 );
+
+    unsigned int i_count;
+    const hb_glyph_info_t *p_infos =
+        hb_buffer_get_glyph_infos( p_buffer, &i_count );
+    const hb_glyph_position_t *p_positions =
+        hb_buffer_get_glyph_positions( p_buffer, &i_count );
+    int i_ret = VLC_EGENERIC;
+
+    if( i_count == 0 )
+    {
+        msg_Err( p_filter,
+                 "ShapeRunHarfBuzz() invalid glyph count in shaped run" );
+        goto done;
+    }
+
+    p_run->p_glyphs = vlc_alloc( i_count, sizeof( *p_run->p_glyphs ) );
+    if( !p_run->p_glyphs )
+    {
+        i_ret = VLC_ENOMEM;
+        goto done;
+    }
+
+    for( unsigned int i = 0; i < i_count; ++i )
+    {
+        glyph_cache_shaped_t *p_glyph = &p_run->p_glyphs[ i ];
+        p_glyph->i_index = p_infos[ i ].codepoint;
+        p_glyph->i_cluster = p_infos[ i ].cluster;
+        p_glyph->i_x_offset = p_positions[ i ].x_offset;
+        p_glyph->i_y_offset = p_positions[ i ].y_offset;
+        p_glyph->i_x_advance = p_positions[ i ].x_advance;
+        p_glyph->i_y_advance = p_positions[ i ].y_advance;
+    }
+    p_run->i_glyph_count = i_count;
+
+    if( p_cache )
+        glyph_cache_PutRun( p_cache, p_run->p_face,
+                            p_run->direction, p_run->script,
+                            p_text, i_length, p_run->p_glyphs, i_count );
+    i_ret = VLC_SUCCESS;
+
+done:
+    hb_buffer_destroy( p_buffer );
+    hb_font_destroy( p_hb_font );
+    return i_ret;
+}
+
 /**
  * Shape an itemized paragraph using HarfBuzz.
  * This is where the glyphs of complex scripts get their positions
@@ -784,47 +874,8 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
         else
             p_face = p_run->p_face;
 
-        p_run->p_hb_font = hb_ft_font_create( p_face, 0 );
-        if( !p_run->p_hb_font )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_ft_font_create() error" );
+        if( ShapeRunHarfBuzz( p_filter, p_paragraph, p_run ) )
             goto error;
-        }
-
-        p_run->p_buffer = hb_buffer_create();
-        if( !p_run->p_buffer )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz(): hb_buffer_create() error" );
-            goto error;
-        }
-
-        hb_buffer_set_direction( p_run->p_buffer, p_run->direction );
-        hb_buffer_set_script( p_run->p_buffer, p_run->script );
-#ifdef __OS2__
-        hb_buffer_add_utf16( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
-#else
-        hb_buffer_add_utf32( p_run->p_buffer,
-                             p_paragraph->p_code_points + p_run->i_start_offset,
-                             p_run->i_end_offset - p_run->i_start_offset, 0,
-                             p_run->i_end_offset - p_run->i_start_offset );
-#endif
-        hb_shape( p_run->p_hb_font, p_run->p_buffer, 0, 0 );
-        p_run->p_glyph_infos =
-            hb_buffer_get_glyph_infos( p_run->p_buffer, &p_run->i_glyph_count );
-        p_run->p_glyph_positions =
-            hb_buffer_get_glyph_positions( p_run->p_buffer, &p_run->i_glyph_count );
-
-        if( p_run->i_glyph_count <= 0 )
-        {
-            msg_Err( p_filter,
-                     "ShapeParagraphHarfBuzz() invalid glyph count in shaped run" );
-            goto error;
-        }
 
         i_total_glyphs += p_run->i_glyph_count;
     }
@@ -849,8 +900,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
     {
         run_desc_t *p_run = p_paragraph->p_runs + i;
-        hb_glyph_info_t *p_infos = p_run->p_glyph_infos;
-        hb_glyph_position_t *p_positions = p_run->p_glyph_positions;
+        const glyph_cache_shaped_t *p_glyphs = p_run->p_glyphs;
         for( unsigned int j = 0; j < p_run->i_glyph_count; ++j )
         {
             /*
@@ -863,11 +913,11 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             int i_run_index = p_run->direction == HB_DIRECTION_LTR ?
                     j : p_run->i_glyph_count - 1 - j;
             int i_source_index =
-                    p_infos[ i_run_index ].cluster + p_run->i_start_offset;
+                    p_glyphs[ i_run_index ].i_cluster + p_run->i_start_offset;
 
             p_new_paragraph->p_code_points[ i_index ] = 0;
             p_new_paragraph->pi_glyph_indices[ i_index ] =
-                p_infos[ i_run_index ].codepoint;
+                p_glyphs[ i_run_index ].i_index;
             p_new_paragraph->p_scripts[ i_index ] =
                 p_paragraph->p_scripts[ i_source_index ];
             p_new_paragraph->p_types[ i_index ] =
@@ -882,13 +932,13 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
             p_new_paragraph->pi_karaoke_bar[ i_index ] =
                 p_paragraph->pi_karaoke_bar[ i_source_index ];
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_offset =
-                p_positions[ i_run_index ].x_offset;
+                p_glyphs[ i_run_index ].i_x_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_offset =
-                p_positions[ i_run_index ].y_offset;
+                p_glyphs[ i_run_index ].i_y_offset;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_x_advance =
-                p_positions[ i_run_index ].x_advance;
+                p_glyphs[ i_run_index ].i_x_advance;
             p_new_paragraph->p_glyph_bitmaps[ i_index ].i_y_advance =
-                p_positions[ i_run_index ].y_advance;
+                p_glyphs[ i_run_index ].i_y_advance;
 
             ++i_index;
         }
@@ -898,10 +948,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
     }
 
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
-    {
-        hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
-    }
+        free( p_paragraph->p_runs[ i ].p_glyphs );
     FreeParagraph( *p_old_paragraph );
     *p_old_paragraph = p_new_paragraph;
 
@@ -909,12 +956,7 @@ static int ShapeParagraphHarfBuzz( filter_t *p_filter,
 
 error:
     for( int i = 0; i < p_paragraph->i_runs_count; ++i )
-    {
-        if( p_paragraph->p_runs[ i ].p_hb_font )
-            hb_font_destroy( p_paragraph->p_runs[ i ].p_hb_font );
-        if( p_paragraph->p_runs[ i ].p_buffer )
-            hb_buffer_destroy( p_paragraph->p_runs[ i ].p_buffer );
-    }
+        free( p_paragraph->p_runs[ i ].p_glyphs );
 
     if( p_new_paragraph )
         FreeParagraph( p_new_paragraph );
@@ -1055,6 +1097,15 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
         else
             p_face = p_run->p_face;
 
+        glyph_cache_key_t cache_key = { .p_face = p_face };
+
+        if( ( p_style->i_style_flags & STYLE_BOLD )
+              && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
+            cache_key.i_flags |= GLYPH_CACHE_BOLD;
+        if( ( p_style->i_style_flags & STYLE_ITALIC )
+              && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
+            cache_key.i_flags |= GLYPH_CACHE_ITALIC;
+
         if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
         {
             double f_outline_thickness =
@@ -1065,6 +1116,8 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                             i_radius,
                             FT_STROKER_LINECAP_ROUND,
                             FT_STROKER_LINEJOIN_ROUND, 0 );
+            cache_key.i_flags |= GLYPH_CACHE_OUTLINE;
+            cache_key.i_radius = i_radius;
         }
 
         for( int j = p_run->i_start_offset; j < p_run->i_end_offset; ++j )
@@ -1117,39 +1170,54 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
                     SKIP_GLYPH( p_bitmaps )
             }
 
-            if( FT_Load_Glyph( p_face, i_glyph_index,
-                               FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
-             && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
-                SKIP_GLYPH( p_bitmaps )
+            p_bitmaps->cache_key = cache_key;
+            p_bitmaps->cache_key.i_index = i_glyph_index;
 
-            if( ( p_style->i_style_flags & STYLE_BOLD )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_BOLD ) )
-                FT_GlyphSlot_Embolden( p_face->glyph );
-            if( ( p_style->i_style_flags & STYLE_ITALIC )
-                  && !( p_face->style_flags & FT_STYLE_FLAG_ITALIC ) )
-                FT_GlyphSlot_Oblique( p_face->glyph );
+            FT_Vector advance;
+            if( !p_sys->p_glyph_cache
+             || glyph_cache_GetGlyph( p_sys->p_glyph_cache, &p_bitmaps->cache_key,
+                                      &p_bitmaps->p_glyph, &p_bitmaps->p_outline,
+                                      &advance ) )
+            {
+                if( FT_Load_Glyph( p_face, i_glyph_index,
+                                   FT_LOAD_NO_BITMAP | FT_LOAD_DEFAULT )
+                 && FT_Load_Glyph( p_face, i_glyph_index, FT_LOAD_DEFAULT ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
-                SKIP_GLYPH( p_bitmaps )
+                if( cache_key.i_flags & GLYPH_CACHE_BOLD )
+                    FT_GlyphSlot_Embolden( p_face->glyph );
+                if( cache_key.i_flags & GLYPH_CACHE_ITALIC )
+                    FT_GlyphSlot_Oblique( p_face->glyph );
 
-#undef SKIP_GLYPH
+                if( FT_Get_Glyph( p_face->glyph, &p_bitmaps->p_glyph ) )
+                    SKIP_GLYPH( p_bitmaps )
 
-            if( p_sys->p_stroker && (p_style->i_style_flags & STYLE_OUTLINE) )
-            {
-                p_bitmaps->p_outline = p_bitmaps->p_glyph;
-                if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
-                                           p_sys->p_stroker, 0, 0 ) )
-                    p_bitmaps->p_outline = 0;
+                if( cache_key.i_flags & GLYPH_CACHE_OUTLINE )
+                {
+                    p_bitmaps->p_outline = p_bitmaps->p_glyph;
+                    if( FT_Glyph_StrokeBorder( &p_bitmaps->p_outline,
+                                               p_sys->p_stroker, 0, 0 ) )
+                        p_bitmaps->p_outline = 0;
+                }
+
+                advance = p_face->glyph->advance;
+                if( p_sys->p_glyph_cache )
+                    glyph_cache_PutGlyph( p_sys->p_glyph_cache,
+                                          &p_bitmaps->cache_key,
+                                          p_bitmaps->p_glyph,
+                                          p_bitmaps->p_outline, &advance );
             }
 
+#undef SKIP_GLYPH
+
             if( p_style->i_shadow_alpha != STYLE_ALPHA_TRANSPARENT )
                 p_bitmaps->p_shadow = p_bitmaps->p_outline ?
                                       p_bitmaps->p_outline : p_bitmaps->p_glyph;
 
             if( b_overwrite_advance )
             {
-                p_bitmaps->i_x_advance = p_face->glyph->advance.x;
-                p_bitmaps->i_y_advance = p_face->glyph->advance.y;
+                p_bitmaps->i_x_advance = advance.x;
+                p_bitmaps->i_y_advance = advance.y;
             }
 
             unsigned i_x_advance = FT_FLOOR( abs( p_bitmaps->i_x_advance ) );
@@ -1160,6 +1228,40 @@ static int LoadGlyphs( filter_t *p_filter, paragraph_t *p_paragraph,
     return VLC_SUCCESS;
 }
 
+/**
+ * Render a glyph at the pen position like FT_Glyph_To_Bitmap(), or copy
+ * its bitmap from the glyph cache.
+ */
+static FT_Error RenderGlyph( filter_t *p_filter, const glyph_bitmaps_t *p_bitmaps,
+                             enum glyph_cache_bitmap i_type, FT_Glyph *pp_glyph,
+                             FT_Vector *p_pen, bool b_destroy )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    glyph_cache_t *p_cache = p_sys->p_glyph_cache;
+
+    /* Glyphs loaded as bitmaps are not moved to the pen position */
+    if( !p_cache || (*pp_glyph)->format != FT_GLYPH_FORMAT_OUTLINE )
+        return FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                   p_pen, b_destroy );
+
+    FT_Glyph p_bitmap = glyph_cache_GetBitmap( p_cache, &p_bitmaps->cache_key,
+                                               i_type, p_pen );
+    if( p_bitmap )
+    {
+        if( b_destroy )
+            FT_Done_Glyph( *pp_glyph );
+        *pp_glyph = p_bitmap;
+        return 0;
+    }
+
+    FT_Error i_error = FT_Glyph_To_Bitmap( pp_glyph, FT_RENDER_MODE_NORMAL,
+                                           p_pen, b_destroy );
+    if( !i_error )
+        glyph_cache_PutBitmap( p_cache, &p_bitmaps->cache_key, i_type,
+                               p_pen, *pp_glyph );
+    return i_error;
+}
+
 static int LayoutLine( filter_t *p_filter,
                        paragraph_t *p_paragraph,
                        int i_first_char, int i_last_char,
@@ -1256,8 +1358,8 @@ static int LayoutLine( filter_t *p_filter,
 
         if( p_bitmaps->p_shadow )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_shadow, FT_RENDER_MODE_NORMAL,
-                                    &pen_shadow, 0 ) )
+            if( RenderGlyph( p_filter, p_bitmaps, GLYPH_CACHE_BITMAP_SHADOW,
+                             &p_bitmaps->p_shadow, &pen_shadow, false ) )
                 p_bitmaps->p_shadow = 0;
             else
                 FT_Glyph_Get_CBox( p_bitmaps->p_shadow, ft_glyph_bbox_pixels,
@@ -1265,8 +1367,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_glyph )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_glyph, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, p_bitmaps, GLYPH_CACHE_BITMAP_GLYPH,
+                             &p_bitmaps->p_glyph, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_glyph );
                 if( p_bitmaps->p_outline )
@@ -1281,8 +1383,8 @@ static int LayoutLine( filter_t *p_filter,
         }
         if( p_bitmaps->p_outline )
         {
-            if( FT_Glyph_To_Bitmap( &p_bitmaps->p_outline, FT_RENDER_MODE_NORMAL,
-                                    &pen_new, 1 ) )
+            if( RenderGlyph( p_filter, p_bitmaps, GLYPH_CACHE_BITMAP_OUTLINE,
+                             &p_bitmaps->p_outline, &pen_new, true ) )
             {
                 FT_Done_Glyph( p_bitmaps->p_outline );
                 p_bitmaps->p_outline = 0;
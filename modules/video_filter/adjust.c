@@ -36,6 +36,7 @@
 #include <vlc_common.h>
 #include <vlc_atomic.h>
 #include <vlc_plugin.h>
+#include <vlc_executor.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
@@ -123,8 +124,12 @@ typedef struct
                                int, int );
     int (*pf_process_sat_hue_clip)( picture_t *, picture_t *, int, int,
                                     int, int, int );
+    vlc_executor_t *executor;
 } filter_sys_t;
 
+/* Minimum number of lines per slice */
+#define ADJUST_SLICE_LINES 64
+
 /*****************************************************************************
  * Create: allocates adjust video filter
  *****************************************************************************/
@@ -178,6 +183,8 @@ static int Create( vlc_object_t *p_this )
             return VLC_EGENERIC;
     }
 
+    p_sys->executor = vlc_executor_Hold();
+
     /* needed to get options passed in transcode using the
      * adjust{name=value} syntax */
     config_ChainParse( p_filter, "", ppsz_filter_options, p_filter->p_cfg );
@@ -222,104 +229,65 @@ static void Destroy( vlc_object_t *p_this )
     var_DelCallback( p_filter, "brightness-threshold",
                                              AdjustCallback, p_sys );
 
+    if( p_sys->executor != NULL )
+        vlc_executor_Release( p_sys->executor );
     free( p_sys );
 }
 
 /*****************************************************************************
  * Run the filter on a Planar YUV picture
  *****************************************************************************/
-static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+struct adjust_planar
 {
     /* The full range will only be used for 10-bit */
     int pi_luma[1024];
-    int pi_gamma[1024];
-
+    bool b_16bit;
+    bool b_clip;
+    int i_sin, i_cos, i_sat, i_x, i_y;
+    picture_t *p_pic;
     picture_t *p_outpic;
+    filter_sys_t *p_sys;
+};
 
-    filter_sys_t *p_sys = p_filter->p_sys;
-
-    if( !p_pic ) return NULL;
+/**
+ * Restricts a picture to the lines of one slice of each plane.
+ *
+ * Only the format and the planes of the view are set: it is only meant to be
+ * passed to the pixel processing functions.
+ */
+static void SlicePicture( picture_t *p_view, const picture_t *p_pic,
+                          unsigned slice, unsigned slices )
+{
+    p_view->format = p_pic->format;
+    p_view->i_planes = p_pic->i_planes;
 
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
+    for( int i = 0; i < p_pic->i_planes; i++ )
     {
-        picture_Release( p_pic );
-        return NULL;
+        plane_t *p = &p_view->p[i];
+        unsigned first, end;
+
+        *p = p_pic->p[i];
+        filter_GetSliceLines( p->i_visible_lines, 1, slice, slices,
+                              &first, &end );
+        p->p_pixels += first * p->i_pitch;
+        p->i_lines = p->i_visible_lines = end - first;
     }
+}
 
-    bool b_16bit;
-    float f_range;
-    switch( p_filter->fmt_in.video.i_chroma )
-    {
-        CASE_PLANAR_YUV10
-            b_16bit = true;
-            f_range = 1024.f;
-            break;
-        CASE_PLANAR_YUV9
-            b_16bit = true;
-            f_range = 512.f;
-            break;
-        default:
-            b_16bit = false;
-            f_range = 256.f;
-    }
-
-    const float f_max = f_range - 1.f;
-    const unsigned i_max = f_max;
-    const int i_range = f_range;
-    const unsigned i_size = i_range;
-    const unsigned i_mid = i_range >> 1;
-
-    /* Get variables */
-    int32_t i_cont = lroundf( vlc_atomic_load_float( &p_sys->f_contrast ) * f_max );
-    int32_t i_lum = lroundf( (vlc_atomic_load_float( &p_sys->f_brightness ) - 1.f) * f_max );
-    float f_hue = vlc_atomic_load_float( &p_sys->f_hue ) * (float)(M_PI / 180.);
-    int i_sat = (int)( vlc_atomic_load_float( &p_sys->f_saturation ) * f_range );
-    float f_gamma = 1.f / vlc_atomic_load_float( &p_sys->f_gamma );
-
-    /*
-     * Threshold mode drops out everything about luma, contrast and gamma.
-     */
-    if( !atomic_load( &p_sys->b_brightness_threshold ) )
-    {
-
-        /* Contrast is a fast but kludged function, so I put this gap to be
-         * cleaner :) */
-        i_lum += i_mid - i_cont / 2;
-
-        /* Fill the gamma lookup table */
-        for( unsigned i = 0 ; i < i_size; i++ )
-        {
-            pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
-        }
-
-        /* Fill the luma lookup table */
-        for( unsigned i = 0 ; i < i_size; i++ )
-        {
-            pi_luma[ i ] = pi_gamma[VLC_CLIP( (int)(i_lum + i_cont * i / i_range), 0, i_max )];
-        }
-    }
-    else
-    {
-        /*
-         * We get luma as threshold value: the higher it is, the darker is
-         * the image. Should I reverse this?
-         */
-        for( int i = 0 ; i < i_range; i++ )
-        {
-            pi_luma[ i ] = (i < i_lum) ? 0 : i_max;
-        }
+static void FilterPlanarSlice( void *opaque, unsigned slice, unsigned slices )
+{
+    const struct adjust_planar *ctx = opaque;
+    const int *pi_luma = ctx->pi_luma;
+    picture_t pic, outpic;
+    picture_t *p_pic = &pic, *p_outpic = &outpic;
 
-        /*
-         * Desaturates image to avoid that strange yellow halo...
-         */
-        i_sat = 0;
-    }
+    SlicePicture( p_pic, ctx->p_pic, slice, slices );
+    SlicePicture( p_outpic, ctx->p_outpic, slice, slices );
 
     /*
      * Do the Y plane
      */
-    if ( b_16bit )
+    if ( ctx->b_16bit )
     {
         uint16_t *p_in, *p_in_end, *p_line_end;
         uint16_t *p_out;
@@ -395,29 +363,128 @@ static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
     /*
      * Do the U and V planes
      */
+    /* Currently no errors are implemented in the functions, if any are added
+     * check them here */
+    if( ctx->b_clip )
+        ctx->p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, ctx->i_sin,
+                                             ctx->i_cos, ctx->i_sat,
+                                             ctx->i_x, ctx->i_y );
+    else
+        ctx->p_sys->pf_process_sat_hue( p_pic, p_outpic, ctx->i_sin,
+                                        ctx->i_cos, ctx->i_sat,
+                                        ctx->i_x, ctx->i_y );
+}
 
-    int i_sin = sinf(f_hue) * f_max;
-    int i_cos = cosf(f_hue) * f_max;
+static picture_t *FilterPlanar( filter_t *p_filter, picture_t *p_pic )
+{
+    struct adjust_planar ctx;
+    int *pi_luma = ctx.pi_luma;
+    int pi_gamma[1024];
 
-    /* pow(2, (bpp * 2) - 1) */
-    int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
-    int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
+    picture_t *p_outpic;
+
+    filter_sys_t *p_sys = p_filter->p_sys;
 
-    if ( i_sat > i_range )
+    if( !p_pic ) return NULL;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
     {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue_clip( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    bool b_16bit;
+    float f_range;
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        CASE_PLANAR_YUV10
+            b_16bit = true;
+            f_range = 1024.f;
+            break;
+        CASE_PLANAR_YUV9
+            b_16bit = true;
+            f_range = 512.f;
+            break;
+        default:
+            b_16bit = false;
+            f_range = 256.f;
+    }
+
+    const float f_max = f_range - 1.f;
+    const unsigned i_max = f_max;
+    const int i_range = f_range;
+    const unsigned i_size = i_range;
+    const unsigned i_mid = i_range >> 1;
+
+    /* Get variables */
+    int32_t i_cont = lroundf( vlc_atomic_load_float( &p_sys->f_contrast ) * f_max );
+    int32_t i_lum = lroundf( (vlc_atomic_load_float( &p_sys->f_brightness ) - 1.f) * f_max );
+    float f_hue = vlc_atomic_load_float( &p_sys->f_hue ) * (float)(M_PI / 180.);
+    int i_sat = (int)( vlc_atomic_load_float( &p_sys->f_saturation ) * f_range );
+    float f_gamma = 1.f / vlc_atomic_load_float( &p_sys->f_gamma );
+
+    /*
+     * Threshold mode drops out everything about luma, contrast and gamma.
+     */
+    if( !atomic_load( &p_sys->b_brightness_threshold ) )
+    {
+
+        /* Contrast is a fast but kludged function, so I put this gap to be
+         * cleaner :) */
+        i_lum += i_mid - i_cont / 2;
+
+        /* Fill the gamma lookup table */
+        for( unsigned i = 0 ; i < i_size; i++ )
+        {
+            pi_gamma[ i ] = VLC_CLIP( powf(i / f_max, f_gamma) * f_max, 0, i_max );
+        }
+
+        /* Fill the luma lookup table */
+        for( unsigned i = 0 ; i < i_size; i++ )
+        {
+            pi_luma[ i ] = pi_gamma[VLC_CLIP( (int)(i_lum + i_cont * i / i_range), 0, i_max )];
+        }
     }
     else
     {
-        /* Currently no errors are implemented in the function, if any are added
-         * check them here */
-        p_sys->pf_process_sat_hue( p_pic, p_outpic, i_sin, i_cos, i_sat,
-                                        i_x, i_y );
+        /*
+         * We get luma as threshold value: the higher it is, the darker is
+         * the image. Should I reverse this?
+         */
+        for( int i = 0 ; i < i_range; i++ )
+        {
+            pi_luma[ i ] = (i < i_lum) ? 0 : i_max;
+        }
+
+        /*
+         * Desaturates image to avoid that strange yellow halo...
+         */
+        i_sat = 0;
     }
 
+    int i_sin = sinf(f_hue) * f_max;
+    int i_cos = cosf(f_hue) * f_max;
+
+    /* pow(2, (bpp * 2) - 1) */
+    int i_x = ( cosf(f_hue) + sinf(f_hue) ) * f_range * i_mid;
+    int i_y = ( cosf(f_hue) - sinf(f_hue) ) * f_range * i_mid;
+
+    ctx.b_16bit = b_16bit;
+    ctx.b_clip = i_sat > i_range;
+    ctx.i_sin = i_sin;
+    ctx.i_cos = i_cos;
+    ctx.i_sat = i_sat;
+    ctx.i_x = i_x;
+    ctx.i_y = i_y;
+    ctx.p_pic = p_pic;
+    ctx.p_outpic = p_outpic;
+    ctx.p_sys = p_sys;
+
+    /* Every pixel is processed independently */
+    filter_RunSlices( p_sys->executor, p_pic->p[Y_PLANE].i_visible_lines,
+                      ADJUST_SLICE_LINES, FilterPlanarSlice, &ctx );
+
     return CopyInfoAndRelease( p_outpic, p_pic );
 }
 
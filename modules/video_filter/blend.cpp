@@ -32,6 +32,7 @@
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
+#include "blend_row.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -632,11 +633,257 @@ static const struct {
 #undef YUV
 };
 
+/*****************************************************************************
+ * Line blending
+ *****************************************************************************
+ * The common destinations are blended one line at a time by the routines of
+ * blend_row.c, with the same results as Blend<>().
+ *****************************************************************************/
+
+/* Number of source pixels converted at once */
+#define ROW_CHUNK 256
+
+/* Source lines as YUVA planes or as packed RGBA pixels, converted if the
+ * source chroma is not already so */
+class CRowSource : public CPicture {
+public:
+    CRowSource(const CPicture &cfg, bool rgb) : CPicture(cfg)
+    {
+        if (fmt->i_chroma != VLC_CODEC_YUVP)
+            return;
+
+        const video_palette_t *p = fmt->p_palette;
+        for (unsigned i = 0; i < VIDEO_PALETTE_COLORS_MAX; i++) {
+            if (!rgb) {
+                memcpy(palette[i], p->palette[i], 4);
+            } else if (i < (unsigned)p->i_entries) {
+                int r, g, b;
+                yuv_to_rgb(&r, &g, &b, p->palette[i][0],
+                           p->palette[i][1], p->palette[i][2]);
+                palette[i][0] = r;
+                palette[i][1] = g;
+                palette[i][2] = b;
+                palette[i][3] = p->palette[i][3];
+            } else {
+                memset(palette[i], 0, 4);
+            }
+        }
+    }
+    /* Gets n pixels of the line from dx as Y, U, V and A lines */
+    void getPlanar(unsigned dx, unsigned n, const uint8_t *lines[4])
+    {
+        if (fmt->i_chroma == VLC_CODEC_YUVA) {
+            for (unsigned plane = 0; plane < 4; plane++)
+                lines[plane] = &CPicture::getLine<1>(plane)[x + dx];
+            return;
+        }
+
+        const uint8_t *src = CPicture::getLine<1>(0);
+        if (fmt->i_chroma == VLC_CODEC_YUVP) {
+            src += x + dx;
+            for (unsigned i = 0; i < n; i++) {
+                const uint8_t *entry = palette[src[i]];
+                buffer[0][i] = entry[0];
+                buffer[1][i] = entry[1];
+                buffer[2][i] = entry[2];
+                buffer[3][i] = entry[3];
+            }
+        } else {
+            src += (x + dx) * 4;
+            for (unsigned i = 0; i < n; i++, src += 4) {
+                uint8_t y, u, v;
+                rgb_to_yuv(&y, &u, &v, src[0], src[1], src[2]);
+                buffer[0][i] = y;
+                buffer[1][i] = u;
+                buffer[2][i] = v;
+                buffer[3][i] = src[3];
+            }
+        }
+        for (unsigned plane = 0; plane < 4; plane++)
+            lines[plane] = buffer[plane];
+    }
+    /* Gets n pixels of the line from dx as RGBA pixels */
+    const uint8_t *getPacked(unsigned dx, unsigned n)
+    {
+        if (fmt->i_chroma == VLC_CODEC_RGBA)
+            return &CPicture::getLine<1>(0)[(x + dx) * 4];
+
+        uint8_t *dst = &buffer[0][0];
+        if (fmt->i_chroma == VLC_CODEC_YUVP) {
+            const uint8_t *src = &CPicture::getLine<1>(0)[x + dx];
+            for (unsigned i = 0; i < n; i++)
+                memcpy(&dst[4 * i], palette[src[i]], 4);
+        } else {
+            const uint8_t *src[4];
+            for (unsigned plane = 0; plane < 4; plane++)
+                src[plane] = &CPicture::getLine<1>(plane)[x + dx];
+            for (unsigned i = 0; i < n; i++) {
+                int r, g, b;
+                yuv_to_rgb(&r, &g, &b, src[0][i], src[1][i], src[2][i]);
+                dst[4 * i + 0] = r;
+                dst[4 * i + 1] = g;
+                dst[4 * i + 2] = b;
+                dst[4 * i + 3] = src[3][i];
+            }
+        }
+        return dst;
+    }
+    void nextLine()
+    {
+        y++;
+    }
+private:
+    uint8_t buffer[4][ROW_CHUNK];
+    uint8_t palette[VIDEO_PALETTE_COLORS_MAX][4];
+};
+
+template <typename pixel, unsigned rx, unsigned ry, bool swap_uv,
+          bool semiplanar = false>
+class CRowYUV : public CPicture {
+public:
+    static const bool rgb = false;
+
+    CRowYUV(const CPicture &cfg) : CPicture(cfg)
+    {
+    }
+    void blend(const blend_row_t *row, CRowSource &src,
+               unsigned dx, unsigned n, unsigned alpha)
+    {
+        const uint8_t *lines[4];
+
+        src.getPlanar(dx, n, lines);
+        blendPlane(row, 1, CPicture::getLine<1>(0), x + dx,
+                   lines[0], lines[3], n, alpha);
+        if ((y % ry) != 0)
+            return;
+
+        /* The chroma is blended with the first pixel of each block */
+        const unsigned skip = (rx - (x + dx) % rx) % rx;
+        if (skip >= n)
+            return;
+        const unsigned cx = (x + dx + skip) / rx;
+        const unsigned count = (n - skip + rx - 1) / rx;
+
+        if (semiplanar) {
+            row->semiplanar(&CPicture::getLine<ry>(1)[2 * cx],
+                            lines[swap_uv ? 2 : 1] + skip,
+                            lines[swap_uv ? 1 : 2] + skip,
+                            lines[3] + skip, count, alpha);
+        } else {
+            blendPlane(row, rx, CPicture::getLine<ry>(swap_uv ? 2 : 1), cx,
+                       lines[1] + skip, lines[3] + skip, count, alpha);
+            blendPlane(row, rx, CPicture::getLine<ry>(swap_uv ? 1 : 2), cx,
+                       lines[2] + skip, lines[3] + skip, count, alpha);
+        }
+    }
+    void nextLine()
+    {
+        y++;
+    }
+private:
+    static void blendPlane(const blend_row_t *row, unsigned step,
+                           uint8_t *line, unsigned dx, const uint8_t *src,
+                           const uint8_t *a, unsigned n, unsigned alpha)
+    {
+        if (sizeof(pixel) == 1)
+            (step == 1 ? row->plane : row->chroma)(&line[dx], src, a,
+                                                   n, alpha);
+        else
+            (step == 1 ? row->plane10 : row->chroma10)(&((uint16_t *)line)[dx],
+                                                       src, a, n, alpha);
+    }
+};
+
+class CRowRGB32 : public CPicture {
+public:
+    static const bool rgb = true;
+
+    CRowRGB32(const CPicture &cfg) : CPicture(cfg)
+    {
+        GetPackedRgbIndexes(fmt, &offset_r, &offset_g, &offset_b);
+    }
+    void blend(const blend_row_t *row, CRowSource &src,
+               unsigned dx, unsigned n, unsigned alpha)
+    {
+        row->rgbx(&CPicture::getLine<1>(0)[(x + dx) * 4],
+                  src.getPacked(dx, n), n, alpha,
+                  offset_r, offset_g, offset_b);
+    }
+    void nextLine()
+    {
+        y++;
+    }
+private:
+    int offset_r;
+    int offset_g;
+    int offset_b;
+};
+
+template <class TDst>
+void BlendRows(const blend_row_t *row,
+               const CPicture &dst_data, const CPicture &src_data,
+               unsigned width, unsigned height, int alpha)
+{
+    CRowSource src(src_data, TDst::rgb);
+    TDst dst(dst_data);
+
+    for (unsigned y = 0; y < height; y++) {
+        for (unsigned x = 0; x < width; x += ROW_CHUNK)
+            dst.blend(row, src, x, __MIN(width - x, ROW_CHUNK), alpha);
+        src.nextLine();
+        dst.nextLine();
+    }
+}
+
+typedef void (*blend_rows_function_t)(const blend_row_t *row,
+                                      const CPicture &dst_data,
+                                      const CPicture &src_data,
+                                      unsigned width, unsigned height,
+                                      int alpha);
+
+static const struct {
+    vlc_fourcc_t          dst;
+    blend_rows_function_t blend;
+} row_blends[] = {
+    { VLC_CODEC_RGB32,    BlendRows<CRowRGB32> },
+
+    { VLC_CODEC_YV12,     BlendRows<CRowYUV<uint8_t,  2,2, true> > },
+    { VLC_CODEC_NV12,     BlendRows<CRowYUV<uint8_t,  2,2, false, true> > },
+    { VLC_CODEC_NV21,     BlendRows<CRowYUV<uint8_t,  2,2, true,  true> > },
+    { VLC_CODEC_J420,     BlendRows<CRowYUV<uint8_t,  2,2, false> > },
+    { VLC_CODEC_I420,     BlendRows<CRowYUV<uint8_t,  2,2, false> > },
+    { VLC_CODEC_J422,     BlendRows<CRowYUV<uint8_t,  2,1, false> > },
+    { VLC_CODEC_I422,     BlendRows<CRowYUV<uint8_t,  2,1, false> > },
+    { VLC_CODEC_J444,     BlendRows<CRowYUV<uint8_t,  1,1, false> > },
+    { VLC_CODEC_I444,     BlendRows<CRowYUV<uint8_t,  1,1, false> > },
+#ifndef WORDS_BIGENDIAN
+    { VLC_CODEC_I420_10L, BlendRows<CRowYUV<uint16_t, 2,2, false> > },
+    { VLC_CODEC_I422_10L, BlendRows<CRowYUV<uint16_t, 2,1, false> > },
+    { VLC_CODEC_I444_10L, BlendRows<CRowYUV<uint16_t, 1,1, false> > },
+#endif
+};
+
+/* The line routines need distinct red, green and blue bytes */
+static bool IsRowBlendable(const video_format_t *fmt)
+{
+    int r, g, b;
+
+    if (fmt->i_chroma != VLC_CODEC_RGB32)
+        return true;
+    if (GetPackedRgbIndexes(fmt, &r, &g, &b) != VLC_SUCCESS)
+        return false;
+    return r >= 0 && r < 4 && g >= 0 && g < 4 && b >= 0 && b < 4 &&
+           r != g && g != b && r != b;
+}
+
 struct filter_sys_t {
-    filter_sys_t() : blend(NULL)
+    filter_sys_t() : blend(NULL), blend_rows(NULL)
     {
     }
     blend_function_t blend;
+    /* Vectorized line blending, if available for the chromas */
+    blend_rows_function_t blend_rows;
+    blend_row_t row;
 };
 
 } // namespace
@@ -666,13 +913,18 @@ static void Blend(filter_t *filter,
     video_format_FixRgb(&filter->fmt_out.video);
     video_format_FixRgb(&filter->fmt_in.video);
 
-    sys->blend(CPicture(dst, &filter->fmt_out.video,
-                        filter->fmt_out.video.i_x_offset + x_offset,
-                        filter->fmt_out.video.i_y_offset + y_offset),
-               CPicture(src, &filter->fmt_in.video,
-                        filter->fmt_in.video.i_x_offset,
-                        filter->fmt_in.video.i_y_offset),
-               width, height, alpha);
+    const CPicture dst_data(dst, &filter->fmt_out.video,
+                            filter->fmt_out.video.i_x_offset + x_offset,
+                            filter->fmt_out.video.i_y_offset + y_offset);
+    const CPicture src_data(src, &filter->fmt_in.video,
+                            filter->fmt_in.video.i_x_offset,
+                            filter->fmt_in.video.i_y_offset);
+
+    if (sys->blend_rows && alpha <= 255 &&
+        IsRowBlendable(&filter->fmt_out.video))
+        sys->blend_rows(&sys->row, dst_data, src_data, width, height, alpha);
+    else
+        sys->blend(dst_data, src_data, width, height, alpha);
 }
 
 static int Open(vlc_object_t *object)
@@ -687,6 +939,13 @@ static int Open(vlc_object_t *object)
             sys->blend = blends[i].blend;
     }
 
+    if (sys->blend && blend_row_Init(&sys->row)) {
+        for (size_t i = 0; i < sizeof(row_blends) / sizeof(*row_blends); i++) {
+            if (row_blends[i].dst == dst)
+                sys->blend_rows = row_blends[i].blend;
+        }
+    }
+
     if (!sys->blend) {
        msg_Err(filter, "no matching alpha blending routine (chroma: %4.4s -> %4.4s)",
                (char *)&src, (char *)&dst);
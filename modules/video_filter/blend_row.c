@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * blend_row.c: line blending routines
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+
+#include "blend_row.h"
+
+#ifdef HAVE_BLEND_ROW_SSE4_1
+# include <immintrin.h>
+#endif
+
+/* Same rounding as blend.cpp */
+static inline unsigned div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static inline void merge(uint8_t *dst, unsigned src, unsigned f)
+{
+    *dst = div255((255 - f) * *dst + src * f);
+}
+
+static void PlaneC(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                   unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned f = div255(alpha * a[i]);
+
+        if (f > 0)
+            merge(&dst[i], src[i], f);
+    }
+}
+
+static void ChromaC(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                    unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned f = div255(alpha * a[2 * i]);
+
+        if (f > 0)
+            merge(&dst[i], src[2 * i], f);
+    }
+}
+
+static void SemiPlanarC(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                        const uint8_t *a, unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned f = div255(alpha * a[2 * i]);
+
+        if (f > 0)
+        {
+            merge(&dst[2 * i], u[2 * i], f);
+            merge(&dst[2 * i + 1], v[2 * i], f);
+        }
+    }
+}
+
+static inline void merge10(uint16_t *dst, unsigned src, unsigned f)
+{
+    *dst = div255((255 - f) * *dst + (src * 1023 / 255) * f);
+}
+
+static void Plane10C(uint16_t *dst, const uint8_t *src, const uint8_t *a,
+                     unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned f = div255(alpha * a[i]);
+
+        if (f > 0)
+            merge10(&dst[i], src[i], f);
+    }
+}
+
+static void Chroma10C(uint16_t *dst, const uint8_t *src, const uint8_t *a,
+                      unsigned n, unsigned alpha)
+{
+    for (unsigned i = 0; i < n; i++)
+    {
+        const unsigned f = div255(alpha * a[2 * i]);
+
+        if (f > 0)
+            merge10(&dst[i], src[2 * i], f);
+    }
+}
+
+static void RgbxC(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                  unsigned alpha, unsigned r, unsigned g, unsigned b)
+{
+    for (unsigned i = 0; i < n; i++, dst += 4, rgba += 4)
+    {
+        const unsigned f = div255(alpha * rgba[3]);
+
+        if (f > 0)
+        {
+            merge(&dst[r], rgba[0], f);
+            merge(&dst[g], rgba[1], f);
+            merge(&dst[b], rgba[2], f);
+        }
+    }
+}
+
+void blend_row_InitC(blend_row_t *row)
+{
+    row->plane = PlaneC;
+    row->chroma = ChromaC;
+    row->semiplanar = SemiPlanarC;
+    row->plane10 = Plane10C;
+    row->chroma10 = Chroma10C;
+    row->rgbx = RgbxC;
+}
+
+#ifdef HAVE_BLEND_ROW_SSE4_1
+/* ================= SSE4.1 ================= */
+#define VEC __m128i
+#define VEC_SIZE 16
+#define V(op) _mm_ ## op
+#define V_ZERO() _mm_setzero_si128()
+#define V_AND(a, b) _mm_and_si128(a, b)
+#define V_OR(a, b) _mm_or_si128(a, b)
+#define V_LOAD(p) _mm_loadu_si128((const __m128i *)(p))
+#define V_STORE(p, v) _mm_storeu_si128((__m128i *)(p), v)
+#define V_LOAD_HALF(p) _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)(p)))
+#define V_ORDER(v) (v)
+#define V_BROADCAST(p) V_LOAD(p)
+#define VLC_TARGET __attribute__((__target__("sse4.1")))
+#define RENAME(a) a ## _sse4_1
+#include "blend_row_simd.h"
+#undef VEC
+#undef VEC_SIZE
+#undef V
+#undef V_ZERO
+#undef V_AND
+#undef V_OR
+#undef V_LOAD
+#undef V_STORE
+#undef V_LOAD_HALF
+#undef V_ORDER
+#undef V_BROADCAST
+#undef VLC_TARGET
+#undef RENAME
+
+void blend_row_InitSSE4_1(blend_row_t *row)
+{
+    row->plane = plane_sse4_1;
+    row->chroma = chroma_sse4_1;
+    row->semiplanar = semiplanar_sse4_1;
+    row->plane10 = plane10_sse4_1;
+    row->chroma10 = chroma10_sse4_1;
+    row->rgbx = rgbx_sse4_1;
+}
+#endif
+
+#ifdef HAVE_BLEND_ROW_AVX2
+/* ================= AVX2 ================= */
+#define VEC __m256i
+#define VEC_SIZE 32
+#define V(op) _mm256_ ## op
+#define V_ZERO() _mm256_setzero_si256()
+#define V_AND(a, b) _mm256_and_si256(a, b)
+#define V_OR(a, b) _mm256_or_si256(a, b)
+#define V_LOAD(p) _mm256_loadu_si256((const __m256i *)(p))
+#define V_STORE(p, v) _mm256_storeu_si256((__m256i *)(p), v)
+#define V_LOAD_HALF(p) \
+    _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+/* The packs work on each 128-bit lane */
+#define V_ORDER(v) _mm256_permute4x64_epi64(v, _MM_SHUFFLE(3, 1, 2, 0))
+#define V_BROADCAST(p) \
+    _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(p)))
+#define VLC_TARGET __attribute__((__target__("avx2")))
+#define RENAME(a) a ## _avx2
+#include "blend_row_simd.h"
+#undef VEC
+#undef VEC_SIZE
+#undef V
+#undef V_ZERO
+#undef V_AND
+#undef V_OR
+#undef V_LOAD
+#undef V_STORE
+#undef V_LOAD_HALF
+#undef V_ORDER
+#undef V_BROADCAST
+#undef VLC_TARGET
+#undef RENAME
+
+void blend_row_InitAVX2(blend_row_t *row)
+{
+    row->plane = plane_avx2;
+    row->chroma = chroma_avx2;
+    row->semiplanar = semiplanar_avx2;
+    row->plane10 = plane10_avx2;
+    row->chroma10 = chroma10_avx2;
+    row->rgbx = rgbx_avx2;
+}
+#endif
+
+bool blend_row_Init(blend_row_t *row)
+{
+#ifdef HAVE_BLEND_ROW_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        blend_row_InitAVX2(row);
+        return true;
+    }
+#endif
+#ifdef HAVE_BLEND_ROW_SSE4_1
+    if (vlc_CPU_SSE4_1())
+    {
+        blend_row_InitSSE4_1(row);
+        return true;
+    }
+#endif
+    blend_row_InitC(row);
+    return false;
+}
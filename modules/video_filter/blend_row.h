@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * blend_row.h: line blending routines
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_BLEND_ROW_H
+#define VLC_BLEND_ROW_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Each routine blends n 8-bit source pixels onto one line of a destination
+ * plane. The opacity of a pixel is div255(alpha * a[i]), where alpha is the
+ * global opacity (0-255) and a[] the source alpha line. The results are
+ * identical to the per-pixel blending of blend.cpp.
+ */
+typedef struct
+{
+    /** dst[i] blended with src[i] */
+    void (*plane)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                  unsigned n, unsigned alpha);
+    /** dst[i] blended with src[2i] (horizontally subsampled chroma).
+     * The source lines must hold 2n - 1 pixels. */
+    void (*chroma)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                   unsigned n, unsigned alpha);
+    /** dst[2i] and dst[2i+1] blended with u[2i] and v[2i] (NV12 chroma) */
+    void (*semiplanar)(uint8_t *dst, const uint8_t *u, const uint8_t *v,
+                       const uint8_t *a, unsigned n, unsigned alpha);
+    /** plane() onto 10-bit pixels, the source is scaled to 10 bits */
+    void (*plane10)(uint16_t *dst, const uint8_t *src, const uint8_t *a,
+                    unsigned n, unsigned alpha);
+    /** chroma() onto 10-bit pixels */
+    void (*chroma10)(uint16_t *dst, const uint8_t *src, const uint8_t *a,
+                     unsigned n, unsigned alpha);
+    /** Packed RGBA source pixels onto 32-bit RGB pixels, whose red, green
+     * and blue bytes are at offsets r, g and b. The fourth byte is kept. */
+    void (*rgbx)(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                 unsigned alpha, unsigned r, unsigned g, unsigned b);
+} blend_row_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void blend_row_InitC(blend_row_t *);
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+ && defined(HAVE_SSE2_INTRINSICS)
+# define HAVE_BLEND_ROW_SSE4_1 1
+# define HAVE_BLEND_ROW_AVX2 1
+void blend_row_InitSSE4_1(blend_row_t *);
+void blend_row_InitAVX2(blend_row_t *);
+#endif
+
+/**
+ * Selects the fastest routines for the CPU.
+ *
+ * @return true if vectorized routines were selected, false if only the C
+ * routines are available
+ */
+bool blend_row_Init(blend_row_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
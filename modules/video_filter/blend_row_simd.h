@@ -0,0 +1,236 @@
+/*****************************************************************************
+ * blend_row_simd.h: SSE4.1 and AVX2 line blending template
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * These are the C routines of blend_row.c, on one vector at a time. 8-bit
+ * pixels are blended in 16-bit lanes, where (255 - a) * d + a * s cannot
+ * overflow, and div255() of a null opacity returns the destination pixel
+ * as is. 10-bit pixels are blended in 32-bit lanes with pmaddwd, and the
+ * pixels with a null opacity are kept explicitly, as the C code skips them.
+ * The remaining pixels of a line are blended by the C routines.
+ *
+ * Before including this file, define:
+ *  - VEC: the vector type, of VEC_SIZE bytes,
+ *  - V(op): the intrinsic for the vector size,
+ *  - V_ZERO(), V_AND(a, b) and V_OR(a, b): the bitwise intrinsics,
+ *  - V_LOAD(p) and V_STORE(p, v): unaligned load and store,
+ *  - V_LOAD_HALF(p): loads VEC_SIZE / 2 bytes, widened to 16-bit lanes,
+ *  - V_ORDER(v): reorders the 64-bit quarters after a pack of two vectors,
+ *  - V_BROADCAST(p): loads 16 bytes into each 128-bit lane,
+ *  - VLC_TARGET: the target attribute,
+ *  - RENAME(a): the name of the function.
+ */
+
+VLC_TARGET
+static inline VEC RENAME(div255_16)(VEC v)
+{
+    const VEC one = V(set1_epi16)(1);
+
+    return V(srli_epi16)(V(add_epi16)(V(add_epi16)(V(srli_epi16)(v, 8), v),
+                                      one), 8);
+}
+
+VLC_TARGET
+static inline VEC RENAME(div255_32)(VEC v)
+{
+    const VEC one = V(set1_epi32)(1);
+
+    return V(srli_epi32)(V(add_epi32)(V(add_epi32)(V(srli_epi32)(v, 8), v),
+                                      one), 8);
+}
+
+/* Blends 8-bit values in 16-bit lanes */
+VLC_TARGET
+static inline VEC RENAME(merge16)(VEC d, VEC s, VEC a, VEC alpha)
+{
+    const VEC c255 = V(set1_epi16)(255);
+
+    a = RENAME(div255_16)(V(mullo_epi16)(a, alpha));
+    return RENAME(div255_16)(V(add_epi16)(
+                V(mullo_epi16)(V(sub_epi16)(c255, a), d),
+                V(mullo_epi16)(s, a)));
+}
+
+/* Blends 8-bit values */
+VLC_TARGET
+static inline VEC RENAME(merge8)(VEC d, VEC s, VEC a, VEC alpha)
+{
+    const VEC zero = V_ZERO();
+    VEC lo = RENAME(merge16)(V(unpacklo_epi8)(d, zero),
+                             V(unpacklo_epi8)(s, zero),
+                             V(unpacklo_epi8)(a, zero), alpha);
+    VEC hi = RENAME(merge16)(V(unpackhi_epi8)(d, zero),
+                             V(unpackhi_epi8)(s, zero),
+                             V(unpackhi_epi8)(a, zero), alpha);
+
+    return V(packus_epi16)(lo, hi);
+}
+
+/* Blends 8-bit values onto 10-bit values, in 16-bit lanes */
+VLC_TARGET
+static inline VEC RENAME(merge10)(VEC d, VEC s, VEC a, VEC alpha)
+{
+    const VEC zero = V_ZERO();
+    const VEC c255 = V(set1_epi16)(255);
+
+    a = RENAME(div255_16)(V(mullo_epi16)(a, alpha));
+    /* s * 1023 / 255 == 4 * s + s / 85 */
+    s = V(add_epi16)(V(slli_epi16)(s, 2),
+                     V(mulhi_epu16)(s, V(set1_epi16)(772)));
+
+    const VEC w = V(sub_epi16)(c255, a);
+    VEC lo = V(madd_epi16)(V(unpacklo_epi16)(d, s), V(unpacklo_epi16)(w, a));
+    VEC hi = V(madd_epi16)(V(unpackhi_epi16)(d, s), V(unpackhi_epi16)(w, a));
+    VEC r = V(packus_epi32)(RENAME(div255_32)(lo), RENAME(div255_32)(hi));
+
+    return V(blendv_epi8)(r, d, V(cmpeq_epi16)(a, zero));
+}
+
+/* Even 8-bit pixels of 2 * VEC_SIZE bytes */
+VLC_TARGET
+static inline VEC RENAME(even8)(const uint8_t *p)
+{
+    const VEC mask = V(set1_epi16)(0xff);
+
+    return V_ORDER(V(packus_epi16)(V_AND(V_LOAD(p), mask),
+                                   V_AND(V_LOAD(p + VEC_SIZE), mask)));
+}
+
+VLC_TARGET
+static void RENAME(plane)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                          unsigned n, unsigned alpha)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    unsigned i;
+
+    for (i = 0; i + VEC_SIZE <= n; i += VEC_SIZE)
+        V_STORE(&dst[i], RENAME(merge8)(V_LOAD(&dst[i]), V_LOAD(&src[i]),
+                                        V_LOAD(&a[i]), va));
+
+    PlaneC(&dst[i], &src[i], &a[i], n - i, alpha);
+}
+
+VLC_TARGET
+static void RENAME(chroma)(uint8_t *dst, const uint8_t *src, const uint8_t *a,
+                           unsigned n, unsigned alpha)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    unsigned i;
+
+    /* The source lines end after the pixel 2n - 2 */
+    for (i = 0; i + VEC_SIZE < n; i += VEC_SIZE)
+        V_STORE(&dst[i], RENAME(merge8)(V_LOAD(&dst[i]),
+                                        RENAME(even8)(&src[2 * i]),
+                                        RENAME(even8)(&a[2 * i]), va));
+
+    ChromaC(&dst[i], &src[2 * i], &a[2 * i], n - i, alpha);
+}
+
+VLC_TARGET
+static void RENAME(semiplanar)(uint8_t *dst, const uint8_t *u,
+                               const uint8_t *v, const uint8_t *a,
+                               unsigned n, unsigned alpha)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    const VEC mask = V(set1_epi16)(0xff);
+    unsigned i;
+
+    /* Interleave the even U and V pixels as the destination is */
+    for (i = 0; i + VEC_SIZE / 2 < n; i += VEC_SIZE / 2)
+    {
+        const VEC vu = V_LOAD(&u[2 * i]);
+        const VEC vv = V_LOAD(&v[2 * i]);
+        const VEC vai = V_LOAD(&a[2 * i]);
+        const VEC s = V_OR(V_AND(vu, mask), V(slli_epi16)(vv, 8));
+        const VEC sa = V_OR(V_AND(vai, mask), V(slli_epi16)(vai, 8));
+
+        V_STORE(&dst[2 * i],
+                RENAME(merge8)(V_LOAD(&dst[2 * i]), s, sa, va));
+    }
+
+    SemiPlanarC(&dst[2 * i], &u[2 * i], &v[2 * i], &a[2 * i], n - i, alpha);
+}
+
+VLC_TARGET
+static void RENAME(plane10)(uint16_t *dst, const uint8_t *src,
+                            const uint8_t *a, unsigned n, unsigned alpha)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    unsigned i;
+
+    for (i = 0; i + VEC_SIZE / 2 <= n; i += VEC_SIZE / 2)
+        V_STORE(&dst[i], RENAME(merge10)(V_LOAD(&dst[i]),
+                                         V_LOAD_HALF(&src[i]),
+                                         V_LOAD_HALF(&a[i]), va));
+
+    Plane10C(&dst[i], &src[i], &a[i], n - i, alpha);
+}
+
+VLC_TARGET
+static void RENAME(chroma10)(uint16_t *dst, const uint8_t *src,
+                             const uint8_t *a, unsigned n, unsigned alpha)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    const VEC mask = V(set1_epi16)(0xff);
+    unsigned i;
+
+    for (i = 0; i + VEC_SIZE / 2 < n; i += VEC_SIZE / 2)
+        V_STORE(&dst[i],
+                RENAME(merge10)(V_LOAD(&dst[i]),
+                                V_AND(V_LOAD(&src[2 * i]), mask),
+                                V_AND(V_LOAD(&a[2 * i]), mask), va));
+
+    Chroma10C(&dst[i], &src[2 * i], &a[2 * i], n - i, alpha);
+}
+
+VLC_TARGET
+static void RENAME(rgbx)(uint8_t *dst, const uint8_t *rgba, unsigned n,
+                         unsigned alpha, unsigned r, unsigned g, unsigned b)
+{
+    const VEC va = V(set1_epi16)(alpha);
+    uint8_t color[16], opacity[16];
+    unsigned i;
+
+    /* Move the source components to the destination offsets, with a null
+     * opacity for the fourth byte */
+    memset(color, 0x80, sizeof (color));
+    memset(opacity, 0x80, sizeof (opacity));
+    for (i = 0; i < 16; i += 4)
+    {
+        color[i + r] = i;
+        color[i + g] = i + 1;
+        color[i + b] = i + 2;
+        opacity[i + r] = opacity[i + g] = opacity[i + b] = i + 3;
+    }
+    const VEC vcolor = V_BROADCAST(color);
+    const VEC vopacity = V_BROADCAST(opacity);
+
+    for (i = 0; i + VEC_SIZE / 4 <= n; i += VEC_SIZE / 4)
+    {
+        const VEC s = V_LOAD(&rgba[4 * i]);
+
+        V_STORE(&dst[4 * i],
+                RENAME(merge8)(V_LOAD(&dst[4 * i]),
+                               V(shuffle_epi8)(s, vcolor),
+                               V(shuffle_epi8)(s, vopacity), va));
+    }
+
+    RgbxC(&dst[4 * i], &rgba[4 * i], n - i, alpha, r, g, b);
+}
@@ -55,18 +55,29 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_TEXT N_("Alpha of the blended image")
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
+#define WIDTH_TEXT N_("Width of the generated images")
+#define WIDTH_LONGTEXT N_("Width of the images generated when no image " \
+                          "file is given")
+
+#define HEIGHT_TEXT N_("Height of the generated images")
+#define HEIGHT_LONGTEXT N_("Height of the images generated when no image " \
+                           "file is given")
+
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
-#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
+#define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto. " \
+                               "An image is generated if none is given.")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma separated chromas which the base " \
+                                "image will be loaded in")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
-#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
+#define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image. " \
+                                "An image is generated if none is given.")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma separated chromas which the blend " \
+                                 "image will be loaded in")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -78,29 +89,33 @@ vlc_module_begin ()
     set_capability( "video filter", 0 )
 
     set_section( N_("Benchmarking"), NULL )
-    add_integer( CFG_PREFIX "loops", 1000, LOOPS_TEXT,
+    add_integer( CFG_PREFIX "loops", 100, LOOPS_TEXT,
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "width", 1920, 16, 8192, WIDTH_TEXT,
+              WIDTH_LONGTEXT, false )
+    add_integer_with_range( CFG_PREFIX "height", 1080, 16, 8192, HEIGHT_TEXT,
+              HEIGHT_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile(CFG_PREFIX "base-image", NULL,
                  BASE_IMAGE_TEXT, BASE_IMAGE_LONGTEXT)
-    add_string( CFG_PREFIX "base-chroma", "I420", BASE_CHROMA_TEXT,
-              BASE_CHROMA_LONGTEXT, false )
+    add_string( CFG_PREFIX "base-chroma", "I420,NV12,I0AL,RV32",
+              BASE_CHROMA_TEXT, BASE_CHROMA_LONGTEXT, false )
 
     set_section( N_("Blend image"), NULL )
     add_loadfile(CFG_PREFIX "blend-image", NULL,
                  BLEND_IMAGE_TEXT, BLEND_IMAGE_LONGTEXT)
-    add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
-              BLEND_CHROMA_LONGTEXT, false )
+    add_string( CFG_PREFIX "blend-chroma", "YUVA,RGBA,YUVP",
+              BLEND_CHROMA_TEXT, BLEND_CHROMA_LONGTEXT, false )
 
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
 };
 
 /*****************************************************************************
@@ -110,12 +125,15 @@ typedef struct
 {
     bool b_done;
     int i_loops, i_alpha;
+    unsigned i_width, i_height;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_base_chromas;
+    char *psz_blend_image;
+    char *psz_blend_chromas;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    /* Palette of the YUVP blend images */
+    video_palette_t palette;
 } filter_sys_t;
 
 static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
@@ -145,6 +163,120 @@ static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
     return VLC_SUCCESS;
 }
 
+/* Subtitle-like opacity: transparent, opaque and translucent areas */
+static uint8_t blendbench_Alpha( unsigned x, unsigned y )
+{
+    switch( (x / 64 + y / 16) % 4 )
+    {
+        case 0:
+            return 0;
+        case 1:
+            return 255;
+        case 2:
+            return 128;
+        default:
+            return x + y;
+    }
+}
+
+static int blendbench_GenerateImage( vlc_object_t *p_this, picture_t **pp_pic,
+                                     vlc_fourcc_t i_chroma,
+                                     unsigned i_width, unsigned i_height,
+                                     const char *psz_name )
+{
+    video_format_t fmt;
+
+    video_format_Init( &fmt, i_chroma );
+    video_format_Setup( &fmt, i_chroma, i_width, i_height,
+                        i_width, i_height, 1, 1 );
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+    {
+        msg_Err( p_this, "Unable to generate %s image", psz_name );
+        return VLC_EGENERIC;
+    }
+
+    /* Deterministic content, so that the output can be compared */
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            uint8_t *line = &p->p_pixels[y * p->i_pitch];
+
+            if( p->i_pixel_pitch == 2 )
+                for( int x = 0; x < p->i_visible_pitch / 2; x++ )
+                {
+                    /* 10-bit pixels */
+                    uint16_t v = (x * 3 + y * 5 + i * 256) & 1023;
+                    memcpy( &line[2 * x], &v, 2 );
+                }
+            else
+                for( int x = 0; x < p->i_visible_pitch; x++ )
+                    line[x] = x * 3 + y * 5 + i * 64;
+        }
+    }
+
+    if( i_chroma == VLC_CODEC_YUVA )
+        for( unsigned y = 0; y < i_height; y++ )
+            for( unsigned x = 0; x < i_width; x++ )
+                p_pic->p[A_PLANE].p_pixels[y * p_pic->p[A_PLANE].i_pitch + x] =
+                    blendbench_Alpha( x, y );
+    else if( i_chroma == VLC_CODEC_RGBA )
+        for( unsigned y = 0; y < i_height; y++ )
+            for( unsigned x = 0; x < i_width; x++ )
+                p_pic->p[0].p_pixels[y * p_pic->p[0].i_pitch + 4 * x + 3] =
+                    blendbench_Alpha( x, y );
+    else if( i_chroma == VLC_CODEC_YUVP )
+        for( unsigned y = 0; y < i_height; y++ )
+            for( unsigned x = 0; x < i_width; x++ )
+                p_pic->p[0].p_pixels[y * p_pic->p[0].i_pitch + x] =
+                    blendbench_Alpha( x, y );
+
+    *pp_pic = p_pic;
+    return VLC_SUCCESS;
+}
+
+static int blendbench_GetImage( filter_t *p_filter, picture_t **pp_pic,
+                                vlc_fourcc_t i_chroma, char *psz_file,
+                                unsigned i_height, const char *psz_name )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( psz_file != NULL && *psz_file != '\0' )
+        return blendbench_LoadImage( VLC_OBJECT(p_filter), pp_pic, i_chroma,
+                                     psz_file, psz_name );
+    return blendbench_GenerateImage( VLC_OBJECT(p_filter), pp_pic, i_chroma,
+                                     p_sys->i_width, i_height, psz_name );
+}
+
+static vlc_fourcc_t blendbench_GetChroma( const char *psz_chroma, size_t i_len )
+{
+    if( i_len != 4 )
+        return 0;
+    return VLC_FOURCC( psz_chroma[0], psz_chroma[1], psz_chroma[2],
+                       psz_chroma[3] );
+}
+
+/* FNV-1a hash of the visible pixels */
+static uint32_t blendbench_Checksum( const picture_t *p_pic )
+{
+    uint32_t i_hash = 2166136261u;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            for( int x = 0; x < p->i_visible_pitch; x++ )
+                i_hash = (i_hash ^ p->p_pixels[y * p->i_pitch + x])
+                         * 16777619u;
+    }
+    return i_hash;
+}
+
 /*****************************************************************************
  * Create: allocates video thread output method
  *****************************************************************************/
@@ -152,8 +284,6 @@ static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -174,38 +304,28 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = !psz_temp || strlen( psz_temp ) != 4 ? 0 :
-        VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                   CFG_PREFIX "height" );
+
+    p_sys->psz_base_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
+    p_sys->psz_base_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
+    p_sys->psz_blend_image =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
+    p_sys->psz_blend_chromas =
+        var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-chroma" );
+
+    p_sys->palette.i_entries = VIDEO_PALETTE_COLORS_MAX;
+    for( unsigned i = 0; i < VIDEO_PALETTE_COLORS_MAX; i++ )
     {
-        free( p_sys );
-        return i_ret;
-    }
-
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = !psz_temp || strlen( psz_temp ) != 4
-        ? 0 : VLC_FOURCC( psz_temp[0], psz_temp[1], psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                                  psz_cmd, "Blend" );
-
-    free( psz_temp );
-    free( psz_cmd );
-
-    if( i_ret != VLC_SUCCESS )
-    {
-        picture_Release( p_sys->p_base_image );
-        free( p_sys );
-
-        return VLC_EGENERIC;
+        p_sys->palette.palette[i][0] = 16 + i * 219 / 255;
+        p_sys->palette.palette[i][1] = 255 - i;
+        p_sys->palette.palette[i][2] = i * 7;
+        /* The palette index is the opacity in the generated images */
+        p_sys->palette.palette[i][3] = i;
     }
 
     return VLC_SUCCESS;
@@ -219,58 +339,132 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_base_chromas );
+    free( p_sys->psz_blend_image );
+    free( p_sys->psz_blend_chromas );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Bench: blends a picture onto another one
  *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+static void Bench( filter_t *p_filter, const picture_t *p_base,
+                   const picture_t *p_blend_image )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_fourcc_t i_base_chroma = p_base->format.i_chroma;
+    const vlc_fourcc_t i_blend_chroma = p_blend_image->format.i_chroma;
     filter_t *p_blend;
 
-    if( p_sys->b_done )
-        return p_pic;
-
     p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
     if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
+        return;
+    p_blend->fmt_out.video = p_base->format;
+    p_blend->fmt_in.video = p_blend_image->format;
+    if( i_blend_chroma == VLC_CODEC_YUVP &&
+        p_blend->fmt_in.video.p_palette == NULL )
+        p_blend->fmt_in.video.p_palette = &p_sys->palette;
     p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
     if( !p_blend->p_module )
     {
-        picture_Release( p_pic );
+        msg_Warn( p_filter, "Cannot blend %4.4s onto %4.4s",
+                  (const char *)&i_blend_chroma, (const char *)&i_base_chroma );
+        vlc_object_release( p_blend );
+        return;
+    }
+
+    picture_t *p_dst = picture_NewFromFormat( &p_base->format );
+    if( p_dst == NULL )
+    {
+        module_unneed( p_blend, p_blend->p_module );
         vlc_object_release( p_blend );
-        return NULL;
+        return;
     }
 
+    /* The output of a single blend must not change from a build or CPU to
+     * another */
+    picture_Copy( p_dst, p_base );
+    p_blend->pf_video_blend( p_blend, p_dst, p_blend_image,
+                             0, 0, p_sys->i_alpha );
+    const uint32_t i_checksum = blendbench_Checksum( p_dst );
+
     vlc_tick_t time = vlc_tick_now();
     for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
+        p_blend->pf_video_blend( p_blend, p_dst, p_blend_image,
                                  0, 0, p_sys->i_alpha );
     }
     time = vlc_tick_now() - time;
-
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              secf_from_vlc_tick(time) );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
+    if( time <= 0 )
+        time = 1;
+
+    const unsigned i_pixels = __MIN(p_blend_image->format.i_visible_width,
+                                    p_base->format.i_visible_width) *
+                              __MIN(p_blend_image->format.i_visible_height,
+                                    p_base->format.i_visible_height);
+
+    msg_Info( p_filter, "%4.4s onto %4.4s: blended %d images in %f sec",
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
+              p_sys->i_loops, secf_from_vlc_tick(time) );
+    msg_Info( p_filter, "%4.4s onto %4.4s: %f images/second, "
+              "%f Mpixels/second, checksum %08"PRIx32,
+              (const char *)&i_blend_chroma, (const char *)&i_base_chroma,
               (float) p_sys->i_loops / time * CLOCK_FREQ,
-              (float) p_sys->i_loops / time * CLOCK_FREQ *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
+              (float) p_sys->i_loops / time * CLOCK_FREQ * i_pixels / 1e6,
+              i_checksum );
 
+    picture_Release( p_dst );
     module_unneed( p_blend, p_blend->p_module );
-
     vlc_object_release( p_blend );
+}
 
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    if( p_sys->b_done )
+        return p_pic;
     p_sys->b_done = true;
+
+    /* Every blend chroma onto every base chroma. The generated blend image
+     * is a subtitle band, a third of the base height. */
+    for( const char *psz_base = p_sys->psz_base_chromas;
+         psz_base != NULL && *psz_base != '\0'; )
+    {
+        size_t i_len = strcspn( psz_base, "," );
+        vlc_fourcc_t i_base_chroma = blendbench_GetChroma( psz_base, i_len );
+        picture_t *p_base;
+
+        psz_base += i_len + (psz_base[i_len] == ',');
+        if( blendbench_GetImage( p_filter, &p_base, i_base_chroma,
+                                 p_sys->psz_base_image, p_sys->i_height,
+                                 "Base" ) != VLC_SUCCESS )
+            continue;
+
+        for( const char *psz_blend = p_sys->psz_blend_chromas;
+             psz_blend != NULL && *psz_blend != '\0'; )
+        {
+            size_t i_blend_len = strcspn( psz_blend, "," );
+            vlc_fourcc_t i_blend_chroma =
+                blendbench_GetChroma( psz_blend, i_blend_len );
+            picture_t *p_blend;
+
+            psz_blend += i_blend_len + (psz_blend[i_blend_len] == ',');
+            if( blendbench_GetImage( p_filter, &p_blend, i_blend_chroma,
+                                     p_sys->psz_blend_image,
+                                     __MAX(p_sys->i_height / 3, 1),
+                                     "Blend" ) != VLC_SUCCESS )
+                continue;
+
+            Bench( p_filter, p_base, p_blend );
+            picture_Release( p_blend );
+        }
+        picture_Release( p_base );
+    }
+
     return p_pic;
 }
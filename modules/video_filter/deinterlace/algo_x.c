@@ -33,6 +33,7 @@
 #include <vlc_common.h>
 #include <vlc_cpu.h>
 #include <vlc_picture.h>
+#include <vlc_filter.h>
 
 #include "deinterlace.h" /* filter_sys_t */
 
@@ -511,9 +512,18 @@ static inline void XDeintBand8x8MMXEXT( uint8_t *dst, int i_dst,
  * Public functions
  *****************************************************************************/
 
-int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+struct x_slices
+{
+    picture_t *p_outpic;
+    const picture_t *p_pic;
+};
+
+/* Renders the bands of 8 lines of one slice of each plane */
+static void RenderXSlice( void *opaque, unsigned slice, unsigned slices )
 {
-    VLC_UNUSED(p_filter);
+    const struct x_slices *ctx = opaque;
+    picture_t *p_outpic = ctx->p_outpic;
+    const picture_t *p_pic = ctx->p_pic;
     int i_plane;
 #if defined (CAN_COMPILE_MMXEXT)
     const bool mmxext = vlc_CPU_MMXEXT();
@@ -531,9 +541,16 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         const int i_dst = p_outpic->p[i_plane].i_pitch;
         const int i_src = p_pic->p[i_plane].i_pitch;
 
+        unsigned first, end;
         int y, x;
 
-        for( y = 0; y < i_mby; y++ )
+        filter_GetSliceLines( p_outpic->p[i_plane].i_visible_lines, 8,
+                              slice, slices, &first, &end );
+
+        const int i_first = first / 8;
+        const int i_end = __MIN( i_mby, (int)(end + 7) / 8 );
+
+        for( y = i_first; y < i_end; y++ )
         {
             uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
             uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
@@ -547,10 +564,10 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
         }
 
         /* Last line (C only)*/
-        if( i_mody )
+        if( i_mody && i_mby >= i_first && 8 * i_mby < (int)end )
         {
-            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*y*i_dst];
-            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*y*i_src];
+            uint8_t *dst = &p_outpic->p[i_plane].p_pixels[8*i_mby*i_dst];
+            uint8_t *src = &p_pic->p[i_plane].p_pixels[8*i_mby*i_src];
 
             for( x = 0; x < i_mbx; x++ )
             {
@@ -569,5 +586,17 @@ int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
     if( mmxext )
         emms();
 #endif
+}
+
+int RenderX( filter_t *p_filter, picture_t *p_outpic, picture_t *p_pic )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    struct x_slices ctx = {
+        .p_outpic = p_outpic,
+        .p_pic = p_pic,
+    };
+
+    filter_RunSlices( p_sys->executor, p_outpic->p[0].i_visible_lines,
+                      DEINTERLACE_SLICE_LINES, RenderXSlice, &ctx );
     return VLC_SUCCESS;
 }
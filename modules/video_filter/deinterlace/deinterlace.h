@@ -61,6 +61,9 @@ static const char *const mode_list_text[] = {
  * Data structures
  *****************************************************************************/
 
+/** Minimum number of lines per slice for the parallel algorithms */
+#define DEINTERLACE_SLICE_LINES 64
+
 /**
  * Top-level deinterlace subsystem state.
  */
@@ -77,6 +80,9 @@ typedef struct
 
     struct deinterlace_ctx   context;
 
+    /** Thread pool for the slice-parallel algorithms (X, Yadif) */
+    struct vlc_executor *executor;
+
     /* Algorithm-specific substructures */
     union {
         phosphor_sys_t phosphor; /**< Phosphor algorithm state. */
@@ -157,6 +157,31 @@ void Merge8BitSSE2( void *, const void *, const void *, size_t );
 void Merge16BitSSE2( void *, const void *, const void *, size_t );
 #endif
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+ && defined(HAVE_SSE2_INTRINSICS)
+# define HAVE_MERGE_AVX2 1
+/**
+ * AVX2 routine to blend 8 bit pixels from two picture lines.
+ *
+ * This rounds like the SSE2 routine. No EndMerge() call is needed.
+ *
+ * @param _p_dest Target
+ * @param _p_s1 Source line A
+ * @param _p_s2 Source line B
+ * @param i_bytes Number of bytes to merge
+ */
+void Merge8BitAVX2( void *, const void *, const void *, size_t );
+/**
+ * AVX2 routine to blend 16 bit pixels from two picture lines.
+ *
+ * @param _p_dest Target
+ * @param _p_s1 Source line A
+ * @param _p_s2 Source line B
+ * @param i_bytes Number of *bytes* to merge
+ */
+void Merge16BitAVX2( void *, const void *, const void *, size_t );
+#endif
+
 #if defined(CAN_COMPILE_ARM)
 /**
  * ARM NEON routine to blend pixels from two picture lines.
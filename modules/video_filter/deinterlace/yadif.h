@@ -147,7 +147,53 @@ static void yadif_filter_line_c_16bit(uint8_t *dst8, uint8_t *prev8, uint8_t *cu
     int x;
     uint16_t *prev2= parity ? prev : cur ;
     uint16_t *next2= parity ? cur  : next;
+    w /= 2;
     mrefs /= 2;
     prefs /= 2;
     FILTER
 }
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) \
+ && defined(HAVE_SSE2_INTRINSICS)
+// ================ AVX2 =================
+#define HAVE_YADIF_AVX2
+#include <immintrin.h>
+
+#define YADIF_PIXEL uint8_t
+#define YADIF_LANES 16
+#define YADIF_LOAD(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define YADIF_STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi16(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+#define YADIF_OP(op) op ## epi16
+#define YADIF_C yadif_filter_line_c
+#define RENAME(a) a ## _avx2
+#include "yadif_avx2.h"
+#undef RENAME
+#undef YADIF_C
+#undef YADIF_OP
+#undef YADIF_STORE
+#undef YADIF_LOAD
+#undef YADIF_LANES
+#undef YADIF_PIXEL
+
+#define YADIF_PIXEL uint16_t
+#define YADIF_LANES 8
+#define YADIF_LOAD(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define YADIF_STORE(p, v) \
+    _mm_storeu_si128((__m128i *)(p), \
+                     _mm_packus_epi32(_mm256_castsi256_si128(v), \
+                                      _mm256_extracti128_si256(v, 1)))
+#define YADIF_OP(op) op ## epi32
+#define YADIF_C yadif_filter_line_c_16bit
+#define RENAME(a) a ## _avx2_16bit
+#include "yadif_avx2.h"
+#undef RENAME
+#undef YADIF_C
+#undef YADIF_OP
+#undef YADIF_STORE
+#undef YADIF_LOAD
+#undef YADIF_LANES
+#undef YADIF_PIXEL
+#endif
@@ -0,0 +1,150 @@
+/*****************************************************************************
+ * yadif_avx2.h : AVX2 Yadif line filter template
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This is the same algorithm as the FILTER macro of yadif.h, on one vector
+ * of pixels at a time. Pixels are widened so that the intermediate sums
+ * cannot overflow: 8-bit pixels are processed as 16 x 16-bit lanes, and
+ * 16-bit pixels as 8 x 32-bit lanes. The output is identical to the C code.
+ *
+ * Before including this file, define:
+ *  - YADIF_PIXEL: the pixel type,
+ *  - YADIF_LANES: the number of pixels per vector,
+ *  - YADIF_LOAD(p): loads and widens YADIF_LANES pixels,
+ *  - YADIF_STORE(p, v): narrows and stores YADIF_LANES pixels,
+ *  - YADIF_OP(op): the intrinsic suffix for the lane width,
+ *  - YADIF_C: the C function for the remaining pixels of a line,
+ *  - RENAME(a): the name of the function.
+ */
+
+#define V_ADD(a, b) YADIF_OP(_mm256_add_)(a, b)
+#define V_SUB(a, b) YADIF_OP(_mm256_sub_)(a, b)
+#define V_MIN(a, b) YADIF_OP(_mm256_min_)(a, b)
+#define V_MAX(a, b) YADIF_OP(_mm256_max_)(a, b)
+#define V_ABS(a)    YADIF_OP(_mm256_abs_)(a)
+#define V_HALF(a)   YADIF_OP(_mm256_srai_)(a, 1)
+#define V_LT(a, b)  YADIF_OP(_mm256_cmpgt_)(b, a)
+/* m ? a : b */
+#define V_SEL(m, a, b) _mm256_blendv_epi8(b, a, m)
+
+__attribute__((__target__("avx2")))
+static void RENAME(yadif_filter_line)(uint8_t *dst8, uint8_t *prev8,
+                                      uint8_t *cur8, uint8_t *next8, int w,
+                                      int prefs, int mrefs, int parity,
+                                      int mode)
+{
+    YADIF_PIXEL *dst = (YADIF_PIXEL *)dst8;
+    const YADIF_PIXEL *prev = (const YADIF_PIXEL *)prev8;
+    const YADIF_PIXEL *cur = (const YADIF_PIXEL *)cur8;
+    const YADIF_PIXEL *next = (const YADIF_PIXEL *)next8;
+    const YADIF_PIXEL *prev2 = parity ? prev : cur;
+    const YADIF_PIXEL *next2 = parity ? cur : next;
+    const int pw = w / sizeof (YADIF_PIXEL);
+    const int pm = mrefs / (int)sizeof (YADIF_PIXEL);
+    const int pp = prefs / (int)sizeof (YADIF_PIXEL);
+    const __m256i one = YADIF_OP(_mm256_set1_)(1);
+    int x;
+
+    for (x = 0; x + YADIF_LANES <= pw; x += YADIF_LANES)
+    {
+        const __m256i c = YADIF_LOAD(&cur[x + pm]);
+        const __m256i e = YADIF_LOAD(&cur[x + pp]);
+        const __m256i p2 = YADIF_LOAD(&prev2[x]);
+        const __m256i n2 = YADIF_LOAD(&next2[x]);
+        const __m256i d = V_HALF(V_ADD(p2, n2));
+
+        __m256i td0 = V_ABS(V_SUB(p2, n2));
+        __m256i td1 = V_HALF(V_ADD(V_ABS(V_SUB(YADIF_LOAD(&prev[x + pm]), c)),
+                                   V_ABS(V_SUB(YADIF_LOAD(&prev[x + pp]), e))));
+        __m256i td2 = V_HALF(V_ADD(V_ABS(V_SUB(YADIF_LOAD(&next[x + pm]), c)),
+                                   V_ABS(V_SUB(YADIF_LOAD(&next[x + pp]), e))));
+        __m256i diff = V_MAX(V_MAX(V_HALF(td0), td1), td2);
+
+        __m256i pred = V_HALF(V_ADD(c, e));
+        __m256i score = V_SUB(V_ADD(V_ADD(
+                V_ABS(V_SUB(YADIF_LOAD(&cur[x + pm - 1]),
+                            YADIF_LOAD(&cur[x + pp - 1]))),
+                V_ABS(V_SUB(c, e))),
+                V_ABS(V_SUB(YADIF_LOAD(&cur[x + pm + 1]),
+                            YADIF_LOAD(&cur[x + pp + 1])))), one);
+
+        /* Edge directions. The second check of each side only applies to
+         * the lanes where the first one succeeded. */
+#define V_CHECK(j) \
+        V_ADD(V_ADD( \
+            V_ABS(V_SUB(YADIF_LOAD(&cur[x + pm - 1 + (j)]), \
+                        YADIF_LOAD(&cur[x + pp - 1 - (j)]))), \
+            V_ABS(V_SUB(YADIF_LOAD(&cur[x + pm + (j)]), \
+                        YADIF_LOAD(&cur[x + pp - (j)])))), \
+            V_ABS(V_SUB(YADIF_LOAD(&cur[x + pm + 1 + (j)]), \
+                        YADIF_LOAD(&cur[x + pp + 1 - (j)]))))
+#define V_PRED(j) \
+        V_HALF(V_ADD(YADIF_LOAD(&cur[x + pm + (j)]), \
+                     YADIF_LOAD(&cur[x + pp - (j)])))
+
+        for (int j = -1; j <= 1; j += 2)
+        {
+            __m256i s = V_CHECK(j);
+            __m256i m = V_LT(s, score);
+
+            score = V_SEL(m, s, score);
+            pred = V_SEL(m, V_PRED(j), pred);
+
+            s = V_CHECK(2 * j);
+            m = _mm256_and_si256(m, V_LT(s, score));
+            score = V_SEL(m, s, score);
+            pred = V_SEL(m, V_PRED(2 * j), pred);
+        }
+#undef V_PRED
+#undef V_CHECK
+
+        if (mode < 2)
+        {
+            const __m256i b = V_HALF(V_ADD(YADIF_LOAD(&prev2[x + 2 * pm]),
+                                           YADIF_LOAD(&next2[x + 2 * pm])));
+            const __m256i f = V_HALF(V_ADD(YADIF_LOAD(&prev2[x + 2 * pp]),
+                                           YADIF_LOAD(&next2[x + 2 * pp])));
+            const __m256i de = V_SUB(d, e), dc = V_SUB(d, c);
+            const __m256i bc = V_SUB(b, c), fe = V_SUB(f, e);
+            const __m256i max = V_MAX(V_MAX(de, dc), V_MIN(bc, fe));
+            const __m256i min = V_MIN(V_MIN(de, dc), V_MAX(bc, fe));
+
+            diff = V_MAX(V_MAX(diff, min), V_SUB(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative, so this is the same as the C clipping */
+        pred = V_MIN(V_MAX(pred, V_SUB(d, diff)), V_ADD(d, diff));
+        YADIF_STORE(&dst[x], pred);
+    }
+
+    if (x < pw)
+        YADIF_C((uint8_t *)&dst[x], (uint8_t *)&prev[x], (uint8_t *)&cur[x],
+                (uint8_t *)&next[x], (pw - x) * sizeof (YADIF_PIXEL),
+                prefs, mrefs, parity, mode);
+}
+
+#undef V_SEL
+#undef V_LT
+#undef V_HALF
+#undef V_ABS
+#undef V_MAX
+#undef V_MIN
+#undef V_SUB
+#undef V_ADD
@@ -33,6 +33,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_cpu.h>
+#include <vlc_executor.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 
@@ -108,6 +109,8 @@ typedef struct
     int              radius;
     const vlc_chroma_description_t *chroma;
     struct vf_priv_s cfg;
+    size_t           buf_size; /* per plane, in cfg.buf */
+    vlc_executor_t  *executor;
 } filter_sys_t;
 
 static int Open(vlc_object_t *object)
@@ -132,6 +135,8 @@ static int Open(vlc_object_t *object)
     var_AddCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     var_AddCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     sys->cfg.buf = NULL;
+    sys->buf_size = 0;
+    sys->executor = vlc_executor_Hold();
 
     struct vf_priv_s *cfg = &sys->cfg;
     cfg->thresh      = 0.0;
@@ -169,10 +174,53 @@ static void Close(vlc_object_t *object)
     var_DelCallback(filter, CFG_PREFIX "radius",   Callback, NULL);
     var_DelCallback(filter, CFG_PREFIX "strength", Callback, NULL);
     aligned_free(sys->cfg.buf);
+    if (sys->executor != NULL)
+        vlc_executor_Release(sys->executor);
     vlc_mutex_destroy(&sys->lock);
     free(sys);
 }
 
+struct gradfun_planes
+{
+    filter_t  *filter;
+    picture_t *src;
+    picture_t *dst;
+};
+
+/* The blur is a running sum down each plane, so the planes are filtered in
+ * parallel (each with its own part of the buffer) rather than bands. */
+static void FilterPlanes(void *opaque, unsigned slice, unsigned slices)
+{
+    const struct gradfun_planes *ctx = opaque;
+    filter_sys_t *sys = ctx->filter->p_sys;
+    const video_format_t *fmt = &ctx->filter->fmt_in.video;
+    const vlc_chroma_description_t *chroma = sys->chroma;
+    unsigned first, end;
+
+    filter_GetSliceLines(ctx->dst->i_planes, 1, slice, slices, &first, &end);
+
+    for (unsigned i = first; i < end; i++) {
+        const plane_t *srcp = &ctx->src->p[i];
+        plane_t       *dstp = &ctx->dst->p[i];
+        struct vf_priv_s cfg = sys->cfg;
+
+        if (cfg.buf != NULL)
+            cfg.buf += i * sys->buf_size;
+
+        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
+        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
+        int r = (cfg.radius  * chroma->p[i].w.num / chroma->p[i].w.den +
+                 cfg.radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
+        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
+        if (__MIN(w, h) > 2 * r && cfg.buf) {
+            filter_plane(&cfg, dstp->p_pixels, srcp->p_pixels,
+                         w, h, dstp->i_pitch, srcp->i_pitch, r);
+        } else {
+            plane_CopyPixels(dstp, srcp);
+        }
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     filter_sys_t *sys = filter->p_sys;
@@ -193,28 +241,18 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
 
     cfg->thresh = (1 << 15) / strength;
     if (cfg->radius != radius) {
+        /* Keep each plane buffer 16-bytes aligned */
+        size_t size = (((fmt->i_width + 15) & ~15) * (radius + 1) / 2 + 32 + 7) & ~7;
+
         cfg->radius = radius;
-        cfg->buf    = aligned_alloc(16,
-                                   (((fmt->i_width + 15) & ~15) * (cfg->radius + 1) / 2 + 32) * sizeof(*cfg->buf));
+        aligned_free(cfg->buf);
+        cfg->buf    = aligned_alloc(16, dst->i_planes * size * sizeof(*cfg->buf));
+        sys->buf_size = size;
     }
 
-    for (int i = 0; i < dst->i_planes; i++) {
-        const plane_t *srcp = &src->p[i];
-        plane_t       *dstp = &dst->p[i];
+    struct gradfun_planes ctx = { .filter = filter, .src = src, .dst = dst };
 
-        const vlc_chroma_description_t *chroma = sys->chroma;
-        int w = fmt->i_width  * chroma->p[i].w.num / chroma->p[i].w.den;
-        int h = fmt->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
-        int r = (cfg->radius  * chroma->p[i].w.num / chroma->p[i].w.den +
-                 cfg->radius  * chroma->p[i].h.num / chroma->p[i].h.den) / 2;
-        r = VLC_CLIP((r + 1) & ~1, RADIUS_MIN, RADIUS_MAX);
-        if (__MIN(w, h) > 2 * r && cfg->buf) {
-            filter_plane(cfg, dstp->p_pixels, srcp->p_pixels,
-                         w, h, dstp->i_pitch, srcp->i_pitch, r);
-        } else {
-            plane_CopyPixels(dstp, srcp);
-        }
-    }
+    filter_RunSlices(sys->executor, dst->i_planes, 1, FilterPlanes, &ctx);
 
     picture_CopyProperties(dst, src);
     picture_Release(src);
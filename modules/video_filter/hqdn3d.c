@@ -30,6 +30,7 @@
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
+#include <vlc_executor.h>
 #include <vlc_filter.h>
 #include <vlc_picture.h>
 #include "filter_picture.h"
@@ -95,6 +96,7 @@ typedef struct
     bool   b_recalc_coefs;
     vlc_mutex_t coefs_mutex;
     float  luma_spat, luma_temp, chroma_spat, chroma_temp;
+    vlc_executor_t *executor;
 } filter_sys_t;
 
 /*****************************************************************************
@@ -137,11 +139,14 @@ static int Open(vlc_object_t *this)
         if (sys->w[i] > wmax) wmax = sys->w[i];
         sys->h[i] = fmt_out->i_height * chroma->p[i].h.num / chroma->p[i].h.den;
     }
-    cfg->Line = malloc(wmax*sizeof(unsigned int));
-    if (!cfg->Line) {
+    cfg->Line[0] = vlc_alloc(3 * wmax, sizeof(unsigned int));
+    if (!cfg->Line[0]) {
         free(sys);
         return VLC_ENOMEM;
     }
+    cfg->Line[1] = cfg->Line[0] + wmax;
+    cfg->Line[2] = cfg->Line[1] + wmax;
+    sys->executor = vlc_executor_Hold();
 
     config_ChainParse(filter, FILTER_PREFIX, filter_options,
                       filter->p_cfg);
@@ -184,13 +189,44 @@ static void Close(vlc_object_t *this)
     for (int i = 0; i < 3; ++i) {
         free(cfg->Frame[i]);
     }
-    free(cfg->Line);
+    free(cfg->Line[0]);
+    if (sys->executor != NULL)
+        vlc_executor_Release(sys->executor);
     free(sys);
 }
 
 /*****************************************************************************
  * Filter
  *****************************************************************************/
+struct hqdn3d_planes
+{
+    filter_sys_t *sys;
+    picture_t *src;
+    picture_t *dst;
+};
+
+/* The spatial and temporal filters are recursive along the lines of each
+ * plane, so the planes are processed in parallel rather than bands. */
+static void FilterPlanes(void *opaque, unsigned slice, unsigned slices)
+{
+    const struct hqdn3d_planes *ctx = opaque;
+    filter_sys_t *sys = ctx->sys;
+    struct vf_priv_s *cfg = &sys->cfg;
+    unsigned first, end;
+
+    filter_GetSliceLines(3, 1, slice, slices, &first, &end);
+
+    for (unsigned i = first; i < end; i++) {
+        int *spat = cfg->Coefs[i ? 2 : 0];
+        int *temp = cfg->Coefs[i ? 3 : 1];
+
+        deNoise(ctx->src->p[i].p_pixels, ctx->dst->p[i].p_pixels,
+                cfg->Line[i], &cfg->Frame[i], sys->w[i], sys->h[i],
+                ctx->src->p[i].i_pitch, ctx->dst->p[i].i_pitch,
+                spat, spat, temp);
+    }
+}
+
 static picture_t *Filter(filter_t *filter, picture_t *src)
 {
     picture_t *dst;
@@ -220,24 +256,9 @@ static picture_t *Filter(filter_t *filter, picture_t *src)
     }
     vlc_mutex_unlock( &sys->coefs_mutex );
 
-    deNoise(src->p[0].p_pixels, dst->p[0].p_pixels,
-            cfg->Line, &cfg->Frame[0], sys->w[0], sys->h[0],
-            src->p[0].i_pitch, dst->p[0].i_pitch,
-            cfg->Coefs[0],
-            cfg->Coefs[0],
-            cfg->Coefs[1]);
-    deNoise(src->p[1].p_pixels, dst->p[1].p_pixels,
-            cfg->Line, &cfg->Frame[1], sys->w[1], sys->h[1],
-            src->p[1].i_pitch, dst->p[1].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
-    deNoise(src->p[2].p_pixels, dst->p[2].p_pixels,
-            cfg->Line, &cfg->Frame[2], sys->w[2], sys->h[2],
-            src->p[2].i_pitch, dst->p[2].i_pitch,
-            cfg->Coefs[2],
-            cfg->Coefs[2],
-            cfg->Coefs[3]);
+    struct hqdn3d_planes ctx = { .sys = sys, .src = src, .dst = dst };
+
+    filter_RunSlices(sys->executor, 3, 1, FilterPlanes, &ctx);
 
     if(unlikely(!cfg->Frame[0] || !cfg->Frame[1] || !cfg->Frame[2]))
     {
@@ -0,0 +1,547 @@
+/*****************************************************************************
+ * vshm.c: shared memory video output
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * This display exports pictures to another process without copying them.
+ * Its picture pool is allocated in memory file descriptors, so that the
+ * decoder draws straight into memory shared with the consumer. See vshm.h
+ * for the protocol.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_fs.h>
+#include <vlc_network.h>
+#include <vlc_vout_display.h>
+
+#include "vshm.h"
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define PATH_TEXT N_("Socket path")
+#define PATH_LONGTEXT N_("Path of the local socket that the consumer " \
+                         "connects to.")
+
+#define CHROMA_TEXT N_("Chroma")
+#define CHROMA_LONGTEXT N_("Output chroma for the shared pictures as a " \
+                           "4-character string, eg. \"I420\". By default, " \
+                           "decoded pictures are shared as they are.")
+
+#define HELD_TEXT N_("Held pictures")
+#define HELD_LONGTEXT N_("Maximum number of pictures that the consumer can " \
+                         "hold at once. Pictures are skipped for the " \
+                         "consumer while it holds that many.")
+
+static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
+                video_format_t *fmtp, vlc_video_context *context);
+static void Close(vout_display_t *vd);
+
+vlc_module_begin()
+    set_description(N_("Shared memory video output"))
+    set_shortname(N_("Shared memory"))
+
+    set_category(CAT_VIDEO)
+    set_subcategory(SUBCAT_VIDEO_VOUT)
+    set_capability("vout display", 0)
+
+    add_string("vshm-path", NULL, PATH_TEXT, PATH_LONGTEXT, false)
+    add_string("vshm-chroma", NULL, CHROMA_TEXT, CHROMA_LONGTEXT, true)
+    add_integer_with_range("vshm-held", 4, 1, VSHM_BUFFERS_MAX / 2,
+                           HELD_TEXT, HELD_LONGTEXT, true)
+
+    set_callbacks(Open, Close)
+vlc_module_end()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+static_assert(VSHM_PLANES_MAX == PICTURE_PLANE_MAX, "Wrong plane count");
+
+typedef struct
+{
+    int fd;
+    void *base;
+    size_t size;
+    unsigned index;
+} picture_sys_t;
+
+struct vout_display_sys_t {
+    char *path;
+    int listener;
+    int consumer;
+
+    picture_pool_t *pool;
+    picture_t *pictures[VSHM_BUFFERS_MAX];
+    unsigned count;
+
+    size_t buffer_size;
+    struct vshm_plane planes[VSHM_PLANES_MAX];
+    unsigned plane_count;
+
+    /* Pictures lent to the consumer */
+    picture_t *held[VSHM_BUFFERS_MAX];
+    unsigned held_count;
+    unsigned max_held;
+    uint64_t sequence;
+};
+
+static picture_pool_t *Pool(vout_display_t *, unsigned);
+static void           Prepare(vout_display_t *, picture_t *, subpicture_t *, vlc_tick_t);
+static void           Display(vout_display_t *, picture_t *);
+static int            Control(vout_display_t *, int, va_list);
+
+static int Listen(vout_display_t *vd, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_LOCAL };
+
+    if (strlen(path) >= sizeof (addr.sun_path)) {
+        msg_Err(vd, "socket path too long: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = vlc_socket(PF_LOCAL, SOCK_SEQPACKET, 0, true);
+    if (fd == -1) {
+        msg_Err(vd, "cannot create socket: %s", vlc_strerror_c(errno));
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof (addr))) {
+        if (errno != EADDRINUSE)
+            goto error;
+
+        /* Remove the socket of a dead process, but not of a live one */
+        int probe = vlc_socket(PF_LOCAL, SOCK_SEQPACKET, 0, false);
+        if (probe == -1)
+            goto error;
+        if (connect(probe, (struct sockaddr *)&addr, sizeof (addr)) == 0
+         || errno != ECONNREFUSED) {
+            vlc_close(probe);
+            errno = EADDRINUSE;
+            goto error;
+        }
+        vlc_close(probe);
+
+        msg_Info(vd, "removing dead socket: %s", path);
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof (addr)))
+            goto error;
+    }
+
+    if (listen(fd, 1)) {
+        unlink(path);
+        goto error;
+    }
+    return fd;
+
+error:
+    msg_Err(vd, "cannot listen on %s: %s", path, vlc_strerror_c(errno));
+    vlc_close(fd);
+    return -1;
+}
+
+/*****************************************************************************
+ * Open: allocates video thread
+ *****************************************************************************
+ * This function allocates and initializes a vout method.
+ *****************************************************************************/
+static int Open(vout_display_t *vd, const vout_display_cfg_t *cfg,
+                video_format_t *fmtp, vlc_video_context *context)
+{
+    char *path = var_InheritString(vd, "vshm-path");
+    if (path == NULL) {
+        msg_Err(vd, "missing socket path");
+        return VLC_EGENERIC;
+    }
+
+    vout_display_sys_t *sys = calloc(1, sizeof (*sys));
+    if (unlikely(sys == NULL)) {
+        free(path);
+        return VLC_ENOMEM;
+    }
+    sys->path = path;
+    sys->consumer = -1;
+    sys->max_held = var_InheritInteger(vd, "vshm-held");
+
+    /* Define the video format */
+    video_format_t fmt;
+    video_format_ApplyRotation(&fmt, fmtp);
+
+    char *chroma = var_InheritString(vd, "vshm-chroma");
+    if (chroma != NULL) {
+        vlc_fourcc_t fcc = vlc_fourcc_GetCodecFromString(VIDEO_ES, chroma);
+        if (fcc == 0)
+            msg_Warn(vd, "unknown chroma %s", chroma);
+        else
+            fmt.i_chroma = fcc;
+        free(chroma);
+    }
+
+    /* Opaque (hardware) pictures cannot be shared: use system memory */
+    const vlc_chroma_description_t *desc =
+        vlc_fourcc_GetChromaDescription(fmt.i_chroma);
+    if (desc == NULL || desc->plane_count == 0)
+        fmt.i_chroma = VLC_CODEC_I420;
+    video_format_FixRgb(&fmt);
+
+    /* Lay the planes out in one buffer per picture */
+    picture_t layout;
+    if (picture_Setup(&layout, &fmt)) {
+        msg_Err(vd, "unsupported chroma %4.4s", (const char *)&fmt.i_chroma);
+        goto error;
+    }
+
+    size_t size = 0;
+    for (int i = 0; i < layout.i_planes; i++) {
+        const plane_t *p = &layout.p[i];
+
+        sys->planes[i].offset = size;
+        sys->planes[i].pitch = p->i_pitch;
+        sys->planes[i].lines = p->i_lines;
+        size += (size_t)p->i_pitch * p->i_lines;
+        if (size > UINT32_MAX)
+            goto error;
+    }
+    sys->plane_count = layout.i_planes;
+    sys->buffer_size = size;
+
+    sys->listener = Listen(vd, path);
+    if (sys->listener == -1)
+        goto error;
+
+    *fmtp = fmt;
+
+    vd->sys     = sys;
+    vd->pool    = Pool;
+    vd->prepare = Prepare;
+    vd->display = Display;
+    vd->control = Control;
+
+    (void) cfg; (void) context;
+    return VLC_SUCCESS;
+
+error:
+    free(sys->path);
+    free(sys);
+    return VLC_EGENERIC;
+}
+
+static void Disconnect(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->consumer == -1)
+        return;
+
+    for (unsigned i = 0; i < sys->count; i++)
+        if (sys->held[i] != NULL) {
+            picture_Release(sys->held[i]);
+            sys->held[i] = NULL;
+        }
+    sys->held_count = 0;
+
+    net_Close(sys->consumer);
+    sys->consumer = -1;
+    msg_Dbg(vd, "consumer disconnected");
+}
+
+static void Close(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    Disconnect(vd);
+    net_Close(sys->listener);
+    unlink(sys->path);
+
+    if (sys->pool != NULL)
+        picture_pool_Release(sys->pool);
+    free(sys->path);
+    free(sys);
+}
+
+static void DestroyPicture(picture_t *pic)
+{
+    picture_sys_t *psys = pic->p_sys;
+
+    munmap(psys->base, psys->size);
+    vlc_close(psys->fd);
+    free(psys);
+}
+
+static picture_t *CreatePicture(vout_display_t *vd, unsigned index)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    picture_sys_t *psys = malloc(sizeof (*psys));
+    if (unlikely(psys == NULL))
+        return NULL;
+
+    psys->fd = vlc_memfd();
+    if (psys->fd == -1)
+        goto error;
+
+    psys->size = sys->buffer_size;
+    psys->index = index;
+    if (ftruncate(psys->fd, psys->size))
+        goto error_fd;
+
+    psys->base = mmap(NULL, psys->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      psys->fd, 0);
+    if (psys->base == MAP_FAILED)
+        goto error_fd;
+#ifdef F_ADD_SEALS
+    /* The consumer can then map the buffer safely */
+    fcntl(psys->fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+
+    picture_resource_t res = {
+        .p_sys = psys,
+        .pf_destroy = DestroyPicture,
+    };
+
+    for (unsigned i = 0; i < sys->plane_count; i++) {
+        res.p[i].p_pixels = (uint8_t *)psys->base + sys->planes[i].offset;
+        res.p[i].i_lines = sys->planes[i].lines;
+        res.p[i].i_pitch = sys->planes[i].pitch;
+    }
+
+    picture_t *pic = picture_NewFromResource(&vd->fmt, &res);
+    if (likely(pic != NULL))
+        return pic;
+
+    munmap(psys->base, psys->size);
+error_fd:
+    vlc_close(psys->fd);
+error:
+    msg_Err(vd, "cannot allocate shared picture: %s", vlc_strerror_c(errno));
+    free(psys);
+    return NULL;
+}
+
+/**
+ * Return the shared pictures
+ *
+ * The consumer can hold up to max_held pictures for an unbounded time, so
+ * the pool has that many pictures on top of the requested count. Otherwise,
+ * the decoder could run out of pictures and stop producing the frames that
+ * the consumer waits for before it releases the ones it holds.
+ */
+static picture_pool_t *Pool(vout_display_t *vd, unsigned requested_count)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->pool != NULL)
+        return sys->pool;
+
+    unsigned count = requested_count + sys->max_held;
+    if (count > VSHM_BUFFERS_MAX) {
+        msg_Err(vd, "too many shared pictures: %u requested and %u held "
+                "(maximum %u), decrease vshm-held", requested_count,
+                sys->max_held, VSHM_BUFFERS_MAX);
+        return NULL;
+    }
+
+    /* Do not return fewer pictures: the core would then use pictures in
+     * system memory and copy them to the shared ones */
+    for (unsigned i = 0; i < count; i++) {
+        sys->pictures[i] = CreatePicture(vd, i);
+        if (sys->pictures[i] == NULL) {
+            while (i > 0)
+                picture_Release(sys->pictures[--i]);
+            return NULL;
+        }
+    }
+
+    sys->pool = picture_pool_New(count, sys->pictures);
+    if (unlikely(sys->pool == NULL)) {
+        while (count > 0)
+            picture_Release(sys->pictures[--count]);
+        return NULL;
+    }
+    sys->count = count;
+    return sys->pool;
+}
+
+/**
+ * Sends the format and the buffer descriptors to a new consumer.
+ */
+static int SendFormat(vout_display_t *vd, int fd)
+{
+    vout_display_sys_t *sys = vd->sys;
+    const video_format_t *fmt = &vd->fmt;
+    struct vshm_format msg = {
+        .type = VSHM_FORMAT,
+        .version = VSHM_VERSION,
+        .chroma = fmt->i_chroma,
+        .width = fmt->i_width,
+        .height = fmt->i_height,
+        .x_offset = fmt->i_x_offset,
+        .y_offset = fmt->i_y_offset,
+        .visible_width = fmt->i_visible_width,
+        .visible_height = fmt->i_visible_height,
+        .sar_num = fmt->i_sar_num,
+        .sar_den = fmt->i_sar_den,
+        .frame_rate = fmt->i_frame_rate,
+        .frame_rate_base = fmt->i_frame_rate_base,
+        .buffer_size = sys->buffer_size,
+        .buffer_count = sys->count,
+        .max_held = sys->max_held,
+        .plane_count = sys->plane_count,
+    };
+    memcpy(msg.planes, sys->planes, sizeof (msg.planes));
+
+    union {
+        char buf[CMSG_SPACE(VSHM_BUFFERS_MAX * sizeof (int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { .iov_base = &msg, .iov_len = sizeof (msg) };
+    struct msghdr hdr = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = CMSG_SPACE(sys->count * sizeof (int)),
+    };
+
+    memset(&control, 0, sizeof (control));
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sys->count * sizeof (int));
+
+    int *fds = (int *)CMSG_DATA(cmsg);
+    for (unsigned i = 0; i < sys->count; i++) {
+        picture_sys_t *psys = sys->pictures[i]->p_sys;
+        fds[i] = psys->fd;
+    }
+
+    if (sendmsg(fd, &hdr, MSG_NOSIGNAL) != sizeof (msg)) {
+        msg_Err(vd, "cannot send format: %s", vlc_strerror_c(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Accepts a new consumer, and gets the pictures that it gave back.
+ */
+static void Poll(vout_display_t *vd)
+{
+    vout_display_sys_t *sys = vd->sys;
+
+    if (sys->consumer == -1) {
+        if (sys->pool == NULL)
+            return;
+
+        int fd = vlc_accept(sys->listener, NULL, NULL, true);
+        if (fd == -1)
+            return;
+
+        if (SendFormat(vd, fd)) {
+            net_Close(fd);
+            return;
+        }
+        sys->consumer = fd;
+        msg_Dbg(vd, "consumer connected");
+    }
+
+    struct vshm_release msg;
+    ssize_t len;
+
+    while ((len = recv(sys->consumer, &msg, sizeof (msg), 0)) > 0) {
+        if (len != sizeof (msg) || msg.type != VSHM_RELEASE
+         || msg.buffer >= sys->count || sys->held[msg.buffer] == NULL) {
+            msg_Err(vd, "invalid message from consumer");
+            Disconnect(vd);
+            return;
+        }
+
+        picture_Release(sys->held[msg.buffer]);
+        sys->held[msg.buffer] = NULL;
+        sys->held_count--;
+    }
+
+    if (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+        Disconnect(vd);
+}
+
+static void Prepare(vout_display_t *vd, picture_t *pic, subpicture_t *subpic,
+                    vlc_tick_t date)
+{
+    Poll(vd);
+    (void) pic; (void) subpic; (void) date;
+}
+
+static void Display(vout_display_t *vd, picture_t *pic)
+{
+    vout_display_sys_t *sys = vd->sys;
+    picture_sys_t *psys = pic->p_sys;
+    uint64_t sequence = sys->sequence++;
+
+    /* Get the pictures released since Prepare() before lending another */
+    Poll(vd);
+    if (sys->consumer == -1)
+        return;
+
+    /* Pictures from the pool are clones sharing the buffer private data */
+    assert(psys != NULL && psys->index < sys->count);
+
+    /* The same picture can be displayed again, e.g. while paused */
+    if (sys->held[psys->index] != NULL || sys->held_count >= sys->max_held)
+        return;
+
+    struct vshm_frame msg = {
+        .type = VSHM_FRAME,
+        .buffer = psys->index,
+        .sequence = sequence,
+        .date = US_FROM_VLC_TICK(pic->date),
+    };
+
+    if (send(sys->consumer, &msg, sizeof (msg), MSG_NOSIGNAL) != sizeof (msg)) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+            Disconnect(vd);
+        return;
+    }
+
+    sys->held[psys->index] = picture_Hold(pic);
+    sys->held_count++;
+}
+
+static int Control(vout_display_t *vd, int query, va_list args)
+{
+    /* Do not keep released pictures while no pictures are displayed */
+    Poll(vd);
+    (void) query; (void) args;
+    return VLC_EGENERIC;
+}
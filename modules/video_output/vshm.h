@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * vshm.h: shared memory video output protocol
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_VSHM_H
+#define VLC_VSHM_H 1
+
+#include <stdint.h>
+
+/*
+ * The vshm display listens on a local sequenced-packet socket
+ * (AF_LOCAL, SOCK_SEQPACKET), and serves one consumer at a time.
+ *
+ * When a consumer connects, the display sends a vshm_format message. Its
+ * ancillary data carries one file descriptor per buffer (SCM_RIGHTS), in
+ * buffer index order. Each buffer holds one picture, with the planes at the
+ * given offsets. The consumer should map the buffers read-only.
+ *
+ * The display then sends a vshm_frame message for every picture that it
+ * displays. The video output does not write to the buffer of a frame until
+ * the consumer gives it back with a vshm_release message. If the consumer
+ * holds too many buffers, further frames are skipped for the consumer; this
+ * shows as a gap in the sequence numbers.
+ *
+ * The display allocates max_held buffers on top of those that the decoder
+ * and the video output need, so the consumer can hold buffers for as long as
+ * it wants without stalling the decoder. Buffers still held when the
+ * consumer disconnects are released.
+ *
+ * All integers are in host byte order.
+ */
+
+#define VSHM_VERSION 1
+
+/** Maximum number of buffers */
+#define VSHM_BUFFERS_MAX 32
+/** Maximum number of planes per picture */
+#define VSHM_PLANES_MAX 5
+
+enum vshm_type
+{
+    VSHM_FORMAT = 1, /**< Display to consumer: struct vshm_format */
+    VSHM_FRAME,      /**< Display to consumer: struct vshm_frame */
+    VSHM_RELEASE,    /**< Consumer to display: struct vshm_release */
+};
+
+struct vshm_plane
+{
+    uint32_t offset; /**< Offset of the plane in the buffer (bytes) */
+    uint32_t pitch;  /**< Length of a line (bytes) */
+    uint32_t lines;  /**< Number of lines */
+};
+
+struct vshm_format
+{
+    uint32_t type;     /**< VSHM_FORMAT */
+    uint32_t version;  /**< VSHM_VERSION */
+    uint32_t chroma;   /**< VLC chroma four character code */
+    uint32_t width;    /**< Picture width (pixels) */
+    uint32_t height;   /**< Picture height (pixels) */
+    uint32_t x_offset; /**< Visible area left offset (pixels) */
+    uint32_t y_offset; /**< Visible area top offset (pixels) */
+    uint32_t visible_width;
+    uint32_t visible_height;
+    uint32_t sar_num;  /**< Sample aspect ratio */
+    uint32_t sar_den;
+    uint32_t frame_rate; /**< Frame rate, or zero if unknown */
+    uint32_t frame_rate_base;
+    uint32_t buffer_size;  /**< Size of each buffer (bytes) */
+    uint32_t buffer_count; /**< Number of buffers (and descriptors) */
+    uint32_t max_held;     /**< Number of buffers the consumer can hold */
+    uint32_t plane_count;
+    struct vshm_plane planes[VSHM_PLANES_MAX];
+};
+
+struct vshm_frame
+{
+    uint32_t type;     /**< VSHM_FRAME */
+    uint32_t buffer;   /**< Buffer index */
+    uint64_t sequence; /**< Number of the displayed picture, from zero */
+    int64_t date;      /**< Presentation timestamp (microseconds) */
+};
+
+struct vshm_release
+{
+    uint32_t type;     /**< VSHM_RELEASE */
+    uint32_t buffer;   /**< Buffer index */
+};
+
+#endif
@@ -26,6 +26,7 @@
 # include <stdatomic.h>
 
 # include <vlc_viewpoint.h>
+# include "misc/histogram.h"
 
 /* Max input rate factor (1/4 -> 4) */
 # define AOUT_MAX_INPUT_RATE (4)
@@ -78,6 +79,7 @@ typedef struct
 
     atomic_uint buffers_lost;
     atomic_uint buffers_played;
+    vlc_histogram_t latency; /**< Delay of the output when playing */
     atomic_uchar restart;
 } aout_owner_t;
 
@@ -132,6 +134,7 @@ int aout_DecNew(audio_output_t *, const audio_sample_format_t *,
 void aout_DecDelete(audio_output_t *);
 int aout_DecPlay(audio_output_t *aout, block_t *block);
 void aout_DecGetResetStats(audio_output_t *, unsigned *, unsigned *);
+void aout_DecMoveLatency(audio_output_t *, vlc_histogram_t *);
 void aout_DecChangePause(audio_output_t *, bool b_paused, vlc_tick_t i_date);
 void aout_DecChangeRate(audio_output_t *aout, float rate);
 void aout_DecFlush(audio_output_t *, bool wait);
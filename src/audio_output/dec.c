@@ -103,6 +103,7 @@ error:
 
     atomic_init (&owner->buffers_lost, 0);
     atomic_init (&owner->buffers_played, 0);
+    vlc_histogram_Init (&owner->latency);
     atomic_store_explicit(&owner->vp.update, true, memory_order_relaxed);
     return 0;
 }
@@ -244,6 +245,7 @@ static void aout_DecSynchronize(audio_output_t *aout, vlc_tick_t dec_pts)
      */
     if (aout->time_get(aout, &drift) != 0)
         return; /* nothing can be done if timing is unknown */
+    vlc_histogram_AddTime (&owner->latency, drift);
     drift += vlc_tick_now () - dec_pts;
 
     /* Late audio output.
@@ -400,6 +402,13 @@ void aout_DecGetResetStats(audio_output_t *aout, unsigned *restrict lost,
                                        memory_order_relaxed);
 }
 
+void aout_DecMoveLatency(audio_output_t *aout, vlc_histogram_t *latency)
+{
+    aout_owner_t *owner = aout_owner (aout);
+
+    vlc_histogram_Move(latency, &owner->latency);
+}
+
 void aout_DecChangePause (audio_output_t *aout, bool paused, vlc_tick_t date)
 {
     aout_owner_t *owner = aout_owner (aout);
@@ -461,7 +461,13 @@ module_config_t *config_FindConfig(const char *name)
 
     module_config_t *const *p;
     p = bsearch (name, config.list, config.count, sizeof (*p), confnamecmp);
-    return p ? *p : NULL;
+    if (p == NULL)
+        return NULL;
+
+    /* Items of plug-ins from the cache are only indexed until needed */
+    if (module_Describe((*p)->owner))
+        return NULL;
+    return *p;
 }
 
 /**
@@ -493,6 +499,9 @@ void config_ResetAll(void)
     vlc_rwlock_wrlock (&config_lock);
     for (vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
+        if (module_Describe(p))
+            continue;
+
         for (size_t i = 0; i < p->conf.size; i++ )
         {
             module_config_t *p_config = p->conf.items + i;
@@ -431,7 +431,7 @@ int config_SaveConfigFile (vlc_object_t *p_this)
         module_t *p_parser = p->module;
         module_config_t *p_item, *p_end;
 
-        if (p->conf.count == 0)
+        if (p->conf.count == 0 || module_Describe(p))
             continue;
 
         fprintf( file, "[%s]", module_get_object (p_parser) );
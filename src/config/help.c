@@ -597,7 +597,7 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
     const bool desc = var_InheritBool(p_this, "help-verbose");
 
     /* Enumerate the config for each module */
-    for (const vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
+    for (vlc_plugin_t *p = vlc_plugins; p != NULL; p = p->next)
     {
         const module_t *m = p->module;
         const module_config_t *section = NULL;
@@ -609,6 +609,9 @@ static void Usage (vlc_object_t *p_this, char const *psz_search)
             continue;
         found = true;
 
+        if (module_Describe(p))
+            continue;
+
         if (!plugin_show(p))
             continue;
 
@@ -664,6 +667,8 @@ static void ListModules (vlc_object_t *p_this, bool b_verbose)
     {
         module_t *p_parser = list[j];
         const char *objname = module_get_object (p_parser);
+
+        module_Describe(p_parser->plugin);
         printf(color ? GREEN"  %-22s "WHITE"%s\n"GRAY : "  %-22s %s\n",
                objname, module_gettext(p_parser, p_parser->psz_longname));
 
@@ -80,10 +80,33 @@ struct decoder_owner
 
     void (*pf_update_stat)( struct decoder_owner *, unsigned decoded, unsigned lost );
 
+    /* Multi-threading mode reported by the decoder module */
+    enum vlc_decoder_thread_type thread_type;
+    unsigned         thread_count;
+
     /* Some decoders require already packetized data (ie. not truncated) */
     decoder_t *p_packetizer;
     bool b_packetizer;
 
+    /* Packetizer thread, if packetizing and decoding are pipelined */
+    struct
+    {
+        bool          enabled;
+        vlc_thread_t  thread;
+        block_fifo_t *fifo; /* Blocks to packetize */
+        vlc_cond_t    wait_fifo; /* Signaled when the fifo is dequeued */
+        /* Incremented on flush, with both fifos locked */
+        unsigned      generation;
+        bool          flushing;
+        bool          draining;
+        bool          busy;
+
+        /* -- Only used by the packetizer thread -- */
+        es_format_t   fmt; /* Last format sent to the decoder thread */
+        bool          fmt_sent;
+        vlc_tick_t    preroll_end;
+    } pipeline;
+
     /* Current format in use by the output */
     es_format_t    fmt;
 
@@ -157,6 +180,10 @@ struct decoder_owner
 /* */
 #define DECODER_SPU_VOUT_WAIT_DURATION   VLC_TICK_FROM_MS(200)
 #define BLOCK_FLAG_CORE_PRIVATE_RELOADED (1 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
+#define BLOCK_FLAG_CORE_PRIVATE_MARKER   (2 << BLOCK_FLAG_CORE_PRIVATE_SHIFT)
+
+/* Maximum number of packetized blocks waiting for the decoder thread */
+#define DECODER_PIPELINE_DEPTH 8
 
 static inline struct decoder_owner *dec_get_owner( decoder_t *p_dec )
 {
@@ -224,6 +251,9 @@ static void UnloadDecoder( decoder_t *p_dec )
     es_format_Clean( &p_dec->fmt_out );
 }
 
+static void DecoderUpdateThreads( decoder_t *, enum vlc_decoder_thread_type,
+                                  unsigned );
+
 static int ReloadDecoder( decoder_t *p_dec, bool b_packetizer,
                           const es_format_t *restrict p_fmt, enum reload reload )
 {
@@ -238,6 +268,7 @@ static int ReloadDecoder( decoder_t *p_dec, bool b_packetizer,
 
     /* Restart the decoder module */
     UnloadDecoder( p_dec );
+    DecoderUpdateThreads( p_dec, VLC_DECODER_THREAD_NONE, 0 );
     p_owner->error = false;
 
     if( reload == RELOAD_DECODER_AOUT )
@@ -783,13 +814,18 @@ static int DecoderTimedWait( decoder_t *p_dec, vlc_tick_t deadline )
     return ret;
 }
 
-static inline void DecoderUpdatePreroll( vlc_tick_t *pi_preroll, const block_t *p )
+static inline bool DecoderStartsPreroll( const block_t *p )
 {
     if( p->i_flags & BLOCK_FLAG_PREROLL )
-        *pi_preroll = (vlc_tick_t)INT64_MAX;
+        return true;
     /* Check if we can use the packet for end of preroll */
-    else if( (p->i_flags & BLOCK_FLAG_DISCONTINUITY) &&
-             (p->i_buffer == 0 || (p->i_flags & BLOCK_FLAG_CORRUPTED)) )
+    return (p->i_flags & BLOCK_FLAG_DISCONTINUITY) &&
+           (p->i_buffer == 0 || (p->i_flags & BLOCK_FLAG_CORRUPTED));
+}
+
+static inline void DecoderUpdatePreroll( vlc_tick_t *pi_preroll, const block_t *p )
+{
+    if( DecoderStartsPreroll( p ) )
         *pi_preroll = (vlc_tick_t)INT64_MAX;
     else if( p->i_dts != VLC_TICK_INVALID )
         *pi_preroll = __MIN( *pi_preroll, p->i_dts );
@@ -1146,6 +1182,13 @@ discard:
     picture_Release( p_picture );
 }
 
+static struct input_stats *DecoderGetStats( struct decoder_owner *p_owner )
+{
+    input_thread_t *p_input = p_owner->p_input;
+
+    return p_input != NULL ? input_priv(p_input)->stats : NULL;
+}
+
 static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
                                     unsigned decoded, unsigned lost )
 {
@@ -1174,9 +1217,55 @@ static void DecoderUpdateStatVideo( struct decoder_owner *p_owner,
                                   memory_order_relaxed);
         atomic_fetch_add_explicit(&stats->displayed_pictures, displayed,
                                   memory_order_relaxed);
+
+        if( p_owner->p_vout != NULL )
+            vout_MoveStatisticTimes( p_owner->p_vout,
+                &stats->stages[INPUT_STATS_VOUT_PREPARE_PICTURE_TIME],
+                &stats->stages[INPUT_STATS_VOUT_RENDER_TIME],
+                &stats->stages[INPUT_STATS_VOUT_PREPARE_TIME],
+                &stats->stages[INPUT_STATS_VOUT_DISPLAY_TIME] );
+    }
+}
+
+static atomic_uintmax_t *DecoderThreadsStat( struct decoder_owner *p_owner )
+{
+    struct input_stats *stats = DecoderGetStats( p_owner );
+
+    if( stats == NULL )
+        return NULL;
+
+    switch( p_owner->thread_type )
+    {
+        case VLC_DECODER_THREAD_FRAME:
+            return &stats->video_frame_threads;
+        case VLC_DECODER_THREAD_SLICE:
+            return &stats->video_slice_threads;
+        default:
+            return NULL;
     }
 }
 
+static void DecoderUpdateThreads( decoder_t *p_dec,
+                                  enum vlc_decoder_thread_type type,
+                                  unsigned count )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    atomic_uintmax_t *stat;
+
+    /* Only called from the thread running the decoder module */
+    stat = DecoderThreadsStat( p_owner );
+    if( stat != NULL )
+        atomic_fetch_sub_explicit( stat, p_owner->thread_count,
+                                   memory_order_relaxed );
+
+    p_owner->thread_type = type;
+    p_owner->thread_count = count;
+
+    stat = DecoderThreadsStat( p_owner );
+    if( stat != NULL )
+        atomic_fetch_add_explicit( stat, count, memory_order_relaxed );
+}
+
 static void DecoderQueueVideo( decoder_t *p_dec, picture_t *p_pic )
 {
     assert( p_pic );
@@ -1330,6 +1419,10 @@ static void DecoderUpdateStatAudio( struct decoder_owner *p_owner,
                                   memory_order_relaxed);
         atomic_fetch_add_explicit(&stats->decoded_audio, decoded,
                                   memory_order_relaxed);
+
+        if( p_owner->p_aout != NULL )
+            aout_DecMoveLatency( p_owner->p_aout,
+                                 &stats->stages[INPUT_STATS_AOUT_LATENCY] );
     }
 }
 
@@ -1410,12 +1503,57 @@ static void DecoderQueueSpu( decoder_t *p_dec, subpicture_t *p_spu )
     }
 }
 
+/**
+ * In-band event from the packetizer thread to the decoder thread
+ */
+struct decoder_marker
+{
+    block_t block;
+    bool has_format;
+    es_format_t fmt; /* New packetizer output format */
+    bool has_preroll;
+    vlc_tick_t preroll_end; /* INT64_MAX restarts the preroll */
+};
+
+static void DecoderMarkerRelease( block_t *p_block )
+{
+    struct decoder_marker *p_marker =
+        container_of( p_block, struct decoder_marker, block );
+
+    if( p_marker->has_format )
+        es_format_Clean( &p_marker->fmt );
+    free( p_marker );
+}
+
+static const struct vlc_block_callbacks decoder_marker_cbs =
+{
+    DecoderMarkerRelease,
+};
+
+static struct decoder_marker *DecoderMarkerNew( void )
+{
+    struct decoder_marker *p_marker = malloc( sizeof( *p_marker ) );
+    if( unlikely(p_marker == NULL) )
+        return NULL;
+
+    block_Init( &p_marker->block, &decoder_marker_cbs, NULL, 0 );
+    p_marker->block.i_flags = BLOCK_FLAG_CORE_PRIVATE_MARKER;
+    p_marker->has_format = false;
+    p_marker->has_preroll = false;
+    return p_marker;
+}
+
 static void DecoderProcess( decoder_t *p_dec, block_t *p_block );
 static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    struct input_stats *stats = DecoderGetStats( p_owner );
+    vlc_tick_t start = stats != NULL ? vlc_tick_now() : VLC_TICK_INVALID;
 
     int ret = p_dec->pf_decode( p_dec, p_block );
+    if( stats != NULL )
+        vlc_histogram_AddTime( &stats->stages[INPUT_STATS_DECODE_TIME],
+                               vlc_tick_now() - start );
     switch( ret )
     {
         case VLCDEC_SUCCESS:
@@ -1441,6 +1579,36 @@ static void DecoderDecode( decoder_t *p_dec, block_t *p_block )
     }
 }
 
+static void DecoderProcessMarker( decoder_t *p_dec, block_t *p_block )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    struct decoder_marker *p_marker =
+        container_of( p_block, struct decoder_marker, block );
+
+    if( p_marker->has_preroll )
+    {
+        vlc_mutex_lock( &p_owner->lock );
+        if( p_marker->preroll_end == (vlc_tick_t)INT64_MAX )
+            p_owner->i_preroll_end = (vlc_tick_t)INT64_MAX;
+        else
+            p_owner->i_preroll_end = __MIN( p_owner->i_preroll_end,
+                                            p_marker->preroll_end );
+        vlc_mutex_unlock( &p_owner->lock );
+    }
+
+    if( p_marker->has_format
+     && !es_format_IsSimilar( &p_dec->fmt_in, &p_marker->fmt ) )
+    {
+        msg_Dbg( p_dec, "restarting module due to input format change");
+
+        /* Drain the decoder module */
+        DecoderDecode( p_dec, NULL );
+
+        ReloadDecoder( p_dec, false, &p_marker->fmt, RELOAD_DECODER );
+    }
+    block_Release( p_block );
+}
+
 /**
  * Decode a block
  *
@@ -1468,15 +1636,26 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
             goto error;
     }
 
-    bool packetize = p_owner->p_packetizer != NULL;
+    if( p_block != NULL && (p_block->i_flags & BLOCK_FLAG_CORE_PRIVATE_MARKER) )
+    {
+        DecoderProcessMarker( p_dec, p_block );
+        return;
+    }
+
+    /* In pipelined mode, the blocks are already packetized, and the preroll
+     * is updated by markers from the packetizer thread. */
+    bool packetize = p_owner->p_packetizer != NULL && !p_owner->pipeline.enabled;
     if( p_block )
     {
         if( p_block->i_buffer <= 0 )
             goto error;
 
-        vlc_mutex_lock( &p_owner->lock );
-        DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
-        vlc_mutex_unlock( &p_owner->lock );
+        if( !p_owner->pipeline.enabled )
+        {
+            vlc_mutex_lock( &p_owner->lock );
+            DecoderUpdatePreroll( &p_owner->i_preroll_end, p_block );
+            vlc_mutex_unlock( &p_owner->lock );
+        }
         if( unlikely( p_block->i_flags & BLOCK_FLAG_CORE_PRIVATE_RELOADED ) )
         {
             /* This block has already been packetized */
@@ -1549,7 +1728,9 @@ error:
 static void DecoderProcessFlush( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
-    decoder_t *p_packetizer = p_owner->p_packetizer;
+    /* In pipelined mode, the packetizer thread flushes the packetizer */
+    decoder_t *p_packetizer = p_owner->pipeline.enabled ? NULL
+                                                        : p_owner->p_packetizer;
 
     if( p_owner->error )
         return;
@@ -1640,6 +1821,20 @@ static void OutputChangeRate( decoder_t *p_dec, float rate )
     }
 }
 
+static void DecoderUpdateStatFifo( struct decoder_owner *p_owner,
+                                   size_t depth, vlc_tick_t idle_date )
+{
+    struct input_stats *stats = DecoderGetStats( p_owner );
+
+    if( stats == NULL )
+        return;
+
+    vlc_histogram_Add( &stats->stages[INPUT_STATS_DECODER_FIFO_DEPTH], depth );
+    vlc_histogram_AddTime( &stats->stages[INPUT_STATS_DECODER_WAIT_TIME],
+                           idle_date != VLC_TICK_INVALID
+                           ? vlc_tick_now() - idle_date : 0 );
+}
+
 /**
  * The decoding main loop
  *
@@ -1651,6 +1846,7 @@ static void *DecoderThread( void *p_data )
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
     float rate = 1.f;
     bool paused = false;
+    vlc_tick_t idle_date = VLC_TICK_INVALID; /* waiting for a block since */
 
     /* The decoder's main loop */
     vlc_fifo_Lock( p_owner->p_fifo );
@@ -1723,6 +1919,7 @@ static void *DecoderThread( void *p_data )
 
         if( p_owner->paused && p_owner->frames_countdown == 0 )
         {   /* Wait for resumption from pause */
+            idle_date = VLC_TICK_INVALID;
             p_owner->b_idle = true;
             vlc_cond_signal( &p_owner->wait_acknowledge );
             vlc_fifo_Wait( p_owner->p_fifo );
@@ -1733,11 +1930,15 @@ static void *DecoderThread( void *p_data )
         vlc_cond_signal( &p_owner->wait_fifo );
         vlc_testcancel(); /* forced expedited cancellation in case of stop */
 
+        size_t depth = vlc_fifo_GetCount( p_owner->p_fifo );
         block_t *p_block = vlc_fifo_DequeueUnlocked( p_owner->p_fifo );
         if( p_block == NULL )
         {
             if( likely(!p_owner->b_draining) )
             {   /* Wait for a block to decode (or a request to drain) */
+                if( idle_date == VLC_TICK_INVALID
+                 && DecoderGetStats( p_owner ) != NULL )
+                    idle_date = vlc_tick_now();
                 p_owner->b_idle = true;
                 vlc_cond_signal( &p_owner->wait_acknowledge );
                 vlc_fifo_Wait( p_owner->p_fifo );
@@ -1747,6 +1948,11 @@ static void *DecoderThread( void *p_data )
             /* We have emptied the FIFO and there is a pending request to
              * drain. Pass p_block = NULL to decoder just once. */
         }
+        else
+        {
+            DecoderUpdateStatFifo( p_owner, depth, idle_date );
+            idle_date = VLC_TICK_INVALID;
+        }
 
         vlc_fifo_Unlock( p_owner->p_fifo );
 
@@ -1776,6 +1982,194 @@ static void *DecoderThread( void *p_data )
     vlc_assert_unreachable();
 }
 
+/**
+ * Queues blocks from the packetizer thread to the decoder thread
+ *
+ * This waits for room in the decoder FIFO. The blocks are dropped if the
+ * decoder was flushed since the generation was read.
+ */
+static void PacketizerForward( struct decoder_owner *p_owner, block_t *p_block,
+                               unsigned generation )
+{
+    vlc_fifo_Lock( p_owner->p_fifo );
+    while( vlc_fifo_GetCount( p_owner->p_fifo ) >= DECODER_PIPELINE_DEPTH
+        && generation == p_owner->pipeline.generation )
+        vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+
+    if( generation == p_owner->pipeline.generation )
+    {
+        vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
+        p_block = NULL;
+    }
+    vlc_fifo_Unlock( p_owner->p_fifo );
+
+    if( p_block != NULL )
+        block_ChainRelease( p_block );
+}
+
+/**
+ * Packetizes a block, and forwards the result to the decoder thread
+ *
+ * \param p_dec the decoder object
+ * \param p_block the block to packetize, or NULL to drain the packetizer
+ * \param generation the flush generation when the block was dequeued
+ */
+static void PacketizerProcess( decoder_t *p_dec, block_t *p_block,
+                               unsigned generation )
+{
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    decoder_t *p_packetizer = p_owner->p_packetizer;
+    block_t *p_packetized_block;
+    block_t **pp_block = p_block ? &p_block : NULL;
+
+    if( p_block )
+    {
+        if( p_block->i_buffer <= 0 )
+        {
+            block_Release( p_block );
+            return;
+        }
+
+        /* The decoder thread resets its preroll end once prerolled, so only
+         * send the updates that could change it. */
+        vlc_tick_t preroll_end = p_owner->pipeline.preroll_end;
+        DecoderUpdatePreroll( &preroll_end, p_block );
+        if( DecoderStartsPreroll( p_block )
+         || preroll_end < p_owner->pipeline.preroll_end )
+        {
+            struct decoder_marker *p_marker = DecoderMarkerNew();
+            if( likely(p_marker != NULL) )
+            {
+                p_marker->has_preroll = true;
+                p_marker->preroll_end = preroll_end;
+                PacketizerForward( p_owner, &p_marker->block, generation );
+            }
+        }
+        p_owner->pipeline.preroll_end = preroll_end;
+    }
+
+    while( (p_packetized_block =
+            p_packetizer->pf_packetize( p_packetizer, pp_block ) ) )
+    {
+        if( !p_owner->pipeline.fmt_sent
+         || !es_format_IsSimilar( &p_owner->pipeline.fmt,
+                                  &p_packetizer->fmt_out ) )
+        {
+            struct decoder_marker *p_marker = DecoderMarkerNew();
+            if( unlikely(p_marker == NULL) )
+            {
+                block_ChainRelease( p_packetized_block );
+                continue;
+            }
+            if( es_format_Copy( &p_marker->fmt, &p_packetizer->fmt_out ) )
+            {
+                block_Release( &p_marker->block );
+                block_ChainRelease( p_packetized_block );
+                continue;
+            }
+            p_marker->has_format = true;
+
+            es_format_Clean( &p_owner->pipeline.fmt );
+            es_format_Copy( &p_owner->pipeline.fmt, &p_packetizer->fmt_out );
+            p_owner->pipeline.fmt_sent = true;
+            PacketizerForward( p_owner, &p_marker->block, generation );
+        }
+
+        if( p_packetizer->pf_get_cc )
+            PacketizerGetCc( p_dec, p_packetizer );
+
+        PacketizerForward( p_owner, p_packetized_block, generation );
+    }
+}
+
+/**
+ * The packetizer thread, if packetizing and decoding are pipelined
+ *
+ * It feeds the decoder thread with packetized blocks, and with markers for
+ * the format and preroll changes.
+ */
+static void *PacketizerThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    block_fifo_t *p_fifo = p_owner->pipeline.fifo;
+
+    vlc_fifo_Lock( p_fifo );
+    vlc_fifo_CleanupPush( p_fifo );
+
+    for( ;; )
+    {
+        if( p_owner->pipeline.flushing )
+        {
+            decoder_t *p_packetizer = p_owner->p_packetizer;
+            int canc = vlc_savecancel();
+
+            p_owner->pipeline.flushing = false;
+            vlc_fifo_Unlock( p_fifo );
+
+            if( p_packetizer->pf_flush != NULL )
+                p_packetizer->pf_flush( p_packetizer );
+            /* The decoder thread resets its preroll end and may have missed
+             * the last markers */
+            p_owner->pipeline.preroll_end = (vlc_tick_t)INT64_MIN;
+            p_owner->pipeline.fmt_sent = false;
+
+            vlc_fifo_Lock( p_fifo );
+            vlc_restorecancel( canc );
+            continue;
+        }
+
+        vlc_cond_signal( &p_owner->pipeline.wait_fifo );
+        vlc_testcancel(); /* forced expedited cancellation in case of stop */
+
+        block_t *p_block = vlc_fifo_DequeueUnlocked( p_fifo );
+        if( p_block == NULL && likely(!p_owner->pipeline.draining) )
+        {   /* Wait for a block to packetize (or a request to drain) */
+            vlc_fifo_Wait( p_fifo );
+            continue;
+        }
+
+        const unsigned generation = p_owner->pipeline.generation;
+        p_owner->pipeline.busy = true;
+        vlc_fifo_Unlock( p_fifo );
+
+        int canc = vlc_savecancel();
+        bool drained = false;
+
+        PacketizerProcess( p_dec, p_block, generation );
+
+        if( p_block == NULL )
+        {   /* The packetizer is drained, now drain the decoder */
+            vlc_fifo_Lock( p_owner->p_fifo );
+            if( generation == p_owner->pipeline.generation )
+            {
+                p_owner->b_draining = true;
+                vlc_fifo_Signal( p_owner->p_fifo );
+                drained = true;
+            }
+            vlc_fifo_Unlock( p_owner->p_fifo );
+        }
+        vlc_restorecancel( canc );
+
+        vlc_fifo_Lock( p_fifo );
+        if( drained )
+            p_owner->pipeline.draining = false;
+        p_owner->pipeline.busy = false;
+
+        if( vlc_fifo_IsEmpty( p_fifo ) )
+        {   /* Nothing may have been forwarded: wake input_DecoderWait() up,
+             * as the decoder thread would not. */
+            vlc_fifo_Unlock( p_fifo );
+            vlc_mutex_lock( &p_owner->lock );
+            vlc_cond_signal( &p_owner->wait_acknowledge );
+            vlc_mutex_unlock( &p_owner->lock );
+            vlc_fifo_Lock( p_fifo );
+        }
+    }
+    vlc_cleanup_pop();
+    vlc_assert_unreachable();
+}
+
 static const struct decoder_owner_callbacks dec_video_cbs =
 {
     .video = {
@@ -1785,6 +2179,7 @@ static const struct decoder_owner_callbacks dec_video_cbs =
         .queue_cc = DecoderQueueCc,
         .get_display_date = DecoderGetDisplayDate,
         .get_display_rate = DecoderGetDisplayRate,
+        .threads_update = DecoderUpdateThreads,
     },
     .get_attachments = DecoderGetInputAttachments,
 };
@@ -1840,6 +2235,8 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->i_last_rate = INPUT_RATE_DEFAULT;
     p_owner->p_input = p_input;
     p_owner->p_resource = p_resource;
+    p_owner->thread_type = VLC_DECODER_THREAD_NONE;
+    p_owner->thread_count = 0;
     p_owner->p_aout = NULL;
     p_owner->p_vout = NULL;
     p_owner->i_spu_channel = 0;
@@ -1909,6 +2306,31 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         }
     }
 
+    /* Packetize in a separate thread if requested */
+    p_owner->pipeline.enabled = false;
+    p_owner->pipeline.fifo = NULL;
+    p_owner->pipeline.generation = 0;
+    p_owner->pipeline.flushing = false;
+    p_owner->pipeline.draining = false;
+    p_owner->pipeline.busy = false;
+    p_owner->pipeline.fmt_sent = false;
+    p_owner->pipeline.preroll_end = (vlc_tick_t)INT64_MIN;
+    es_format_Init( &p_owner->pipeline.fmt, fmt->i_cat, 0 );
+    vlc_cond_init( &p_owner->pipeline.wait_fifo );
+
+    if( p_owner->p_packetizer != NULL
+     && var_InheritBool( p_dec, "decoder-pipeline" ) )
+    {
+        p_owner->pipeline.fifo = block_FifoNew();
+        if( likely(p_owner->pipeline.fifo != NULL)
+         && es_format_Copy( &p_owner->pipeline.fmt, fmt ) == VLC_SUCCESS )
+        {
+            /* The decoder module is loaded with this format */
+            p_owner->pipeline.fmt_sent = true;
+            p_owner->pipeline.enabled = true;
+        }
+    }
+
     switch( fmt->i_cat )
     {
         case VIDEO_ES:
@@ -1983,9 +2405,13 @@ static void DeleteDecoder( decoder_t * p_dec )
 
     const enum es_format_category_e i_cat =p_dec->fmt_in.i_cat;
     UnloadDecoder( p_dec );
+    DecoderUpdateThreads( p_dec, VLC_DECODER_THREAD_NONE, 0 );
 
     /* Free all packets still in the decoder fifo. */
     block_FifoRelease( p_owner->p_fifo );
+    if( p_owner->pipeline.fifo != NULL )
+        block_FifoRelease( p_owner->pipeline.fifo );
+    es_format_Clean( &p_owner->pipeline.fmt );
 
     /* Cleanup */
 #ifdef ENABLE_SOUT
@@ -2046,6 +2472,7 @@ static void DeleteDecoder( decoder_t * p_dec )
         vlc_object_release( p_owner->p_packetizer );
     }
 
+    vlc_cond_destroy( &p_owner->pipeline.wait_fifo );
     vlc_cond_destroy( &p_owner->wait_timed );
     vlc_cond_destroy( &p_owner->wait_fifo );
     vlc_cond_destroy( &p_owner->wait_acknowledge );
@@ -2126,10 +2553,25 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     }
 #endif
 
+    /* Spawn the packetizer thread */
+    if( p_owner->pipeline.enabled
+     && vlc_clone( &p_owner->pipeline.thread, PacketizerThread, p_dec,
+                   i_priority ) )
+    {
+        msg_Err( p_dec, "cannot spawn packetizer thread" );
+        DeleteDecoder( p_dec );
+        return NULL;
+    }
+
     /* Spawn the decoder thread */
     if( vlc_clone( &p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
         msg_Err( p_dec, "cannot spawn decoder thread" );
+        if( p_owner->pipeline.enabled )
+        {
+            vlc_cancel( p_owner->pipeline.thread );
+            vlc_join( p_owner->pipeline.thread, NULL );
+        }
         DeleteDecoder( p_dec );
         return NULL;
     }
@@ -2174,6 +2616,21 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( p_owner->pipeline.enabled )
+    {
+        vlc_cancel( p_owner->pipeline.thread );
+
+        vlc_fifo_Lock( p_owner->pipeline.fifo );
+        vlc_fifo_Lock( p_owner->p_fifo );
+        /* Unblock PacketizerForward() */
+        p_owner->pipeline.generation++;
+        vlc_cond_signal( &p_owner->wait_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->pipeline.fifo );
+
+        vlc_join( p_owner->pipeline.thread, NULL );
+    }
+
     vlc_cancel( p_owner->thread );
 
     vlc_fifo_Lock( p_owner->p_fifo );
@@ -2221,18 +2678,26 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    block_fifo_t *p_fifo = p_owner->p_fifo;
+    vlc_cond_t *p_wait = &p_owner->wait_fifo;
 
-    vlc_fifo_Lock( p_owner->p_fifo );
+    if( p_owner->pipeline.enabled )
+    {   /* Feed the packetizer thread */
+        p_fifo = p_owner->pipeline.fifo;
+        p_wait = &p_owner->pipeline.wait_fifo;
+    }
+
+    vlc_fifo_Lock( p_fifo );
     if( !b_do_pace )
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         /* 400 MiB, i.e. ~ 50mb/s for 60s */
-        if( vlc_fifo_GetBytes( p_owner->p_fifo ) > 400*1024*1024 )
+        if( vlc_fifo_GetBytes( p_fifo ) > 400*1024*1024 )
         {
             msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                       "consumed quickly enough), resetting fifo!" );
-            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
+            block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_fifo ) );
             p_block->i_flags |= BLOCK_FLAG_DISCONTINUITY;
         }
     }
@@ -2241,12 +2706,12 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
     {   /* The FIFO is not consumed when waiting, so pacing would deadlock VLC.
          * Locking is not necessary as b_waiting is only read, not written by
          * the decoder thread. */
-        while( vlc_fifo_GetCount( p_owner->p_fifo ) >= 10 )
-            vlc_fifo_WaitCond( p_owner->p_fifo, &p_owner->wait_fifo );
+        while( vlc_fifo_GetCount( p_fifo ) >= 10 )
+            vlc_fifo_WaitCond( p_fifo, p_wait );
     }
 
-    vlc_fifo_QueueUnlocked( p_owner->p_fifo, p_block );
-    vlc_fifo_Unlock( p_owner->p_fifo );
+    vlc_fifo_QueueUnlocked( p_fifo, p_block );
+    vlc_fifo_Unlock( p_fifo );
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -2255,6 +2720,18 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
 
     assert( !p_owner->b_waiting );
 
+    /* Check the packetizer thread first, as it forwards its blocks and
+     * draining requests to the decoder thread before becoming idle. */
+    if( p_owner->pipeline.enabled )
+    {
+        vlc_fifo_Lock( p_owner->pipeline.fifo );
+        bool b_busy = !vlc_fifo_IsEmpty( p_owner->pipeline.fifo )
+                   || p_owner->pipeline.draining || p_owner->pipeline.busy;
+        vlc_fifo_Unlock( p_owner->pipeline.fifo );
+        if( b_busy )
+            return false;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     if( !vlc_fifo_IsEmpty( p_owner->p_fifo ) || p_owner->b_draining )
     {
@@ -2294,6 +2771,15 @@ void input_DecoderDrain( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( p_owner->pipeline.enabled )
+    {   /* The packetizer thread requests the decoder to drain once done */
+        vlc_fifo_Lock( p_owner->pipeline.fifo );
+        p_owner->pipeline.draining = true;
+        vlc_fifo_Signal( p_owner->pipeline.fifo );
+        vlc_fifo_Unlock( p_owner->pipeline.fifo );
+        return;
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
     p_owner->b_draining = true;
     vlc_fifo_Signal( p_owner->p_fifo );
@@ -2308,11 +2794,27 @@ void input_DecoderFlush( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
 
+    if( p_owner->pipeline.enabled )
+    {
+        vlc_fifo_Lock( p_owner->pipeline.fifo );
+        block_ChainRelease(
+            vlc_fifo_DequeueAllUnlocked( p_owner->pipeline.fifo ) );
+        p_owner->pipeline.flushing = true;
+        vlc_fifo_Signal( p_owner->pipeline.fifo );
+    }
+
     vlc_fifo_Lock( p_owner->p_fifo );
 
     /* Empty the fifo */
     block_ChainRelease( vlc_fifo_DequeueAllUnlocked( p_owner->p_fifo ) );
 
+    if( p_owner->pipeline.enabled )
+    {   /* Drop the blocks being packetized, and unblock
+         * PacketizerForward() */
+        p_owner->pipeline.generation++;
+        vlc_cond_signal( &p_owner->wait_fifo );
+    }
+
     /* Don't need to wait for the DecoderThread to flush. Indeed, if called a
      * second time, this function will clear the FIFO again before anything was
      * dequeued by DecoderThread and there is no need to flush a second time in
@@ -2330,6 +2832,8 @@ void input_DecoderFlush( decoder_t *p_dec )
     vlc_cond_signal( &p_owner->wait_timed );
 
     vlc_fifo_Unlock( p_owner->p_fifo );
+    if( p_owner->pipeline.enabled )
+        vlc_fifo_Unlock( p_owner->pipeline.fifo );
 }
 
 void input_DecoderGetCcDesc( decoder_t *p_dec, decoder_cc_desc_t *p_desc )
@@ -2508,13 +3012,22 @@ void input_DecoderWait( decoder_t *p_dec )
         if( p_owner->paused )
             break;
         vlc_fifo_Lock( p_owner->p_fifo );
-        if( p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo ) )
+        bool b_idle = p_owner->b_idle && vlc_fifo_IsEmpty( p_owner->p_fifo );
+        vlc_fifo_Unlock( p_owner->p_fifo );
+
+        if( b_idle && p_owner->pipeline.enabled )
+        {
+            vlc_fifo_Lock( p_owner->pipeline.fifo );
+            b_idle = vlc_fifo_IsEmpty( p_owner->pipeline.fifo )
+                  && !p_owner->pipeline.busy;
+            vlc_fifo_Unlock( p_owner->pipeline.fifo );
+        }
+
+        if( b_idle )
         {
             msg_Err( p_dec, "buffer deadlock prevented" );
-            vlc_fifo_Unlock( p_owner->p_fifo );
             break;
         }
-        vlc_fifo_Unlock( p_owner->p_fifo );
         vlc_cond_wait( &p_owner->wait_acknowledge, &p_owner->lock );
     }
     vlc_mutex_unlock( &p_owner->lock );
@@ -2570,8 +3083,11 @@ bool input_DecoderHasFormatChanged( decoder_t *p_dec, es_format_t *p_fmt, vlc_me
 size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     struct decoder_owner *p_owner = dec_get_owner( p_dec );
+    size_t i_size = block_FifoSize( p_owner->p_fifo );
 
-    return block_FifoSize( p_owner->p_fifo );
+    if( p_owner->pipeline.enabled )
+        i_size += block_FifoSize( p_owner->pipeline.fifo );
+    return i_size;
 }
 
 void input_DecoderGetObjects( decoder_t *p_dec,
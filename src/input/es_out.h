@@ -89,7 +89,10 @@ enum es_out_query_private_e
     ES_OUT_SET_VBI_PAGE,                            /* arg1=unsigned res=can fail */
 
     /* Set VBI/Teletext menu transparent */
-    ES_OUT_SET_VBI_TRANSPARENCY                     /* arg1=bool res=can fail */
+    ES_OUT_SET_VBI_TRANSPARENCY,                    /* arg1=bool res=can fail */
+
+    /* Seek within the timeshift buffer */
+    ES_OUT_SET_TIMESHIFT_TIME,                      /* arg1=vlc_tick_t i_time arg2=bool b_absolute res=can fail */
 };
 
 static inline void es_out_SetMode( es_out_t *p_out, int i_mode )
@@ -36,6 +36,10 @@
 #endif
 #include <sys/stat.h>
 #include <unistd.h>
+#include <fcntl.h>
+#ifdef HAVE_MMAP
+#  include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -85,6 +89,7 @@ typedef struct attribute_packed
     es_out_id_t *p_es;
     block_t *p_block;
     int     i_offset;  /* We do not use file > INT_MAX */
+    int     i_size;    /* Size of the record, negative if it was not stored */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -161,6 +166,22 @@ typedef struct attribute_packed
     } u;
 } ts_cmd_t;
 
+/* Block as stored in a timeshift file, followed by its data */
+typedef struct
+{
+    vlc_tick_t i_dts;
+    vlc_tick_t i_pts;
+    vlc_tick_t i_length;
+    uint32_t   i_flags;
+    uint32_t   i_nb_samples;
+    size_t     i_buffer;
+} ts_block_header_t;
+
+#define TS_RECORD_ALIGN 16
+
+/* A storage is a preallocated file used as a ring buffer of block records.
+ * As long as the reader keeps up, the writer reuses the space it released;
+ * a new storage is only chained when the ring is full. */
 typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
@@ -169,19 +190,32 @@ struct ts_storage_t
     /* */
 #ifdef _WIN32
     char    *psz_file;  /* Filename */
+    vlc_mutex_t fd_lock; /* Serializes seek and I/O on fd */
 #endif
-    size_t  i_file_max; /* Max size in bytes */
-    int64_t i_file_size;/* Current size in bytes */
-    FILE    *p_filew;   /* FILE handle for data writing */
-    FILE    *p_filer;   /* FILE handle for data reading */
-
-    /* */
-    int      i_cmd_r;
-    int      i_cmd_w;
-    int      i_cmd_max;
+    int     fd;
+#ifdef HAVE_MMAP
+    uint8_t *p_map;     /* Mapping of the whole file, or NULL */
+#endif
+    size_t  i_file_max; /* Ring size in bytes */
+    size_t  i_data_r;   /* Offset of the oldest stored record */
+    size_t  i_data_w;   /* Offset following the newest record */
+    int     i_blocks;   /* Number of records stored or being written */
+
+    /* Ring of commands */
+    size_t   i_cmd_r;
+    size_t   i_cmd_w;
+    size_t   i_cmd_max;
     ts_cmd_t *p_cmd;
 };
 
+/* Keyframe stored in the timeshift buffer */
+typedef struct
+{
+    vlc_tick_t  i_time;  /* Input time of the keyframe */
+    uint64_t    i_pos;   /* Position of its command (see i_cmd_pushed) */
+    es_out_id_t *p_es;
+} ts_index_t;
+
 typedef struct
 {
     vlc_thread_t   thread;
@@ -213,6 +247,21 @@ typedef struct
 
     vlc_tick_t     i_cmd_delay;
 
+    /* Keyframe index, sorted by position and time */
+    uint64_t       i_cmd_pushed; /* Number of commands pushed */
+    uint64_t       i_cmd_popped; /* Number of commands popped */
+    size_t         i_index_first;
+    size_t         i_index_last;
+    size_t         i_index_max;
+    ts_index_t     *p_index;
+    vlc_tick_t     i_times_time; /* Last input time pushed */
+    vlc_tick_t     i_times_date;
+    vlc_tick_t     i_read_time;  /* Last input time popped */
+
+    /* Commands before i_seek_pos are skipped */
+    bool           b_seek;
+    uint64_t       i_seek_pos;
+
 } ts_thread_t;
 
 struct es_out_id_t
@@ -261,15 +310,16 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, vlc_tick_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, vlc_tick_t i_time, bool b_absolute );
 
 static void         *TsRun( void * );
 
 static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
 static void         TsStorageDelete( ts_storage_t * );
-static void         TsStoragePack( ts_storage_t *p_storage );
-static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
+static int          TsStorageReserve( ts_storage_t *, ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
-static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
+static void         TsStorageWriteCmd( ts_storage_t *, ts_cmd_t *p_cmd );
+static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
 
 static void CmdClean( ts_cmd_t * );
@@ -717,6 +767,15 @@ static int ControlLocked( es_out_t *p_out, int i_query, va_list args )
     {
         return ControlLockedSetFrameNext( p_out );
     }
+    case ES_OUT_SET_TIMESHIFT_TIME:
+    {
+        const vlc_tick_t i_time = va_arg( args, vlc_tick_t );
+        const bool b_absolute = (bool)va_arg( args, int );
+
+        if( !p_sys->b_delayed )
+            return VLC_EGENERIC;
+        return TsSeek( p_sys->p_ts, i_time, b_absolute );
+    }
 
     case ES_OUT_GET_PCR_SYSTEM:
         if( p_sys->b_delayed )
@@ -783,6 +842,7 @@ static const struct es_out_callbacks es_out_timeshift_cbs =
  *****************************************************************************/
 static void TsDestroy( ts_thread_t *p_ts )
 {
+    free( p_ts->p_index );
     vlc_cond_destroy( &p_ts->wait );
     vlc_mutex_destroy( &p_ts->lock );
     free( p_ts );
@@ -814,6 +874,17 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_cmd_delay = 0;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_cmd_pushed = 0;
+    p_ts->i_cmd_popped = 0;
+    p_ts->i_index_first = 0;
+    p_ts->i_index_last = 0;
+    p_ts->i_index_max = 0;
+    p_ts->p_index = NULL;
+    p_ts->i_times_time = VLC_TICK_INVALID;
+    p_ts->i_times_date = VLC_TICK_INVALID;
+    p_ts->i_read_time = VLC_TICK_INVALID;
+    p_ts->b_seek = false;
+    p_ts->i_seek_pos = 0;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -862,39 +933,124 @@ static void TsStop( ts_thread_t *p_ts )
 
     TsDestroy( p_ts );
 }
+static void TsIndexPushCmd( ts_thread_t *p_ts, const ts_cmd_t *p_cmd,
+                            bool b_keyframe )
+{
+    vlc_mutex_assert( &p_ts->lock );
+
+    const uint64_t i_pos = p_ts->i_cmd_pushed++;
+
+    if( p_cmd->i_type == C_CONTROL &&
+        p_cmd->u.control.i_query == ES_OUT_SET_TIMES )
+    {
+        p_ts->i_times_time = p_cmd->u.control.u.times.i_time;
+        p_ts->i_times_date = p_cmd->i_date;
+        return;
+    }
+
+    /* The input time is only updated a few times per second, interpolate it
+     * with the reception date of the keyframe */
+    if( !b_keyframe || p_ts->i_times_time == VLC_TICK_INVALID )
+        return;
+
+    if( p_ts->i_index_last >= p_ts->i_index_max )
+    {
+        if( p_ts->i_index_first > 0 )
+        {
+            memmove( p_ts->p_index, &p_ts->p_index[p_ts->i_index_first],
+                     (p_ts->i_index_last - p_ts->i_index_first) * sizeof(*p_ts->p_index) );
+            p_ts->i_index_last -= p_ts->i_index_first;
+            p_ts->i_index_first = 0;
+        }
+        else
+        {
+            size_t i_max = __MAX( 2 * p_ts->i_index_max, 256 );
+            ts_index_t *p_index = realloc( p_ts->p_index, i_max * sizeof(*p_index) );
+            if( !p_index )
+                return;
+            p_ts->p_index = p_index;
+            p_ts->i_index_max = i_max;
+        }
+    }
+
+    ts_index_t *p_entry = &p_ts->p_index[p_ts->i_index_last];
+    p_entry->i_time = p_ts->i_times_time + p_cmd->i_date - p_ts->i_times_date;
+    p_entry->i_pos = i_pos;
+    p_entry->p_es = p_cmd->u.send.p_es;
+
+    /* Keep the index sorted by time as well */
+    if( p_ts->i_index_last > p_ts->i_index_first &&
+        p_entry[-1].i_time > p_entry->i_time )
+        return;
+    p_ts->i_index_last++;
+}
+static void TsIndexPopCmd( ts_thread_t *p_ts, const ts_cmd_t *p_cmd )
+{
+    vlc_mutex_assert( &p_ts->lock );
+
+    p_ts->i_cmd_popped++;
+
+    if( p_cmd->i_type == C_CONTROL &&
+        p_cmd->u.control.i_query == ES_OUT_SET_TIMES )
+        p_ts->i_read_time = p_cmd->u.control.u.times.i_time;
+
+    while( p_ts->i_index_first < p_ts->i_index_last &&
+           p_ts->p_index[p_ts->i_index_first].i_pos < p_ts->i_cmd_popped )
+        p_ts->i_index_first++;
+    if( p_ts->i_index_first == p_ts->i_index_last )
+        p_ts->i_index_first = p_ts->i_index_last = 0;
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
+    ts_cmd_t cmd = *p_cmd;
+
+    /* Only this thread adds commands and storages, so the reserved space
+     * can be filled without holding the lock */
     vlc_mutex_lock( &p_ts->lock );
+    ts_storage_t *p_storage = p_ts->p_storage_w;
+    bool b_room = p_storage && !TsStorageReserve( p_storage, &cmd );
+    vlc_mutex_unlock( &p_ts->lock );
 
-    if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
+    if( !b_room )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        int64_t i_size = p_ts->i_tmp_size_max;
+        if( cmd.i_type == C_SEND )
+            i_size = __MAX( i_size, (int64_t)(sizeof(ts_block_header_t) +
+                            cmd.u.send.p_block->i_buffer + TS_RECORD_ALIGN) );
 
-        if( !p_storage )
+        p_storage = TsStorageNew( p_ts->psz_tmp_path, i_size );
+        if( !p_storage || TsStorageReserve( p_storage, &cmd ) )
         {
+            if( p_storage )
+                TsStorageDelete( p_storage );
             CmdClean( p_cmd );
-            vlc_mutex_unlock( &p_ts->lock );
             /* TODO warn the user (but only once) */
             return;
         }
 
+        vlc_mutex_lock( &p_ts->lock );
         if( !p_ts->p_storage_w )
         {
             p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
         {
-            TsStoragePack( p_ts->p_storage_w );
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
         }
+        vlc_mutex_unlock( &p_ts->lock );
     }
 
+    const bool b_keyframe = cmd.i_type == C_SEND &&
+                            (cmd.u.send.p_block->i_flags & BLOCK_FLAG_TYPE_I);
+
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStorageWriteCmd( p_storage, &cmd );
 
+    vlc_mutex_lock( &p_ts->lock );
+    TsStoragePushCmd( p_storage, &cmd );
+    TsIndexPushCmd( p_ts, &cmd, b_keyframe );
     vlc_cond_signal( &p_ts->wait );
-
     vlc_mutex_unlock( &p_ts->lock );
 }
 static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
@@ -905,6 +1061,7 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
         return VLC_EGENERIC;
 
     TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+    TsIndexPopCmd( p_ts, p_cmd );
 
     while( TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
@@ -989,6 +1146,82 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsSeek( ts_thread_t *p_ts, vlc_tick_t i_time, bool b_absolute )
+{
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_ts->lock );
+
+    if( !b_absolute )
+    {
+        if( p_ts->i_read_time == VLC_TICK_INVALID )
+            goto out;
+        i_time += p_ts->i_read_time;
+    }
+
+    /* Only seek within the stored commands, and not past the input */
+    if( p_ts->i_index_first >= p_ts->i_index_last ||
+        i_time < p_ts->p_index[p_ts->i_index_first].i_time ||
+        i_time > p_ts->i_times_time + vlc_tick_now() - p_ts->i_times_date )
+        goto out;
+
+    /* Last keyframe at or before the requested time */
+    size_t i_low = p_ts->i_index_first;
+    size_t i_high = p_ts->i_index_last;
+    while( i_high - i_low > 1 )
+    {
+        const size_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_ts->p_index[i_mid].i_time <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
+    }
+
+    /* Restart from a keyframe of the ES of the last keyframe, the other ones
+     * (if any) may not be decodable from there */
+    es_out_id_t *p_es = p_ts->p_index[p_ts->i_index_last - 1].p_es;
+    while( i_low > p_ts->i_index_first && p_ts->p_index[i_low].p_es != p_es )
+        i_low--;
+    if( p_ts->p_index[i_low].p_es != p_es )
+        goto out;
+
+    msg_Dbg( p_ts->p_input, "timeshift: seeking to %"PRId64" (%"PRIu64
+             " commands skipped)", p_ts->p_index[i_low].i_time,
+             p_ts->p_index[i_low].i_pos - p_ts->i_cmd_popped );
+
+    p_ts->b_seek = true;
+    p_ts->i_seek_pos = p_ts->p_index[i_low].i_pos;
+    vlc_cond_signal( &p_ts->wait );
+    i_ret = VLC_SUCCESS;
+out:
+    vlc_mutex_unlock( &p_ts->lock );
+    return i_ret;
+}
+
+static void TsExecuteCmd( es_out_t *p_out, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_out, p_cmd );
+        break;
+    default:
+        vlc_assert_unreachable();
+        break;
+    }
+}
 
 static void *TsRun( void *p_data )
 {
@@ -1000,6 +1233,7 @@ static void *TsRun( void *p_data )
         ts_cmd_t cmd;
         vlc_tick_t  i_deadline;
         bool b_buffering;
+        bool b_skip, b_seeked;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -1010,7 +1244,13 @@ static void *TsRun( void *p_data )
             const int canc = vlc_savecancel();
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
-            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
+            /* Skip the commands up to the keyframe we seek to: their
+             * blocks are dropped without being read back */
+            const uint64_t i_pos = p_ts->i_cmd_popped;
+            b_skip = p_ts->b_seek && i_pos < p_ts->i_seek_pos;
+            b_seeked = p_ts->b_seek && i_pos == p_ts->i_seek_pos;
+
+            if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, b_skip ) )
             {
                 vlc_restorecancel( canc );
                 break;
@@ -1020,58 +1260,85 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
-        if( b_buffering && i_buffering_date < 0 )
+        if( !b_skip )
         {
-            i_buffering_date = cmd.i_date;
-        }
-        else if( i_buffering_date > 0 )
-        {
-            p_ts->i_buffering_delay += i_buffering_date - cmd.i_date; /* It is < 0 */
-            if( b_buffering )
+            if( b_seeked )
+            {
+                /* Play the keyframe now */
+                p_ts->b_seek = false;
+                p_ts->i_rate_date = -1;
+                p_ts->i_cmd_delay = vlc_tick_now() - cmd.i_date - p_ts->i_buffering_delay;
+            }
+
+            if( b_buffering && i_buffering_date < 0 )
+            {
                 i_buffering_date = cmd.i_date;
-            else
-                i_buffering_date = -1;
-        }
+            }
+            else if( i_buffering_date > 0 )
+            {
+                p_ts->i_buffering_delay += i_buffering_date - cmd.i_date; /* It is < 0 */
+                if( b_buffering )
+                    i_buffering_date = cmd.i_date;
+                else
+                    i_buffering_date = -1;
+            }
 
-        if( p_ts->i_rate_date < 0 )
-            p_ts->i_rate_date = cmd.i_date;
+            if( p_ts->i_rate_date < 0 )
+                p_ts->i_rate_date = cmd.i_date;
 
-        p_ts->i_rate_delay = 0;
-        if( p_ts->i_rate_source != p_ts->i_rate )
-        {
-            const vlc_tick_t i_duration = cmd.i_date - p_ts->i_rate_date;
-            p_ts->i_rate_delay = i_duration * p_ts->i_rate / p_ts->i_rate_source - i_duration;
-        }
-        if( p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay < 0 && p_ts->i_rate != p_ts->i_rate_source )
-        {
-            const int canc = vlc_savecancel();
+            p_ts->i_rate_delay = 0;
+            if( p_ts->i_rate_source != p_ts->i_rate )
+            {
+                const vlc_tick_t i_duration = cmd.i_date - p_ts->i_rate_date;
+                p_ts->i_rate_delay = i_duration * p_ts->i_rate / p_ts->i_rate_source - i_duration;
+            }
+            if( p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay < 0 && p_ts->i_rate != p_ts->i_rate_source )
+            {
+                const int canc = vlc_savecancel();
 
-            /* Auto reset to rate 1.0 */
-            msg_Warn( p_ts->p_input, "es out timeshift: auto reset rate to %d", p_ts->i_rate_source );
+                /* Auto reset to rate 1.0 */
+                msg_Warn( p_ts->p_input, "es out timeshift: auto reset rate to %d", p_ts->i_rate_source );
 
-            p_ts->i_cmd_delay = 0;
-            p_ts->i_buffering_delay = 0;
+                p_ts->i_cmd_delay = 0;
+                p_ts->i_buffering_delay = 0;
 
-            p_ts->i_rate_delay = 0;
-            p_ts->i_rate_date = -1;
-            p_ts->i_rate = p_ts->i_rate_source;
+                p_ts->i_rate_delay = 0;
+                p_ts->i_rate_date = -1;
+                p_ts->i_rate = p_ts->i_rate_source;
 
-            if( !es_out_SetRate( p_ts->p_out, p_ts->i_rate_source, p_ts->i_rate ) )
-            {
-                vlc_value_t val = { .i_int = p_ts->i_rate };
-                /* Warn back input
-                 * FIXME it is perfectly safe BUT it is ugly as it may hide a
-                 * rate change requested by user */
-                input_ControlPushHelper( p_ts->p_input, INPUT_CONTROL_SET_RATE, &val );
-            }
+                if( !es_out_SetRate( p_ts->p_out, p_ts->i_rate_source, p_ts->i_rate ) )
+                {
+                    vlc_value_t val = { .i_int = p_ts->i_rate };
+                    /* Warn back input
+                     * FIXME it is perfectly safe BUT it is ugly as it may hide a
+                     * rate change requested by user */
+                    input_ControlPushHelper( p_ts->p_input, INPUT_CONTROL_SET_RATE, &val );
+                }
 
-            vlc_restorecancel( canc );
+                vlc_restorecancel( canc );
+            }
+            i_deadline = cmd.i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
         }
-        i_deadline = cmd.i_date + p_ts->i_cmd_delay + p_ts->i_rate_delay + p_ts->i_buffering_delay;
 
         vlc_cleanup_pop();
         vlc_mutex_unlock( &p_ts->lock );
 
+        if( b_skip )
+        {
+            /* Blocks and clock references are dropped, but the ES and
+             * the other controls must follow the stream */
+            const int canc = vlc_savecancel();
+            if( cmd.i_type == C_SEND ||
+                ( cmd.i_type == C_CONTROL &&
+                  ( cmd.u.control.i_query == ES_OUT_SET_PCR ||
+                    cmd.u.control.i_query == ES_OUT_SET_GROUP_PCR ) ) )
+                CmdClean( &cmd );
+            else
+                TsExecuteCmd( p_ts->p_out, &cmd );
+            vlc_restorecancel( canc );
+            continue;
+        }
+
         /* Regulate the speed of command processing to the same one than
          * reading  */
         vlc_cleanup_push( cmd_cleanup_routine, &cmd );
@@ -1082,27 +1349,9 @@ static void *TsRun( void *p_data )
 
         /* Execute the command  */
         const int canc = vlc_savecancel();
-        switch( cmd.i_type )
-        {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            vlc_assert_unreachable();
-            break;
-        }
+        if( b_seeked )
+            es_out_Control( p_ts->p_out, ES_OUT_RESET_PCR );
+        TsExecuteCmd( p_ts->p_out, &cmd );
         vlc_restorecancel( canc );
     }
 
@@ -1126,40 +1375,42 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
 
-    p_storage->p_filew = fdopen( fd, "w+b" );
-    if( p_storage->p_filew == NULL )
-    {
-        vlc_close( fd );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
-    p_storage->p_filer = vlc_fopen( psz_file, "rb" );
-    if( p_storage->p_filer == NULL )
-    {
-        fclose( p_storage->p_filew );
-        vlc_unlink( psz_file );
-        goto error;
-    }
-
 #ifndef _WIN32
     vlc_unlink( psz_file );
     free( psz_file );
 #else
     p_storage->psz_file = psz_file;
+    vlc_mutex_init( &p_storage->fd_lock );
 #endif
+    p_storage->fd = fd;
     p_storage->p_next = NULL;
 
     /* */
     p_storage->i_file_max = i_tmp_size_max;
-    p_storage->i_file_size = 0;
+    p_storage->i_data_r = 0;
+    p_storage->i_data_w = 0;
+    p_storage->i_blocks = 0;
 
     /* */
     p_storage->i_cmd_w = 0;
     p_storage->i_cmd_r = 0;
     p_storage->i_cmd_max = 30000;
     p_storage->p_cmd = vlc_alloc( p_storage->i_cmd_max, sizeof(*p_storage->p_cmd) );
-    //fprintf( stderr, "\nSTORAGE name=%s size=%d KiB\n", p_storage->psz_file, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) /1024 );
+
+#ifdef HAVE_MMAP
+    p_storage->p_map = NULL;
+# ifdef HAVE_POSIX_FALLOCATE
+    /* Only map a file with all its blocks allocated: writing to a hole of a
+     * mapping on a full file system would raise SIGBUS. */
+    if( posix_fallocate( fd, 0, p_storage->i_file_max ) == 0 )
+    {
+        void *p_map = mmap( NULL, p_storage->i_file_max,
+                            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        if( p_map != MAP_FAILED )
+            p_storage->p_map = p_map;
+    }
+# endif
+#endif
 
     if( !p_storage->p_cmd )
     {
@@ -1167,10 +1418,6 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         return NULL;
     }
     return p_storage;
-error:
-    free( psz_file );
-    free( p_storage );
-    return NULL;
 }
 
 static void TsStorageDelete( ts_storage_t *p_storage )
@@ -1185,107 +1432,232 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
-    fclose( p_storage->p_filer );
-    fclose( p_storage->p_filew );
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
+        munmap( p_storage->p_map, p_storage->i_file_max );
+#endif
+    vlc_close( p_storage->fd );
 #ifdef _WIN32
     vlc_unlink( p_storage->psz_file );
     free( p_storage->psz_file );
+    vlc_mutex_destroy( &p_storage->fd_lock );
 #endif
     free( p_storage );
 }
 
-static void TsStoragePack( ts_storage_t *p_storage )
+/* The input thread writes while the timeshift thread reads, hence the
+ * positioned I/O: the file offset is shared by both. */
+#ifdef _WIN32
+static ssize_t TsStoragePWrite( ts_storage_t *p_storage, const void *p_data,
+                                size_t i_size, size_t i_offset )
 {
-    /* Try to release a bit of memory */
-    if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
-        return;
+    ssize_t i_ret = -1;
+
+    vlc_mutex_lock( &p_storage->fd_lock );
+    if( lseek( p_storage->fd, i_offset, SEEK_SET ) == (off_t)i_offset )
+        i_ret = write( p_storage->fd, p_data, i_size );
+    vlc_mutex_unlock( &p_storage->fd_lock );
+    return i_ret;
+}
 
-    p_storage->i_cmd_max = __MAX( p_storage->i_cmd_w, 1 );
+static ssize_t TsStoragePRead( ts_storage_t *p_storage, void *p_data,
+                               size_t i_size, size_t i_offset )
+{
+    ssize_t i_ret = -1;
 
-    ts_cmd_t *p_new = realloc( p_storage->p_cmd, p_storage->i_cmd_max * sizeof(*p_storage->p_cmd) );
-    if( p_new )
-        p_storage->p_cmd = p_new;
+    vlc_mutex_lock( &p_storage->fd_lock );
+    if( lseek( p_storage->fd, i_offset, SEEK_SET ) == (off_t)i_offset )
+        i_ret = read( p_storage->fd, p_data, i_size );
+    vlc_mutex_unlock( &p_storage->fd_lock );
+    return i_ret;
 }
-static bool TsStorageIsFull( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
+#else
+# define TsStoragePWrite( p_storage, p_data, i_size, i_offset ) \
+    pwrite( (p_storage)->fd, p_data, i_size, i_offset )
+# define TsStoragePRead( p_storage, p_data, i_size, i_offset ) \
+    pread( (p_storage)->fd, p_data, i_size, i_offset )
+#endif
+
+static int TsStorageWrite( ts_storage_t *p_storage, size_t i_offset,
+                           const void *p_data, size_t i_size )
 {
-    if( p_cmd && p_cmd->i_type == C_SEND && p_storage->i_cmd_w > 0 )
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
     {
-        size_t i_size = sizeof(*p_cmd->u.send.p_block) + p_cmd->u.send.p_block->i_buffer;
-
-        if( p_storage->i_file_size + i_size >= p_storage->i_file_max )
-            return true;
+        memcpy( &p_storage->p_map[i_offset], p_data, i_size );
+        return VLC_SUCCESS;
     }
-    return p_storage->i_cmd_w >= p_storage->i_cmd_max;
+#endif
+    const uint8_t *p = p_data;
+    while( i_size > 0 )
+    {
+        ssize_t i_ret = TsStoragePWrite( p_storage, p, i_size, i_offset );
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p += i_ret;
+        i_offset += i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
 }
-static bool TsStorageIsEmpty( ts_storage_t *p_storage )
+
+static int TsStorageRead( ts_storage_t *p_storage, size_t i_offset,
+                          void *p_data, size_t i_size )
 {
-    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
+#ifdef HAVE_MMAP
+    if( p_storage->p_map )
+    {
+        memcpy( p_data, &p_storage->p_map[i_offset], i_size );
+        return VLC_SUCCESS;
+    }
+#endif
+    uint8_t *p = p_data;
+    while( i_size > 0 )
+    {
+        ssize_t i_ret = TsStoragePRead( p_storage, p, i_size, i_offset );
+        if( i_ret < 0 && errno == EINTR )
+            continue;
+        if( i_ret <= 0 )
+            return VLC_EGENERIC;
+        p += i_ret;
+        i_offset += i_ret;
+        i_size -= i_ret;
+    }
+    return VLC_SUCCESS;
 }
-static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bool b_flush )
+
+/**
+ * Reserves room for a command, and for the data of its block if any.
+ *
+ * On success, the record of the block is located at cmd.u.send.i_offset.
+ */
+static int TsStorageReserve( ts_storage_t *p_storage, ts_cmd_t *p_cmd )
 {
-    ts_cmd_t cmd = *p_cmd;
+    if( p_storage->i_cmd_w - p_storage->i_cmd_r >= p_storage->i_cmd_max )
+        return VLC_EGENERIC;
+    if( p_cmd->i_type != C_SEND )
+        return VLC_SUCCESS;
 
-    assert( !TsStorageIsFull( p_storage, p_cmd ) );
+    const size_t i_size = (sizeof(ts_block_header_t) +
+                           p_cmd->u.send.p_block->i_buffer +
+                           TS_RECORD_ALIGN - 1) & ~(TS_RECORD_ALIGN - 1);
+    const size_t i_max = p_storage->i_file_max;
+    size_t i_r = p_storage->i_data_r;
+    size_t i_w = p_storage->i_data_w;
+    size_t i_offset;
 
-    if( cmd.i_type == C_SEND )
+    if( p_storage->i_blocks == 0 )
+        i_r = i_w = 0;
+
+    if( p_storage->i_blocks == 0 || i_w > i_r )
     {
-        block_t *p_block = cmd.u.send.p_block;
+        /* Free space at the end, then at the beginning of the ring */
+        if( i_size <= i_max - i_w )
+            i_offset = i_w;
+        else if( i_size <= i_r )
+            i_offset = 0;
+        else
+            return VLC_EGENERIC;
+    }
+    else if( i_w < i_r && i_size <= i_r - i_w )
+        i_offset = i_w;
+    else
+        return VLC_EGENERIC;
 
-        cmd.u.send.p_block = NULL;
-        cmd.u.send.i_offset = ftell( p_storage->p_filew );
+    p_storage->i_data_r = i_r;
+    p_storage->i_data_w = i_offset + i_size;
+    p_storage->i_blocks++;
 
-        if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
-        {
-            block_Release( p_block );
-            return;
-        }
-        p_storage->i_file_size += sizeof(*p_block);
-        if( p_block->i_buffer > 0 )
-        {
-            if( fwrite( p_block->p_buffer, p_block->i_buffer, 1, p_storage->p_filew ) != 1 )
-            {
-                block_Release( p_block );
-                return;
-            }
-        }
-        p_storage->i_file_size += p_block->i_buffer;
-        block_Release( p_block );
+    p_cmd->u.send.i_offset = i_offset;
+    p_cmd->u.send.i_size = i_size;
+    return VLC_SUCCESS;
+}
+static bool TsStorageIsEmpty( ts_storage_t *p_storage )
+{
+    return !p_storage || p_storage->i_cmd_r >= p_storage->i_cmd_w;
+}
+/**
+ * Stores the block of a command into its reserved record.
+ *
+ * This may be called without the lock.
+ */
+static void TsStorageWriteCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type != C_SEND )
+        return;
 
-        if( b_flush )
-            fflush( p_storage->p_filew );
-    }
-    p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
+    block_t *p_block = p_cmd->u.send.p_block;
+    const size_t i_offset = p_cmd->u.send.i_offset;
+    const ts_block_header_t header = {
+        .i_dts = p_block->i_dts,
+        .i_pts = p_block->i_pts,
+        .i_length = p_block->i_length,
+        .i_flags = p_block->i_flags,
+        .i_nb_samples = p_block->i_nb_samples,
+        .i_buffer = p_block->i_buffer,
+    };
+
+    if( TsStorageWrite( p_storage, i_offset, &header, sizeof(header) ) ||
+        TsStorageWrite( p_storage, i_offset + sizeof(header),
+                        p_block->p_buffer, p_block->i_buffer ) )
+        p_cmd->u.send.i_size = -p_cmd->u.send.i_size;
+
+    p_cmd->u.send.p_block = NULL;
+    block_Release( p_block );
+}
+static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd )
+{
+    assert( p_storage->i_cmd_w - p_storage->i_cmd_r < p_storage->i_cmd_max );
+
+    p_storage->p_cmd[p_storage->i_cmd_w++ % p_storage->i_cmd_max] = *p_cmd;
 }
 static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush )
 {
     assert( !TsStorageIsEmpty( p_storage ) );
 
-    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++];
+    *p_cmd = p_storage->p_cmd[p_storage->i_cmd_r++ % p_storage->i_cmd_max];
+    if( p_storage->i_cmd_r == p_storage->i_cmd_w )
+        p_storage->i_cmd_r = p_storage->i_cmd_w = 0;
+
     if( p_cmd->i_type == C_SEND )
     {
-        block_t block;
+        const size_t i_offset = p_cmd->u.send.i_offset;
+        ts_block_header_t header;
+        block_t *p_block = NULL;
 
-        if( !b_flush &&
-            !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
-            fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
+        if( !b_flush && p_cmd->u.send.i_size > 0 &&
+            !TsStorageRead( p_storage, i_offset, &header, sizeof(header) ) )
         {
-            block_t *p_block = block_Alloc( block.i_buffer );
-            if( p_block )
+            p_block = block_Alloc( header.i_buffer );
+            if( p_block &&
+                TsStorageRead( p_storage, i_offset + sizeof(header),
+                               p_block->p_buffer, header.i_buffer ) )
             {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_nb_samples = block.i_nb_samples;
-                p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
+                block_Release( p_block );
+                p_block = NULL;
             }
-            p_cmd->u.send.p_block = p_block;
         }
-        else
+
+        if( p_block )
+        {
+            p_block->i_dts      = header.i_dts;
+            p_block->i_pts      = header.i_pts;
+            p_block->i_flags    = header.i_flags;
+            p_block->i_length   = header.i_length;
+            p_block->i_nb_samples = header.i_nb_samples;
+        }
+        else if( !b_flush )
         {
             //perror( "TsStoragePopCmd" );
-            p_cmd->u.send.p_block = block_Alloc( 1 );
+            p_block = block_Alloc( 1 );
         }
+        p_cmd->u.send.p_block = p_block;
+
+        /* Release the record */
+        p_storage->i_blocks--;
+        p_storage->i_data_r = i_offset + abs( p_cmd->u.send.i_size );
     }
 }
 
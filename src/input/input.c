@@ -201,6 +201,28 @@ int input_Start( input_thread_t *p_input )
     return VLC_SUCCESS;
 }
 
+/**
+ * Preparses an item on the calling thread.
+ *
+ * This runs an input created by input_CreatePreparser() synchronously,
+ * instead of starting a thread with input_Start(). It returns when the item
+ * is preparsed, or when input_Stop() is called from another thread.
+ * The input must then be closed with input_Close().
+ *
+ * \param p_input the preparser input
+ */
+void input_Preparse( input_thread_t *p_input )
+{
+    input_thread_private_t *priv = input_priv(p_input);
+
+    assert( priv->b_preparsing && !priv->is_running );
+
+    /* Preparse() sets the interruption context of the input */
+    vlc_interrupt_t *ctx = vlc_interrupt_set( NULL );
+    Preparse( priv );
+    vlc_interrupt_set( ctx );
+}
+
 /**
  * Request a running input thread to stop and die
  *
@@ -611,7 +633,20 @@ static void MainLoopDemux( input_thread_t *p_input, bool *pb_changed )
     }
 
     if( i_ret == VLC_DEMUXER_SUCCESS )
-        i_ret = demux_Demux( p_demux );
+    {
+        struct input_stats *stats = p_priv->stats;
+
+        if( stats != NULL )
+        {
+            vlc_tick_t start = vlc_tick_now();
+
+            i_ret = demux_Demux( p_demux );
+            vlc_histogram_AddTime( &stats->stages[INPUT_STATS_DEMUX_TIME],
+                                   vlc_tick_now() - start );
+        }
+        else
+            i_ret = demux_Demux( p_demux );
+    }
 
     i_ret = i_ret > 0 ? VLC_DEMUXER_SUCCESS : ( i_ret < 0 ? VLC_DEMUXER_EGENERIC : VLC_DEMUXER_EOF);
 
@@ -1937,6 +1972,14 @@ static bool Control( input_thread_t *p_input,
                 break;
             }
 
+            /* Jump within the timeshift buffer if the time is there */
+            if( !es_out_Control( priv->p_es_out, ES_OUT_SET_TIMESHIFT_TIME,
+                                 param.time.i_val, absolute ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_Control( priv->p_es_out, ES_OUT_RESET_PCR );
 
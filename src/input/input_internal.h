@@ -33,6 +33,7 @@
 #include <libvlc.h>
 #include "input_interface.h"
 #include "misc/interrupt.h"
+#include "misc/histogram.h"
 
 struct input_stats;
 
@@ -300,6 +301,7 @@ static inline void input_ControlPushEsHelper( input_thread_t *p_input, int i_typ
 }
 
 bool input_Stopped( input_thread_t * );
+void input_Preparse( input_thread_t * );
 
 int input_GetAttachments(input_thread_t *input, input_attachment_t ***attachments);
 
@@ -351,10 +353,13 @@ struct input_stats {
     atomic_uintmax_t demux_discontinuity;
     atomic_uintmax_t decoded_audio;
     atomic_uintmax_t decoded_video;
+    atomic_uintmax_t video_frame_threads;
+    atomic_uintmax_t video_slice_threads;
     atomic_uintmax_t played_abuffers;
     atomic_uintmax_t lost_abuffers;
     atomic_uintmax_t displayed_pictures;
     atomic_uintmax_t lost_pictures;
+    vlc_histogram_t stages[INPUT_STATS_STAGE_COUNT];
 };
 
 struct input_stats *input_stats_Create(void);
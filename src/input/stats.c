@@ -63,10 +63,14 @@ struct input_stats *input_stats_Create(void)
     atomic_init(&stats->demux_discontinuity, 0);
     atomic_init(&stats->decoded_audio, 0);
     atomic_init(&stats->decoded_video, 0);
+    atomic_init(&stats->video_frame_threads, 0);
+    atomic_init(&stats->video_slice_threads, 0);
     atomic_init(&stats->played_abuffers, 0);
     atomic_init(&stats->lost_abuffers, 0);
     atomic_init(&stats->displayed_pictures, 0);
     atomic_init(&stats->lost_pictures, 0);
+    for (unsigned i = 0; i < INPUT_STATS_STAGE_COUNT; i++)
+        vlc_histogram_Init(&stats->stages[i]);
     return stats;
 }
 
@@ -106,10 +110,18 @@ void input_stats_Compute(struct input_stats *stats, input_stats_t *st)
     /* Vouts */
     st->i_decoded_video = atomic_load_explicit(&stats->decoded_video,
                                                memory_order_relaxed);
+    st->i_video_frame_threads = atomic_load_explicit(
+                    &stats->video_frame_threads, memory_order_relaxed);
+    st->i_video_slice_threads = atomic_load_explicit(
+                    &stats->video_slice_threads, memory_order_relaxed);
     st->i_displayed_pictures = atomic_load_explicit(&stats->displayed_pictures,
                                                     memory_order_relaxed);
     st->i_lost_pictures = atomic_load_explicit(&stats->lost_pictures,
                                                memory_order_relaxed);
+
+    /* Pipeline stages */
+    for (unsigned i = 0; i < INPUT_STATS_STAGE_COUNT; i++)
+        vlc_histogram_Get(&stats->stages[i], &st->stages[i]);
 }
 
 /** Update a counter element with new values
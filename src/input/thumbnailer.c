@@ -26,6 +26,7 @@
 
 #include <vlc_thumbnailer.h>
 #include <vlc_input.h>
+#include <vlc_executor.h>
 #include "misc/background_worker.h"
 
 struct vlc_thumbnailer_t
@@ -259,6 +260,7 @@ vlc_thumbnailer_t *vlc_thumbnailer_Create( vlc_object_t* parent)
     struct background_worker_config cfg = {
         .default_timeout = -1,
         .max_threads = 1,
+        .priority = VLC_EXECUTOR_PRIORITY_HIGH,
         .pf_release = thumbnailer_request_Release,
         .pf_hold = thumbnailer_request_Hold,
         .pf_start = thumbnailer_request_Start,
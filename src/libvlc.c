@@ -99,6 +99,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv->main_playlist = NULL;
     priv->p_vlm = NULL;
     priv->media_source_provider = NULL;
+    priv->block_pool = false;
 
     vlc_ExitInit( &priv->exit );
 
@@ -230,6 +231,9 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         exit(0);
     }
 
+    if( var_InheritBool( p_libvlc, "block-pool" ) )
+        priv->block_pool = block_PoolInit() == VLC_SUCCESS;
+
 #ifdef HAVE_DAEMON
     /* Check for daemon mode */
     if( var_InheritBool( p_libvlc, "daemon" ) )
@@ -479,6 +483,18 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( !var_InheritBool( p_libvlc, "ignore-config" ) )
         config_AutoSaveConfigFile( VLC_OBJECT(p_libvlc) );
 
+    if( priv->block_pool )
+    {
+        struct block_pool_stats stats;
+
+        block_PoolDeinit();
+        block_PoolGetStats( &stats );
+        msg_Dbg( p_libvlc, "block pool: %llu cache hits, %llu depot hits, "
+                 "%llu misses, %llu evictions", stats.cache_hits,
+                 stats.depot_hits, stats.misses, stats.evictions );
+        priv->block_pool = false;
+    }
+
     /* Free module bank. It is refcounted, so we call this each time  */
     vlc_LogDeinit (p_libvlc);
     module_EndBank (true);
@@ -81,6 +81,21 @@ int vlc_LogPreinit(libvlc_int_t *) VLC_USED;
 void vlc_LogInit(libvlc_int_t *);
 void vlc_LogDeinit(libvlc_int_t *);
 
+/*
+ * Data blocks
+ */
+struct block_pool_stats
+{
+    unsigned long long cache_hits; /**< allocations from a thread cache */
+    unsigned long long depot_hits; /**< allocations from the global depot */
+    unsigned long long misses; /**< allocations from the system heap */
+    unsigned long long evictions; /**< pooled blocks freed to the heap */
+};
+
+int block_PoolInit(void);
+void block_PoolDeinit(void);
+void block_PoolGetStats(struct block_pool_stats *);
+
 /*
  * LibVLC exit event handling
  */
@@ -201,6 +216,7 @@ typedef struct libvlc_priv_t
     vlc_actions_t *actions; ///< Hotkeys handler
     struct vlc_medialibrary_t *p_media_library; ///< Media library instance
     struct vlc_thumbnailer_t *p_thumbnailer; ///< Lazily instantiated media thumbnailer
+    bool block_pool; ///< Whether the block pool is in use
 
     /* Exit callback */
     vlc_exit_t       exit;
@@ -23,47 +23,102 @@
 #include <assert.h>
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_executor.h>
 #include <vlc_list.h>
 #include <vlc_threads.h>
 
 #include "libvlc.h"
 #include "background_worker.h"
 
+struct background_worker;
+
 struct task {
-    struct vlc_list node;
+    struct vlc_list node; /**< node in the queue or the running list */
+    struct vlc_runnable runnable; /**< submitted to the executor */
+    struct background_worker *owner;
     void* id; /**< id associated with entity */
     void* entity; /**< the entity to process */
     vlc_tick_t timeout; /**< timeout duration in vlc_tick_t */
-};
-
-struct background_worker;
-
-struct background_thread {
-    struct background_worker *owner;
-    vlc_cond_t probe_cancel_wait; /**< wait for probe request or cancelation */
+    vlc_tick_t deadline; /**< deadline of a running pf_run() task */
     bool probe; /**< true if a probe is requested */
     bool cancel; /**< true if a cancel is requested */
-    struct task *task; /**< current task */
-    struct vlc_list node;
 };
 
 struct background_worker {
     void* owner;
     struct background_worker_config conf;
+    vlc_executor_t *executor; /**< executor shared by all workers */
+    vlc_timer_t timer; /**< times pf_run() tasks out */
+    bool has_timer;
 
     vlc_mutex_t lock;
 
-    int uncompleted; /**< number of tasks requested but not completed */
-    int nthreads; /**< number of threads in the threads list */
-    struct vlc_list threads; /**< list of active background_thread instances */
+    int nrunning; /**< number of tasks in the running list */
+    struct vlc_list running; /**< tasks submitted to the executor */
 
     struct vlc_list queue; /**< queue of tasks */
-    vlc_cond_t queue_wait; /**< wait for the queue to be non-empty */
 
-    vlc_cond_t nothreads_wait; /**< wait for nthreads == 0 */
+    vlc_cond_t probe_cancel_wait; /**< wait for probe request or cancelation */
+    vlc_cond_t idle_wait; /**< wait for nrunning == 0 */
     bool closing; /**< true if background worker deletion is requested */
 };
 
+/* Background tasks mostly wait for I/O, they may use more threads than
+ * there are CPUs. Threads are only started when all are busy. */
+#define BACKGROUND_THREADS_PER_CPU 2
+#define BACKGROUND_THREADS_MIN     4
+
+static vlc_mutex_t executor_lock = VLC_STATIC_MUTEX;
+static vlc_executor_t *executor = NULL;
+static unsigned executor_refs = 0;
+
+/**
+ * Gets the executor of all background workers.
+ *
+ * Tasks wait for their input for long: they must not hold the threads of the
+ * process-wide executor, used for audio and video processing (see
+ * vlc_executor_Hold()). All the background workers share an executor of low
+ * priority threads instead.
+ */
+static vlc_executor_t *ExecutorHold(void)
+{
+    vlc_executor_t *ret;
+
+    vlc_mutex_lock(&executor_lock);
+    if (executor == NULL)
+    {
+        unsigned count = BACKGROUND_THREADS_PER_CPU * vlc_GetCPUCount();
+
+        executor = vlc_executor_New(__MAX(count, BACKGROUND_THREADS_MIN),
+                                    VLC_THREAD_PRIORITY_LOW);
+    }
+
+    ret = executor;
+    if (ret != NULL)
+        executor_refs++;
+    vlc_mutex_unlock(&executor_lock);
+    return ret;
+}
+
+static void ExecutorRelease(void)
+{
+    vlc_executor_t *dead = NULL;
+
+    vlc_mutex_lock(&executor_lock);
+    assert(executor_refs > 0);
+    if (--executor_refs == 0)
+    {
+        dead = executor;
+        executor = NULL;
+    }
+    vlc_mutex_unlock(&executor_lock);
+
+    if (dead != NULL)
+        vlc_executor_Delete(dead);
+}
+
+static void RunTask(void *data);
+
 static struct task *task_Create(struct background_worker *worker, void *id,
                                 void *entity, int timeout)
 {
@@ -71,9 +126,16 @@ static struct task *task_Create(struct background_worker *worker, void *id,
     if (unlikely(!task))
         return NULL;
 
+    task->runnable.run = RunTask;
+    task->runnable.userdata = task;
+    task->runnable.priority = worker->conf.priority;
+    task->owner = worker;
     task->id = id;
     task->entity = entity;
     task->timeout = timeout < 0 ? worker->conf.default_timeout : VLC_TICK_FROM_MS(timeout);
+    task->deadline = INT64_MAX;
+    task->probe = false;
+    task->cancel = false;
     worker->conf.pf_hold(task->entity);
     return task;
 }
@@ -84,32 +146,26 @@ static void task_Destroy(struct background_worker *worker, struct task *task)
     free(task);
 }
 
-static struct task *QueueTake(struct background_worker *worker, int timeout_ms)
+/**
+ * Submit queued tasks to the executor, as long as the worker is allowed to
+ * run more tasks in parallel.
+ */
+static void QueueSubmit(struct background_worker *worker)
 {
     vlc_mutex_assert(&worker->lock);
 
-    vlc_tick_t deadline = vlc_tick_now() + VLC_TICK_FROM_MS(timeout_ms);
-    bool timeout = false;
-    while (!timeout && !worker->closing && vlc_list_is_empty(&worker->queue))
-        timeout = vlc_cond_timedwait(&worker->queue_wait,
-                                     &worker->lock, deadline) != 0;
-
-    if (worker->closing || timeout)
-        return NULL;
-
-    struct task *task = vlc_list_first_entry_or_null(&worker->queue,
-                                                     struct task, node);
-    assert(task);
-    vlc_list_remove(&task->node);
-
-    return task;
-}
+    while (!worker->closing && worker->nrunning < worker->conf.max_threads)
+    {
+        struct task *task = vlc_list_first_entry_or_null(&worker->queue,
+                                                         struct task, node);
+        if (!task)
+            break;
 
-static void QueuePush(struct background_worker *worker, struct task *task)
-{
-    vlc_mutex_assert(&worker->lock);
-    vlc_list_append(&task->node, &worker->queue);
-    vlc_cond_signal(&worker->queue_wait);
+        vlc_list_remove(&task->node);
+        vlc_list_append(&task->node, &worker->running);
+        worker->nrunning++;
+        vlc_executor_Submit(worker->executor, &task->runnable);
+    }
 }
 
 static void QueueRemoveAll(struct background_worker *worker, void *id)
@@ -126,169 +182,160 @@ static void QueueRemoveAll(struct background_worker *worker, void *id)
     }
 }
 
-static struct background_thread *
-background_thread_Create(struct background_worker *owner)
+static void RunningRemove(struct background_worker *worker, struct task *task)
 {
-    struct background_thread *thread = malloc(sizeof(*thread));
-    if (!thread)
-        return NULL;
+    vlc_mutex_assert(&worker->lock);
 
-    vlc_cond_init(&thread->probe_cancel_wait);
-    thread->probe = false;
-    thread->cancel = false;
-    thread->task = NULL;
-    thread->owner = owner;
-    return thread;
+    vlc_list_remove(&task->node);
+    worker->nrunning--;
+    assert(worker->nrunning >= 0);
+    if (!worker->nrunning)
+        vlc_cond_signal(&worker->idle_wait);
 }
 
-static void background_thread_Destroy(struct background_thread *thread)
-{
-    vlc_cond_destroy(&thread->probe_cancel_wait);
-    free(thread);
-}
+static void TimeoutTasks(void *data);
 
-static struct background_worker *background_worker_Create(void *owner,
-                                         struct background_worker_config *conf)
+/**
+ * Arms the timer for the earliest deadline of the running pf_run() tasks.
+ */
+static void TimerUpdate(struct background_worker *worker)
 {
-    struct background_worker* worker = malloc(sizeof(*worker));
-    if (unlikely(!worker))
-        return NULL;
-
-    worker->conf = *conf;
-    worker->owner = owner;
-
-    vlc_mutex_init(&worker->lock);
-    worker->uncompleted = 0;
-    worker->nthreads = 0;
-    vlc_list_init(&worker->threads);
-    vlc_list_init(&worker->queue);
-    vlc_cond_init(&worker->queue_wait);
-    vlc_cond_init(&worker->nothreads_wait);
-    worker->closing = false;
-    return worker;
-}
+    vlc_mutex_assert(&worker->lock);
 
-static void background_worker_Destroy(struct background_worker *worker)
-{
-    vlc_cond_destroy(&worker->queue_wait);
-    vlc_mutex_destroy(&worker->lock);
-    free(worker);
-}
+    vlc_tick_t deadline = INT64_MAX;
+    struct task *task;
+    vlc_list_foreach(task, &worker->running, node)
+        if (!task->cancel && task->deadline < deadline)
+            deadline = task->deadline;
 
-static void TerminateTask(struct background_thread *thread, struct task *task)
-{
-    struct background_worker *worker = thread->owner;
-    task_Destroy(worker, task);
+    if (deadline == INT64_MAX)
+        return; /* a stale expiry finds nothing to do */
 
-    vlc_mutex_lock(&worker->lock);
-    thread->task = NULL;
-    worker->uncompleted--;
-    assert(worker->uncompleted >= 0);
-    vlc_mutex_unlock(&worker->lock);
+    /* Created on first use, as it comes with a thread */
+    if (!worker->has_timer)
+    {
+        if (vlc_timer_create(&worker->timer, TimeoutTasks, worker))
+            return;
+        worker->has_timer = true;
+    }
+    vlc_timer_schedule(worker->timer, true, deadline, 0);
 }
 
-static void RemoveThread(struct background_thread *thread)
+static void TimeoutTasks(void *data)
 {
-    struct background_worker *worker = thread->owner;
+    struct background_worker *worker = data;
+    vlc_tick_t now = vlc_tick_now();
 
     vlc_mutex_lock(&worker->lock);
 
-    vlc_list_remove(&thread->node);
-    worker->nthreads--;
-    assert(worker->nthreads >= 0);
-    if (!worker->nthreads)
-        vlc_cond_signal(&worker->nothreads_wait);
+    struct task *task;
+    vlc_list_foreach(task, &worker->running, node)
+        if (!task->cancel && task->deadline <= now)
+        {
+            /* Running: this kills the interruption context of pf_run() */
+            task->cancel = true;
+            vlc_executor_Cancel(worker->executor, &task->runnable);
+        }
 
+    TimerUpdate(worker);
     vlc_mutex_unlock(&worker->lock);
-
-    background_thread_Destroy(thread);
 }
 
-static void* Thread( void* data )
+static void StartAndWaitTask(struct background_worker *worker,
+                             struct task *task)
 {
-    struct background_thread *thread = data;
-    struct background_worker *worker = thread->owner;
+    vlc_tick_t deadline;
+    if (task->timeout > 0)
+        deadline = vlc_tick_now() + task->timeout;
+    else
+        deadline = INT64_MAX; /* no deadline */
+
+    void *handle;
+    if (worker->conf.pf_start(worker->owner, task->entity, &handle))
+        return;
 
     for (;;)
     {
         vlc_mutex_lock(&worker->lock);
-        struct task *task = QueueTake(worker, 5000);
-        if (!task)
-        {
-            vlc_mutex_unlock(&worker->lock);
-            /* terminate this thread */
-            break;
-        }
-
-        thread->task = task;
-        thread->cancel = false;
-        thread->probe = false;
-        vlc_tick_t deadline;
-        if (task->timeout > 0)
-            deadline = vlc_tick_now() + task->timeout;
-        else
-            deadline = INT64_MAX; /* no deadline */
+        bool timeout = false;
+        while (!timeout && !task->probe && !task->cancel)
+            /* any non-zero return value means timeout */
+            timeout = vlc_cond_timedwait(&worker->probe_cancel_wait,
+                                         &worker->lock, deadline) != 0;
+
+        bool cancel = task->cancel;
+        task->probe = false;
         vlc_mutex_unlock(&worker->lock);
 
-        void *handle;
-        if (worker->conf.pf_start(worker->owner, task->entity, &handle))
+        if (timeout || cancel
+                || worker->conf.pf_probe(worker->owner, handle))
         {
-            TerminateTask(thread, task);
-            continue;
+            worker->conf.pf_stop(worker->owner, handle);
+            break;
         }
+    }
+}
 
-        for (;;)
+static void RunTask(void *data)
+{
+    struct task *task = data;
+    struct background_worker *worker = task->owner;
+
+    if (worker->conf.pf_run)
+    {
+        if (task->timeout > 0)
         {
             vlc_mutex_lock(&worker->lock);
-            bool timeout = false;
-            while (!timeout && !thread->probe && !thread->cancel)
-                /* any non-zero return value means timeout */
-                timeout = vlc_cond_timedwait(&thread->probe_cancel_wait,
-                                             &worker->lock, deadline) != 0;
-
-            bool cancel = thread->cancel;
-            thread->cancel = false;
-            thread->probe = false;
+            task->deadline = vlc_tick_now() + task->timeout;
+            TimerUpdate(worker);
             vlc_mutex_unlock(&worker->lock);
-
-            if (timeout || cancel
-                    || worker->conf.pf_probe(worker->owner, handle))
-            {
-                worker->conf.pf_stop(worker->owner, handle);
-                TerminateTask(thread, task);
-                break;
-            }
         }
+        worker->conf.pf_run(worker->owner, task->entity);
     }
+    else
+        StartAndWaitTask(worker, task);
+
+    /* Release the entity first: the worker may be deleted as soon as the
+     * task is removed from the running list. */
+    worker->conf.pf_release(task->entity);
 
-    RemoveThread(thread);
+    vlc_mutex_lock(&worker->lock);
+    RunningRemove(worker, task);
+    QueueSubmit(worker);
+    vlc_mutex_unlock(&worker->lock);
 
-    return NULL;
+    free(task);
 }
 
-static bool SpawnThread(struct background_worker *worker)
+struct background_worker* background_worker_New( void* owner,
+    struct background_worker_config* conf )
 {
-    vlc_mutex_assert(&worker->lock);
+    struct background_worker* worker = malloc(sizeof(*worker));
+    if (unlikely(!worker))
+        return NULL;
 
-    struct background_thread *thread = background_thread_Create(worker);
-    if (!thread)
-        return false;
+    worker->conf = *conf;
+    if (worker->conf.max_threads < 1)
+        worker->conf.max_threads = 1;
 
-    if (vlc_clone_detach(NULL, Thread, thread, VLC_THREAD_PRIORITY_LOW))
+    worker->executor = ExecutorHold();
+    if (unlikely(!worker->executor))
     {
-        free(thread);
-        return false;
+        free(worker);
+        return NULL;
     }
-    worker->nthreads++;
-    vlc_list_append(&thread->node, &worker->threads);
 
-    return true;
-}
+    worker->owner = owner;
+    worker->has_timer = false;
 
-struct background_worker* background_worker_New( void* owner,
-    struct background_worker_config* conf )
-{
-    return background_worker_Create(owner, conf);
+    vlc_mutex_init(&worker->lock);
+    worker->nrunning = 0;
+    vlc_list_init(&worker->running);
+    vlc_list_init(&worker->queue);
+    vlc_cond_init(&worker->probe_cancel_wait);
+    vlc_cond_init(&worker->idle_wait);
+    worker->closing = false;
+    return worker;
 }
 
 int background_worker_Push( struct background_worker* worker, void* entity,
@@ -299,10 +346,8 @@ int background_worker_Push( struct background_worker* worker, void* entity,
         return VLC_ENOMEM;
 
     vlc_mutex_lock(&worker->lock);
-    QueuePush(worker, task);
-    if (++worker->uncompleted > worker->nthreads
-            && worker->nthreads < worker->conf.max_threads)
-        SpawnThread(worker);
+    vlc_list_append(&task->node, &worker->queue);
+    QueueSubmit(worker);
     vlc_mutex_unlock(&worker->lock);
 
     return VLC_SUCCESS;
@@ -315,15 +360,24 @@ static void BackgroundWorkerCancelLocked(struct background_worker *worker,
 
     QueueRemoveAll(worker, id);
 
-    struct background_thread *thread;
-    vlc_list_foreach(thread, &worker->threads, node)
+    struct task *task;
+    vlc_list_foreach(task, &worker->running, node)
     {
-        if (!id || (thread->task && thread->task->id == id && !thread->cancel))
+        if ((id && task->id != id) || task->cancel)
+            continue;
+
+        task->cancel = true;
+        /* Not started yet: the executor will never run it. Otherwise, this
+         * kills the interruption context of pf_run(). */
+        if (vlc_executor_Cancel(worker->executor, &task->runnable))
         {
-            thread->cancel = true;
-            vlc_cond_signal(&thread->probe_cancel_wait);
+            RunningRemove(worker, task);
+            task_Destroy(worker, task);
         }
     }
+
+    vlc_cond_broadcast(&worker->probe_cancel_wait);
+    QueueSubmit(worker);
 }
 
 void background_worker_Cancel( struct background_worker* worker, void* id )
@@ -337,12 +391,10 @@ void background_worker_RequestProbe( struct background_worker* worker )
 {
     vlc_mutex_lock(&worker->lock);
 
-    struct background_thread *thread;
-    vlc_list_foreach(thread, &worker->threads, node)
-    {
-        thread->probe = true;
-        vlc_cond_signal(&thread->probe_cancel_wait);
-    }
+    struct task *task;
+    vlc_list_foreach(task, &worker->running, node)
+        task->probe = true;
+    vlc_cond_broadcast(&worker->probe_cancel_wait);
 
     vlc_mutex_unlock(&worker->lock);
 }
@@ -351,16 +403,21 @@ void background_worker_Delete( struct background_worker* worker )
 {
     vlc_mutex_lock(&worker->lock);
 
+    /* closing is now true, QueueSubmit() will not submit anything anymore */
     worker->closing = true;
     BackgroundWorkerCancelLocked(worker, NULL);
-    /* closing is now true, this will wake up any QueueTake() */
-    vlc_cond_broadcast(&worker->queue_wait);
 
-    while (worker->nthreads)
-        vlc_cond_wait(&worker->nothreads_wait, &worker->lock);
+    while (worker->nrunning)
+        vlc_cond_wait(&worker->idle_wait, &worker->lock);
 
     vlc_mutex_unlock(&worker->lock);
 
-    /* no threads use the worker anymore, we can destroy it */
-    background_worker_Destroy(worker);
+    /* no tasks use the worker anymore, we can destroy it */
+    if (worker->has_timer)
+        vlc_timer_destroy(worker->timer);
+    vlc_cond_destroy(&worker->idle_wait);
+    vlc_cond_destroy(&worker->probe_cancel_wait);
+    vlc_mutex_destroy(&worker->lock);
+    ExecutorRelease();
+    free(worker);
 }
@@ -30,10 +30,19 @@ struct background_worker_config {
     vlc_tick_t default_timeout;
 
     /**
-     * Maximum number of threads used to execute tasks.
+     * Maximum number of tasks executed in parallel.
+     *
+     * Tasks are executed by an executor shared by all background workers
+     * (see vlc_executor.h), which starts low priority threads on demand.
      */
     int max_threads;
 
+    /**
+     * Priority of the tasks among the pending tasks of all background
+     * workers (VLC_EXECUTOR_PRIORITY_*)
+     */
+    int priority;
+
     /**
      * Release an entity
      *
@@ -63,6 +72,22 @@ struct background_worker_config {
      **/
     void( *pf_hold )( void* entity );
 
+    /**
+     * Run a task synchronously
+     *
+     * If not NULL, this callback is used instead of \ref pf_start, \ref
+     * pf_probe and \ref pf_stop: the task is executed directly on an executor
+     * thread, and is complete when the callback returns.
+     *
+     * The callback runs with an interruption context of its own, which is
+     * killed if the task is cancelled or times out (see vlc_killed() and
+     * vlc_interrupt_register()).
+     *
+     * \param owner the owner of the background-worker
+     * \param entity the entity to process
+     **/
+    void( *pf_run )( void* owner, void* entity );
+
     /**
      * Start a new task
      *
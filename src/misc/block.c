@@ -28,12 +28,14 @@
 #include <sys/stat.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdatomic.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include "libvlc.h"
 
 #ifndef NDEBUG
 static void block_Check (block_t *block)
@@ -105,6 +107,338 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /** Initial reserved header and footer size. */
 #define BLOCK_PADDING      32
 
+/*
+ * Block pool
+ *
+ * When enabled, block_Alloc() rounds allocations up to power-of-two size
+ * classes. Each thread keeps a short free list per class, and exchanges
+ * batches of blocks with a global depot whenever its list runs empty or full,
+ * so that most allocations and releases do not take any lock. Larger
+ * allocations bypass the pool.
+ */
+
+/** Smallest size class (256 bytes) */
+#define POOL_MIN_SHIFT 8
+/** Number of size classes (the biggest being 128 KiB) */
+#define POOL_CLASSES 10
+/** Maximum size of a thread free list, in bytes */
+#define POOL_CACHE_BYTES (256 << 10)
+/** Maximum length of a thread free list */
+#define POOL_CACHE_MAX 64
+/** Maximum length of a depot list, in units of thread free lists */
+#define POOL_DEPOT_RATIO 8
+
+struct block_cache
+{
+    block_t *lists[POOL_CLASSES];
+    unsigned counts[POOL_CLASSES];
+
+    /* Statistics not yet added to the global counters */
+    unsigned long cache_hits;
+    unsigned long depot_hits;
+    unsigned long misses;
+    unsigned long evictions;
+};
+
+static vlc_mutex_t pool_lock = VLC_STATIC_MUTEX;
+static unsigned pool_users = 0; /* protected by pool_lock */
+static bool pool_has_key = false; /* protected by pool_lock */
+static vlc_threadvar_t pool_key;
+static atomic_bool pool_enabled = ATOMIC_VAR_INIT(false);
+
+/* Depot, protected by pool_lock */
+static block_t *pool_depot[POOL_CLASSES];
+static unsigned pool_depot_counts[POOL_CLASSES];
+
+static atomic_ullong pool_cache_hits = ATOMIC_VAR_INIT(0);
+static atomic_ullong pool_depot_hits = ATOMIC_VAR_INIT(0);
+static atomic_ullong pool_misses = ATOMIC_VAR_INIT(0);
+static atomic_ullong pool_evictions = ATOMIC_VAR_INIT(0);
+
+/**
+ * Gets the size class of an allocation, or -1 if it is too large.
+ */
+static int PoolClass(size_t size)
+{
+    if (size > ((size_t)1 << (POOL_MIN_SHIFT + POOL_CLASSES - 1)))
+        return -1;
+    if (size <= (1 << POOL_MIN_SHIFT))
+        return 0;
+    return (sizeof (unsigned long) * 8) - vlc_clzl(size - 1) - POOL_MIN_SHIFT;
+}
+
+static size_t PoolClassSize(unsigned c)
+{
+    return (size_t)1 << (POOL_MIN_SHIFT + c);
+}
+
+/**
+ * Gets the maximum length of a thread free list.
+ */
+static unsigned PoolCacheMax(unsigned c)
+{
+    unsigned max = POOL_CACHE_BYTES >> (POOL_MIN_SHIFT + c);
+
+    if (max > POOL_CACHE_MAX)
+        max = POOL_CACHE_MAX;
+    if (max < 2)
+        max = 2;
+    return max;
+}
+
+static void PoolCacheFlushStats(struct block_cache *cache)
+{
+    atomic_fetch_add_explicit(&pool_cache_hits, cache->cache_hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool_depot_hits, cache->depot_hits,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool_misses, cache->misses,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&pool_evictions, cache->evictions,
+                              memory_order_relaxed);
+    cache->cache_hits = cache->depot_hits = 0;
+    cache->misses = cache->evictions = 0;
+}
+
+/**
+ * Moves a batch of blocks from the depot to a thread free list.
+ */
+static void PoolCacheRefill(struct block_cache *cache, unsigned c)
+{
+    unsigned n = PoolCacheMax(c) / 2;
+
+    vlc_mutex_lock(&pool_lock);
+    while (n > 0 && pool_depot[c] != NULL)
+    {
+        block_t *b = pool_depot[c];
+
+        pool_depot[c] = b->p_next;
+        pool_depot_counts[c]--;
+        b->p_next = cache->lists[c];
+        cache->lists[c] = b;
+        cache->counts[c]++;
+        n--;
+    }
+    vlc_mutex_unlock(&pool_lock);
+
+    PoolCacheFlushStats(cache);
+}
+
+/**
+ * Moves blocks from a thread free list to the depot.
+ *
+ * Blocks which do not fit in the depot, or all of them if the pool has been
+ * disabled, are freed instead.
+ */
+static void PoolCacheSpill(struct block_cache *cache, unsigned c, unsigned n)
+{
+    const unsigned max = PoolCacheMax(c) * POOL_DEPOT_RATIO;
+    block_t *excess = NULL;
+
+    assert(n <= cache->counts[c]);
+
+    vlc_mutex_lock(&pool_lock);
+    while (n > 0)
+    {
+        block_t *b = cache->lists[c];
+
+        cache->lists[c] = b->p_next;
+        cache->counts[c]--;
+
+        if (pool_users > 0 && pool_depot_counts[c] < max)
+        {
+            b->p_next = pool_depot[c];
+            pool_depot[c] = b;
+            pool_depot_counts[c]++;
+        }
+        else
+        {
+            b->p_next = excess;
+            excess = b;
+        }
+        n--;
+    }
+    vlc_mutex_unlock(&pool_lock);
+
+    while (excess != NULL)
+    {
+        block_t *next = excess->p_next;
+
+        free(excess);
+        cache->evictions++;
+        excess = next;
+    }
+
+    PoolCacheFlushStats(cache);
+}
+
+static void PoolCacheDestroy(void *data)
+{
+    struct block_cache *cache = data;
+
+    for (unsigned c = 0; c < POOL_CLASSES; c++)
+        if (cache->counts[c] > 0)
+            PoolCacheSpill(cache, c, cache->counts[c]);
+
+    PoolCacheFlushStats(cache);
+    free(cache);
+}
+
+static struct block_cache *PoolCacheGet(void)
+{
+    struct block_cache *cache = vlc_threadvar_get(pool_key);
+
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc(1, sizeof (*cache));
+        if (likely(cache != NULL) && vlc_threadvar_set(pool_key, cache))
+        {
+            free(cache);
+            cache = NULL;
+        }
+    }
+    return cache;
+}
+
+static block_t *PoolAlloc(unsigned c)
+{
+    struct block_cache *cache = PoolCacheGet();
+    if (unlikely(cache == NULL))
+        return malloc(PoolClassSize(c));
+
+    block_t *b = cache->lists[c];
+
+    if (b != NULL)
+        cache->cache_hits++;
+    else
+    {
+        PoolCacheRefill(cache, c);
+        b = cache->lists[c];
+        if (b == NULL)
+        {
+            cache->misses++;
+            return malloc(PoolClassSize(c));
+        }
+        cache->depot_hits++;
+    }
+
+    cache->lists[c] = b->p_next;
+    cache->counts[c]--;
+    return b;
+}
+
+static void block_pool_Release(block_t *block)
+{
+    /* Pooled blocks span exactly their size class. */
+    assert(block->p_start == (unsigned char *)(block + 1));
+
+    if (atomic_load_explicit(&pool_enabled, memory_order_acquire))
+    {
+        struct block_cache *cache = PoolCacheGet();
+
+        if (likely(cache != NULL))
+        {
+            int c = PoolClass(sizeof (*block) + block->i_size);
+
+            assert(c >= 0);
+            assert(PoolClassSize(c) == sizeof (*block) + block->i_size);
+
+            if (cache->counts[c] >= PoolCacheMax(c))
+                PoolCacheSpill(cache, c, PoolCacheMax(c) / 2);
+
+            block->p_next = cache->lists[c];
+            cache->lists[c] = block;
+            cache->counts[c]++;
+            return;
+        }
+    }
+
+    free(block);
+}
+
+static const struct vlc_block_callbacks block_pool_cbs =
+{
+    block_pool_Release,
+};
+
+int block_PoolInit(void)
+{
+    int ret = VLC_SUCCESS;
+
+    vlc_mutex_lock(&pool_lock);
+    /* The key is never deleted, as other threads may still own caches. */
+    if (!pool_has_key)
+        pool_has_key = vlc_threadvar_create(&pool_key, PoolCacheDestroy) == 0;
+
+    if (likely(pool_has_key))
+    {
+        if (pool_users++ == 0)
+            atomic_store_explicit(&pool_enabled, true, memory_order_release);
+    }
+    else
+        ret = VLC_ENOMEM;
+    vlc_mutex_unlock(&pool_lock);
+    return ret;
+}
+
+void block_PoolDeinit(void)
+{
+    vlc_mutex_lock(&pool_lock);
+    assert(pool_users > 0);
+    if (--pool_users > 0)
+    {
+        vlc_mutex_unlock(&pool_lock);
+        return;
+    }
+    atomic_store_explicit(&pool_enabled, false, memory_order_relaxed);
+    vlc_mutex_unlock(&pool_lock);
+
+    /* Flush the cache of the calling thread. Other threads flush theirs as
+     * they exit. */
+    struct block_cache *cache = vlc_threadvar_get(pool_key);
+    if (cache != NULL)
+    {
+        vlc_threadvar_set(pool_key, NULL);
+        PoolCacheDestroy(cache);
+    }
+
+    block_t *lists[POOL_CLASSES];
+    unsigned long long evictions = 0;
+
+    vlc_mutex_lock(&pool_lock);
+    for (unsigned c = 0; c < POOL_CLASSES; c++)
+    {
+        lists[c] = pool_depot[c];
+        pool_depot[c] = NULL;
+        pool_depot_counts[c] = 0;
+    }
+    vlc_mutex_unlock(&pool_lock);
+
+    for (unsigned c = 0; c < POOL_CLASSES; c++)
+        while (lists[c] != NULL)
+        {
+            block_t *next = lists[c]->p_next;
+
+            free(lists[c]);
+            lists[c] = next;
+            evictions++;
+        }
+
+    atomic_fetch_add_explicit(&pool_evictions, evictions,
+                              memory_order_relaxed);
+}
+
+void block_PoolGetStats(struct block_pool_stats *stats)
+{
+    stats->cache_hits = atomic_load_explicit(&pool_cache_hits,
+                                             memory_order_relaxed);
+    stats->depot_hits = atomic_load_explicit(&pool_depot_hits,
+                                             memory_order_relaxed);
+    stats->misses = atomic_load_explicit(&pool_misses, memory_order_relaxed);
+    stats->evictions = atomic_load_explicit(&pool_evictions,
+                                            memory_order_relaxed);
+}
+
 block_t *block_Alloc (size_t size)
 {
     if (unlikely(size >> 27))
@@ -114,16 +448,29 @@ block_t *block_Alloc (size_t size)
     }
 
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    const struct vlc_block_callbacks *cbs = &block_generic_cbs;
+    block_t *b;
+    int c;
+
+    if (atomic_load_explicit(&pool_enabled, memory_order_acquire)
+     && (c = PoolClass(alloc)) >= 0)
+    {
+        /* Use the whole size class, so that block_Realloc() can use it. */
+        alloc = PoolClassSize(c);
+        cbs = &block_pool_cbs;
+        b = PoolAlloc(c);
+    }
+    else
+        b = malloc (alloc);
     if (unlikely(b == NULL))
         return NULL;
 
-    block_Init(b, &block_generic_cbs, b + 1, alloc - sizeof (*b));
+    block_Init(b, cbs, b + 1, alloc - sizeof (*b));
     static_assert ((BLOCK_PADDING % BLOCK_ALIGN) == 0,
                    "BLOCK_PADDING must be a multiple of BLOCK_ALIGN");
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
@@ -141,10 +488,149 @@ void block_Release(block_t *block)
     block->cbs->free(block);
 }
 
+/*
+ * Shared blocks
+ *
+ * The first call to block_Share() diverts the callbacks of the original
+ * block to a per-payload table, which also counts the references. The
+ * original block header stays allocated (the payload may follow it in
+ * memory) until the last reference is released.
+ *
+ * The headroom before the shared payload is not visible to any block, so
+ * the first block that prepends data takes it over, and writes to it in
+ * place. The headroom is given up if that block is shared in turn, as the
+ * new block would then see the prepended data.
+ */
+struct block_shared
+{
+    struct vlc_block_callbacks cbs;
+    const struct vlc_block_callbacks *origin_cbs;
+    block_t *origin;
+    const uint8_t *base; /**< Start of the shared payload */
+    atomic_uintptr_t head; /**< Block owning the headroom, 0 if none */
+    atomic_uint refs;
+};
+
+static void block_shared_Release(block_t *block)
+{
+    struct block_shared *shared =
+        container_of(block->cbs, struct block_shared, cbs);
+    block_t *origin = shared->origin;
+    uintptr_t owner = (uintptr_t)block;
+
+    /* Nothing refers to the prepended data anymore */
+    atomic_compare_exchange_strong_explicit(&shared->head, &owner, 0,
+                                            memory_order_relaxed,
+                                            memory_order_relaxed);
+    if (block != origin)
+        free(block);
+
+    if (atomic_fetch_sub_explicit(&shared->refs, 1, memory_order_acq_rel) == 1)
+    {
+        origin->cbs = shared->origin_cbs;
+        free(shared);
+        block_Release(origin);
+    }
+}
+
+block_t *block_Share(block_t *block)
+{
+    struct block_shared *shared;
+
+    block_Check(block);
+
+    if (block->cbs->free == block_shared_Release)
+        shared = container_of(block->cbs, struct block_shared, cbs);
+    else
+    {
+        shared = malloc(sizeof (*shared));
+        if (unlikely(shared == NULL))
+            return NULL;
+
+        shared->cbs.free = block_shared_Release;
+        shared->origin_cbs = block->cbs;
+        shared->origin = block;
+        shared->base = block->p_buffer;
+        atomic_init(&shared->head, 0);
+        atomic_init(&shared->refs, 1);
+        block->cbs = &shared->cbs;
+    }
+
+    if (block->p_buffer < shared->base) /* Give up the headroom */
+        atomic_store_explicit(&shared->head, (uintptr_t)shared,
+                              memory_order_relaxed);
+
+    block_t *copy = malloc(sizeof (*copy));
+    if (unlikely(copy == NULL))
+        return NULL;
+
+    block_Init(copy, &shared->cbs, block->p_start, block->i_size);
+    copy->p_buffer = block->p_buffer;
+    copy->i_buffer = block->i_buffer;
+    block_CopyProperties(copy, block);
+    atomic_fetch_add_explicit(&shared->refs, 1, memory_order_relaxed);
+    return copy;
+}
+
+bool block_IsShared(const block_t *block)
+{
+    if (block->cbs->free != block_shared_Release)
+        return false;
+
+    struct block_shared *shared =
+        container_of(block->cbs, struct block_shared, cbs);
+    return atomic_load_explicit(&shared->refs, memory_order_acquire) > 1;
+}
+
+/**
+ * Checks whether a shared block can be reallocated in place, that is,
+ * without growing its payload at the end, nor writing to the headroom
+ * that another block owns.
+ */
+static bool block_shared_TryRealloc(block_t *block, size_t prebody,
+                                    size_t body)
+{
+    struct block_shared *shared =
+        container_of(block->cbs, struct block_shared, cbs);
+    uintptr_t owner = 0;
+
+    if (body > block->i_buffer)
+        return false;
+    if (prebody == 0)
+        return true;
+    if (block->p_buffer > shared->base)
+        return false; /* The data before the payload is shared */
+
+    return atomic_compare_exchange_strong_explicit(&shared->head, &owner,
+                                                   (uintptr_t)block,
+                                                   memory_order_relaxed,
+                                                   memory_order_relaxed)
+        || owner == (uintptr_t)block;
+}
+
+block_t *block_Writable(block_t *block)
+{
+    if (!block_IsShared(block))
+        return block;
+
+    block_t *copy = block_Alloc(block->i_buffer);
+    if (likely(copy != NULL))
+    {
+        memcpy(copy->p_buffer, block->p_buffer, block->i_buffer);
+        BlockMetaCopy(copy, block);
+    }
+    block_Release(block);
+    return copy;
+}
+
 block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 {
     block_Check( p_block );
 
+    /* A shared payload is never modified: it is copied instead, unless
+     * data is only prepended to it in the headroom. */
+    const bool shared = block_IsShared( p_block );
+
     /* Corner case: empty block requested */
     if( i_prebody <= 0 && i_body <= (size_t)(-i_prebody) )
         i_prebody = i_body = 0;
@@ -177,7 +663,7 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
 
     if( p_block->i_buffer == 0 )
     {   /* Corner case: nothing to preserve */
-        if( requested <= p_block->i_size )
+        if( requested <= p_block->i_size && !shared )
         {   /* Enough room: recycle buffer */
             size_t extra = p_block->i_size - requested;
 
@@ -202,7 +688,8 @@ block_t *block_TryRealloc (block_t *p_block, ssize_t i_prebody, size_t i_body)
     /* Second, reallocate the buffer if we lack space. */
     assert( i_prebody >= 0 );
     if( (size_t)(p_block->p_buffer - p_start) < (size_t)i_prebody
-     || (size_t)(p_end - p_block->p_buffer) < i_body )
+     || (size_t)(p_end - p_block->p_buffer) < i_body
+     || (shared && !block_shared_TryRealloc( p_block, i_prebody, i_body )) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea == NULL )
@@ -0,0 +1,399 @@
+/*****************************************************************************
+ * executor.c: work-stealing thread pool
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_executor.h>
+#include <vlc_list.h>
+#include <vlc_threads.h>
+
+#include "interrupt.h"
+
+/*
+ * Each thread owns a queue of pending runnables, sorted by priority.
+ * Submissions are spread over the queues in round-robin order. A thread pops
+ * the runnable of highest priority among the heads of all queues, preferring
+ * its own queue, then the next ones, on ties.
+ *
+ * Whenever two queue locks are held, they are taken in thread index order.
+ * vlc_executor_Cancel() takes all of them, so that a runnable cannot move
+ * from a queue to a thread behind its back.
+ *
+ * Threads are started on demand, when a runnable is submitted while there
+ * are more pending runnables than idle threads, up to the maximum. They are
+ * only stopped when the executor is deleted.
+ */
+
+struct vlc_executor_thread
+{
+    vlc_executor_t *owner;
+    vlc_thread_t thread;
+
+    vlc_mutex_t lock; /**< protects queue and current */
+    struct vlc_list queue; /**< pending runnables, highest priority first */
+    atomic_uint count; /**< number of runnables in queue */
+    atomic_int head; /**< priority of the first runnable in queue */
+    /**
+     * Identifier of the running runnable, or 0. The runnable itself is not
+     * referenced, as its run() callback may free it.
+     */
+    uint64_t current;
+    vlc_interrupt_t interrupt; /**< interruption context of current */
+};
+
+struct vlc_executor
+{
+    unsigned nthreads; /**< maximum number of threads */
+    int priority; /**< threads scheduling priority */
+    atomic_uint next; /**< round-robin submission index */
+    atomic_uint_fast64_t next_id; /**< next runnable identifier */
+    atomic_uint pending; /**< number of runnables in all queues */
+
+    vlc_mutex_t lock; /**< protects the fields below, wakes idle threads */
+    vlc_cond_t wait;
+    unsigned started; /**< number of started threads */
+    unsigned idle; /**< number of threads waiting for runnables */
+    bool closing;
+
+    struct vlc_executor_thread threads[];
+};
+
+static void QueueUpdateHead(struct vlc_executor_thread *thread)
+{
+    struct vlc_runnable *first =
+        vlc_list_first_entry_or_null(&thread->queue, struct vlc_runnable,
+                                     node);
+    if (first != NULL)
+        atomic_store_explicit(&thread->head, first->priority,
+                              memory_order_relaxed);
+}
+
+static void QueueInsert(struct vlc_executor_thread *thread,
+                        struct vlc_runnable *runnable)
+{
+    vlc_mutex_assert(&thread->lock);
+
+    /* Keep FIFO order among runnables of the same priority */
+    struct vlc_list *prev = thread->queue.prev;
+    while (prev != &thread->queue
+        && container_of(prev, struct vlc_runnable, node)->priority
+               < runnable->priority)
+        prev = prev->prev;
+
+    vlc_list_add_after(&runnable->node, prev);
+    QueueUpdateHead(thread);
+    atomic_fetch_add_explicit(&thread->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&thread->owner->pending, 1,
+                              memory_order_relaxed);
+}
+
+static void QueueRemove(struct vlc_executor_thread *thread,
+                        struct vlc_runnable *runnable)
+{
+    vlc_mutex_assert(&thread->lock);
+
+    vlc_list_remove(&runnable->node);
+    QueueUpdateHead(thread);
+    atomic_fetch_sub_explicit(&thread->count, 1, memory_order_relaxed);
+    atomic_fetch_sub_explicit(&thread->owner->pending, 1,
+                              memory_order_relaxed);
+}
+
+/**
+ * Takes a runnable from the queue of the victim, and makes it the current
+ * runnable of the calling thread.
+ */
+static struct vlc_runnable *TakeFrom(struct vlc_executor_thread *self,
+                                     struct vlc_executor_thread *victim)
+{
+    struct vlc_executor_thread *first = self < victim ? self : victim;
+    struct vlc_executor_thread *second = self < victim ? victim : self;
+
+    vlc_mutex_lock(&first->lock);
+    if (second != first)
+        vlc_mutex_lock(&second->lock);
+
+    struct vlc_runnable *runnable =
+        vlc_list_first_entry_or_null(&victim->queue, struct vlc_runnable,
+                                     node);
+    if (runnable != NULL)
+    {
+        QueueRemove(victim, runnable);
+        vlc_interrupt_init(&self->interrupt);
+        self->current = runnable->id;
+    }
+
+    if (second != first)
+        vlc_mutex_unlock(&second->lock);
+    vlc_mutex_unlock(&first->lock);
+    return runnable;
+}
+
+static struct vlc_runnable *Take(struct vlc_executor_thread *self)
+{
+    vlc_executor_t *executor = self->owner;
+    unsigned index = self - executor->threads;
+
+    for (;;)
+    {
+        struct vlc_executor_thread *best = NULL;
+        int best_priority = 0;
+
+        /* Find the highest priority without locking the queues */
+        for (unsigned i = 0; i < executor->nthreads; i++)
+        {
+            struct vlc_executor_thread *victim =
+                &executor->threads[(index + i) % executor->nthreads];
+
+            if (atomic_load_explicit(&victim->count,
+                                     memory_order_relaxed) == 0)
+                continue;
+
+            int priority = atomic_load_explicit(&victim->head,
+                                                memory_order_relaxed);
+            if (best == NULL || priority > best_priority)
+            {
+                best = victim;
+                best_priority = priority;
+            }
+        }
+
+        if (best == NULL)
+            return NULL;
+
+        struct vlc_runnable *runnable = TakeFrom(self, best);
+        if (runnable != NULL)
+            return runnable;
+        /* The queue was emptied meanwhile, look again */
+    }
+}
+
+static void *Thread(void *data)
+{
+    struct vlc_executor_thread *self = data;
+    vlc_executor_t *executor = self->owner;
+
+    for (;;)
+    {
+        struct vlc_runnable *runnable = Take(self);
+
+        if (runnable == NULL)
+        {
+            vlc_mutex_lock(&executor->lock);
+            executor->idle++;
+            while (atomic_load(&executor->pending) == 0 && !executor->closing)
+                vlc_cond_wait(&executor->wait, &executor->lock);
+            executor->idle--;
+
+            bool closing = executor->closing;
+            vlc_mutex_unlock(&executor->lock);
+
+            if (closing && atomic_load(&executor->pending) == 0)
+                break;
+            continue;
+        }
+
+        vlc_interrupt_set(&self->interrupt);
+        runnable->run(runnable->userdata);
+        vlc_interrupt_set(NULL);
+
+        /* The runnable may have been freed by its callback by now, and
+         * its address reused by a new one: only its identifier is left */
+        vlc_mutex_lock(&self->lock);
+        self->current = 0;
+        vlc_mutex_unlock(&self->lock);
+        vlc_interrupt_deinit(&self->interrupt);
+    }
+
+    return NULL;
+}
+
+vlc_executor_t *vlc_executor_New(unsigned max_threads, int priority)
+{
+    assert(max_threads > 0);
+
+    vlc_executor_t *executor =
+        malloc(sizeof (*executor) + max_threads * sizeof (executor->threads[0]));
+    if (unlikely(executor == NULL))
+        return NULL;
+
+    executor->nthreads = max_threads;
+    executor->priority = priority;
+    atomic_init(&executor->next, 0);
+    atomic_init(&executor->next_id, 1);
+    atomic_init(&executor->pending, 0);
+    vlc_mutex_init(&executor->lock);
+    vlc_cond_init(&executor->wait);
+    executor->started = 0;
+    executor->idle = 0;
+    executor->closing = false;
+
+    for (unsigned i = 0; i < max_threads; i++)
+    {
+        struct vlc_executor_thread *thread = &executor->threads[i];
+
+        thread->owner = executor;
+        vlc_mutex_init(&thread->lock);
+        vlc_list_init(&thread->queue);
+        atomic_init(&thread->count, 0);
+        atomic_init(&thread->head, 0);
+        thread->current = 0;
+    }
+
+    /* Threads are started by vlc_executor_Submit() */
+    return executor;
+}
+
+void vlc_executor_Delete(vlc_executor_t *executor)
+{
+    vlc_mutex_lock(&executor->lock);
+    executor->closing = true;
+    vlc_cond_broadcast(&executor->wait);
+    vlc_mutex_unlock(&executor->lock);
+
+    /* No more threads are started once closing */
+    for (unsigned i = 0; i < executor->started; i++)
+        vlc_join(executor->threads[i].thread, NULL);
+
+    assert(atomic_load(&executor->pending) == 0);
+
+    for (unsigned i = 0; i < executor->nthreads; i++)
+    {
+        assert(vlc_list_is_empty(&executor->threads[i].queue));
+        vlc_mutex_destroy(&executor->threads[i].lock);
+    }
+    vlc_cond_destroy(&executor->wait);
+    vlc_mutex_destroy(&executor->lock);
+    free(executor);
+}
+
+void vlc_executor_Submit(vlc_executor_t *executor,
+                         struct vlc_runnable *runnable)
+{
+    unsigned index = atomic_fetch_add_explicit(&executor->next, 1,
+                                               memory_order_relaxed);
+    struct vlc_executor_thread *thread =
+        &executor->threads[index % executor->nthreads];
+
+    vlc_mutex_lock(&thread->lock);
+    runnable->id = atomic_fetch_add_explicit(&executor->next_id, 1,
+                                             memory_order_relaxed);
+    QueueInsert(thread, runnable);
+    vlc_mutex_unlock(&thread->lock);
+
+    vlc_mutex_lock(&executor->lock);
+    /* Start a thread if the idle ones cannot take all pending runnables.
+     * If that fails, the runnable is taken once a thread is available. */
+    if (executor->started < executor->nthreads && !executor->closing
+     && atomic_load(&executor->pending) > executor->idle)
+    {
+        struct vlc_executor_thread *newthread =
+            &executor->threads[executor->started];
+
+        if (vlc_clone(&newthread->thread, Thread, newthread,
+                      executor->priority) == 0)
+            executor->started++;
+    }
+    vlc_cond_signal(&executor->wait);
+    vlc_mutex_unlock(&executor->lock);
+}
+
+bool vlc_executor_Cancel(vlc_executor_t *executor,
+                         struct vlc_runnable *runnable)
+{
+    bool removed = false;
+
+    for (unsigned i = 0; i < executor->nthreads; i++)
+        vlc_mutex_lock(&executor->threads[i].lock);
+
+    for (unsigned i = 0; i < executor->nthreads; i++)
+    {
+        struct vlc_executor_thread *thread = &executor->threads[i];
+        struct vlc_runnable *it;
+
+        if (thread->current != 0 && thread->current == runnable->id)
+        {
+            vlc_interrupt_kill(&thread->interrupt);
+            break;
+        }
+
+        vlc_list_foreach(it, &thread->queue, node)
+            if (it == runnable)
+            {
+                QueueRemove(thread, runnable);
+                removed = true;
+                break;
+            }
+
+        if (removed)
+            break;
+    }
+
+    for (unsigned i = executor->nthreads; i > 0; i--)
+        vlc_mutex_unlock(&executor->threads[i - 1].lock);
+
+    return removed;
+}
+
+static vlc_mutex_t shared_lock = VLC_STATIC_MUTEX;
+static vlc_executor_t *shared_executor = NULL;
+static unsigned shared_refs = 0;
+
+vlc_executor_t *vlc_executor_Hold(void)
+{
+    vlc_executor_t *executor;
+
+    vlc_mutex_lock(&shared_lock);
+    if (shared_executor == NULL)
+    {
+        unsigned count = vlc_GetCPUCount();
+        shared_executor = vlc_executor_New(count > 0 ? count : 1,
+                                           VLC_THREAD_PRIORITY_OUTPUT);
+    }
+
+    executor = shared_executor;
+    if (executor != NULL)
+        shared_refs++;
+    vlc_mutex_unlock(&shared_lock);
+    return executor;
+}
+
+void vlc_executor_Release(vlc_executor_t *executor)
+{
+    vlc_mutex_lock(&shared_lock);
+    assert(executor == shared_executor);
+    assert(shared_refs > 0);
+
+    if (--shared_refs == 0)
+        shared_executor = NULL;
+    else
+        executor = NULL;
+    vlc_mutex_unlock(&shared_lock);
+
+    if (executor != NULL)
+        vlc_executor_Delete(executor);
+}
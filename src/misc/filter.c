@@ -25,9 +25,11 @@
 #endif
 
 #include <assert.h>
+#include <stdatomic.h>
 
 #include <vlc_common.h>
 #include <libvlc.h>
+#include <vlc_executor.h>
 #include <vlc_filter.h>
 #include <vlc_modules.h>
 #include "../misc/variables.h"
@@ -176,6 +178,77 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/* */
+
+struct filter_slices
+{
+    filter_slice_cb cb;
+    void *opaque;
+    unsigned count;
+    atomic_uint next; /**< next slice to process */
+    vlc_sem_t done; /**< posted whenever a runnable completes */
+    struct vlc_runnable runnables[FILTER_SLICES_MAX - 1];
+};
+
+static void RunSlices( struct filter_slices *sl )
+{
+    unsigned slice;
+
+    while( (slice = atomic_fetch_add( &sl->next, 1 )) < sl->count )
+        sl->cb( sl->opaque, slice, sl->count );
+}
+
+static void RunSlicesAsync( void *data )
+{
+    struct filter_slices *sl = data;
+
+    RunSlices( sl );
+    vlc_sem_post( &sl->done );
+}
+
+void filter_RunSlices( vlc_executor_t *executor, unsigned lines,
+                       unsigned min_lines, filter_slice_cb cb, void *opaque )
+{
+    unsigned count = 1;
+
+    if( executor != NULL )
+    {
+        count = __MIN( vlc_GetCPUCount(), FILTER_SLICES_MAX );
+        count = __MIN( count, lines / __MAX( min_lines, 1 ) );
+    }
+
+    if( count <= 1 )
+    {
+        cb( opaque, 0, 1 );
+        return;
+    }
+
+    struct filter_slices sl = {
+        .cb = cb,
+        .opaque = opaque,
+        .count = count,
+    };
+
+    atomic_init( &sl.next, 0 );
+    vlc_sem_init( &sl.done, 0 );
+
+    for( unsigned i = 0; i < count - 1; i++ )
+    {
+        sl.runnables[i].run = RunSlicesAsync;
+        sl.runnables[i].userdata = &sl;
+        sl.runnables[i].priority = VLC_EXECUTOR_PRIORITY_HIGH;
+        vlc_executor_Submit( executor, &sl.runnables[i] );
+    }
+
+    /* The calling thread processes slices too, until there are none left.
+     * Runnables which have not started by then are not needed anymore. */
+    RunSlices( &sl );
+    for( unsigned i = 0; i < count - 1; i++ )
+        if( !vlc_executor_Cancel( executor, &sl.runnables[i] ) )
+            vlc_sem_wait( &sl.done );
+    vlc_sem_destroy( &sl.done );
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
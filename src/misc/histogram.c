@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * histogram.c: concurrent histograms for the pipeline statistics
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include "histogram.h"
+
+void vlc_histogram_Init(vlc_histogram_t *h)
+{
+    atomic_init(&h->count, 0);
+    atomic_init(&h->total, 0);
+    atomic_init(&h->max, 0);
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS; i++)
+        atomic_init(&h->buckets[i], 0);
+}
+
+static unsigned vlc_histogram_Bucket(uintmax_t value)
+{
+    if (value == 0)
+        return 0;
+
+    /* 2^(i-1) <= value < 2^i */
+    unsigned i = 8 * sizeof (unsigned long long) - vlc_clzll(value);
+    return __MIN(i, INPUT_STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+static void vlc_histogram_Max(atomic_uintmax_t *max, uintmax_t value)
+{
+    uintmax_t cur = atomic_load_explicit(max, memory_order_relaxed);
+
+    while (value > cur
+        && !atomic_compare_exchange_weak_explicit(max, &cur, value,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed));
+}
+
+void vlc_histogram_Add(vlc_histogram_t *h, uintmax_t value)
+{
+    atomic_fetch_add_explicit(&h->buckets[vlc_histogram_Bucket(value)], 1,
+                              memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->total, value, memory_order_relaxed);
+    vlc_histogram_Max(&h->max, value);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+}
+
+static void vlc_histogram_MoveValue(atomic_uintmax_t *dst,
+                                    atomic_uintmax_t *src)
+{
+    uintmax_t value = atomic_exchange_explicit(src, 0, memory_order_relaxed);
+
+    if (value != 0)
+        atomic_fetch_add_explicit(dst, value, memory_order_relaxed);
+}
+
+void vlc_histogram_Move(vlc_histogram_t *restrict dst,
+                        vlc_histogram_t *restrict src)
+{
+    /* Most stages do not run between two moves */
+    if (atomic_load_explicit(&src->count, memory_order_relaxed) == 0)
+        return;
+
+    vlc_histogram_MoveValue(&dst->count, &src->count);
+    vlc_histogram_MoveValue(&dst->total, &src->total);
+    vlc_histogram_Max(&dst->max, atomic_exchange_explicit(&src->max, 0,
+                                                memory_order_relaxed));
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS; i++)
+        vlc_histogram_MoveValue(&dst->buckets[i], &src->buckets[i]);
+}
+
+void vlc_histogram_Get(vlc_histogram_t *h, input_stats_histogram_t *out)
+{
+    out->i_count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    out->i_total = atomic_load_explicit(&h->total, memory_order_relaxed);
+    out->i_max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS; i++)
+        out->buckets[i] = atomic_load_explicit(&h->buckets[i],
+                                               memory_order_relaxed);
+}
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ * histogram.h: concurrent histograms for the pipeline statistics
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef LIBVLC_MISC_HISTOGRAM_H
+# define LIBVLC_MISC_HISTOGRAM_H
+
+# include <stdatomic.h>
+# include <vlc_input_item.h>
+
+/**
+ * Histogram of the values measured at a stage of the pipeline
+ *
+ * Values are added lock-free by the thread running the stage, and moved or
+ * read by the statistics. The fields are atomic on their own: a reader
+ * racing with a writer may see a value in the count but not in the
+ * buckets yet, and the other way around.
+ *
+ * \see input_stats_histogram_t
+ */
+typedef struct
+{
+    atomic_uintmax_t count;
+    atomic_uintmax_t total;
+    atomic_uintmax_t max;
+    atomic_uintmax_t buckets[INPUT_STATS_HISTOGRAM_BUCKETS];
+} vlc_histogram_t;
+
+void vlc_histogram_Init(vlc_histogram_t *);
+
+void vlc_histogram_Add(vlc_histogram_t *, uintmax_t value);
+
+/**
+ * Adds a duration, in microseconds.
+ */
+static inline void vlc_histogram_AddTime(vlc_histogram_t *h, vlc_tick_t time)
+{
+    vlc_histogram_Add(h, time > 0 ? US_FROM_VLC_TICK(time) : 0);
+}
+
+/**
+ * Moves the values of a histogram to another one.
+ *
+ * The source histogram is left empty, but for the values added meanwhile.
+ */
+void vlc_histogram_Move(vlc_histogram_t *restrict dst,
+                        vlc_histogram_t *restrict src);
+
+void vlc_histogram_Get(vlc_histogram_t *, input_stats_histogram_t *);
+
+#endif
@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * ring.c: lock-free single-producer single-consumer block queue
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+/*
+ * The producer only writes the tail index, and the consumer only writes the
+ * head index. Each side publishes its index with release semantics, so that
+ * the other side sees the slot contents once it sees the index.
+ *
+ * A side which finds the ring empty (or full) raises its waiting flag, checks
+ * the ring again, and sleeps on its semaphore. The other side posts the
+ * semaphore only if it can clear the flag, so that the common case does not
+ * involve any system call. The flags and the indexes use sequentially
+ * consistent operations, so that either the sleeper sees the new index, or
+ * the waker sees the flag.
+ */
+
+#define RING_LINE 64
+
+struct block_ring_t
+{
+    /* Consumer side */
+    alignas (RING_LINE) atomic_size_t head;
+    atomic_bool reader_waiting;
+    vlc_sem_t readable;
+
+    /* Producer side */
+    alignas (RING_LINE) atomic_size_t tail;
+    atomic_bool writer_waiting;
+    vlc_sem_t writable;
+
+    alignas (RING_LINE) atomic_size_t bytes;
+    size_t mask;
+    block_t *slots[];
+};
+
+block_ring_t *block_RingNew(size_t max)
+{
+    size_t size = 1;
+
+    assert(max > 0);
+    while (size < max)
+    {
+        if (unlikely(size > SIZE_MAX / 2))
+            return NULL;
+        size *= 2;
+    }
+
+    size_t length = sizeof (block_ring_t) + size * sizeof (block_t *);
+    length = (length + RING_LINE - 1) & ~(size_t)(RING_LINE - 1);
+
+    block_ring_t *ring = aligned_alloc(RING_LINE, length);
+    if (unlikely(ring == NULL))
+        return NULL;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->reader_waiting, false);
+    vlc_sem_init(&ring->readable, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->writer_waiting, false);
+    vlc_sem_init(&ring->writable, 0);
+    atomic_init(&ring->bytes, 0);
+    ring->mask = size - 1;
+    return ring;
+}
+
+void block_RingRelease(block_ring_t *ring)
+{
+    block_t *block;
+
+    while ((block = block_RingTryGet(ring)) != NULL)
+        block_Release(block);
+
+    vlc_sem_destroy(&ring->writable);
+    vlc_sem_destroy(&ring->readable);
+    aligned_free(ring);
+}
+
+/**
+ * Wakes the other side up if it is waiting.
+ */
+static void RingWake(atomic_bool *waiting, vlc_sem_t *sem)
+{
+    if (atomic_load(waiting) && atomic_exchange(waiting, false))
+        vlc_sem_post(sem);
+}
+
+/**
+ * Puts the calling side to sleep until the other side wakes it up, unless
+ * the ring changed state in the mean time.
+ */
+static void RingSleep(block_ring_t *ring, atomic_bool *waiting,
+                      vlc_sem_t *sem, bool (*ready)(const block_ring_t *))
+{
+    atomic_store(waiting, true);
+
+    if (ready(ring))
+    {
+        /* If the flag was cleared already, a post is pending: consume it. */
+        if (!atomic_exchange(waiting, false))
+            vlc_sem_wait(sem);
+        return;
+    }
+
+    vlc_sem_wait(sem);
+}
+
+static bool RingReadable(const block_ring_t *ring)
+{
+    return atomic_load(&ring->tail) != atomic_load(&ring->head);
+}
+
+static bool RingWritable(const block_ring_t *ring)
+{
+    return atomic_load(&ring->tail) - atomic_load(&ring->head) <= ring->mask;
+}
+
+bool block_RingTryPut(block_ring_t *ring, block_t *block)
+{
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    assert(block != NULL && block->p_next == NULL);
+
+    if (tail - head > ring->mask)
+        return false; /* full */
+
+    ring->slots[tail & ring->mask] = block;
+    atomic_fetch_add_explicit(&ring->bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_store(&ring->tail, tail + 1);
+
+    RingWake(&ring->reader_waiting, &ring->readable);
+    return true;
+}
+
+void block_RingPut(block_ring_t *ring, block_t *block)
+{
+    while (!block_RingTryPut(ring, block))
+        RingSleep(ring, &ring->writer_waiting, &ring->writable,
+                  RingWritable);
+}
+
+block_t *block_RingTryGet(block_ring_t *ring)
+{
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head == tail)
+        return NULL; /* empty */
+
+    block_t *block = ring->slots[head & ring->mask];
+
+    atomic_fetch_sub_explicit(&ring->bytes, block->i_buffer,
+                              memory_order_relaxed);
+    atomic_store(&ring->head, head + 1);
+
+    RingWake(&ring->writer_waiting, &ring->writable);
+    return block;
+}
+
+block_t *block_RingGet(block_ring_t *ring)
+{
+    block_t *block;
+
+    vlc_testcancel();
+
+    while ((block = block_RingTryGet(ring)) == NULL)
+        RingSleep(ring, &ring->reader_waiting, &ring->readable,
+                  RingReadable);
+
+    return block;
+}
+
+size_t block_RingCount(const block_ring_t *ring)
+{
+    /* Load the head first: the tail cannot be behind it. */
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    return tail - head;
+}
+
+size_t block_RingSize(const block_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->bytes, memory_order_relaxed);
+}
@@ -36,9 +36,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#ifdef HAVE_SEARCH_H
-# include <search.h>
-#endif
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -51,94 +48,138 @@
 
 typedef struct vlc_modcap
 {
-    char *name;
+    const char *name;
     module_t **modv;
     size_t modc;
 } vlc_modcap_t;
 
 static int vlc_modcap_cmp(const void *a, const void *b)
 {
-    const vlc_modcap_t *capa = a, *capb = b;
-    return strcmp(capa->name, capb->name);
+    const char *name = a;
+    const vlc_modcap_t *cap = b;
+    return strcmp(name, cap->name);
 }
 
-static void vlc_modcap_free(void *data)
-{
-    vlc_modcap_t *cap = data;
-
-    free(cap->modv);
-    free(cap->name);
-    free(cap);
-}
-
-static int vlc_module_cmp (const void *a, const void *b)
+int vlc_module_cmp(const void *a, const void *b)
 {
     const module_t *const *ma = a, *const *mb = b;
+    int ret = strcmp(module_get_capability(*ma), module_get_capability(*mb));
+    if (ret != 0)
+        return ret;
     /* Note that qsort() uses _ascending_ order,
      * so the smallest module is the one with the biggest score. */
     return (*mb)->i_score - (*ma)->i_score;
 }
 
-static void vlc_modcap_sort(const void *node, const VISIT which,
-                            const int depth)
-{
-    vlc_modcap_t *const *cp = node, *cap = *cp;
-
-    if (which != postorder && which != leaf)
-        return;
-
-    qsort(cap->modv, cap->modc, sizeof (*cap->modv), vlc_module_cmp);
-    (void) depth;
-}
-
 static struct
 {
     vlc_mutex_t lock;
     block_t *caches;
-    void *caps_tree;
+    module_t **modv; /**< all modules, by capability then score */
+    vlc_modcap_t *capv; /**< capabilities, by name */
+    size_t capc;
+    module_t **sortedv; /**< modules from the plugins caches, sorted */
+    size_t sortedc;
     unsigned usage;
-} modules = { VLC_STATIC_MUTEX, NULL, NULL, 0 };
+} modules = { VLC_STATIC_MUTEX, NULL, NULL, NULL, 0, NULL, 0, 0 };
 
 vlc_plugin_t *vlc_plugins = NULL;
 
 /**
- * Adds a module to the bank
+ * Merges two tables of modules sorted by capability and score.
  */
-static int vlc_module_store(module_t *mod)
+static void vlc_module_merge(module_t **restrict modv,
+                             module_t *const *av, size_t ac,
+                             module_t *const *bv, size_t bc)
 {
-    const char *name = module_get_capability(mod);
-    vlc_modcap_t *cap = malloc(sizeof (*cap));
-    if (unlikely(cap == NULL))
-        return -1;
+    while (ac > 0 && bc > 0)
+        if (vlc_module_cmp(av, bv) <= 0)
+            *(modv++) = *(av++), ac--;
+        else
+            *(modv++) = *(bv++), bc--;
 
-    cap->name = strdup(name);
-    cap->modv = NULL;
-    cap->modc = 0;
+    while (ac-- > 0)
+        *(modv++) = *(av++);
+    while (bc-- > 0)
+        *(modv++) = *(bv++);
+}
 
-    if (unlikely(cap->name == NULL))
-        goto error;
+/**
+ * Indexes the modules of the bank by capability
+ *
+ * All modules are sorted in a single table, by capability and then by
+ * decreasing score, so that the modules for a given capability form a
+ * contiguous and ready-to-use range of the table.
+ *
+ * The modules registered from the plugins caches are already sorted, see
+ * vlc_modcap_merge(). Only the other ones are sorted here, i.e. the core and
+ * static modules, plus all the dynamic ones if there is no plugins cache.
+ */
+static void vlc_modcap_index(void)
+{
+    vlc_mutex_assert(&modules.lock);
 
-    vlc_modcap_t **cp = tsearch(cap, &modules.caps_tree, vlc_modcap_cmp);
-    if (unlikely(cp == NULL))
-        goto error;
+    size_t modc = 0, restc = 0;
+
+    for (vlc_plugin_t *lib = vlc_plugins; lib != NULL; lib = lib->next)
+    {
+        modc += lib->modules_count;
+#ifdef HAVE_DYNAMIC_PLUGINS
+        if (lib->indexed)
+            continue;
+#endif
+        restc += lib->modules_count;
+    }
+    assert(modc == restc + modules.sortedc);
+
+    module_t **modv = vlc_alloc(modc, sizeof (*modv));
+    module_t **restv = vlc_alloc(restc, sizeof (*restv));
+    vlc_modcap_t *capv = vlc_alloc(modc, sizeof (*capv));
+    size_t capc = 0;
 
-    if (*cp != cap)
+    if (unlikely(modv == NULL || capv == NULL
+              || (restv == NULL && restc > 0)))
     {
-        vlc_modcap_free(cap);
-        cap = *cp;
+        free(capv);
+        free(restv);
+        free(modv);
+        return;
     }
 
-    module_t **modv = realloc(cap->modv, sizeof (*modv) * (cap->modc + 1));
-    if (unlikely(modv == NULL))
-        return -1;
+    restc = 0;
+    for (vlc_plugin_t *lib = vlc_plugins; lib != NULL; lib = lib->next)
+    {
+#ifdef HAVE_DYNAMIC_PLUGINS
+        if (lib->indexed)
+            continue;
+#endif
+        for (module_t *m = lib->module; m != NULL; m = m->next)
+            restv[restc++] = m;
+    }
 
-    cap->modv = modv;
-    cap->modv[cap->modc] = mod;
-    cap->modc++;
-    return 0;
-error:
-    vlc_modcap_free(cap);
-    return -1;
+    qsort(restv, restc, sizeof (*restv), vlc_module_cmp);
+    vlc_module_merge(modv, modules.sortedv, modules.sortedc, restv, restc);
+    free(restv);
+
+    for (size_t i = 0; i < modc; i++)
+    {
+        const char *name = module_get_capability(modv[i]);
+
+        if (capc == 0 || strcmp(capv[capc - 1].name, name))
+        {
+            capv[capc].name = name;
+            capv[capc].modv = modv + i;
+            capv[capc].modc = 0;
+            capc++;
+        }
+        capv[capc - 1].modc++;
+    }
+
+    free(modules.capv);
+    free(modules.modv);
+    modules.modv = modv;
+    modules.capv = capv;
+    modules.capc = capc;
 }
 
 /**
@@ -150,9 +191,6 @@ static void vlc_plugin_store(vlc_plugin_t *lib)
 
     lib->next = vlc_plugins;
     vlc_plugins = lib;
-
-    for (module_t *m = lib->module; m != NULL; m = m->next)
-        vlc_module_store(m);
 }
 
 /**
@@ -195,6 +233,47 @@ static void module_InitStaticModules(void) { }
 #ifdef HAVE_DYNAMIC_PLUGINS
 static const char vlc_entry_name[] = "vlc_entry" MODULE_SUFFIX;
 
+/**
+ * Merges the capability index of a plugins cache
+ *
+ * The modules registered from a plugins cache come sorted by capability and
+ * score from the cache file. They are merged with those of the previous
+ * caches, and left out of the sort in vlc_modcap_index().
+ */
+static void vlc_modcap_merge(vlc_plugin_cache_t *cache)
+{
+    vlc_mutex_assert(&modules.lock);
+
+    size_t n;
+    module_t **run = vlc_cache_index(cache, &n);
+    if (run == NULL)
+        return;
+
+    /* The cache file may have been written by another build */
+    for (size_t i = 1; i < n; i++)
+        if (vlc_module_cmp(&run[i - 1], &run[i]) > 0)
+        {
+            free(run);
+            return;
+        }
+
+    module_t **modv = vlc_alloc(modules.sortedc + n, sizeof (*modv));
+    if (unlikely(modv == NULL))
+    {
+        free(run);
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        run[i]->plugin->indexed = true;
+
+    vlc_module_merge(modv, modules.sortedv, modules.sortedc, run, n);
+    free(run);
+    free(modules.sortedv);
+    modules.sortedv = modv;
+    modules.sortedc += n;
+}
+
 /**
  * Loads a dynamically-linked plug-in into memory and initialize it.
  *
@@ -257,7 +336,7 @@ typedef struct module_bank
 
     size_t        size;
     vlc_plugin_t **plugins;
-    vlc_plugin_t *cache;
+    vlc_plugin_cache_t *cache;
 } module_bank_t;
 
 /**
@@ -269,20 +348,8 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
     vlc_plugin_t *plugin = NULL;
 
     /* Check our plugins cache first then load plugin if needed */
-    if (bank->mode & CACHE_READ_FILE)
-    {
-        plugin = vlc_cache_lookup(&bank->cache, relpath);
-
-        if (plugin != NULL
-         && (plugin->mtime != (int64_t)st->st_mtime
-          || plugin->size != (uint64_t)st->st_size))
-        {
-            msg_Err(bank->obj, "stale plugins cache: modified %s",
-                    plugin->abspath);
-            vlc_plugin_destroy(plugin);
-            plugin = NULL;
-        }
-    }
+    if (bank->cache != NULL)
+        plugin = vlc_cache_lookup(bank->cache, relpath, st);
 
     if (plugin == NULL)
     {
@@ -417,16 +484,20 @@ static void AllocatePluginPath(vlc_object_t *obj, const char *path,
         AllocatePluginDir(&bank, 5, path, NULL);
     }
 
-    /* Deal with unmatched cache entries from cache file */
-    while (bank.cache != NULL)
+    /* Deal with unmatched cache entries from cache file: unless the
+     * directory was not scanned, they are stale and not even deserialized.
+     * Either way, plug-ins from the cache are only described when used. */
+    if (bank.cache != NULL)
     {
-        vlc_plugin_t *plugin = bank.cache;
+        if (!(mode & CACHE_SCAN_DIR))
+        {
+            vlc_plugin_t *plugin;
 
-        bank.cache = plugin->next;
-        if (mode & CACHE_SCAN_DIR)
-            vlc_plugin_destroy(plugin);
-        else
-            vlc_plugin_store(plugin);
+            while ((plugin = vlc_cache_next(bank.cache)) != NULL)
+                vlc_plugin_store(plugin);
+        }
+        vlc_modcap_merge(bank.cache);
+        vlc_cache_release(bank.cache);
     }
 
     if (mode & CACHE_WRITE_FILE)
@@ -504,6 +575,13 @@ int module_Map(vlc_object_t *obj, vlc_plugin_t *plugin)
     if (atomic_load_explicit(&plugin->handle, memory_order_acquire))
         return 0; /* fast path: already loaded */
 
+    /* The entry points names are part of the description */
+    if (module_Describe(plugin))
+    {
+        msg_Err(obj, "corrupted plugins cache entry: %s", plugin->abspath);
+        return -1;
+    }
+
     /* Try to load the plug-in (without locks, so read-only) */
     assert(plugin->abspath != NULL);
 
@@ -546,6 +624,38 @@ error:
     return -1;
 }
 
+/**
+ * Ensures that the description of a plug-in is loaded.
+ *
+ * Plug-ins registered from the plugins cache only come with their
+ * capabilities, shortcuts and configuration items names. The rest of their
+ * description is deserialized from the cache the first time it is needed.
+ *
+ * \note This function is thread-safe.
+ *
+ * \return 0 on success, -1 if the cache entry is corrupted
+ */
+int module_Describe(vlc_plugin_t *plugin)
+{
+    static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+
+    if (atomic_load_explicit(&plugin->described, memory_order_acquire))
+        return 0; /* fast path: already described */
+
+    int ret = 0;
+
+    vlc_mutex_lock(&lock);
+    if (!atomic_load_explicit(&plugin->described, memory_order_relaxed))
+    {
+        ret = vlc_cache_describe(plugin);
+        if (ret == 0)
+            atomic_store_explicit(&plugin->described, true,
+                                  memory_order_release);
+    }
+    vlc_mutex_unlock(&lock);
+    return ret;
+}
+
 /**
  * Ensures that a module is not loaded.
  *
@@ -569,6 +679,12 @@ int module_Map(vlc_object_t *obj, vlc_plugin_t *plugin)
     return 0;
 }
 
+int module_Describe(vlc_plugin_t *plugin)
+{
+    (void) plugin;
+    return 0;
+}
+
 static void module_Unmap(vlc_plugin_t *plugin)
 {
     (void) plugin;
@@ -596,6 +712,7 @@ void module_InitBank (void)
         if (likely(plugin != NULL))
             vlc_plugin_store(plugin);
         config_SortConfig ();
+        vlc_modcap_index();
     }
     modules.usage++;
 
@@ -617,7 +734,8 @@ void module_EndBank (bool b_plugins)
 {
     vlc_plugin_t *libs = NULL;
     block_t *caches = NULL;
-    void *caps_tree = NULL;
+    module_t **modv = NULL, **sortedv = NULL;
+    vlc_modcap_t *capv = NULL;
 
     /* If plugins were _not_ loaded, then the caller still has the bank lock
      * from module_InitBank(). */
@@ -632,14 +750,22 @@ void module_EndBank (bool b_plugins)
         config_UnsortConfig ();
         libs = vlc_plugins;
         caches = modules.caches;
-        caps_tree = modules.caps_tree;
+        modv = modules.modv;
+        capv = modules.capv;
+        sortedv = modules.sortedv;
         vlc_plugins = NULL;
         modules.caches = NULL;
-        modules.caps_tree = NULL;
+        modules.modv = NULL;
+        modules.capv = NULL;
+        modules.capc = 0;
+        modules.sortedv = NULL;
+        modules.sortedc = 0;
     }
     vlc_mutex_unlock (&modules.lock);
 
-    tdestroy(caps_tree, vlc_modcap_free);
+    free(sortedv);
+    free(capv);
+    free(modv);
 
     while (libs != NULL)
     {
@@ -674,7 +800,7 @@ void module_LoadPlugins(vlc_object_t *obj)
         config_UnsortConfig ();
         config_SortConfig ();
 
-        twalk(modules.caps_tree, vlc_modcap_sort);
+        vlc_modcap_index();
     }
     vlc_mutex_unlock (&modules.lock);
 
@@ -736,14 +862,14 @@ module_t **module_list_get (size_t *n)
  */
 ssize_t module_list_cap (module_t ***restrict list, const char *name)
 {
-    const vlc_modcap_t **cp = tfind(&name, &modules.caps_tree, vlc_modcap_cmp);
-    if (cp == NULL)
+    const vlc_modcap_t *cap = bsearch(name, modules.capv, modules.capc,
+                                      sizeof (*cap), vlc_modcap_cmp);
+    if (cap == NULL)
     {
         *list = NULL;
         return 0;
     }
 
-    const vlc_modcap_t *cap = *cp;
     size_t n = cap->modc;
     module_t **tab = vlc_alloc (n, sizeof (*tab));
     *list = tab;
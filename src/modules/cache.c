@@ -56,7 +56,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 35
+#define CACHE_SUBVERSION_NUM 38
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -180,14 +180,11 @@ static int vlc_cache_load_align(size_t align, block_t *file)
 
 static int vlc_cache_load_config(module_config_t *cfg, block_t *file)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
     LOAD_FLAG (cfg->b_internal);
     LOAD_FLAG (cfg->b_unsaveable);
     LOAD_FLAG (cfg->b_safe);
     LOAD_FLAG (cfg->b_removed);
     LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
     LOAD_STRING (cfg->psz_text);
     LOAD_STRING (cfg->psz_longtext);
     LOAD_IMMEDIATE (cfg->list_count);
@@ -264,13 +261,15 @@ static int vlc_cache_load_plugin_config(vlc_plugin_t *plugin, block_t *file)
 
     plugin->conf.size = lines;
 
-    /* Do the duplication job */
+    /* Only load what the configuration index and the command line parser
+     * need, the rest is in the plug-in description */
     for (size_t i = 0; i < lines; i++)
     {
         module_config_t *item = plugin->conf.items + i;
 
-        if (vlc_cache_load_config(item, file))
-            return -1;
+        LOAD_IMMEDIATE (item->i_type);
+        LOAD_IMMEDIATE (item->i_short);
+        LOAD_STRING (item->psz_name);
 
         if (CONFIG_ITEM(item->i_type))
         {
@@ -292,9 +291,8 @@ static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
     if (unlikely(module == NULL))
         return -1;
 
-    LOAD_STRING(module->psz_shortname);
-    LOAD_STRING(module->psz_longname);
-    LOAD_STRING(module->psz_help);
+    LOAD_STRING(module->psz_capability);
+    LOAD_IMMEDIATE(module->i_score);
 
     LOAD_IMMEDIATE(module->i_shortcuts);
     if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
@@ -306,22 +304,102 @@ static int vlc_cache_load_module(vlc_plugin_t *plugin, block_t *file)
         for (unsigned j = 0; j < module->i_shortcuts; j++)
             LOAD_STRING(module->pp_shortcuts[j]);
     }
+    return 0;
+error:
+    return -1;
+}
 
+static int vlc_cache_load_module_desc(module_t *module, block_t *file)
+{
+    LOAD_STRING(module->psz_shortname);
+    LOAD_STRING(module->psz_longname);
+    LOAD_STRING(module->psz_help);
     LOAD_STRING(module->activate_name);
     LOAD_STRING(module->deactivate_name);
-    LOAD_STRING(module->psz_capability);
-    LOAD_IMMEDIATE(module->i_score);
     return 0;
 error:
     return -1;
 }
 
-static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
+/**
+ * Cache entry, i.e. serialized plug-in, in the cache file
+ */
+struct vlc_cache_entry
 {
+    const char *path; /**< Relative path of the plug-in */
+    uint8_t *data; /**< Remaining serialized data after the path */
+    size_t size; /**< Size of the remaining serialized data */
+    int64_t mtime; /**< Last modification time of the plug-in */
+    uint64_t file_size; /**< File size of the plug-in */
+    uint32_t modules; /**< Number of modules */
+    size_t first; /**< Number of the first module in the cache file */
+    vlc_plugin_t *plugin; /**< Plug-in registered from the entry (or NULL) */
+    bool used; /**< Whether the entry was already returned */
+};
+
+/**
+ * Plugins cache index
+ *
+ * The cache file is not deserialized as a whole: loading it only indexes
+ * the entries by path. The index part of an entry is deserialized when it is
+ * looked up, and the description part when the plug-in is first used.
+ *
+ * The cache file also lists all its modules sorted by capability and score,
+ * so that the module bank need not sort them, see vlc_cache_index().
+ */
+struct vlc_plugin_cache
+{
+    vlc_object_t *obj;
+    char *dir;
+    const uint32_t *index; /**< Module numbers by capability and score */
+    size_t modules; /**< Number of modules */
+    size_t next; /**< Next entry for vlc_cache_next() */
+    size_t count;
+    struct vlc_cache_entry entries[];
+};
+
+/**
+ * Gets a module of a plug-in from its rank in the cache entry.
+ */
+static module_t *vlc_cache_module(const vlc_plugin_t *plugin, unsigned i)
+{
+    /* vlc_module_create() keeps the first module first, but inserts the
+     * other ones in reverse order */
+    module_t *module = plugin->module;
+
+    if (i > 0)
+        for (unsigned j = i; j < plugin->modules_count; j++)
+            module = module->next;
+    return module;
+}
+
+static vlc_plugin_t *vlc_cache_load_plugin(const struct vlc_cache_entry *entry,
+                                           const char *dir)
+{
+    block_t record = {
+        .p_buffer = entry->data,
+        .i_buffer = entry->size,
+    }, *file = &record;
+
     vlc_plugin_t *plugin = vlc_plugin_create();
     if (unlikely(plugin == NULL))
         return NULL;
 
+    plugin->path = strdup(entry->path);
+    if (unlikely(plugin->path == NULL))
+        goto error;
+
+    if (unlikely(asprintf(&plugin->abspath, "%s" DIR_SEP "%s", dir,
+                          entry->path) == -1))
+    {
+        plugin->abspath = NULL;
+        goto error;
+    }
+
+    LOAD_IMMEDIATE(plugin->mtime);
+    LOAD_IMMEDIATE(plugin->size);
+    LOAD_FLAG(plugin->unloadable);
+
     uint32_t modules;
     LOAD_IMMEDIATE(modules);
 
@@ -332,29 +410,106 @@ static vlc_plugin_t *vlc_cache_load_plugin(block_t *file)
     if (vlc_cache_load_plugin_config(plugin, file))
         goto error;
 
-    LOAD_STRING(plugin->textdomain);
+    /* The description is deserialized in place when first needed */
+    plugin->desc.data = file->p_buffer;
+    plugin->desc.size = file->i_buffer;
+    atomic_init(&plugin->described, false);
+    return plugin;
 
-    const char *path;
-    LOAD_STRING(path);
-    if (path == NULL)
-        goto error;
+error:
+    vlc_plugin_destroy(plugin);
+    return NULL;
+}
 
-    plugin->path = strdup(path);
-    if (unlikely(plugin->path == NULL))
-        goto error;
+/**
+ * Deserializes the description of a plug-in registered from the cache.
+ *
+ * This fills the module names and entry points, the configuration items
+ * details and the text domain, which are not needed to register the plug-in.
+ *
+ * \note The caller must serialize calls for a given plug-in.
+ * \return 0 on success, -1 if the cache entry is corrupted
+ */
+int vlc_cache_describe(vlc_plugin_t *plugin)
+{
+    if (plugin->desc.data == NULL)
+        return -1;
 
-    LOAD_FLAG(plugin->unloadable);
-    LOAD_IMMEDIATE(plugin->mtime);
-    LOAD_IMMEDIATE(plugin->size);
+    block_t record = {
+        .p_buffer = (uint8_t *)plugin->desc.data,
+        .i_buffer = plugin->desc.size,
+    }, *file = &record;
+
+    for (unsigned i = 0; i < plugin->modules_count; i++)
+        if (vlc_cache_load_module_desc(vlc_cache_module(plugin, i), file))
+            goto error;
+
+    for (size_t i = 0; i < plugin->conf.size; i++)
+        if (vlc_cache_load_config(plugin->conf.items + i, file))
+            goto error;
+
+    LOAD_STRING(plugin->textdomain);
 
     if (plugin->textdomain != NULL)
         vlc_bindtextdomain(plugin->textdomain);
 
-    return plugin;
+    return 0;
 
 error:
-    vlc_plugin_destroy(plugin);
-    return NULL;
+    plugin->desc.data = NULL;
+    return -1;
+}
+
+static int vlc_cache_load_entry(struct vlc_cache_entry *entry, block_t *file)
+{
+    uint32_t size;
+
+    LOAD_IMMEDIATE(size);
+
+    if (file->i_buffer < size)
+        goto error;
+
+    block_t record = {
+        .p_buffer = file->p_buffer,
+        .i_buffer = size,
+    };
+
+    file->p_buffer += size;
+    file->i_buffer -= size;
+
+    if (vlc_cache_load_string(&entry->path, &record) || entry->path == NULL)
+        goto error;
+
+    entry->data = record.p_buffer;
+    entry->size = record.i_buffer;
+    entry->plugin = NULL;
+    entry->used = false;
+
+    /* Peek at the file properties and the modules count, see
+     * vlc_cache_load_plugin() */
+    file = &record;
+    LOAD_IMMEDIATE(entry->mtime);
+    LOAD_IMMEDIATE(entry->file_size);
+    if (record.i_buffer < 1)
+        goto error;
+    record.p_buffer++;
+    record.i_buffer--;
+    LOAD_IMMEDIATE(entry->modules);
+    return 0;
+error:
+    return -1;
+}
+
+static int vlc_cache_entry_cmp(const void *a, const void *b)
+{
+    const struct vlc_cache_entry *ea = a, *eb = b;
+    return strcmp(ea->path, eb->path);
+}
+
+static int vlc_cache_entry_find(const void *key, const void *elem)
+{
+    const struct vlc_cache_entry *entry = elem;
+    return strcmp(key, entry->path);
 }
 
 /**
@@ -364,9 +519,12 @@ error:
  * will in turn be queried by AllocateAllPlugins() to see if it needs to
  * actually load the dynamically loadable module.
  * This allows us to only fully load plugins when they are actually used.
+ *
+ * Only the entries index is built here. The plug-ins are registered from the
+ * cache file when looked up, and described when used.
  */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
-                             block_t **backingp)
+vlc_plugin_cache_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
+                                   block_t **backingp)
 {
     char *psz_filename;
 
@@ -436,34 +594,63 @@ vlc_plugin_t *vlc_cache_load(vlc_object_t *p_this, const char *dir,
         return NULL;
     }
 
-    vlc_plugin_t *cache = NULL;
+    /* Index the entries */
+    uint32_t count;
+
+    if (vlc_cache_load_immediate(&count, file, sizeof (count))
+     || count > file->i_buffer / sizeof (uint32_t))
+        goto error;
 
-    while (file->i_buffer > 0)
+    vlc_plugin_cache_t *cache =
+        malloc(sizeof (*cache) + count * sizeof (cache->entries[0]));
+    if (unlikely(cache == NULL))
+        goto error;
+
+    cache->obj = p_this;
+    cache->dir = NULL;
+    cache->modules = 0;
+    cache->next = 0;
+    cache->count = count;
+
+    for (size_t i = 0; i < count; i++)
     {
-        vlc_plugin_t *plugin = vlc_cache_load_plugin(file);
-        if (plugin == NULL)
-            goto error;
+        struct vlc_cache_entry *entry = &cache->entries[i];
 
-        if (unlikely(asprintf(&plugin->abspath, "%s" DIR_SEP "%s", dir,
-                              plugin->path) == -1))
-        {
-            plugin->abspath = NULL;
-            vlc_plugin_destroy(plugin);
-            goto error;
-        }
+        if (vlc_cache_load_entry(entry, file))
+            goto error_cache;
 
-        plugin->next = cache;
-        cache = plugin;
+        entry->first = cache->modules;
+        cache->modules += entry->modules;
     }
 
+    /* Module numbers sorted by capability and score */
+    uint32_t modules;
+    const void *index;
+
+    if (vlc_cache_load_immediate(&modules, file, sizeof (modules))
+     || modules != cache->modules
+     || vlc_cache_load_align(alignof (uint32_t), file)
+     || vlc_cache_load_array(&index, sizeof (uint32_t), modules, file)
+     || file->i_buffer > 0)
+        goto error_cache;
+
+    cache->index = index;
+
+    cache->dir = strdup(dir);
+    if (unlikely(cache->dir == NULL))
+        goto error_cache;
+
+    qsort(cache->entries, count, sizeof (cache->entries[0]),
+          vlc_cache_entry_cmp);
+
     file->p_next = *backingp;
     *backingp = file;
     return cache;
 
+error_cache:
+    free(cache);
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
-
-    /* TODO: cleanup */
     block_Release(file);
     return NULL;
 }
@@ -512,14 +699,11 @@ static int CacheSaveAlign(FILE *file, size_t align)
 
 static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
     SAVE_FLAG (cfg->b_internal);
     SAVE_FLAG (cfg->b_unsaveable);
     SAVE_FLAG (cfg->b_safe);
     SAVE_FLAG (cfg->b_removed);
     SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
     SAVE_STRING (cfg->psz_text);
     SAVE_STRING (cfg->psz_longtext);
     SAVE_IMMEDIATE (cfg->list_count);
@@ -564,8 +748,13 @@ static int CacheSaveModuleConfig(FILE *file, const vlc_plugin_t *plugin)
     SAVE_IMMEDIATE (lines);
 
     for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig(file, plugin->conf.items + i))
-           goto error;
+    {
+        const module_config_t *cfg = plugin->conf.items + i;
+
+        SAVE_IMMEDIATE (cfg->i_type);
+        SAVE_IMMEDIATE (cfg->i_short);
+        SAVE_STRING (cfg->psz_name);
+    }
 
     return 0;
 error:
@@ -574,23 +763,91 @@ error:
 
 static int CacheSaveModule(FILE *file, const module_t *module)
 {
-    SAVE_STRING(module->psz_shortname);
-    SAVE_STRING(module->psz_longname);
-    SAVE_STRING(module->psz_help);
+    SAVE_STRING(module->psz_capability);
+    SAVE_IMMEDIATE(module->i_score);
     SAVE_IMMEDIATE(module->i_shortcuts);
 
     for (size_t j = 0; j < module->i_shortcuts; j++)
          SAVE_STRING(module->pp_shortcuts[j]);
+    return 0;
+error:
+    return -1;
+}
 
+static int CacheSaveModuleDesc(FILE *file, const module_t *module)
+{
+    SAVE_STRING(module->psz_shortname);
+    SAVE_STRING(module->psz_longname);
+    SAVE_STRING(module->psz_help);
     SAVE_STRING(module->activate_name);
     SAVE_STRING(module->deactivate_name);
-    SAVE_STRING(module->psz_capability);
-    SAVE_IMMEDIATE(module->i_score);
     return 0;
 error:
     return -1;
 }
 
+/**
+ * Module of the cache file, with its number
+ */
+struct vlc_cache_module
+{
+    module_t *module;
+    uint32_t num;
+};
+
+static int CacheModuleCmp(const void *a, const void *b)
+{
+    const struct vlc_cache_module *ma = a, *mb = b;
+    return vlc_module_cmp(&ma->module, &mb->module);
+}
+
+/**
+ * Saves the numbers of the modules of the cache file, sorted by capability
+ * and score as in the module bank.
+ */
+static int CacheSaveIndex(FILE *file, vlc_plugin_t *const *cache, size_t n)
+{
+    struct vlc_cache_module *modv = NULL;
+    uint32_t modc = 0;
+
+    for (size_t i = 0; i < n; i++)
+        modc += cache[i]->modules_count;
+
+    if (modc > 0)
+    {
+        modv = vlc_alloc(modc, sizeof (*modv));
+        if (unlikely(modv == NULL))
+            goto error;
+    }
+
+    /* Number the modules in the order of the entries */
+    modc = 0;
+    for (size_t i = 0; i < n; i++)
+        for (module_t *module = cache[i]->module;
+             module != NULL;
+             module = module->next)
+        {
+            modv[modc].module = module;
+            modv[modc].num = modc;
+            modc++;
+        }
+
+    if (modc > 0)
+        qsort(modv, modc, sizeof (*modv), CacheModuleCmp);
+
+    SAVE_IMMEDIATE(modc);
+    SAVE_ALIGNOF(uint32_t);
+
+    for (size_t i = 0; i < modc; i++)
+        SAVE_IMMEDIATE(modv[i].num);
+
+    free(modv);
+    return 0;
+error:
+    free(modv);
+    return -1;
+}
+
 static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
 {
     uint32_t i_file_size = 0;
@@ -614,11 +871,30 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
     if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
         goto error;
 
+    uint32_t entries = n;
+    SAVE_IMMEDIATE(entries);
+
     for (size_t i = 0; i < n; i++)
     {
         const vlc_plugin_t *plugin = cache[i];
         uint32_t count = plugin->modules_count;
 
+        /* Entry size, filled in once the entry is written */
+        long start = ftell(file);
+        uint32_t size = 0;
+
+        if (start < 0)
+            goto error;
+        SAVE_IMMEDIATE(size);
+
+        /* Save common info first, so that the entry can be looked up
+         * without deserializing it */
+        SAVE_STRING(plugin->path);
+        SAVE_IMMEDIATE(plugin->mtime);
+        SAVE_IMMEDIATE(plugin->size);
+        SAVE_FLAG(plugin->unloadable);
+
+        /* Index: what is needed to register the plug-in */
         SAVE_IMMEDIATE(count);
 
         for (module_t *module = plugin->module;
@@ -627,18 +903,38 @@ static int CacheSaveBank(FILE *file, vlc_plugin_t *const *cache, size_t n)
             if (CacheSaveModule(file, module))
                 goto error;
 
-        /* Config stuff */
         if (CacheSaveModuleConfig(file, plugin))
             goto error;
 
-        /* Save common info */
+        /* Description: what is only needed once the plug-in is used */
+        for (module_t *module = plugin->module;
+             module != NULL;
+             module = module->next)
+            if (CacheSaveModuleDesc(file, module))
+                goto error;
+
+        for (size_t j = 0; j < plugin->conf.size; j++)
+            if (CacheSaveConfig(file, plugin->conf.items + j))
+                goto error;
+
         SAVE_STRING(plugin->textdomain);
-        SAVE_STRING(plugin->path);
-        SAVE_FLAG(plugin->unloadable);
-        SAVE_IMMEDIATE(plugin->mtime);
-        SAVE_IMMEDIATE(plugin->size);
+
+        long end = ftell(file);
+        if (end < 0 || (unsigned long)(end - start) > UINT32_MAX
+         || fseek(file, start, SEEK_SET))
+            goto error;
+
+        size = end - start - sizeof (size);
+        SAVE_IMMEDIATE(size);
+        if (fseek(file, end, SEEK_SET))
+            goto error;
     }
 
+    /* Capability index: the modules numbers in the order of the entries,
+     * sorted by capability and then by decreasing score */
+    if (CacheSaveIndex(file, cache, n))
+        goto error;
+
     if (fflush (file)) /* flush libc buffers */
         goto error;
     return 0; /* success! */
@@ -696,23 +992,130 @@ out:
 
 /**
  * Looks up a plugin file in a table of cached plugins.
+ *
+ * \param st file properties of the plug-in
+ * \return the plug-in registered from the cache, or NULL if the file is
+ * not in the cache, was modified since, or was already looked up
+ * \note Only the index part of the entry is deserialized, see
+ * vlc_cache_describe().
  */
-vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **cache, const char *path)
+vlc_plugin_t *vlc_cache_lookup(vlc_plugin_cache_t *cache, const char *path,
+                               const struct stat *st)
 {
-    vlc_plugin_t **pp = cache, *plugin;
+    struct vlc_cache_entry *entry =
+        bsearch(path, cache->entries, cache->count, sizeof (*entry),
+                vlc_cache_entry_find);
+    if (entry == NULL || entry->used)
+        return NULL;
+
+    entry->used = true;
 
-    while ((plugin = *pp) != NULL)
+    if (entry->mtime != (int64_t)st->st_mtime
+     || entry->file_size != (uint64_t)st->st_size)
     {
-        if (plugin->path != NULL && !strcmp(plugin->path, path))
-        {
-            *pp = plugin->next;
-            plugin->next = NULL;
+        msg_Err(cache->obj, "stale plugins cache: modified %s"DIR_SEP"%s",
+                cache->dir, path);
+        return NULL;
+    }
+
+    vlc_plugin_t *plugin = vlc_cache_load_plugin(entry, cache->dir);
+    if (plugin == NULL)
+        msg_Warn(cache->obj, "corrupted plugins cache entry: %s", path);
+    entry->plugin = plugin;
+    return plugin;
+}
+
+/**
+ * Gets the next plugin of the cache which was not looked up yet.
+ *
+ * \return the plug-in registered from the cache, or NULL if there are none
+ * left
+ */
+vlc_plugin_t *vlc_cache_next(vlc_plugin_cache_t *cache)
+{
+    while (cache->next < cache->count)
+    {
+        struct vlc_cache_entry *entry = &cache->entries[cache->next++];
+
+        if (entry->used)
+            continue;
+
+        entry->used = true;
+
+        vlc_plugin_t *plugin = vlc_cache_load_plugin(entry, cache->dir);
+        entry->plugin = plugin;
+        if (plugin != NULL)
             return plugin;
+
+        msg_Warn(cache->obj, "corrupted plugins cache entry: %s",
+                 entry->path);
+    }
+    return NULL;
+}
+
+/**
+ * Gets the modules registered from the cache, by capability and score.
+ *
+ * The cache file lists its modules in the order of the module bank, so that
+ * the modules of the plug-ins registered from the cache need not be sorted.
+ *
+ * \note The plug-ins registered from the cache must all be in the bank.
+ * \param countp storage for the number of modules [OUT]
+ * \return a table of modules (release with free()), or NULL on error
+ */
+module_t **vlc_cache_index(vlc_plugin_cache_t *cache, size_t *restrict countp)
+{
+    const struct vlc_cache_entry **owners =
+        vlc_alloc(cache->modules, sizeof (*owners));
+    module_t **modv = vlc_alloc(cache->modules, sizeof (*modv));
+    size_t modc = 0;
+
+    if (unlikely((owners == NULL || modv == NULL) && cache->modules > 0))
+        goto error;
+
+    for (size_t i = 0; i < cache->count; i++)
+    {
+        const struct vlc_cache_entry *entry = &cache->entries[i];
+
+        for (size_t j = 0; j < entry->modules; j++)
+            owners[entry->first + j] = entry;
+    }
+
+    for (size_t i = 0; i < cache->modules; i++)
+    {
+        uint32_t num = cache->index[i];
+        const struct vlc_cache_entry *entry;
+
+        /* Each module must be listed exactly once */
+        if (num >= cache->modules || (entry = owners[num]) == NULL)
+        {
+            msg_Warn(cache->obj, "corrupted plugins cache index");
+            goto error;
         }
+        owners[num] = NULL;
 
-        pp = &plugin->next;
+        if (entry->plugin != NULL)
+            modv[modc++] = vlc_cache_module(entry->plugin, num - entry->first);
     }
 
+    free(owners);
+    *countp = modc;
+    return modv;
+error:
+    free(modv);
+    free(owners);
     return NULL;
 }
+
+/**
+ * Releases a plugins cache index.
+ *
+ * \note The plug-ins deserialized from the cache still refer to the cache
+ * file data, which is kept alive separately.
+ */
+void vlc_cache_release(vlc_plugin_cache_t *cache)
+{
+    free(cache->dir);
+    free(cache);
+}
 #endif /* HAVE_DYNAMIC_PLUGINS */
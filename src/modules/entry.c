@@ -109,6 +109,10 @@ vlc_plugin_t *vlc_plugin_create(void)
     atomic_init(&plugin->handle, 0);
     plugin->abspath = NULL;
     plugin->path = NULL;
+    plugin->desc.data = NULL;
+    plugin->desc.size = 0;
+    atomic_init(&plugin->described, true);
+    plugin->indexed = false;
 #endif
     plugin->module = NULL;
 
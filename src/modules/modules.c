@@ -76,6 +76,8 @@ const char *module_get_object( const module_t *m )
  */
 const char *module_get_name( const module_t *m, bool long_name )
 {
+    module_Describe(m->plugin);
+
     if( long_name && ( m->psz_longname != NULL) )
         return m->psz_longname;
 
@@ -92,6 +94,7 @@ const char *module_get_name( const module_t *m, bool long_name )
  */
 const char *module_get_help( const module_t *m )
 {
+    module_Describe(m->plugin);
     return m->psz_help;
 }
 
@@ -391,7 +394,7 @@ bool module_exists (const char * psz_name)
  */
 module_config_t *module_config_get( const module_t *module, unsigned *restrict psize )
 {
-    const vlc_plugin_t *plugin = module->plugin;
+    vlc_plugin_t *plugin = module->plugin;
 
     if (plugin->module != module)
     {   /* For backward compatibility, pretend non-first modules have no
@@ -400,6 +403,12 @@ module_config_t *module_config_get( const module_t *module, unsigned *restrict p
         return NULL;
     }
 
+    if (module_Describe(plugin))
+    {
+        *psize = 0;
+        return NULL;
+    }
+
     unsigned i,j;
     size_t size = plugin->conf.size;
     module_config_t *config = vlc_alloc( size, sizeof( *config ) );
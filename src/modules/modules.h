@@ -53,6 +53,17 @@ typedef struct vlc_plugin_t
     char *path; /**< Relative path (within plug-in directory) */
     int64_t mtime; /**< Last modification time */
     uint64_t size; /**< File size */
+
+    /**
+     * Serialized description in the plugins cache, if not loaded yet
+     */
+    struct
+    {
+        const void *data; /**< Start of the description (or NULL) */
+        size_t size; /**< Size of the description */
+    } desc;
+    atomic_bool described; /**< Whether the description is loaded */
+    bool indexed; /**< Whether the modules are in a cached capability index */
 #endif
 } vlc_plugin_t;
 
@@ -111,8 +122,10 @@ void module_LoadPlugins(vlc_object_t *);
 #define module_LoadPlugins(a) module_LoadPlugins(VLC_OBJECT(a))
 void module_EndBank (bool);
 int module_Map(vlc_object_t *, vlc_plugin_t *);
+int module_Describe(vlc_plugin_t *);
 
 ssize_t module_list_cap (module_t ***, const char *);
+int vlc_module_cmp(const void *, const void *);
 
 int vlc_bindtextdomain (const char *);
 
@@ -161,8 +174,17 @@ void *vlc_dlsym(void *handle, const char *) VLC_USED;
 char *vlc_dlerror(void) VLC_USED;
 
 /* Plugins cache */
-vlc_plugin_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
-vlc_plugin_t *vlc_cache_lookup(vlc_plugin_t **, const char *relpath);
+typedef struct vlc_plugin_cache vlc_plugin_cache_t;
+
+struct stat;
+
+vlc_plugin_cache_t *vlc_cache_load(vlc_object_t *, const char *, block_t **);
+vlc_plugin_t *vlc_cache_lookup(vlc_plugin_cache_t *, const char *relpath,
+                               const struct stat *);
+vlc_plugin_t *vlc_cache_next(vlc_plugin_cache_t *);
+module_t **vlc_cache_index(vlc_plugin_cache_t *, size_t *);
+int vlc_cache_describe(vlc_plugin_t *);
+void vlc_cache_release(vlc_plugin_cache_t *);
 
 void CacheSave(vlc_object_t *, const char *, vlc_plugin_t *const *, size_t);
 
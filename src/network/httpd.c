@@ -42,6 +42,7 @@
 #include <vlc_url.h>
 #include <vlc_mime.h>
 #include <vlc_block.h>
+#include <vlc_atomic.h>
 #include "../libvlc.h"
 
 #include <string.h>
@@ -54,6 +55,12 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+# ifndef EPOLLEXCLUSIVE
+#  define EPOLLEXCLUSIVE 0
+# endif
+#endif
 
 #if defined(_WIN32)
 #   include <winsock2.h>
@@ -68,10 +75,30 @@
 #define HTTPD_CL_BUFSIZE 10000
 #endif
 
+/* maximum number of stream chunks sent with a single gather write */
+#define HTTPD_CL_IOVMAX 64
+
+/* maximum number of events handled per epoll_wait() call */
+#define HTTPD_EPOLL_EVENTS 64
+
 static void httpd_ClientDestroy(httpd_client_t *cl);
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data);
 
-/* each host run in his own thread */
+/* Each worker thread serves its own share of the host clients */
+typedef struct httpd_worker_t
+{
+    httpd_host_t *host;
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+
+    size_t client_count;
+    struct vlc_list clients;
+
+#ifdef HAVE_SYS_EPOLL_H
+    int epfd;
+#endif
+} httpd_worker_t;
+
+/* each host run in its own worker threads */
 struct httpd_host_t
 {
     struct vlc_common_members obj;
@@ -85,7 +112,6 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
@@ -95,8 +121,9 @@ struct httpd_host_t
      * */
     struct vlc_list urls;
 
-    size_t client_count;
-    struct vlc_list clients;
+    /* client threads, accepting connections from the same sockets */
+    httpd_worker_t *workers;
+    unsigned        i_workers;
 
     /* TLS data */
     vlc_tls_server_t *p_tls;
@@ -137,6 +164,22 @@ enum
     HTTPD_CLIENT_TLS_HS_OUT
 };
 
+/* Immutable piece of stream data, shared by all clients of a stream */
+typedef struct httpd_stream_chunk_t
+{
+    vlc_atomic_rc_t rc;
+    struct vlc_list node;   /* in httpd_stream_t.chunks, under its lock */
+    int64_t i_pos;          /* absolute position of the first byte */
+    size_t  i_size;
+    uint8_t p_data[];
+} httpd_stream_chunk_t;
+
+static void httpd_StreamChunkRelease(httpd_stream_chunk_t *chunk)
+{
+    if (vlc_atomic_rc_dec(&chunk->rc))
+        free(chunk);
+}
+
 struct httpd_client_t
 {
     httpd_url_t *url;
@@ -150,6 +193,10 @@ struct httpd_client_t
     vlc_tick_t i_activity_date;
     vlc_tick_t i_activity_timeout;
 
+#ifdef HAVE_SYS_EPOLL_H
+    short   i_poll_events;  /* events registered with the worker epoll */
+#endif
+
     /* buffer for reading header */
     int     i_buffer_size;
     int     i_buffer;
@@ -162,6 +209,11 @@ struct httpd_client_t
      */
     int64_t i_keyframe_wait_to_pass;
 
+    /* stream chunks to send, the first one from i_chunk_offset */
+    httpd_stream_chunk_t *p_chunks[HTTPD_CL_IOVMAX];
+    unsigned i_chunks;
+    size_t   i_chunk_offset;
+
     /* */
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
@@ -607,9 +659,11 @@ struct httpd_stream_t
     bool        b_has_keyframes;
     int64_t     i_last_keyframe_seen_pos;
 
-    /* circular buffer */
-    int         i_buffer_size;      /* buffer size, can't be reallocated smaller */
-    uint8_t     *p_buffer;          /* buffer */
+    /* Data chunks, oldest first. Clients reference the chunks they are
+     * sending, so that data is never copied per client. */
+    struct vlc_list chunks;
+    size_t      i_chunks_size;      /* bytes held in chunks */
+    size_t      i_buffer_size;      /* bytes kept for late clients */
     int64_t     i_buffer_pos;       /* absolute position from beginning */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
 
@@ -628,47 +682,59 @@ static int httpd_StreamCallBack(httpd_callback_sys_t *p_sys,
         return VLC_SUCCESS;
 
     if (answer->i_body_offset > 0) {
-        int     i_pos;
-
+        vlc_mutex_lock(&stream->lock);
         if (answer->i_body_offset >= stream->i_buffer_pos)
-            return VLC_EGENERIC;    /* wait, no data available */
+            goto wait;  /* no data available */
 
         if (cl->i_keyframe_wait_to_pass >= 0) {
             if (stream->i_last_keyframe_seen_pos <= cl->i_keyframe_wait_to_pass)
                 /* still waiting for the next keyframe */
-                return VLC_EGENERIC;
+                goto wait;
 
             /* seek to the new keyframe */
             answer->i_body_offset = stream->i_last_keyframe_seen_pos;
             cl->i_keyframe_wait_to_pass = -1;
         }
 
-        if (answer->i_body_offset + stream->i_buffer_size < stream->i_buffer_pos)
+        httpd_stream_chunk_t *chunk =
+            vlc_list_first_entry_or_null(&stream->chunks,
+                                         httpd_stream_chunk_t, node);
+        assert(chunk != NULL);
+        if (answer->i_body_offset < chunk->i_pos)
             answer->i_body_offset = stream->i_buffer_last_pos; /* this client isn't fast enough */
 
-        i_pos   = answer->i_body_offset % stream->i_buffer_size;
-        int64_t i_write = stream->i_buffer_pos - answer->i_body_offset;
-
-        if (i_write > HTTPD_CL_BUFSIZE)
-            i_write = HTTPD_CL_BUFSIZE;
-        else if (i_write <= 0)
-            return VLC_EGENERIC;    /* wait, no data available */
-
-        /* Don't go past the end of the circular buffer */
-        i_write = __MIN(i_write, stream->i_buffer_size - i_pos);
+        /* Clients are usually close to the live edge: look up backward */
+        chunk = vlc_list_last_entry_or_null(&stream->chunks,
+                                            httpd_stream_chunk_t, node);
+        while (chunk->i_pos > answer->i_body_offset)
+            chunk = vlc_list_prev_entry_or_null(&stream->chunks, chunk,
+                                                httpd_stream_chunk_t, node);
+
+        assert(cl->i_chunks == 0);
+        cl->i_chunk_offset = answer->i_body_offset - chunk->i_pos;
+
+        size_t i_write = 0;
+        do {
+            vlc_atomic_rc_inc(&chunk->rc);
+            cl->p_chunks[cl->i_chunks++] = chunk;
+            i_write += chunk->i_size;
+            chunk = vlc_list_next_entry_or_null(&stream->chunks, chunk,
+                                                httpd_stream_chunk_t, node);
+        } while (chunk != NULL && cl->i_chunks < HTTPD_CL_IOVMAX
+              && i_write - cl->i_chunk_offset < HTTPD_CL_BUFSIZE);
+        vlc_mutex_unlock(&stream->lock);
 
         /* using HTTPD_MSG_ANSWER -> data available */
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
         answer->i_type   = HTTPD_MSG_ANSWER;
 
-        answer->i_body = i_write;
-        answer->p_body = xmalloc(i_write);
-        memcpy(answer->p_body, &stream->p_buffer[i_pos], i_write);
-
-        answer->i_body_offset += i_write;
+        answer->i_body_offset += i_write - cl->i_chunk_offset;
 
         return VLC_SUCCESS;
+wait:
+        vlc_mutex_unlock(&stream->lock);
+        return VLC_EGENERIC;
     } else {
         answer->i_proto  = HTTPD_PROTO_HTTP;
         answer->i_version= 0;
@@ -764,8 +830,9 @@ httpd_stream_t *httpd_StreamNew(httpd_host_t *host,
 
     stream->i_header = 0;
     stream->p_header = NULL;
+    vlc_list_init(&stream->chunks);
+    stream->i_chunks_size = 0;
     stream->i_buffer_size = 5000000;    /* 5 Mo per stream */
-    stream->p_buffer = xmalloc(stream->i_buffer_size);
     /* We set to 1 to make life simpler
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
@@ -801,29 +868,19 @@ int httpd_StreamHeader(httpd_stream_t *stream, uint8_t *p_data, int i_data)
     return VLC_SUCCESS;
 }
 
-static void httpd_AppendData(httpd_stream_t *stream, uint8_t *p_data, int i_data)
-{
-    int i_pos = stream->i_buffer_pos % stream->i_buffer_size;
-    int i_count = i_data;
-    while (i_count > 0) {
-        int i_copy = __MIN(i_count, stream->i_buffer_size - i_pos);
-
-        /* Ok, we can't go past the end of our buffer */
-        memcpy(&stream->p_buffer[i_pos], p_data, i_copy);
-
-        i_pos = (i_pos + i_copy) % stream->i_buffer_size;
-        i_count -= i_copy;
-        p_data  += i_copy;
-    }
-
-    stream->i_buffer_pos += i_data;
-}
-
 int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
 {
-    if (!p_block || !p_block->p_buffer)
+    if (!p_block || !p_block->p_buffer || p_block->i_buffer == 0)
         return VLC_SUCCESS;
 
+    httpd_stream_chunk_t *chunk = malloc(sizeof(*chunk) + p_block->i_buffer);
+    if (unlikely(chunk == NULL))
+        return VLC_ENOMEM;
+
+    vlc_atomic_rc_init(&chunk->rc);
+    chunk->i_size = p_block->i_buffer;
+    memcpy(chunk->p_data, p_block->p_buffer, p_block->i_buffer);
+
     vlc_mutex_lock(&stream->lock);
 
     /* save this pointer (to be used by new connection) */
@@ -834,7 +891,23 @@ int httpd_StreamSend(httpd_stream_t *stream, const block_t *p_block)
         stream->i_last_keyframe_seen_pos = stream->i_buffer_pos;
     }
 
-    httpd_AppendData(stream, p_block->p_buffer, p_block->i_buffer);
+    chunk->i_pos = stream->i_buffer_pos;
+    vlc_list_append(&chunk->node, &stream->chunks);
+    stream->i_chunks_size += chunk->i_size;
+    stream->i_buffer_pos += chunk->i_size;
+
+    /* Forget the oldest data; clients still sending it hold a reference */
+    while (stream->i_chunks_size > stream->i_buffer_size) {
+        httpd_stream_chunk_t *first =
+            vlc_list_first_entry_or_null(&stream->chunks,
+                                         httpd_stream_chunk_t, node);
+        if (first == chunk)
+            break;
+
+        vlc_list_remove(&first->node);
+        stream->i_chunks_size -= first->i_size;
+        httpd_StreamChunkRelease(first);
+    }
 
     vlc_mutex_unlock(&stream->lock);
     return VLC_SUCCESS;
@@ -851,7 +924,10 @@ void httpd_StreamDelete(httpd_stream_t *stream)
     vlc_mutex_destroy(&stream->lock);
     free(stream->psz_mime);
     free(stream->p_header);
-    free(stream->p_buffer);
+
+    httpd_stream_chunk_t *chunk;
+    vlc_list_foreach(chunk, &stream->chunks, node)
+        httpd_StreamChunkRelease(chunk);
     free(stream);
 }
 
@@ -859,6 +935,8 @@ void httpd_StreamDelete(httpd_stream_t *stream)
  * Low level
  *****************************************************************************/
 static void* httpd_HostThread(void *);
+static int httpd_WorkerStart(httpd_host_t *, httpd_worker_t *);
+static void httpd_WorkerStop(httpd_worker_t *);
 static httpd_host_t *httpd_HostCreate(vlc_object_t *, const char *,
                                        const char *, vlc_tls_server_t *);
 
@@ -938,6 +1016,16 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
     vlc_mutex_init(&host->lock);
     vlc_cond_init(&host->wait);
     atomic_init(&host->ref, 1);
+    host->i_workers = 0;
+
+    unsigned i_threads = var_InheritInteger(p_this, "http-threads");
+    if (i_threads < 1)
+        i_threads = 1;
+    host->workers = vlc_alloc(i_threads, sizeof (*host->workers));
+    if (unlikely(host->workers == NULL)) {
+        host->fds = NULL;
+        goto error;
+    }
 
     char *hostname = var_InheritString(p_this, hostvar);
 
@@ -952,13 +1040,14 @@ static httpd_host_t *httpd_HostCreate(vlc_object_t *p_this,
 
     host->port     = port;
     vlc_list_init(&host->urls);
-    host->client_count = 0;
-    vlc_list_init(&host->clients);
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if (vlc_clone(&host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW)) {
+    /* create the threads */
+    while (host->i_workers < i_threads
+        && httpd_WorkerStart(host, &host->workers[host->i_workers]) == 0)
+        host->i_workers++;
+
+    if (host->i_workers == 0) {
         msg_Err(p_this, "cannot spawn http host thread");
         goto error;
     }
@@ -974,6 +1063,7 @@ error:
 
     if (host) {
         net_ListenClose(host->fds);
+        free(host->workers);
         vlc_cond_destroy(&host->wait);
         vlc_mutex_destroy(&host->lock);
         vlc_object_release(host);
@@ -986,8 +1076,6 @@ error:
 /* delete a host */
 void httpd_HostDelete(httpd_host_t *host)
 {
-    httpd_client_t *client;
-
     vlc_mutex_lock(&httpd.mutex);
 
     if (atomic_fetch_sub_explicit(&host->ref, 1, memory_order_relaxed) > 1) {
@@ -998,16 +1086,14 @@ void httpd_HostDelete(httpd_host_t *host)
     }
 
     vlc_list_remove(&host->node);
-    vlc_cancel(host->thread);
-    vlc_join(host->thread, NULL);
+    for (unsigned i = 0; i < host->i_workers; i++)
+        vlc_cancel(host->workers[i].thread);
+    for (unsigned i = 0; i < host->i_workers; i++)
+        httpd_WorkerStop(&host->workers[i]);
+    free(host->workers);
 
     msg_Dbg(host, "HTTP host removed");
 
-    vlc_list_foreach(client, &host->clients, node) {
-        msg_Warn(host, "client still connected");
-        httpd_ClientDestroy(client);
-    }
-
     assert(vlc_list_is_empty(&host->urls));
     vlc_tls_ServerDelete(host->p_tls);
     net_ListenClose(host->fds);
@@ -1051,7 +1137,7 @@ httpd_url_t *httpd_UrlNew(httpd_host_t *host, const char *psz_url,
     }
 
     vlc_list_append(&url->node, &host->urls);
-    vlc_cond_signal(&host->wait);
+    vlc_cond_broadcast(&host->wait);
     vlc_mutex_unlock(&host->lock);
 
     return url;
@@ -1077,23 +1163,31 @@ void httpd_UrlDelete(httpd_url_t *url)
 
     vlc_mutex_lock(&host->lock);
     vlc_list_remove(&url->node);
+    vlc_mutex_unlock(&host->lock);
+
+    for (unsigned i = 0; i < host->i_workers; i++) {
+        httpd_worker_t *worker = &host->workers[i];
+
+        vlc_mutex_lock(&worker->lock);
+        vlc_list_foreach(client, &worker->clients, node) {
+            if (client->url != url)
+                continue;
+
+            /* TODO complete it */
+            msg_Warn(host, "force closing connections");
+            /* The worker destroys the client once woken up by the shutdown */
+            client->url = NULL;
+            client->i_state = HTTPD_CLIENT_DEAD;
+            vlc_tls_Shutdown(client->sock, true);
+        }
+        vlc_mutex_unlock(&worker->lock);
+    }
 
     vlc_mutex_destroy(&url->lock);
     free(url->psz_url);
     free(url->psz_user);
     free(url->psz_password);
-
-    vlc_list_foreach(client, &host->clients, node) {
-        if (client->url != url)
-            continue;
-
-        /* TODO complete it */
-        msg_Warn(host, "force closing connections");
-        host->client_count--;
-        httpd_ClientDestroy(client);
-    }
     free(url);
-    vlc_mutex_unlock(&host->lock);
 }
 
 static void httpd_MsgInit(httpd_message_t *msg)
@@ -1174,7 +1268,12 @@ static void httpd_ClientInit(httpd_client_t *cl, vlc_tick_t now)
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc(cl->i_buffer_size);
     cl->i_keyframe_wait_to_pass = -1;
+    cl->i_chunks = 0;
+    cl->i_chunk_offset = 0;
     cl->b_stream_mode = false;
+#ifdef HAVE_SYS_EPOLL_H
+    cl->i_poll_events = 0;
+#endif
 
     httpd_MsgInit(&cl->query);
     httpd_MsgInit(&cl->answer);
@@ -1197,6 +1296,8 @@ static void httpd_ClientDestroy(httpd_client_t *cl)
     httpd_MsgClean(&cl->answer);
     httpd_MsgClean(&cl->query);
 
+    for (unsigned i = 0; i < cl->i_chunks; i++)
+        httpd_StreamChunkRelease(cl->p_chunks[i]);
     free(cl->p_buffer);
     free(cl);
 }
@@ -1230,6 +1331,40 @@ ssize_t httpd_NetSend (httpd_client_t *cl, const uint8_t *p, size_t i_len)
     return sock->ops->writev(sock, &iov, 1);
 }
 
+static
+ssize_t httpd_NetSendChunks(httpd_client_t *cl)
+{
+    vlc_tls_t *sock = cl->sock;
+    struct iovec iov[HTTPD_CL_IOVMAX];
+    size_t i_offset = cl->i_chunk_offset;
+
+    for (unsigned i = 0; i < cl->i_chunks; i++) {
+        iov[i].iov_base = cl->p_chunks[i]->p_data + i_offset;
+        iov[i].iov_len = cl->p_chunks[i]->i_size - i_offset;
+        i_offset = 0;
+    }
+
+    ssize_t i_len = sock->ops->writev(sock, iov, cl->i_chunks);
+    if (i_len <= 0)
+        return i_len;
+
+    /* Release the chunks that were sent completely */
+    size_t i_sent = cl->i_chunk_offset + i_len;
+    unsigned i_done = 0;
+
+    while (i_done < cl->i_chunks && i_sent >= cl->p_chunks[i_done]->i_size) {
+        i_sent -= cl->p_chunks[i_done]->i_size;
+        httpd_StreamChunkRelease(cl->p_chunks[i_done]);
+        i_done++;
+    }
+
+    cl->i_chunks -= i_done;
+    memmove(cl->p_chunks, cl->p_chunks + i_done,
+            cl->i_chunks * sizeof (cl->p_chunks[0]));
+    cl->i_chunk_offset = i_sent;
+    return i_len;
+}
+
 
 static const struct
 {
@@ -1539,7 +1674,7 @@ static void httpd_ClientRecv(httpd_client_t *cl)
 
 static void httpd_ClientSend(httpd_client_t *cl)
 {
-    int i_len;
+    ssize_t i_len;
 
     if (cl->i_buffer < 0) {
         /* We need to create the header */
@@ -1572,12 +1707,16 @@ static void httpd_ClientSend(httpd_client_t *cl)
         cl->i_buffer_size = (uint8_t*)p - cl->p_buffer;
     }
 
-    i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
-                           cl->i_buffer_size - cl->i_buffer);
+    if (cl->i_chunks > 0)
+        i_len = httpd_NetSendChunks(cl);
+    else {
+        i_len = httpd_NetSend(cl, &cl->p_buffer[cl->i_buffer],
+                               cl->i_buffer_size - cl->i_buffer);
+        if (i_len > 0)
+            cl->i_buffer += i_len;
+    }
     if (i_len >= 0) {
-        cl->i_buffer += i_len;
-
-        if (cl->i_buffer >= cl->i_buffer_size) {
+        if (cl->i_chunks == 0 && cl->i_buffer >= cl->i_buffer_size) {
             if (cl->answer.i_body == 0  && cl->answer.i_body_offset > 0) {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
@@ -1599,7 +1738,7 @@ static void httpd_ClientSend(httpd_client_t *cl)
 
                 cl->answer.i_body = 0;
                 cl->answer.p_body = NULL;
-            } else /* send finished */
+            } else if (cl->i_chunks == 0) /* send finished */
                 cl->i_state = HTTPD_CLIENT_SEND_DONE;
         }
     } else {
@@ -1666,54 +1805,105 @@ auth_failed:
     return false;
 }
 
-static void httpdLoop(httpd_host_t *host)
+#ifdef HAVE_SYS_EPOLL_H
+/* Updates the persistent epoll registration of a client */
+static int httpd_ClientWatch(httpd_worker_t *worker, httpd_client_t *cl,
+                             int fd, short events)
+{
+    if (events == cl->i_poll_events)
+        return 0;
+
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
+    int op;
+
+    if (events & POLLIN)
+        ev.events |= EPOLLIN;
+    if (events & POLLOUT)
+        ev.events |= EPOLLOUT;
+
+    if (events == 0)
+        op = EPOLL_CTL_DEL;
+    else if (cl->i_poll_events == 0)
+        op = EPOLL_CTL_ADD;
+    else
+        op = EPOLL_CTL_MOD;
+
+    if (epoll_ctl(worker->epfd, op, fd, &ev))
+        return -1;
+
+    cl->i_poll_events = events;
+    return 0;
+}
+#endif
+
+static void httpd_ClientEvent(httpd_host_t *host, httpd_client_t *cl,
+                              vlc_tick_t now)
+{
+    cl->i_activity_date = now;
+
+    switch (cl->i_state) {
+        case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
+        case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake(host, cl);
+            break;
+    }
+}
+
+static void httpdLoop(httpd_worker_t *worker)
 {
-    struct pollfd ufd[host->nfd + host->client_count];
+    httpd_host_t *host = worker->host;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev[HTTPD_EPOLL_EVENTS];
+    int nev;
+    unsigned nfd;
+#else
+    struct pollfd ufd[host->nfd + worker->client_count];
     unsigned nfd;
     for (nfd = 0; nfd < host->nfd; nfd++) {
         ufd[nfd].fd = host->fds[nfd];
         ufd[nfd].events = POLLIN;
         ufd[nfd].revents = 0;
     }
+#endif
 
     vlc_mutex_lock(&host->lock);
-    /* add all socket that should be read/write and close dead connection */
     while (vlc_list_is_empty(&host->urls)) {
         mutex_cleanup_push(&host->lock);
         vlc_cond_wait(&host->wait, &host->lock);
         vlc_cleanup_pop();
     }
+    vlc_mutex_unlock(&host->lock);
 
     vlc_tick_t now = vlc_tick_now();
     bool b_low_delay = false;
     httpd_client_t *cl;
 
+    /* add all socket that should be read/write and close dead connection */
+    vlc_mutex_lock(&worker->lock);
     int canc = vlc_savecancel();
-    vlc_list_foreach(cl, &host->clients, node) {
+    vlc_list_foreach(cl, &worker->clients, node) {
         int64_t i_offset;
+        short events = 0;
 
         if (cl->i_state == HTTPD_CLIENT_DEAD
          || (cl->i_activity_timeout > 0
           && cl->i_activity_date + cl->i_activity_timeout < now)) {
-            host->client_count--;
+            worker->client_count--;
             httpd_ClientDestroy(cl);
             continue;
         }
 
-        struct pollfd *pufd = ufd + nfd;
-        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-        pufd->events = pufd->revents = 0;
-
         switch (cl->i_state) {
             case HTTPD_CLIENT_RECEIVING:
             case HTTPD_CLIENT_TLS_HS_IN:
-                pufd->events = POLLIN;
+                events = POLLIN;
                 break;
 
             case HTTPD_CLIENT_SENDING:
             case HTTPD_CLIENT_TLS_HS_OUT:
-                pufd->events = POLLOUT;
+                events = POLLOUT;
                 break;
 
             case HTTPD_CLIENT_RECEIVE_DONE: {
@@ -1802,6 +1992,7 @@ static void httpdLoop(httpd_host_t *host)
                         bool b_auth_failed = false;
 
                         /* Search the url and trigger callbacks */
+                        vlc_mutex_lock(&host->lock);
                         vlc_list_foreach(url, &host->urls, node) {
                             if (strcmp(url->psz_url, query->psz_url))
                                 continue;
@@ -1829,6 +2020,7 @@ static void httpdLoop(httpd_host_t *host)
                             if (!cl->url)
                                 cl->url = url;
                         }
+                        vlc_mutex_unlock(&host->lock);
 
                         if (answer) {
                             answer->i_proto  = query->i_proto;
@@ -1924,31 +2116,61 @@ static void httpdLoop(httpd_host_t *host)
                 }
         }
 
-        pufd->fd = vlc_tls_GetPollFD(cl->sock, &pufd->events);
+        int fd = vlc_tls_GetPollFD(cl->sock, &events);
+#ifdef HAVE_SYS_EPOLL_H
+        if (httpd_ClientWatch(worker, cl, fd, events)) {
+            cl->i_state = HTTPD_CLIENT_DEAD;
+            events = 0;
+        }
+#else
+        struct pollfd *pufd = ufd + nfd;
+        assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
 
-        if (pufd->events != 0)
+        pufd->fd = fd;
+        pufd->events = events;
+        pufd->revents = 0;
+        if (events != 0)
             nfd++;
-        else
+#endif
+        if (events == 0)
             b_low_delay = true;
     }
-    vlc_mutex_unlock(&host->lock);
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 
     /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
+#ifdef HAVE_SYS_EPOLL_H
+    while ((nev = epoll_wait(worker->epfd, ev, ARRAY_SIZE(ev),
+                             b_low_delay ? 20 : -1)) < 0)
+#else
     while (poll(ufd, nfd, b_low_delay ? 20 : -1) < 0)
+#endif
     {
         if (errno != EINTR)
             msg_Err(host, "polling error: %s", vlc_strerror_c(errno));
     }
 
     canc = vlc_savecancel();
-    vlc_mutex_lock(&host->lock);
+    vlc_mutex_lock(&worker->lock);
 
     /* Handle client sockets */
     now = vlc_tick_now();
+
+#ifdef HAVE_SYS_EPOLL_H
+    bool b_accept = false;
+
+    /* Clients are only destroyed by this thread, before waiting */
+    for (int i = 0; i < nev; i++) {
+        cl = ev[i].data.ptr;
+        if (cl == NULL)
+            b_accept = true; /* listening socket */
+        else
+            httpd_ClientEvent(host, cl, now);
+    }
+#else
     nfd = host->nfd;
 
-    vlc_list_foreach(cl, &host->clients, node) {
+    vlc_list_foreach(cl, &worker->clients, node) {
         const struct pollfd *pufd = &ufd[nfd];
 
         assert(pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])]);
@@ -1959,26 +2181,24 @@ static void httpdLoop(httpd_host_t *host)
         if (pufd->revents == 0)
             continue; // no event received
 
-        cl->i_activity_date = now;
-
-        switch (cl->i_state) {
-            case HTTPD_CLIENT_RECEIVING: httpd_ClientRecv(cl); break;
-            case HTTPD_CLIENT_SENDING:   httpd_ClientSend(cl); break;
-            case HTTPD_CLIENT_TLS_HS_IN:
-            case HTTPD_CLIENT_TLS_HS_OUT:
-                httpd_ClientTlsHandshake(host, cl);
-                break;
-        }
+        httpd_ClientEvent(host, cl, now);
     }
+#endif
 
     /* Handle server sockets (accept new connections) */
     for (nfd = 0; nfd < host->nfd; nfd++) {
-        int fd = ufd[nfd].fd;
+        int fd = host->fds[nfd];
 
-        assert (fd == host->fds[nfd]);
+#ifdef HAVE_SYS_EPOLL_H
+        /* Another worker may have accepted the connection already */
+        if (!b_accept)
+            break;
+#else
+        assert (fd == ufd[nfd].fd);
 
         if (ufd[nfd].revents == 0)
             continue;
+#endif
 
         /* */
         fd = vlc_accept (fd, NULL, NULL, true);
@@ -2013,23 +2233,80 @@ static void httpdLoop(httpd_host_t *host)
         if (host->p_tls != NULL)
             cl->i_state = HTTPD_CLIENT_TLS_HS_OUT;
 
-        host->client_count++;
-        vlc_list_append(&cl->node, &host->clients);
+        worker->client_count++;
+        vlc_list_append(&cl->node, &worker->clients);
     }
 
-    vlc_mutex_unlock(&host->lock);
+    vlc_mutex_unlock(&worker->lock);
     vlc_restorecancel(canc);
 }
 
 static void* httpd_HostThread(void *data)
 {
-    httpd_host_t *host = data;
+    httpd_worker_t *worker = data;
+    httpd_host_t *host = worker->host;
 
     while (atomic_load_explicit(&host->ref, memory_order_relaxed) > 0)
-        httpdLoop(host);
+        httpdLoop(worker);
     return NULL;
 }
 
+static int httpd_WorkerStart(httpd_host_t *host, httpd_worker_t *worker)
+{
+    worker->host = host;
+    vlc_mutex_init(&worker->lock);
+    worker->client_count = 0;
+    vlc_list_init(&worker->clients);
+
+#ifdef HAVE_SYS_EPOLL_H
+    worker->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (worker->epfd == -1)
+        goto error;
+
+    /* All workers watch the listening sockets, but only one is woken up
+     * for each incoming connection (if EPOLLEXCLUSIVE is supported). */
+    for (unsigned i = 0; i < host->nfd; i++) {
+        struct epoll_event ev = {
+            .events = EPOLLIN | EPOLLEXCLUSIVE,
+            .data.ptr = NULL,
+        };
+
+        if (epoll_ctl(worker->epfd, EPOLL_CTL_ADD, host->fds[i], &ev))
+            goto error;
+    }
+#endif
+
+    if (vlc_clone(&worker->thread, httpd_HostThread, worker,
+                  VLC_THREAD_PRIORITY_LOW))
+        goto error;
+    return 0;
+
+error:
+#ifdef HAVE_SYS_EPOLL_H
+    if (worker->epfd != -1)
+        vlc_close(worker->epfd);
+#endif
+    vlc_mutex_destroy(&worker->lock);
+    return -1;
+}
+
+static void httpd_WorkerStop(httpd_worker_t *worker)
+{
+    httpd_client_t *client;
+
+    vlc_join(worker->thread, NULL);
+
+    vlc_list_foreach(client, &worker->clients, node) {
+        msg_Warn(worker->host, "client still connected");
+        httpd_ClientDestroy(client);
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    vlc_close(worker->epfd);
+#endif
+    vlc_mutex_destroy(&worker->lock);
+}
+
 int httpd_StreamSetHTTPHeaders(httpd_stream_t * p_stream,
                                const httpd_header *p_headers, size_t i_headers)
 {
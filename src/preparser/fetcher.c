@@ -26,6 +26,7 @@
 #include <vlc_atomic.h>
 #include <vlc_stream.h>
 #include <vlc_modules.h>
+#include <vlc_executor.h>
 #include <vlc_interrupt.h>
 #include <vlc_arrays.h>
 #include <vlc_threads.h>
@@ -37,7 +38,6 @@
 #include "fetcher.h"
 #include "input/input_interface.h"
 #include "misc/background_worker.h"
-#include "misc/interrupt.h"
 
 struct input_fetcher_t {
     struct background_worker* local;
@@ -57,18 +57,6 @@ struct fetcher_request {
     void *userdata;
 };
 
-struct fetcher_thread {
-    void (*pf_worker)( input_fetcher_t*, struct fetcher_request* );
-
-    struct background_worker* worker;
-    struct fetcher_request* req;
-    input_fetcher_t* fetcher;
-
-    vlc_interrupt_t interrupt;
-    vlc_thread_t thread;
-    atomic_bool active;
-};
-
 static char* CreateCacheKey( input_item_t* item )
 {
     vlc_mutex_lock( &item->lock );
@@ -330,81 +318,22 @@ static void RequestHold( void* req_ )
     vlc_atomic_rc_inc( &req->rc );
 }
 
-static void* FetcherThread( void* handle )
-{
-    struct fetcher_thread* th = handle;
-    vlc_interrupt_set( &th->interrupt );
-
-    th->pf_worker( th->fetcher, th->req );
-
-    atomic_store( &th->active, false );
-    background_worker_RequestProbe( th->worker );
-    return NULL;
-}
-
-static int StartWorker( input_fetcher_t* fetcher,
-    void( *pf_worker )( input_fetcher_t*, struct fetcher_request* ),
-    struct background_worker* bg, struct fetcher_request* req, void** handle )
-{
-    struct fetcher_thread* th = malloc( sizeof *th );
-
-    if( unlikely( !th ) )
-        return VLC_ENOMEM;
-
-    th->req = req;
-    th->worker = bg;
-    th->fetcher = fetcher;
-    th->pf_worker = pf_worker;
-
-    vlc_interrupt_init( &th->interrupt );
-    atomic_init( &th->active, true );
-
-    if( !vlc_clone( &th->thread, FetcherThread, th, VLC_THREAD_PRIORITY_LOW ) )
-    {
-        *handle = th;
-        return VLC_SUCCESS;
-    }
-
-    vlc_interrupt_deinit( &th->interrupt );
-    free( th );
-    return VLC_EGENERIC;
-}
-
-static int ProbeWorker( void* fetcher_, void* th_ )
-{
-    return !atomic_load( &((struct fetcher_thread*)th_)->active );
-    VLC_UNUSED( fetcher_ );
-}
-
-static void CloseWorker( void* fetcher_, void* th_ )
-{
-    struct fetcher_thread* th = th_;
-    VLC_UNUSED( fetcher_ );
-
-    vlc_interrupt_kill( &th->interrupt );
-    vlc_join( th->thread, NULL );
-    vlc_interrupt_deinit( &th->interrupt );
-    free( th );
-}
-
-#define DEF_STARTER(name, worker) \
-static int Start ## name( void* fetcher_, void* req_, void** out ) { \
-    input_fetcher_t* fetcher = fetcher_; \
-    return StartWorker( fetcher, name, worker, req_, out ); }
+#define DEF_RUNNER(name) \
+static void Run ## name( void* fetcher_, void* req_ ) { \
+    name( fetcher_, req_ ); }
 
-DEF_STARTER(  SearchLocal, fetcher->local )
-DEF_STARTER(SearchNetwork, fetcher->network )
-DEF_STARTER(   Downloader, fetcher->downloader )
+DEF_RUNNER(  SearchLocal )
+DEF_RUNNER(SearchNetwork )
+DEF_RUNNER(   Downloader )
 
 static void WorkerInit( input_fetcher_t* fetcher,
-    struct background_worker** worker, int( *starter )( void*, void*, void** ) )
+    struct background_worker** worker, void( *runner )( void*, void* ) )
 {
     struct background_worker_config conf = {
         .default_timeout = 0,
         .max_threads = var_InheritInteger( fetcher->owner, "fetch-art-threads" ),
-        .pf_start = starter,
-        .pf_probe = ProbeWorker,
-        .pf_stop = CloseWorker,
+        .priority = VLC_EXECUTOR_PRIORITY_LOW,
+        .pf_run = runner,
         .pf_release = RequestRelease,
         .pf_hold = RequestHold };
 
@@ -420,9 +349,9 @@ input_fetcher_t* input_fetcher_New( vlc_object_t* owner )
 
     fetcher->owner = owner;
 
-    WorkerInit( fetcher, &fetcher->local, StartSearchLocal );
-    WorkerInit( fetcher, &fetcher->network, StartSearchNetwork );
-    WorkerInit( fetcher, &fetcher->downloader, StartDownloader );
+    WorkerInit( fetcher, &fetcher->local, RunSearchLocal );
+    WorkerInit( fetcher, &fetcher->network, RunSearchNetwork );
+    WorkerInit( fetcher, &fetcher->downloader, RunDownloader );
 
     if( unlikely( !fetcher->local || !fetcher->network || !fetcher->downloader ) )
     {
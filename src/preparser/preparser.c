@@ -24,6 +24,8 @@
 
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_executor.h>
+#include <vlc_interrupt.h>
 
 #include "misc/background_worker.h"
 #include "input/input_interface.h"
@@ -54,7 +56,6 @@ typedef struct input_preparser_task_t
     int preparse_status;
     input_thread_t* input;
     atomic_int state;
-    atomic_bool done;
 } input_preparser_task_t;
 
 static input_preparser_req_t *ReqCreate(input_item_t *item,
@@ -101,10 +102,6 @@ static void InputEvent( input_thread_t *input,
             atomic_store( &task->state, event->state );
             break;
 
-        case INPUT_EVENT_DEAD:
-            atomic_store( &task->done, true );
-            background_worker_RequestProbe( task->preparser->worker );
-            break;
         case INPUT_EVENT_SUBITEMS:
         {
             input_preparser_req_t *req = task->req;
@@ -116,51 +113,6 @@ static void InputEvent( input_thread_t *input,
     }
 }
 
-static int PreparserOpenInput( void* preparser_, void* req_, void** out )
-{
-    input_preparser_t* preparser = preparser_;
-    input_preparser_req_t *req = req_;
-    input_preparser_task_t* task = malloc( sizeof *task );
-
-    if( unlikely( !task ) )
-        goto error;
-
-    atomic_init( &task->state, INIT_S );
-    atomic_init( &task->done, false );
-
-    task->preparser = preparser_;
-    task->input = input_CreatePreparser( preparser->owner, InputEvent,
-                                         task, req->item );
-    if( !task->input )
-        goto error;
-
-    task->req = req;
-    task->preparse_status = -1;
-
-    if( input_Start( task->input ) )
-    {
-        input_Close( task->input );
-        goto error;
-    }
-
-    *out = task;
-
-    return VLC_SUCCESS;
-
-error:
-    free( task );
-    if (req->cbs && req->cbs->on_preparse_ended)
-        req->cbs->on_preparse_ended(req->item, ITEM_PREPARSE_FAILED, req->userdata);
-    return VLC_EGENERIC;
-}
-
-static int PreparserProbeInput( void* preparser_, void* task_ )
-{
-    input_preparser_task_t* task = task_;
-    return atomic_load( &task->done );
-    VLC_UNUSED( preparser_ );
-}
-
 static void on_art_fetch_ended(input_item_t *item, bool fetched, void *userdata)
 {
     VLC_UNUSED(item);
@@ -181,14 +133,38 @@ static const input_fetcher_callbacks_t input_fetcher_callbacks = {
     .on_art_fetch_ended = on_art_fetch_ended,
 };
 
-static void PreparserCloseInput( void* preparser_, void* task_ )
+static void PreparserStopInput( void *input )
 {
-    input_preparser_task_t* task = task_;
-    input_preparser_req_t *req = task->req;
+    input_Stop( input );
+}
 
+static void PreparserRun( void* preparser_, void* req_ )
+{
     input_preparser_t* preparser = preparser_;
+    input_preparser_req_t *req = req_;
+    input_preparser_task_t* task = malloc( sizeof *task );
+
+    if( unlikely( !task ) )
+        goto error;
+
+    atomic_init( &task->state, INIT_S );
+
+    task->preparser = preparser;
+    task->req = req;
+    task->preparse_status = -1;
+    task->input = input_CreatePreparser( preparser->owner, InputEvent,
+                                         task, req->item );
+    if( !task->input )
+        goto error;
+
+    /* The item is preparsed on this executor thread: stop the input if the
+     * task is cancelled or times out */
     input_thread_t* input = task->input;
-    input_item_t* item = input_priv(task->input)->p_item;
+    input_item_t* item = input_priv(input)->p_item;
+
+    vlc_interrupt_register( PreparserStopInput, input );
+    input_Preparse( input );
+    vlc_interrupt_unregister();
 
     int status;
     switch( atomic_load( &task->state ) )
@@ -222,6 +198,12 @@ static void PreparserCloseInput( void* preparser_, void* task_ )
     input_item_SetPreparsed( item, true );
     if (req->cbs && req->cbs->on_preparse_ended)
         req->cbs->on_preparse_ended(req->item, status, req->userdata);
+    return;
+
+error:
+    free( task );
+    if (req->cbs && req->cbs->on_preparse_ended)
+        req->cbs->on_preparse_ended(req->item, ITEM_PREPARSE_FAILED, req->userdata);
 }
 
 static void ReqHoldVoid(void *item) { ReqHold(item); }
@@ -234,9 +216,8 @@ input_preparser_t* input_preparser_New( vlc_object_t *parent )
     struct background_worker_config conf = {
         .default_timeout = VLC_TICK_FROM_MS(var_InheritInteger( parent, "preparse-timeout" )),
         .max_threads = var_InheritInteger( parent, "preparse-threads" ),
-        .pf_start = PreparserOpenInput,
-        .pf_probe = PreparserProbeInput,
-        .pf_stop = PreparserCloseInput,
+        .priority = VLC_EXECUTOR_PRIORITY_LOW,
+        .pf_run = PreparserRun,
         .pf_release = ReqReleaseVoid,
         .pf_hold = ReqHoldVoid
     };
@@ -23,6 +23,7 @@
 #ifndef LIBVLC_VOUT_STATISTIC_H
 # define LIBVLC_VOUT_STATISTIC_H
 # include <stdatomic.h>
+# include "misc/histogram.h"
 
 /* NOTE: Both statistics are atomic on their own, so one might be older than
  * the other one. Currently, only one of them is updated at a time, so this
@@ -30,12 +31,22 @@
 typedef struct {
     atomic_uint displayed;
     atomic_uint lost;
+
+    /* Durations of the display stages of each picture */
+    vlc_histogram_t prepare_picture;
+    vlc_histogram_t render;
+    vlc_histogram_t prepare;
+    vlc_histogram_t display;
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     atomic_init(&stat->displayed, 0);
     atomic_init(&stat->lost, 0);
+    vlc_histogram_Init(&stat->prepare_picture);
+    vlc_histogram_Init(&stat->render);
+    vlc_histogram_Init(&stat->prepare);
+    vlc_histogram_Init(&stat->display);
 }
 
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
@@ -52,6 +63,18 @@ static inline void vout_statistic_GetReset(vout_statistic_t *stat,
     *lost = atomic_exchange_explicit(&stat->lost, 0, memory_order_relaxed);
 }
 
+static inline void vout_statistic_MoveTimes(vout_statistic_t *stat,
+                                            vlc_histogram_t *prepare_picture,
+                                            vlc_histogram_t *render,
+                                            vlc_histogram_t *prepare,
+                                            vlc_histogram_t *display)
+{
+    vlc_histogram_Move(prepare_picture, &stat->prepare_picture);
+    vlc_histogram_Move(render, &stat->render);
+    vlc_histogram_Move(prepare, &stat->prepare);
+    vlc_histogram_Move(display, &stat->display);
+}
+
 static inline void vout_statistic_AddDisplayed(vout_statistic_t *stat,
                                                int displayed)
 {
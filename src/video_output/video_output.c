@@ -351,6 +351,16 @@ void vout_GetResetStatistic(vout_thread_t *vout, unsigned *restrict displayed,
     vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
 }
 
+void vout_MoveStatisticTimes(vout_thread_t *vout,
+                             vlc_histogram_t *prepare_picture,
+                             vlc_histogram_t *render,
+                             vlc_histogram_t *prepare,
+                             vlc_histogram_t *display)
+{
+    vout_statistic_MoveTimes(&vout->p->statistic, prepare_picture, render,
+                             prepare, display);
+}
+
 void vout_Flush(vout_thread_t *vout, vlc_tick_t date)
 {
     vout_control_PushTime(&vout->p->control, VOUT_CONTROL_FLUSH, date);
@@ -898,6 +908,7 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool frame_by_frame)
 {
     bool is_late_dropped = vout->p->is_late_dropped && !vout->p->pause.is_on && !frame_by_frame;
+    const vlc_tick_t start = vlc_tick_now();
 
     vlc_mutex_lock(&vout->p->filter.lock);
 
@@ -957,6 +968,9 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool fra
         vout->p->displayed.current = picture;
     else
         vout->p->displayed.next    = picture;
+
+    vlc_histogram_AddTime(&vout->p->statistic.prepare_picture,
+                          vlc_tick_now() - start);
     return VLC_SUCCESS;
 }
 
@@ -1023,6 +1037,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     picture_t *torender = picture_Hold(sys->displayed.current);
 
     vout_chrono_Start(&sys->render);
+    vlc_tick_t start = vlc_tick_now();
 
     vlc_mutex_lock(&sys->filter.lock);
     picture_t *filtered = filter_chain_VideoFilter(sys->filter.chain_interactive, torender);
@@ -1169,8 +1184,15 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     if (!do_dr_spu && sys->spu_blend != NULL && subpic != NULL)
         picture_BlendSubpicture(todisplay, sys->spu_blend, subpic);
 
+    vlc_tick_t now = vlc_tick_now();
+    vlc_histogram_AddTime(&sys->statistic.render, now - start);
+
     if (vd->prepare != NULL)
+    {
+        start = now;
         vd->prepare(vd, todisplay, do_dr_spu ? subpic : NULL, todisplay->date);
+        vlc_histogram_AddTime(&sys->statistic.prepare, vlc_tick_now() - start);
+    }
 
     vout_chrono_Stop(&sys->render);
 #if 0
@@ -1194,6 +1216,8 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     /* Display the direct buffer returned by vout_RenderPicture */
     sys->displayed.date = vlc_tick_now();
     vout_display_Display(vd, todisplay);
+    vlc_histogram_AddTime(&sys->statistic.display,
+                          vlc_tick_now() - sys->displayed.date);
     if (subpic)
         subpicture_Delete(subpic);
 
@@ -236,6 +236,15 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, vlc_tick_t i_duration );
 void vout_GetResetStatistic( vout_thread_t *p_vout, unsigned *pi_displayed,
                              unsigned *pi_lost );
 
+/**
+ * This function moves the durations of the display stages to histograms.
+ */
+void vout_MoveStatisticTimes( vout_thread_t *p_vout,
+                              vlc_histogram_t *prepare_picture,
+                              vlc_histogram_t *render,
+                              vlc_histogram_t *prepare,
+                              vlc_histogram_t *display );
+
 /**
  * This function will ensure that all ready/displayed pictures have at most
  * the provided date.
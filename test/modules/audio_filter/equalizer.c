@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * equalizer.c: test and benchmark for the equalizer filtering kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that the SIMD variant, if supported by the CPU, and the parallel
+ * filtering of the channel groups produce the same samples and filter state
+ * as the C reference, across consecutive buffers. With the "bench" argument,
+ * it also prints the throughput of each variant.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_tick.h>
+#include <vlc_executor.h>
+#include "../modules/audio_filter/equalizer_simd.h"
+
+#define SAMPLES_MAX 4099
+#define BENCH_SAMPLES 1024
+#define BENCH_LOOPS 200
+
+static bool bench;
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state;
+}
+
+/* Uniform in [lo, hi) */
+static float rnd_float(float lo, float hi)
+{
+    return lo + (hi - lo) * ((rnd() >> 8) / 16777216.f);
+}
+
+static float alpha[EQZ_BANDS_MAX], beta[EQZ_BANDS_MAX];
+static float gamma_[EQZ_BANDS_MAX], amp[EQZ_BANDS_MAX];
+
+static void state_init(eqz_state_t *eqz, bool two_pass)
+{
+    memset(eqz, 0, sizeof (*eqz));
+    eqz->i_band = EQZ_BANDS_MAX;
+    eqz->f_alpha = alpha;
+    eqz->f_beta = beta;
+    eqz->f_gamma = gamma_;
+    eqz->f_amp = amp;
+    eqz->f_gamp = 1.12f;
+    eqz->b_2eqz = two_pass;
+}
+
+static void coeffs_init(void)
+{
+    /* Stable resonators: the poles of z^2 - gamma z + beta are within the
+     * unit circle */
+    for (unsigned j = 0; j < EQZ_BANDS_MAX; j++)
+    {
+        beta[j] = rnd_float(.5f, .99f);
+        gamma_[j] = rnd_float(-.9f, .9f) * (1.f + beta[j]);
+        alpha[j] = rnd_float(.001f, .3f);
+        amp[j] = rnd_float(-.2f, .2f);
+    }
+}
+
+static float src[SAMPLES_MAX * EQZ_CHANNELS_MAX];
+static float ref[SAMPLES_MAX * EQZ_CHANNELS_MAX];
+static float out[SAMPLES_MAX * EQZ_CHANNELS_MAX];
+static float scratch[SAMPLES_MAX * EQZ_CHANNELS_MAX];
+
+static void filter_serial(eqz_state_t *eqz, eqz_filter_group_t filter,
+                          float *dst, const float *in, int samples,
+                          int channels)
+{
+    for (int c = 0; c < channels; c += EQZ_LANES)
+        filter(eqz, dst + c, channels, in, samples, channels, c);
+}
+
+static bool state_equal(const eqz_state_t *a, const eqz_state_t *b)
+{
+    return !memcmp(a->x, b->x, sizeof (a->x))
+        && !memcmp(a->y, b->y, sizeof (a->y))
+        && !memcmp(a->x2, b->x2, sizeof (a->x2))
+        && !memcmp(a->y2, b->y2, sizeof (a->y2));
+}
+
+static void test_channels(vlc_executor_t *executor, int channels,
+                          bool two_pass)
+{
+    static const int lengths[] = { 1, 7, 256, 1000, SAMPLES_MAX };
+    eqz_state_t st_ref, st_par;
+#ifdef EQZ_SIMD
+    eqz_state_t st_simd;
+    const bool simd = eqz_CPU_SIMD();
+
+    state_init(&st_simd, two_pass);
+#endif
+    state_init(&st_ref, two_pass);
+    state_init(&st_par, two_pass);
+
+    /* The state carries over from one buffer to the next */
+    for (size_t i = 0; i < ARRAY_SIZE(lengths); i++)
+    {
+        const int samples = lengths[i];
+        const size_t size = samples * channels * sizeof (float);
+
+        for (int k = 0; k < samples * channels; k++)
+            src[k] = rnd_float(-1.f, 1.f);
+
+        filter_serial(&st_ref, EqzFilterGroupC, ref, src, samples, channels);
+
+#ifdef EQZ_SIMD
+        if (simd)
+        {
+            filter_serial(&st_simd, EqzFilterGroupSIMD, out, src, samples,
+                          channels);
+            assert(!memcmp(out, ref, size));
+            assert(state_equal(&st_simd, &st_ref));
+        }
+#endif
+
+        /* In place, as the filter does */
+        memcpy(out, src, size);
+        EqzFilterParallel(&st_par, EqzGetFilterGroup(), executor, scratch,
+                          out, out, samples, channels);
+        assert(!memcmp(out, ref, size));
+        assert(state_equal(&st_par, &st_ref));
+    }
+}
+
+static void report(const char *variant, int channels, vlc_tick_t ref_time,
+                   vlc_tick_t t)
+{
+    printf("%-8s %2d channels %8.3f ns/frame (x%.2f)\n", variant, channels,
+           (double)(t * 1000) / (BENCH_SAMPLES * (double)BENCH_LOOPS),
+           (double)ref_time / (double)(t ? t : 1));
+}
+
+#define BENCH(call) \
+    ({ vlc_tick_t start_ = vlc_tick_now(); \
+       for (unsigned l_ = 0; l_ < BENCH_LOOPS; l_++) \
+           call; \
+       vlc_tick_now() - start_; })
+
+static void bench_channels(vlc_executor_t *executor, int channels)
+{
+    eqz_state_t eqz;
+    vlc_tick_t t_ref, t;
+
+    state_init(&eqz, true);
+    for (int k = 0; k < BENCH_SAMPLES * channels; k++)
+        src[k] = rnd_float(-1.f, 1.f);
+
+    t_ref = BENCH(filter_serial(&eqz, EqzFilterGroupC, out, src,
+                                BENCH_SAMPLES, channels));
+    report("c", channels, t_ref, t_ref);
+#ifdef EQZ_SIMD
+    if (eqz_CPU_SIMD())
+    {
+        t = BENCH(filter_serial(&eqz, EqzFilterGroupSIMD, out, src,
+                                BENCH_SAMPLES, channels));
+        report("simd", channels, t_ref, t);
+    }
+#endif
+    t = BENCH(EqzFilterParallel(&eqz, EqzGetFilterGroup(), executor, scratch,
+                                out, src, BENCH_SAMPLES, channels));
+    report("parallel", channels, t_ref, t);
+}
+
+int main(int argc, char **argv)
+{
+    static const int channels[] = { 1, 2, 3, 4, 5, 6, 8, 11, 16, 32 };
+
+    bench = argc > 1 && !strcmp(argv[1], "bench");
+    coeffs_init();
+
+    vlc_executor_t *executor = vlc_executor_New(EQZ_GROUPS_MAX - 1,
+                                                VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    for (size_t i = 0; i < ARRAY_SIZE(channels); i++)
+    {
+        test_channels(executor, channels[i], false);
+        test_channels(executor, channels[i], true);
+    }
+
+    if (bench)
+        for (size_t i = 0; i < ARRAY_SIZE(channels); i++)
+            if (channels[i] > EQZ_LANES)
+                bench_channels(executor, channels[i]);
+
+    vlc_executor_Delete(executor);
+    return 0;
+}
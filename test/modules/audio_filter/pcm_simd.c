@@ -0,0 +1,326 @@
+/*****************************************************************************
+ * pcm_simd.c: test and benchmark for the PCM sample kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that every SIMD kernel supported by the CPU produces the same
+ * samples as the C reference. With the "bench" argument, it also prints the
+ * throughput of each variant.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include <vlc_tick.h>
+#include "../modules/audio_filter/pcm_simd.h"
+
+/* Odd, so that the scalar tails get tested too */
+#define SAMPLES (4 * 4096 + 13)
+#define BENCH_LOOPS 2000
+
+static bool bench;
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state;
+}
+
+static void fill_float(float *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        /* Mostly in range, with some clipping and exact halves */
+        switch (rnd() % 16)
+        {
+            case 0:
+                p[i] = ((int32_t)rnd() % 65536) / 32768.f + .5f / 32768.f;
+                break;
+            case 1:
+                p[i] = ((int32_t)rnd() % 1000) / 16.f;
+                break;
+            case 2:
+                p[i] = 1.f;
+                break;
+            case 3:
+                p[i] = -1.f;
+                break;
+            default:
+                p[i] = (int32_t)rnd() / 2147483648.f;
+        }
+    }
+}
+
+static void report(const char *name, const char *variant, vlc_tick_t ref,
+                   vlc_tick_t t)
+{
+    printf("%-12s %-5s %8.3f ns/sample (x%.2f)\n", name, variant,
+           (double)(t * 1000) / (SAMPLES * (double)BENCH_LOOPS),
+           (double)ref / (double)(t ? t : 1));
+}
+
+#define BENCH(call) \
+    ({ vlc_tick_t start_ = vlc_tick_now(); \
+       for (unsigned l_ = 0; l_ < BENCH_LOOPS; l_++) \
+           call; \
+       vlc_tick_now() - start_; })
+
+static float src_f[SAMPLES], ref_f[SAMPLES], out_f[SAMPLES];
+static double src_d[SAMPLES], ref_d[SAMPLES], out_d[SAMPLES];
+static int16_t src_s16[SAMPLES], ref_s16[SAMPLES], out_s16[SAMPLES];
+static int32_t src_s32[SAMPLES], ref_s32[SAMPLES], out_s32[SAMPLES];
+
+static void test_amplify_fl32(const char *variant, pcm_amplify_fl32_t f)
+{
+    memcpy(out_f, src_f, sizeof (out_f));
+    f(out_f, SAMPLES, .73f);
+    assert(!memcmp(out_f, ref_f, sizeof (out_f)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_f, SAMPLES, 1.0001f));
+        if (f == pcm_amplify_fl32_c)
+            ref = t;
+        report("amplify_fl32", variant, ref, t);
+    }
+}
+
+static void test_amplify_fl64(const char *variant, pcm_amplify_fl64_t f)
+{
+    memcpy(out_d, src_d, sizeof (out_d));
+    f(out_d, SAMPLES, .73);
+    assert(!memcmp(out_d, ref_d, sizeof (out_d)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_d, SAMPLES, 1.0001));
+        if (f == pcm_amplify_fl64_c)
+            ref = t;
+        report("amplify_fl64", variant, ref, t);
+    }
+}
+
+static void test_amplify_s16(const char *variant, pcm_amplify_s16_t f)
+{
+    static const int mults[] = { 0, 1, 100, 255, 257, 512, 4000, -300 };
+
+    for (size_t i = 0; i < ARRAY_SIZE(mults); i++)
+    {
+        memcpy(ref_s16, src_s16, sizeof (ref_s16));
+        pcm_amplify_s16_c(ref_s16, SAMPLES, mults[i]);
+        memcpy(out_s16, src_s16, sizeof (out_s16));
+        f(out_s16, SAMPLES, mults[i]);
+        assert(!memcmp(out_s16, ref_s16, sizeof (out_s16)));
+    }
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_s16, SAMPLES, 256));
+        if (f == pcm_amplify_s16_c)
+            ref = t;
+        report("amplify_s16", variant, ref, t);
+    }
+}
+
+static void test_s16_fl32(const char *variant, pcm_s16_fl32_t f)
+{
+    f(out_f, src_s16, SAMPLES);
+    assert(!memcmp(out_f, ref_f, sizeof (out_f)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_f, src_s16, SAMPLES));
+        if (f == pcm_s16_fl32_c)
+            ref = t;
+        report("s16_fl32", variant, ref, t);
+    }
+}
+
+static void test_fl32_s16(const char *variant, pcm_fl32_s16_t f)
+{
+    f(out_s16, src_f, SAMPLES);
+    assert(!memcmp(out_s16, ref_s16, sizeof (out_s16)));
+
+    /* In place */
+    memcpy(out_f, src_f, sizeof (out_f));
+    f((int16_t *)out_f, out_f, SAMPLES);
+    assert(!memcmp(out_f, ref_s16, sizeof (ref_s16)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_s16, src_f, SAMPLES));
+        if (f == pcm_fl32_s16_c)
+            ref = t;
+        report("fl32_s16", variant, ref, t);
+    }
+}
+
+static void test_s32_fl32(const char *variant, pcm_s32_fl32_t f)
+{
+    f(out_f, src_s32, SAMPLES);
+    assert(!memcmp(out_f, ref_f, sizeof (out_f)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_f, src_s32, SAMPLES));
+        if (f == pcm_s32_fl32_c)
+            ref = t;
+        report("s32_fl32", variant, ref, t);
+    }
+}
+
+static void test_fl32_s32(const char *variant, pcm_fl32_s32_t f)
+{
+    f(out_s32, src_f, SAMPLES);
+    assert(!memcmp(out_s32, ref_s32, sizeof (out_s32)));
+
+    /* In place */
+    memcpy(out_f, src_f, sizeof (out_f));
+    f((int32_t *)out_f, out_f, SAMPLES);
+    assert(!memcmp(out_f, ref_s32, sizeof (ref_s32)));
+
+    if (bench)
+    {
+        static vlc_tick_t ref;
+        vlc_tick_t t = BENCH(f(out_s32, src_f, SAMPLES));
+        if (f == pcm_fl32_s32_c)
+            ref = t;
+        report("fl32_s32", variant, ref, t);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench = argc > 1 && !strcmp(argv[1], "bench");
+
+    fill_float(src_f, SAMPLES);
+    for (size_t i = 0; i < SAMPLES; i++)
+    {
+        src_d[i] = src_f[i];
+        src_s16[i] = rnd();
+        src_s32[i] = rnd();
+    }
+
+    memcpy(ref_f, src_f, sizeof (ref_f));
+    pcm_amplify_fl32_c(ref_f, SAMPLES, .73f);
+    test_amplify_fl32("C", pcm_amplify_fl32_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_amplify_fl32("SSE2", pcm_amplify_fl32_sse2);
+    if (vlc_CPU_AVX())
+        test_amplify_fl32("AVX", pcm_amplify_fl32_avx);
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        test_amplify_fl32("NEON", pcm_amplify_fl32_neon);
+#endif
+
+    memcpy(ref_d, src_d, sizeof (ref_d));
+    pcm_amplify_fl64_c(ref_d, SAMPLES, .73);
+    test_amplify_fl64("C", pcm_amplify_fl64_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_amplify_fl64("SSE2", pcm_amplify_fl64_sse2);
+    if (vlc_CPU_AVX())
+        test_amplify_fl64("AVX", pcm_amplify_fl64_avx);
+#endif
+
+    test_amplify_s16("C", pcm_amplify_s16_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_amplify_s16("SSE2", pcm_amplify_s16_sse2);
+    if (vlc_CPU_AVX2())
+        test_amplify_s16("AVX2", pcm_amplify_s16_avx2);
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        test_amplify_s16("NEON", pcm_amplify_s16_neon);
+#endif
+
+    pcm_s16_fl32_c(ref_f, src_s16, SAMPLES);
+    test_s16_fl32("C", pcm_s16_fl32_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_s16_fl32("SSE2", pcm_s16_fl32_sse2);
+    if (vlc_CPU_AVX2())
+        test_s16_fl32("AVX2", pcm_s16_fl32_avx2);
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        test_s16_fl32("NEON", pcm_s16_fl32_neon);
+#endif
+
+    pcm_fl32_s16_c(ref_s16, src_f, SAMPLES);
+    test_fl32_s16("C", pcm_fl32_s16_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_fl32_s16("SSE2", pcm_fl32_s16_sse2);
+    if (vlc_CPU_AVX2())
+        test_fl32_s16("AVX2", pcm_fl32_s16_avx2);
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    if (vlc_CPU_ARM_NEON())
+        test_fl32_s16("NEON", pcm_fl32_s16_neon);
+#endif
+
+    pcm_s32_fl32_c(ref_f, src_s32, SAMPLES);
+    test_s32_fl32("C", pcm_s32_fl32_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_s32_fl32("SSE2", pcm_s32_fl32_sse2);
+    if (vlc_CPU_AVX2())
+        test_s32_fl32("AVX2", pcm_s32_fl32_avx2);
+#endif
+#ifdef PCM_SIMD_NEON
+    if (vlc_CPU_ARM_NEON())
+        test_s32_fl32("NEON", pcm_s32_fl32_neon);
+#endif
+
+    pcm_fl32_s32_c(ref_s32, src_f, SAMPLES);
+    test_fl32_s32("C", pcm_fl32_s32_c);
+#ifdef PCM_SIMD_X86
+    if (vlc_CPU_SSE2())
+        test_fl32_s32("SSE2", pcm_fl32_s32_sse2);
+    if (vlc_CPU_AVX2())
+        test_fl32_s32("AVX2", pcm_fl32_s32_avx2);
+#endif
+#if defined(PCM_SIMD_NEON) && defined(__aarch64__)
+    if (vlc_CPU_ARM_NEON())
+        test_fl32_s32("NEON", pcm_fl32_s32_neon);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*****************************************************************************
+ * pes.c: test and benchmark for the PES packetizer with shared payloads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that a shared ES block produces the same PES bytes as a private
+ * one, without copying its payload. With the "bench" argument, it also
+ * times the duplicate stream output fanning video frames out to the PES
+ * encapsulation of TS muxers, with copied blocks, with shared blocks copied
+ * when the PES header is inserted, and with shared blocks.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_es.h>
+#include <vlc_tick.h>
+#include "../modules/mux/mpeg/pes.h"
+#include "../modules/mux/mpeg/pes.c"
+
+#define SIZE_MAX_TEST (300 * 1024)
+#define BENCH_OUTPUTS 8
+#define BENCH_LOOPS   10
+#define BENCH_RUNS    30
+
+static uint8_t extra[] = {
+    0, 0, 0, 1, 0x67, 0x42, 0xc0, 0x1e, 0, 0, 0, 1, 0x68, 0xce, 0x3c, 0x80,
+};
+
+static uint8_t out_private[SIZE_MAX_TEST + 1024];
+static uint8_t out_shared[SIZE_MAX_TEST + 1024];
+
+/* Copies the PES chain to TS packets, as the TS muxer does */
+static size_t packetize(block_t *chain, uint8_t *out)
+{
+    size_t size = 0;
+    block_t *packet = NULL;
+    size_t used = 0;
+
+    for (block_t *b = chain, *next; b != NULL; b = next)
+    {
+        for (size_t i = 0; i < b->i_buffer; )
+        {
+            if (packet == NULL)
+            {
+                packet = block_Alloc(188);
+                assert(packet != NULL);
+            }
+
+            size_t len = __MIN(b->i_buffer - i, 184 - used);
+
+            memcpy(packet->p_buffer + 4 + used, b->p_buffer + i, len);
+            used += len;
+            i += len;
+            if (used == 184 || i == b->i_buffer)
+            {
+                memcpy(out + size, packet->p_buffer + 4, used);
+                size += used;
+                used = 0;
+                block_Release(packet);
+                packet = NULL;
+            }
+        }
+        next = b->p_next;
+        block_Release(b);
+    }
+    return size;
+}
+
+static void format_init(es_format_t *fmt, int cat, vlc_fourcc_t codec)
+{
+    es_format_Init(fmt, cat, codec);
+    fmt->p_extra = extra;
+    fmt->i_extra = sizeof (extra);
+}
+
+static block_t *es_block(size_t size, bool key)
+{
+    block_t *block = block_Alloc(size);
+    assert(block != NULL);
+    for (size_t i = 0; i < size; i++)
+        block->p_buffer[i] = rand();
+    block->i_pts = VLC_TICK_FROM_MS(140);
+    block->i_dts = VLC_TICK_FROM_MS(100);
+    block->i_length = VLC_TICK_FROM_MS(40);
+    block->i_flags = key ? BLOCK_FLAG_TYPE_I : 0;
+    return block;
+}
+
+static void test_es(const es_format_t *fmt, size_t size, bool key)
+{
+    const int max_pes = (fmt->i_cat == VIDEO_ES) ? INT_MAX : 0;
+    block_t *block = es_block(size, key);
+    block_t *pes = block_Duplicate(block);
+    assert(pes != NULL);
+
+    EStoPES(&pes, fmt, 0xe0, 1, 1, 0, max_pes, 0);
+    const size_t size_private = packetize(pes, out_private);
+
+    const uint8_t *payload = block->p_buffer;
+    pes = block_Share(block);
+    assert(pes != NULL);
+    EStoPES(&pes, fmt, 0xe0, 1, 1, 0, max_pes, 0);
+
+    /* A single PES refers to the shared payload */
+    if (fmt->i_cat == VIDEO_ES || size <= PES_PAYLOAD_SIZE_MAX - 64)
+    {
+        assert(pes->i_flags & BLOCK_FLAG_PES_HEADER);
+        assert(pes->i_length == VLC_TICK_FROM_MS(40));
+        assert(pes->p_next->p_buffer == payload);
+        assert(pes->p_next->i_length == 0);
+    }
+
+    const size_t size_shared = packetize(pes, out_shared);
+    assert(size_private == size_shared);
+    assert(!memcmp(out_private, out_shared, size_shared));
+    assert(block->p_buffer == payload);
+    block_Release(block);
+}
+
+enum fanout
+{
+    FANOUT_DUPLICATE, /* Copies in the duplicate output */
+    FANOUT_COPY, /* Shared blocks, copied to insert the PES header */
+    FANOUT_SHARE,
+};
+
+static vlc_tick_t bench_fanout(const es_format_t *fmt, size_t size,
+                               enum fanout mode)
+{
+    block_t *block = es_block(size, false);
+    vlc_tick_t best = INT64_MAX;
+
+    /* Non-IDR slice, without access unit delimiter */
+    memcpy(block->p_buffer, "\x00\x00\x00\x01\x41", 5);
+
+    /* Keep the fastest run, the others being disturbed by other tasks */
+    for (unsigned r = 0; r < BENCH_RUNS; r++)
+    {
+        vlc_tick_t start = vlc_tick_now();
+
+        for (unsigned l = 0; l < BENCH_LOOPS; l++)
+        {
+            block_t *in = block_Duplicate(block);
+            assert(in != NULL);
+
+            /* As the duplicate stream output, followed by TS muxers */
+            for (unsigned i = 0; i < BENCH_OUTPUTS; i++)
+            {
+                block_t *pes;
+
+                if (i == BENCH_OUTPUTS - 1)
+                    pes = in;
+                else if (mode == FANOUT_DUPLICATE)
+                    pes = block_Duplicate(in);
+                else
+                    pes = block_Share(in);
+                if (mode == FANOUT_COPY)
+                    pes = block_Writable(pes);
+                assert(pes != NULL);
+                EStoPES(&pes, fmt, 0xe0, 1, 1, 0, INT_MAX, 0);
+                /* The TS packets take the same time in all cases */
+                block_ChainRelease(pes);
+            }
+        }
+
+        vlc_tick_t t = vlc_tick_now() - start;
+        if (t < best)
+            best = t;
+    }
+    block_Release(block);
+    return best;
+}
+
+static void bench(void)
+{
+    static const size_t sizes[] = { 16 * 1024, 64 * 1024, 1024 * 1024 };
+    es_format_t fmt;
+
+    format_init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+    {
+        vlc_tick_t t_dup = bench_fanout(&fmt, sizes[i], FANOUT_DUPLICATE);
+        vlc_tick_t t_copy = bench_fanout(&fmt, sizes[i], FANOUT_COPY);
+        vlc_tick_t t_share = bench_fanout(&fmt, sizes[i], FANOUT_SHARE);
+
+        printf("%u outputs, %7zu bytes: duplicated %8.1f us, "
+               "copied on prepend %8.1f us, shared %8.1f us (x%.2f)\n",
+               BENCH_OUTPUTS, sizes[i], (double)t_dup / BENCH_LOOPS,
+               (double)t_copy / BENCH_LOOPS, (double)t_share / BENCH_LOOPS,
+               (double)t_dup / (double)(t_share ? t_share : 1));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static const size_t sizes[] = {
+        1, 100, 183, 184, 185, 1000, 65536, SIZE_MAX_TEST,
+    };
+    es_format_t fmt;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sizes); i++)
+        for (unsigned key = 0; key < 2; key++)
+        {
+            format_init(&fmt, VIDEO_ES, VLC_CODEC_H264);
+            test_es(&fmt, sizes[i], key);
+            format_init(&fmt, VIDEO_ES, VLC_CODEC_MP2V);
+            test_es(&fmt, sizes[i], key);
+            format_init(&fmt, AUDIO_ES, VLC_CODEC_MPGA);
+            test_es(&fmt, sizes[i], key);
+        }
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        bench();
+    return 0;
+}
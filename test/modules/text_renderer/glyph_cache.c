@@ -0,0 +1,302 @@
+/*****************************************************************************
+ * glyph_cache.c: test for the FreeType glyph cache
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that the cached bitmaps are the bitmaps FreeType renders at any pen
+ * position, and the eviction of the least recently used entries.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "../modules/text_renderer/freetype/glyph_cache.c"
+
+#include FT_OUTLINE_H
+
+/* No font is needed: the faces are only compared */
+#define FACE(n) ((FT_Face)(uintptr_t)(n))
+
+/* A triangle, with edges at fractional positions */
+static FT_Glyph new_outline(FT_Library library)
+{
+    static const FT_Vector points[] = {
+        { 3 * 64 + 13, 1 * 64 + 7 },
+        { 9 * 64 + 45, 2 * 64 + 50 },
+        { 5 * 64 + 21, 12 * 64 + 33 },
+    };
+    FT_Glyph glyph;
+
+    assert(!FT_New_Glyph(library, FT_GLYPH_FORMAT_OUTLINE, &glyph));
+
+    FT_OutlineGlyph outline = (FT_OutlineGlyph)glyph;
+    assert(!FT_Outline_New(library, ARRAY_SIZE(points), 1, &outline->outline));
+    for (size_t i = 0; i < ARRAY_SIZE(points); i++)
+    {
+        outline->outline.points[i] = points[i];
+        outline->outline.tags[i] = FT_CURVE_TAG_ON;
+    }
+    outline->outline.contours[0] = ARRAY_SIZE(points) - 1;
+    return glyph;
+}
+
+static FT_BitmapGlyph render(FT_Glyph outline, FT_Vector pen)
+{
+    FT_Glyph glyph = outline;
+
+    assert(!FT_Glyph_To_Bitmap(&glyph, FT_RENDER_MODE_NORMAL, &pen, 0));
+    return (FT_BitmapGlyph)glyph;
+}
+
+static void assert_same_bitmap(FT_BitmapGlyph a, FT_BitmapGlyph b)
+{
+    assert(a->left == b->left && a->top == b->top);
+    assert(a->bitmap.rows == b->bitmap.rows);
+    assert(a->bitmap.width == b->bitmap.width);
+    assert(a->bitmap.rows > 0 && a->bitmap.width > 0);
+    for (unsigned y = 0; y < a->bitmap.rows; y++)
+        assert(!memcmp(&a->bitmap.buffer[y * a->bitmap.pitch],
+                       &b->bitmap.buffer[y * b->bitmap.pitch],
+                       a->bitmap.width));
+}
+
+static void test_bitmaps(FT_Library library)
+{
+    static const FT_Pos positions[] = {
+        0, 13, 64, 64 * 7 + 13, 64 * 7 + 63, -13, -64 * 3 - 51, 64 * 100 + 32,
+    };
+    const glyph_cache_key_t key = { .p_face = FACE(1), .i_index = 42 };
+    glyph_cache_t *cache = glyph_cache_New(1 << 20);
+    glyph_cache_stats_t stats;
+    FT_Glyph outline = new_outline(library);
+
+    assert(cache != NULL);
+    for (size_t i = 0; i < ARRAY_SIZE(positions); i++)
+        for (size_t j = 0; j < ARRAY_SIZE(positions); j++)
+        {
+            const FT_Vector pen = { positions[i], positions[j] };
+            FT_BitmapGlyph ref = render(outline, pen);
+
+            FT_Glyph bitmap = glyph_cache_GetBitmap(cache, &key,
+                                                    GLYPH_CACHE_BITMAP_GLYPH,
+                                                    &pen);
+            if (bitmap == NULL)
+            {
+                glyph_cache_PutBitmap(cache, &key, GLYPH_CACHE_BITMAP_GLYPH,
+                                      &pen, (FT_Glyph)ref);
+                bitmap = glyph_cache_GetBitmap(cache, &key,
+                                               GLYPH_CACHE_BITMAP_GLYPH, &pen);
+                assert(bitmap != NULL);
+            }
+            assert(bitmap != (FT_Glyph)ref);
+            assert_same_bitmap((FT_BitmapGlyph)bitmap, ref);
+            FT_Done_Glyph(bitmap);
+            FT_Done_Glyph((FT_Glyph)ref);
+        }
+
+    /* One bitmap per distinct fractional position */
+    glyph_cache_GetStats(cache, &stats);
+    assert(stats.i_entries == 5 * 5);
+    assert(stats.bitmaps.i_misses == stats.i_entries);
+    assert(stats.bitmaps.i_hits == ARRAY_SIZE(positions)
+                                     * ARRAY_SIZE(positions));
+
+    /* Other kinds of bitmaps and other glyphs are distinct */
+    const FT_Vector pen = { 0, 0 };
+    glyph_cache_key_t other = key;
+    assert(glyph_cache_GetBitmap(cache, &key, GLYPH_CACHE_BITMAP_SHADOW,
+                                 &pen) == NULL);
+    other.i_index++;
+    assert(glyph_cache_GetBitmap(cache, &other, GLYPH_CACHE_BITMAP_GLYPH,
+                                 &pen) == NULL);
+    other = key;
+    other.i_flags = GLYPH_CACHE_BOLD;
+    assert(glyph_cache_GetBitmap(cache, &other, GLYPH_CACHE_BITMAP_GLYPH,
+                                 &pen) == NULL);
+
+    /* Outline glyphs are not bitmaps */
+    glyph_cache_PutBitmap(cache, &other, GLYPH_CACHE_BITMAP_GLYPH, &pen,
+                          outline);
+    assert(glyph_cache_GetBitmap(cache, &other, GLYPH_CACHE_BITMAP_GLYPH,
+                                 &pen) == NULL);
+
+    FT_Done_Glyph(outline);
+    glyph_cache_Delete(cache);
+}
+
+static void test_glyphs(FT_Library library)
+{
+    const glyph_cache_key_t key = {
+        .p_face = FACE(1), .i_index = 3, .i_flags = GLYPH_CACHE_OUTLINE,
+        .i_radius = 128,
+    };
+    const FT_Vector advance = { 7 * 64, 0 };
+    glyph_cache_t *cache = glyph_cache_New(1 << 20);
+    FT_Glyph glyph = new_outline(library), outline = new_outline(library);
+    FT_Glyph copy, copy_outline;
+    FT_Vector copy_advance;
+
+    assert(cache != NULL);
+    assert(glyph_cache_GetGlyph(cache, &key, &copy, &copy_outline,
+                                &copy_advance) != VLC_SUCCESS);
+    assert(copy == NULL && copy_outline == NULL);
+
+    glyph_cache_PutGlyph(cache, &key, glyph, outline, &advance);
+    FT_Done_Glyph(glyph);
+    FT_Done_Glyph(outline);
+
+    /* The cache owns its copies */
+    for (int i = 0; i < 2; i++)
+    {
+        assert(glyph_cache_GetGlyph(cache, &key, &copy, &copy_outline,
+                                    &copy_advance) == VLC_SUCCESS);
+        assert(copy != NULL && copy_outline != NULL && copy != copy_outline);
+        assert(copy->format == FT_GLYPH_FORMAT_OUTLINE);
+        assert(((FT_OutlineGlyph)copy)->outline.n_points == 3);
+        assert(copy_advance.x == advance.x && copy_advance.y == advance.y);
+        FT_Done_Glyph(copy);
+        FT_Done_Glyph(copy_outline);
+    }
+
+    /* Without stroked outline */
+    glyph_cache_key_t plain = key;
+    plain.i_flags = 0;
+    plain.i_radius = 0;
+    glyph = new_outline(library);
+    glyph_cache_PutGlyph(cache, &plain, glyph, NULL, &advance);
+    FT_Done_Glyph(glyph);
+    assert(glyph_cache_GetGlyph(cache, &plain, &copy, &copy_outline,
+                                &copy_advance) == VLC_SUCCESS);
+    assert(copy != NULL && copy_outline == NULL);
+    FT_Done_Glyph(copy);
+
+    glyph_cache_stats_t stats;
+    glyph_cache_GetStats(cache, &stats);
+    assert(stats.glyphs.i_hits == 3 && stats.glyphs.i_misses == 1);
+    assert(stats.i_entries == 2);
+
+    glyph_cache_Delete(cache);
+}
+
+#define RUNS 64
+
+static void put_run(glyph_cache_t *cache, unsigned n)
+{
+    const uni_char_t text[] = { 'r', 'u', 'n', n };
+    glyph_cache_shaped_t glyphs[4];
+
+    for (unsigned i = 0; i < ARRAY_SIZE(glyphs); i++)
+        glyphs[i] = (glyph_cache_shaped_t) {
+            .i_index = n * 10 + i, .i_cluster = i, .i_x_advance = 64 * i,
+        };
+    glyph_cache_PutRun(cache, FACE(2), 0, 0, text, ARRAY_SIZE(text),
+                       glyphs, ARRAY_SIZE(glyphs));
+}
+
+static bool get_run(glyph_cache_t *cache, unsigned n)
+{
+    const uni_char_t text[] = { 'r', 'u', 'n', n };
+    unsigned count;
+    glyph_cache_shaped_t *glyphs =
+        glyph_cache_GetRun(cache, FACE(2), 0, 0, text, ARRAY_SIZE(text),
+                           &count);
+
+    if (glyphs == NULL)
+        return false;
+    assert(count == 4);
+    for (unsigned i = 0; i < count; i++)
+        assert(glyphs[i].i_index == n * 10 + i && glyphs[i].i_cluster == i
+            && glyphs[i].i_x_advance == (int)(64 * i));
+    free(glyphs);
+    return true;
+}
+
+static void test_runs(void)
+{
+    glyph_cache_t *cache = glyph_cache_New(1 << 20);
+    glyph_cache_stats_t stats;
+
+    assert(cache != NULL);
+    assert(!get_run(cache, 0));
+    put_run(cache, 0);
+    assert(get_run(cache, 0));
+
+    /* The text, the face, the direction and the script are in the key */
+    const uni_char_t text[] = { 'r', 'u', 'n', 0 };
+    unsigned count;
+    assert(glyph_cache_GetRun(cache, FACE(2), 0, 0, text, 3, &count) == NULL);
+    assert(glyph_cache_GetRun(cache, FACE(3), 0, 0, text, 4, &count) == NULL);
+    assert(glyph_cache_GetRun(cache, FACE(2), 1, 0, text, 4, &count) == NULL);
+    assert(glyph_cache_GetRun(cache, FACE(2), 0, 1, text, 4, &count) == NULL);
+
+    glyph_cache_GetStats(cache, &stats);
+    assert(stats.runs.i_hits == 1 && stats.runs.i_misses == 5);
+
+    /* Room for a few runs only */
+    const size_t run_size = stats.i_size / stats.i_entries;
+    glyph_cache_Delete(cache);
+    cache = glyph_cache_New(8 * run_size);
+    assert(cache != NULL);
+
+    for (unsigned i = 0; i < RUNS; i++)
+    {
+        put_run(cache, i);
+        /* The first run is used all the time */
+        assert(get_run(cache, 0));
+        glyph_cache_GetStats(cache, &stats);
+        assert(stats.i_size <= stats.i_max_size);
+        assert(stats.i_entries == __MIN(i + 1, 8));
+    }
+
+    assert(stats.i_evictions == RUNS - 8);
+    for (unsigned i = 1; i < RUNS - 7; i++)
+        assert(!get_run(cache, i));
+    for (unsigned i = RUNS - 7; i < RUNS; i++)
+        assert(get_run(cache, i));
+
+    /* Too large to be cached */
+    glyph_cache_shaped_t glyphs[128] = { 0 };
+    glyph_cache_PutRun(cache, FACE(3), 0, 0, text, 4, glyphs,
+                       ARRAY_SIZE(glyphs));
+    assert(glyph_cache_GetRun(cache, FACE(3), 0, 0, text, 4, &count) == NULL);
+    glyph_cache_GetStats(cache, &stats);
+    assert(stats.i_entries == 8);
+
+    glyph_cache_Delete(cache);
+}
+
+int main(void)
+{
+    FT_Library library;
+
+    assert(!FT_Init_FreeType(&library));
+    test_bitmaps(library);
+    test_glyphs(library);
+    test_runs();
+    FT_Done_FreeType(library);
+    return 0;
+}
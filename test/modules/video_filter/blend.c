@@ -0,0 +1,286 @@
+/*****************************************************************************
+ * blend.c: test for the blending SIMD routines
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that the C line blending routines blend like the per-pixel code of
+ * blend.cpp, and that the SSE4.1 and AVX2 routines produce the same pixels
+ * as the C ones.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include "../modules/video_filter/blend_row.c"
+
+/* Not a multiple of any vector size, so that the C tails get tested too */
+#define WIDTH  (4 * 64 + 13)
+/* Detects writes past the end of the line */
+#define GUARD  64
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+static void fill(uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        p[i] = rnd();
+}
+
+/* Mostly transparent and opaque pixels, as in subtitles */
+static void fill_alpha(uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        switch (rnd() % 4)
+        {
+            case 0:
+                p[i] = 0;
+                break;
+            case 1:
+                p[i] = 255;
+                break;
+            default:
+                p[i] = rnd();
+        }
+}
+
+static void fill10(uint16_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        p[i] = rnd() & 1023;
+}
+
+/* blend.cpp merge() and opacity */
+static unsigned ref_div255(unsigned v)
+{
+    return ((v >> 8) + v + 1) >> 8;
+}
+
+static unsigned ref_merge(unsigned dst, unsigned src, unsigned a,
+                          unsigned alpha)
+{
+    a = ref_div255(alpha * a);
+    if (a == 0)
+        return dst;
+    return ref_div255((255 - a) * dst + src * a);
+}
+
+static const unsigned alphas[] = { 0, 1, 128, 254, 255 };
+
+static uint8_t src[2 * WIDTH], u[2 * WIDTH], v[2 * WIDTH], a[2 * WIDTH];
+static uint8_t rgba[4 * WIDTH];
+static uint8_t orig[4 * WIDTH + GUARD], ref[4 * WIDTH + GUARD];
+static uint8_t out[4 * WIDTH + GUARD];
+
+static void test_reference(const blend_row_t *c)
+{
+    const uint16_t *orig10 = (const uint16_t *)orig;
+    const uint16_t *ref10 = (const uint16_t *)ref;
+
+    for (size_t k = 0; k < ARRAY_SIZE(alphas); k++)
+    {
+        const unsigned alpha = alphas[k];
+
+        fill(src, sizeof (src));
+        fill(u, sizeof (u));
+        fill(v, sizeof (v));
+        fill_alpha(a, sizeof (a));
+        fill(orig, sizeof (orig));
+
+        memcpy(ref, orig, sizeof (ref));
+        c->plane(ref, src, a, WIDTH, alpha);
+        for (unsigned i = 0; i < WIDTH; i++)
+            assert(ref[i] == ref_merge(orig[i], src[i], a[i], alpha));
+
+        memcpy(ref, orig, sizeof (ref));
+        c->chroma(ref, src, a, WIDTH, alpha);
+        for (unsigned i = 0; i < WIDTH; i++)
+            assert(ref[i] == ref_merge(orig[i], src[2 * i], a[2 * i], alpha));
+
+        memcpy(ref, orig, sizeof (ref));
+        c->semiplanar(ref, u, v, a, WIDTH, alpha);
+        for (unsigned i = 0; i < WIDTH; i++)
+        {
+            assert(ref[2 * i] == ref_merge(orig[2 * i], u[2 * i], a[2 * i],
+                                           alpha));
+            assert(ref[2 * i + 1] == ref_merge(orig[2 * i + 1], v[2 * i],
+                                               a[2 * i], alpha));
+        }
+
+        fill10((uint16_t *)orig, WIDTH);
+        memcpy(ref, orig, sizeof (ref));
+        c->plane10((uint16_t *)ref, src, a, WIDTH, alpha);
+        for (unsigned i = 0; i < WIDTH; i++)
+            assert(ref10[i] == ref_merge(orig10[i], src[i] * 1023 / 255,
+                                         a[i], alpha));
+
+        fill(rgba, sizeof (rgba));
+        fill(orig, sizeof (orig));
+        memcpy(ref, orig, sizeof (ref));
+        c->rgbx(ref, rgba, WIDTH, alpha, 2, 1, 0);
+        for (unsigned i = 0; i < WIDTH; i++)
+        {
+            const uint8_t *s = &rgba[4 * i];
+
+            assert(ref[4 * i + 2] == ref_merge(orig[4 * i + 2], s[0], s[3],
+                                               alpha));
+            assert(ref[4 * i + 1] == ref_merge(orig[4 * i + 1], s[1], s[3],
+                                               alpha));
+            assert(ref[4 * i + 0] == ref_merge(orig[4 * i + 0], s[2], s[3],
+                                               alpha));
+            assert(ref[4 * i + 3] == orig[4 * i + 3]);
+        }
+    }
+}
+
+static void check(void (*run)(const blend_row_t *, uint8_t *, unsigned,
+                              unsigned),
+                  const blend_row_t *c, const blend_row_t *f, unsigned alpha,
+                  bool ten_bit)
+{
+    /* The odd widths check the tails, and only the line is written */
+    for (unsigned w = WIDTH - 17; w <= WIDTH; w++)
+    {
+        if (ten_bit)
+            fill10((uint16_t *)orig, sizeof (orig) / 2);
+        else
+            fill(orig, sizeof (orig));
+
+        memcpy(ref, orig, sizeof (ref));
+        memcpy(out, orig, sizeof (out));
+        run(c, ref, w, alpha);
+        run(f, out, w, alpha);
+        assert(!memcmp(out, ref, sizeof (out)));
+    }
+}
+
+/* The source lines end at the end of the buffers, where reading further
+ * would be detected */
+#define LINE(buf, len) (&(buf)[sizeof (buf) - (len)])
+
+static void run_plane(const blend_row_t *row, uint8_t *dst, unsigned w,
+                      unsigned alpha)
+{
+    row->plane(dst, LINE(src, w), LINE(a, w), w, alpha);
+}
+
+static void run_chroma(const blend_row_t *row, uint8_t *dst, unsigned w,
+                       unsigned alpha)
+{
+    /* The source line of an odd width ends on an even pixel */
+    row->chroma(dst, LINE(src, w), LINE(a, w), (w + 1) / 2, alpha);
+}
+
+static void run_semiplanar(const blend_row_t *row, uint8_t *dst, unsigned w,
+                           unsigned alpha)
+{
+    row->semiplanar(dst, LINE(u, w), LINE(v, w), LINE(a, w), (w + 1) / 2,
+                    alpha);
+}
+
+static void run_plane10(const blend_row_t *row, uint8_t *dst, unsigned w,
+                        unsigned alpha)
+{
+    row->plane10((uint16_t *)dst, LINE(src, w), LINE(a, w), w, alpha);
+}
+
+static void run_chroma10(const blend_row_t *row, uint8_t *dst, unsigned w,
+                         unsigned alpha)
+{
+    row->chroma10((uint16_t *)dst, LINE(src, w), LINE(a, w), (w + 1) / 2,
+                  alpha);
+}
+
+static void run_rgbx(const blend_row_t *row, uint8_t *dst, unsigned w,
+                     unsigned alpha)
+{
+    /* RV32 as BGRX and as XRGB */
+    row->rgbx(dst, LINE(rgba, 4 * w), w, alpha, 2, 1, 0);
+    row->rgbx(dst, LINE(rgba, 4 * w), w, alpha, 3, 2, 1);
+}
+
+static void test_simd(const blend_row_t *c, const blend_row_t *f)
+{
+    for (unsigned loop = 0; loop < 16; loop++)
+        for (size_t k = 0; k < ARRAY_SIZE(alphas); k++)
+        {
+            const unsigned alpha = alphas[k];
+
+            fill(src, sizeof (src));
+            fill(u, sizeof (u));
+            fill(v, sizeof (v));
+            fill_alpha(a, sizeof (a));
+            fill(rgba, sizeof (rgba));
+            for (size_t i = 3; i < sizeof (rgba); i += 4)
+                fill_alpha(&rgba[i], 1);
+
+            check(run_plane, c, f, alpha, false);
+            check(run_chroma, c, f, alpha, false);
+            check(run_semiplanar, c, f, alpha, false);
+            check(run_plane10, c, f, alpha, true);
+            check(run_chroma10, c, f, alpha, true);
+            check(run_rgbx, c, f, alpha, false);
+        }
+}
+
+int main(void)
+{
+    blend_row_t c;
+
+    blend_row_InitC(&c);
+    test_reference(&c);
+
+#ifdef HAVE_BLEND_ROW_SSE4_1
+    if (vlc_CPU_SSE4_1())
+    {
+        blend_row_t sse;
+
+        blend_row_InitSSE4_1(&sse);
+        test_simd(&c, &sse);
+    }
+    else
+        printf("SSE4.1 not available, not tested\n");
+#endif
+#ifdef HAVE_BLEND_ROW_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        blend_row_t avx2;
+
+        blend_row_InitAVX2(&avx2);
+        test_simd(&c, &avx2);
+    }
+    else
+        printf("AVX2 not available, not tested\n");
+#endif
+    return 0;
+}
@@ -0,0 +1,182 @@
+/*****************************************************************************
+ * deinterlace.c: test for the deinterlacer SIMD kernels
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Checks that the AVX2 Yadif line filters and merge routines produce the
+ * same pixels as the C code, for 8 and 16 bit pixels.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_cpu.h>
+#include "../modules/video_filter/deinterlace/common.h"
+#include "../modules/video_filter/deinterlace/yadif.h"
+#include "../modules/video_filter/deinterlace/merge.c"
+
+/* Odd, so that the C tails get tested too */
+#define WIDTH  (4 * 64 + 13)
+/* Room for the pixels read on each side of the line */
+#define MARGIN 8
+#define PITCH  (2 * (WIDTH + 2 * MARGIN))
+#define LINES  5
+
+typedef void (*yadif_filter_line)(uint8_t *, uint8_t *, uint8_t *, uint8_t *,
+                                  int, int, int, int, int);
+
+static uint32_t rnd_state = 1;
+
+static uint32_t rnd(void)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 8;
+}
+
+static void fill(uint8_t *p, size_t n, unsigned depth, unsigned pixel_size)
+{
+    const unsigned max = (1u << depth) - 1;
+
+    for (size_t i = 0; i < n; i += pixel_size)
+    {
+        unsigned v;
+
+        /* Mostly smooth content, with some saturated pixels and noise */
+        switch (rnd() % 8)
+        {
+            case 0:
+                v = 0;
+                break;
+            case 1:
+                v = max;
+                break;
+            case 2:
+                v = rnd() & max;
+                break;
+            default:
+                v = ((i / pixel_size) * 3 + (rnd() % 5)) & max;
+        }
+
+        if (pixel_size == 2)
+        {
+            uint16_t w = v;
+            memcpy(&p[i], &w, 2);
+        }
+        else
+            p[i] = v;
+    }
+}
+
+static uint8_t prev[LINES * PITCH], cur[LINES * PITCH], next[LINES * PITCH];
+static uint8_t ref[PITCH], out[PITCH];
+
+static void test_yadif(yadif_filter_line c, yadif_filter_line f,
+                       unsigned depth, unsigned pixel_size)
+{
+    const size_t offset = 2 * PITCH + MARGIN * pixel_size;
+
+    for (unsigned loop = 0; loop < 16; loop++)
+    {
+        fill(prev, sizeof (prev), depth, pixel_size);
+        fill(cur, sizeof (cur), depth, pixel_size);
+        fill(next, sizeof (next), depth, pixel_size);
+
+        /* The odd widths check the tails. The references are swapped for
+         * the bottom line, as in RenderYadif(). */
+        for (int w = WIDTH - 3; w <= WIDTH; w++)
+            for (int parity = 0; parity < 2; parity++)
+                for (int mode = 0; mode <= 2; mode += 2)
+                    for (int sign = -1; sign <= 1; sign += 2)
+                    {
+                        const int bytes = w * pixel_size;
+
+                        memset(ref, 0x55, sizeof (ref));
+                        memset(out, 0x55, sizeof (out));
+                        c(ref, prev + offset, cur + offset, next + offset,
+                          bytes, sign * PITCH, -sign * PITCH, parity, mode);
+                        f(out, prev + offset, cur + offset, next + offset,
+                          bytes, sign * PITCH, -sign * PITCH, parity, mode);
+                        assert(!memcmp(out, ref, sizeof (out)));
+                    }
+    }
+}
+
+static void test_merge(void (*f)(void *, const void *, const void *, size_t),
+                       unsigned pixel_size)
+{
+    fill(prev, PITCH, 8 * pixel_size, pixel_size);
+    fill(cur, PITCH, 8 * pixel_size, pixel_size);
+
+    for (size_t bytes = PITCH - 7 * pixel_size; bytes <= PITCH;
+         bytes += pixel_size)
+    {
+        memset(out, 0x55, sizeof (out));
+        f(out, prev, cur, bytes);
+
+        for (size_t i = 0; i < bytes; i += pixel_size)
+        {
+            if (pixel_size == 2)
+            {
+                uint16_t a, b, d;
+
+                memcpy(&a, &prev[i], 2);
+                memcpy(&b, &cur[i], 2);
+                memcpy(&d, &out[i], 2);
+                assert(d == (a + b + 1) >> 1);
+            }
+            else
+                assert(out[i] == (prev[i] + cur[i] + 1) >> 1);
+        }
+        for (size_t i = bytes; i < sizeof (out); i++)
+            assert(out[i] == 0x55);
+    }
+}
+
+int main(void)
+{
+#ifdef HAVE_YADIF_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        test_yadif(yadif_filter_line_c, yadif_filter_line_avx2, 8, 1);
+        test_yadif(yadif_filter_line_c_16bit, yadif_filter_line_avx2_16bit,
+                   10, 2);
+        test_yadif(yadif_filter_line_c_16bit, yadif_filter_line_avx2_16bit,
+                   16, 2);
+    }
+    else
+#endif
+        printf("AVX2 not available, Yadif not tested\n");
+
+#ifdef HAVE_MERGE_AVX2
+    if (vlc_CPU_AVX2())
+    {
+        test_merge(Merge8BitAVX2, 1);
+        test_merge(Merge16BitAVX2, 2);
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*****************************************************************************
+ * vshm.c: test consumer for the shared memory video output
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Plays a mock video with the vshm display, and consumes its pictures from
+ * the socket, as a separate process would.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "../../libvlc/test.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+
+#include "../modules/video_output/vshm.h"
+
+#define WIDTH  64
+#define HEIGHT 48
+#define HELD   2
+#define FRAMES 30
+
+struct consumer
+{
+    int fd;
+    struct vshm_format format;
+    const uint8_t *buffers[VSHM_BUFFERS_MAX];
+    bool held[VSHM_BUFFERS_MAX];
+    unsigned held_count;
+};
+
+static int Connect(const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_LOCAL };
+
+    assert(strlen(path) < sizeof (addr.sun_path));
+    strcpy(addr.sun_path, path);
+
+    /* The socket appears when the video output starts */
+    for (;;)
+    {
+        int fd = socket(AF_LOCAL, SOCK_SEQPACKET, 0);
+        assert(fd != -1);
+
+        if (connect(fd, (struct sockaddr *)&addr, sizeof (addr)) == 0)
+            return fd;
+
+        assert(errno == ENOENT || errno == ECONNREFUSED);
+        close(fd);
+        usleep(10000);
+    }
+}
+
+static void ReceiveFormat(struct consumer *c)
+{
+    union {
+        char buf[CMSG_SPACE(VSHM_BUFFERS_MAX * sizeof (int))];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { .iov_base = &c->format, .iov_len = sizeof (c->format) };
+    struct msghdr hdr = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = control.buf,
+        .msg_controllen = sizeof (control.buf),
+    };
+
+    ssize_t len = recvmsg(c->fd, &hdr, MSG_CMSG_CLOEXEC);
+    assert(len == sizeof (c->format));
+    assert(!(hdr.msg_flags & (MSG_TRUNC | MSG_CTRUNC)));
+
+    const struct vshm_format *f = &c->format;
+    assert(f->type == VSHM_FORMAT);
+    assert(f->version == VSHM_VERSION);
+    assert(!memcmp(&f->chroma, "I420", 4));
+    assert(f->visible_width == WIDTH && f->visible_height == HEIGHT);
+    assert(f->width >= WIDTH && f->height >= HEIGHT);
+    assert(f->max_held == HELD);
+    assert(f->plane_count == 3);
+    assert(f->buffer_count > HELD && f->buffer_count <= VSHM_BUFFERS_MAX);
+
+    for (unsigned i = 0; i < f->plane_count; i++)
+    {
+        const struct vshm_plane *p = &f->planes[i];
+
+        assert(p->pitch >= f->width / (i ? 2 : 1));
+        assert(p->offset + (size_t)p->pitch * p->lines <= f->buffer_size);
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    assert(cmsg != NULL);
+    assert(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS);
+    assert(cmsg->cmsg_len == CMSG_LEN(f->buffer_count * sizeof (int)));
+
+    const int *fds = (const int *)CMSG_DATA(cmsg);
+    for (unsigned i = 0; i < f->buffer_count; i++)
+    {
+        void *base = mmap(NULL, f->buffer_size, PROT_READ, MAP_SHARED,
+                          fds[i], 0);
+        assert(base != MAP_FAILED);
+        close(fds[i]);
+        c->buffers[i] = base;
+    }
+}
+
+static void Release(struct consumer *c, unsigned buffer)
+{
+    struct vshm_release msg = { .type = VSHM_RELEASE, .buffer = buffer };
+
+    assert(c->held[buffer]);
+    c->held[buffer] = false;
+    c->held_count--;
+    assert(send(c->fd, &msg, sizeof (msg), 0) == sizeof (msg));
+}
+
+static void CheckPicture(const struct consumer *c, unsigned buffer)
+{
+    const struct vshm_format *f = &c->format;
+    const uint8_t *base = c->buffers[buffer];
+    /* The mock demuxer fills each picture with a single value */
+    const uint8_t value = base[f->planes[0].offset];
+
+    for (unsigned i = 0; i < f->plane_count; i++)
+    {
+        const struct vshm_plane *p = &f->planes[i];
+        unsigned width = i ? WIDTH / 2 : WIDTH;
+        unsigned height = i ? HEIGHT / 2 : HEIGHT;
+
+        for (unsigned y = 0; y < height; y++)
+            for (unsigned x = 0; x < width; x++)
+                assert(base[p->offset + y * p->pitch + x] == value);
+    }
+}
+
+static void Consume(const char *path)
+{
+    struct consumer c = { .held_count = 0 };
+    uint64_t sequence = 0;
+    int64_t date = INT64_MIN;
+
+    c.fd = Connect(path);
+    ReceiveFormat(&c);
+
+    for (unsigned n = 0; n < FRAMES; n++)
+    {
+        struct vshm_frame frame;
+
+        assert(recv(c.fd, &frame, sizeof (frame), 0) == sizeof (frame));
+        assert(frame.type == VSHM_FRAME);
+        assert(frame.buffer < c.format.buffer_count);
+        assert(n == 0 || frame.sequence > sequence);
+        assert(frame.date >= date);
+        sequence = frame.sequence;
+        date = frame.date;
+
+        /* Held buffers are never sent again */
+        assert(!c.held[frame.buffer]);
+        c.held[frame.buffer] = true;
+        c.held_count++;
+        assert(c.held_count <= HELD);
+
+        CheckPicture(&c, frame.buffer);
+
+        /* Keep the newest pictures, release the oldest */
+        if (c.held_count == HELD)
+            for (unsigned i = 0; i < c.format.buffer_count; i++)
+                if (c.held[i] && i != frame.buffer)
+                {
+                    Release(&c, i);
+                    break;
+                }
+    }
+
+    for (unsigned i = 0; i < c.format.buffer_count; i++)
+        munmap((void *)c.buffers[i], c.format.buffer_size);
+    /* Held pictures are released on disconnection */
+    close(c.fd);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/vlc-vshm-XXXXXX";
+    char path[sizeof (dir) + 8];
+    char path_arg[sizeof (path) + 16];
+    char held_arg[32];
+
+    test_init();
+
+    assert(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof (path), "%s/socket", dir);
+    snprintf(path_arg, sizeof (path_arg), "--vshm-path=%s", path);
+    snprintf(held_arg, sizeof (held_arg), "--vshm-held=%u", HELD);
+
+    const char *argv[] = {
+        "-v", "--vout=vshm", path_arg, held_arg, "--no-audio",
+    };
+
+    libvlc_instance_t *vlc = libvlc_new(sizeof (argv) / sizeof (argv[0]), argv);
+    assert(vlc != NULL);
+
+    char mrl[256];
+    snprintf(mrl, sizeof (mrl),
+             "mock://video_track_count=1;length=100000000;video_chroma=I420;"
+             "video_width=%u;video_height=%u;video_frame_rate=100",
+             WIDTH, HEIGHT);
+
+    libvlc_media_t *media = libvlc_media_new_location(vlc, mrl);
+    assert(media != NULL);
+    libvlc_media_player_t *mp = libvlc_media_player_new_from_media(media);
+    assert(mp != NULL);
+    libvlc_media_release(media);
+
+    assert(libvlc_media_player_play(mp) == 0);
+    Consume(path);
+
+    libvlc_media_player_stop(mp);
+    libvlc_media_player_release(mp);
+    libvlc_release(vlc);
+
+    /* The display removes its socket */
+    assert(access(path, F_OK) == -1 && errno == ENOENT);
+    rmdir(dir);
+    return 0;
+}
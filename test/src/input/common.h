@@ -37,6 +37,14 @@ struct vlc_run_args
 
     /* true to test demux controls */
     bool test_demux_controls;
+
+    /* additional LibVLC command line options */
+    int argc;
+    const char *const *argv;
+
+    /* if not NULL, receives the time spent demuxing, in microseconds,
+     * excluding the LibVLC, stream and demuxer setup */
+    int64_t *demux_time;
 };
 
 void vlc_run_args_init(struct vlc_run_args *args);
@@ -301,6 +301,7 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
 
     uintmax_t i = 0;
     int val;
+    vlc_tick_t start = vlc_tick_now();
 
     while ((val = demux_Demux(demux)) == VLC_DEMUXER_SUCCESS)
     {
@@ -326,6 +327,9 @@ static int demux_process_stream(const struct vlc_run_args *args, stream_t *s)
         i++;
     }
 
+    if (args->demux_time != NULL)
+        *args->demux_time = US_FROM_VLC_TICK(vlc_tick_now() - start);
+
     demux_Delete(demux);
     es_out_Delete(out);
 
@@ -1750,6 +1750,15 @@ REPORT_LIST
     test_titles(&ctx, false);
     test_tracks(&ctx, true);
     test_tracks(&ctx, false);
+
+    /* Same, with the packetizers running in their own threads */
+    ret = var_Create(vlc->p_libvlc_int, "decoder-pipeline", VLC_VAR_BOOL);
+    assert(ret == VLC_SUCCESS);
+    ret = var_SetBool(vlc->p_libvlc_int, "decoder-pipeline", true);
+    assert(ret == VLC_SUCCESS);
+    test_tracks(&ctx, false);
+    var_Destroy(vlc->p_libvlc_int, "decoder-pipeline");
+
     test_programs(&ctx);
 
     vlc_player_RemoveListener(player, listener);
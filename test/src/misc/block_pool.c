@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * block_pool.c: test for the block allocator pool
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+#include <vlc/vlc.h>
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include <string.h>
+#include <assert.h>
+
+#define COUNT 20000
+
+static bool is_pooled(const block_t *block)
+{
+    size_t size = sizeof (*block) + block->i_size;
+
+    return (size & (size - 1)) == 0;
+}
+
+static void test_sizes(void)
+{
+    /* Small blocks are rounded up to their size class */
+    block_t *block = block_Alloc(100);
+    assert(block != NULL);
+    assert(is_pooled(block));
+    assert(block->i_buffer == 100);
+    memset(block->p_buffer, 0x55, block->i_buffer);
+
+    /* Released blocks are reused by the same thread first */
+    block_t *saved = block;
+    block_Release(block);
+    block = block_Alloc(120);
+    assert(block == saved);
+    memset(block->p_buffer, 0xAA, block->i_buffer);
+
+    /* Growing within the size class does not move the payload */
+    size_t room = block->p_start + block->i_size - block->p_buffer;
+    assert(room > 120);
+    block = block_Realloc(block, 0, room);
+    assert(block == saved);
+    assert(block->i_buffer == room);
+    assert(block->p_buffer[119] == 0xAA);
+
+    /* Growing beyond it does */
+    block = block_Realloc(block, 16, 2 * room);
+    assert(block != NULL && block != saved);
+    assert(is_pooled(block));
+    assert(block->p_buffer[16] == 0xAA && block->p_buffer[135] == 0xAA);
+    block_Release(block);
+
+    /* Large blocks bypass the pool */
+    block = block_Alloc(1 << 20);
+    assert(block != NULL);
+    assert(!is_pooled(block));
+    assert(block->i_buffer == (1 << 20));
+    block_Release(block);
+}
+
+static void *Producer(void *data)
+{
+    block_fifo_t *fifo = data;
+
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_Alloc((i * 37) % 70000);
+        assert(block != NULL);
+        memset(block->p_buffer, i & 0xff, block->i_buffer);
+        block->i_dts = i;
+        block_FifoPut(fifo, block);
+    }
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    /* Blocks are released by another thread than the one allocating them,
+     * so they have to go through the depot. */
+    block_fifo_t *fifo = block_FifoNew();
+    assert(fifo != NULL);
+
+    vlc_thread_t th;
+    int val = vlc_clone(&th, Producer, fifo, VLC_THREAD_PRIORITY_LOW);
+    assert(val == 0);
+
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_FifoGet(fifo);
+
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->i_buffer == (i * 37) % 70000);
+        for (size_t j = 0; j < block->i_buffer; j += 997)
+            assert(block->p_buffer[j] == (i & 0xff));
+        block_Release(block);
+    }
+
+    vlc_join(th, NULL);
+    block_FifoRelease(fifo);
+}
+
+int main(void)
+{
+    static const char *argv[] = { "-v", "--block-pool" };
+
+    test_init();
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    test_sizes();
+    test_threads();
+
+    /* Pooled blocks outlive the pool */
+    block_t *block = block_Alloc(100);
+    assert(block != NULL);
+    libvlc_release(vlc);
+    block_Release(block);
+    return 0;
+}
@@ -0,0 +1,196 @@
+/*****************************************************************************
+ * block_share.c: test for shared block payloads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#include <stdlib.h>
+#include <string.h>
+#undef NDEBUG
+#include <assert.h>
+
+#define SIZE    1000
+#define OUTPUTS 8
+
+static const uint8_t *check_block(const block_t *block, uint8_t value)
+{
+    assert(block->i_buffer == SIZE);
+    assert(block->i_pts == VLC_TICK_FROM_MS(40));
+    assert(block->i_dts == VLC_TICK_FROM_MS(20));
+    assert(block->i_flags & BLOCK_FLAG_TYPE_I);
+    for (size_t i = 0; i < block->i_buffer; i++)
+        assert(block->p_buffer[i] == value);
+    return block->p_buffer;
+}
+
+static block_t *new_block(void)
+{
+    block_t *block = block_Alloc(SIZE);
+    assert(block != NULL);
+    memset(block->p_buffer, 0x55, SIZE);
+    block->i_pts = VLC_TICK_FROM_MS(40);
+    block->i_dts = VLC_TICK_FROM_MS(20);
+    block->i_flags = BLOCK_FLAG_TYPE_I;
+    return block;
+}
+
+static void test_release_order(bool origin_first)
+{
+    block_t *blocks[OUTPUTS];
+
+    blocks[0] = new_block();
+    assert(!block_IsShared(blocks[0]));
+
+    for (unsigned i = 1; i < OUTPUTS; i++)
+    {
+        /* Share from the original block and from other shares */
+        blocks[i] = block_Share(blocks[i / 2]);
+        assert(blocks[i] != NULL);
+        assert(blocks[i]->p_next == NULL);
+    }
+
+    /* No payload copies */
+    for (unsigned i = 0; i < OUTPUTS; i++)
+    {
+        assert(block_IsShared(blocks[i]));
+        assert(check_block(blocks[i], 0x55) == blocks[0]->p_buffer);
+    }
+
+    if (origin_first)
+        for (unsigned i = 0; i < OUTPUTS; i++)
+            block_Release(blocks[i]);
+    else
+    {
+        for (unsigned i = OUTPUTS - 1; i > 0; i--)
+            block_Release(blocks[i]);
+        /* The last reference is not shared anymore */
+        assert(!block_IsShared(blocks[0]));
+        block_Release(blocks[0]);
+    }
+}
+
+static void test_writable(void)
+{
+    block_t *block = new_block();
+    block_t *share = block_Share(block);
+    assert(share != NULL);
+
+    /* Copy on write */
+    const uint8_t *payload = block->p_buffer;
+    block_t *copy = block_Writable(share);
+    assert(copy != NULL);
+    assert(!block_IsShared(copy));
+    assert(check_block(copy, 0x55) != payload);
+    memset(copy->p_buffer, 0xAA, copy->i_buffer);
+    check_block(block, 0x55);
+
+    /* The last reference is not copied */
+    assert(!block_IsShared(block));
+    assert(block_Writable(block) == block);
+    block_Release(block);
+    block_Release(copy);
+
+    /* Growing the payload at the end copies it */
+    block = new_block();
+    share = block_Share(block);
+    assert(share != NULL);
+    payload = block->p_buffer;
+
+    share = block_Realloc(share, 0, SIZE + 4);
+    assert(share != NULL && share->p_buffer != payload);
+    share->i_buffer = SIZE;
+    check_block(share, 0x55);
+    block_Release(share);
+
+    /* Only the first block that prepends data gets the headroom */
+    share = block_Share(block);
+    assert(share != NULL);
+    share = block_Realloc(share, 0, SIZE);
+    assert(share != NULL && share->p_buffer == payload);
+    share = block_Realloc(share, 4, SIZE);
+    assert(share != NULL && share->p_buffer + 4 == payload);
+    memset(share->p_buffer, 0xAA, 4);
+    share = block_Realloc(share, 4, SIZE + 4);
+    assert(share != NULL && share->p_buffer + 8 == payload);
+    memset(share->p_buffer, 0xBB, 4);
+
+    block_t *other = block_Share(block);
+    assert(other != NULL);
+    other = block_Realloc(other, 4, SIZE);
+    assert(other != NULL && other->p_buffer + 4 != payload);
+    memset(other->p_buffer, 0xCC, 4);
+    assert(share->p_buffer[0] == 0xBB && share->p_buffer[4] == 0xAA);
+    block_Release(other);
+
+    /* Sharing the prepended data gives the headroom up */
+    other = block_Share(share);
+    assert(other != NULL && other->p_buffer == share->p_buffer);
+    share = block_Realloc(share, 4, SIZE + 8);
+    assert(share != NULL && share->p_buffer + 12 != payload);
+    assert(other->p_buffer[0] == 0xBB && other->p_buffer[4] == 0xAA);
+    block_Release(share);
+    block_Release(other);
+    check_block(block, 0x55);
+
+    /* Not shared anymore: the payload grows in place */
+    block = block_Realloc(block, 4, SIZE);
+    assert(block != NULL && block->p_buffer + 4 == payload);
+    block_Release(block);
+}
+
+static void *release_thread(void *data)
+{
+    block_Release(data);
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    for (unsigned loop = 0; loop < 100; loop++)
+    {
+        block_t *block = new_block();
+        vlc_thread_t threads[OUTPUTS];
+
+        for (unsigned i = 0; i < OUTPUTS; i++)
+        {
+            block_t *share = block_Share(block);
+            assert(share != NULL);
+            assert(vlc_clone(&threads[i], release_thread, share,
+                             VLC_THREAD_PRIORITY_LOW) == 0);
+        }
+        block_Release(block);
+
+        for (unsigned i = 0; i < OUTPUTS; i++)
+            vlc_join(threads[i], NULL);
+    }
+}
+
+int main(void)
+{
+    test_release_order(true);
+    test_release_order(false);
+    test_writable();
+    test_threads();
+    return 0;
+}
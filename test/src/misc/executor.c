@@ -0,0 +1,338 @@
+/*****************************************************************************
+ * executor.c: test for the thread pool
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_executor.h>
+#include <vlc_interrupt.h>
+
+#define COUNT 10000
+
+struct counter
+{
+    atomic_uint value;
+    vlc_sem_t done;
+};
+
+static void Count(void *data)
+{
+    struct counter *counter = data;
+
+    if (atomic_fetch_add(&counter->value, 1) + 1 == COUNT)
+        vlc_sem_post(&counter->done);
+}
+
+static void test_submit(unsigned nthreads)
+{
+    static struct vlc_runnable runnables[COUNT];
+    struct counter counter;
+
+    atomic_init(&counter.value, 0);
+    vlc_sem_init(&counter.done, 0);
+
+    vlc_executor_t *executor = vlc_executor_New(nthreads, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        runnables[i].run = Count;
+        runnables[i].userdata = &counter;
+        runnables[i].priority = i % 3;
+        vlc_executor_Submit(executor, &runnables[i]);
+    }
+
+    vlc_sem_wait(&counter.done);
+    assert(atomic_load(&counter.value) == COUNT);
+
+    vlc_executor_Delete(executor);
+    vlc_sem_destroy(&counter.done);
+}
+
+struct blocker
+{
+    vlc_sem_t started;
+    vlc_sem_t release;
+    int result;
+};
+
+static void Block(void *data)
+{
+    struct blocker *blocker = data;
+
+    vlc_sem_post(&blocker->started);
+    blocker->result = vlc_sem_wait_i11e(&blocker->release);
+}
+
+struct order
+{
+    int values[3];
+    unsigned count;
+    vlc_sem_t recorded;
+};
+
+struct record
+{
+    struct vlc_runnable runnable;
+    struct order *order;
+};
+
+static void Record(void *data)
+{
+    struct record *record = data;
+    struct order *order = record->order;
+
+    order->values[order->count++] = record->runnable.priority;
+    vlc_sem_post(&order->recorded);
+}
+
+static void test_priority_cancel(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(1, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    struct blocker blocker;
+    vlc_sem_init(&blocker.started, 0);
+    vlc_sem_init(&blocker.release, 0);
+
+    struct vlc_runnable block = {
+        .run = Block, .userdata = &blocker,
+    };
+
+    /* Occupy the only thread, so that the next runnables stay pending */
+    vlc_executor_Submit(executor, &block);
+    vlc_sem_wait(&blocker.started);
+
+    struct order order = { .count = 0 };
+    vlc_sem_init(&order.recorded, 0);
+    static const int priorities[] = {
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_HIGH,
+    };
+    struct record records[4];
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        records[i].runnable.run = Record;
+        records[i].runnable.userdata = &records[i];
+        records[i].runnable.priority = priorities[i % 3];
+        records[i].order = &order;
+        vlc_executor_Submit(executor, &records[i].runnable);
+    }
+
+    /* A pending runnable can be cancelled */
+    assert(vlc_executor_Cancel(executor, &records[3].runnable));
+    assert(!vlc_executor_Cancel(executor, &records[3].runnable));
+
+    /* A running runnable is interrupted */
+    assert(!vlc_executor_Cancel(executor, &block));
+
+    vlc_executor_Delete(executor);
+
+    assert(blocker.result == EINTR);
+    assert(order.count == 3);
+    assert(order.values[0] == VLC_EXECUTOR_PRIORITY_HIGH);
+    assert(order.values[1] == VLC_EXECUTOR_PRIORITY_NORMAL);
+    assert(order.values[2] == VLC_EXECUTOR_PRIORITY_LOW);
+
+    vlc_sem_destroy(&order.recorded);
+    vlc_sem_destroy(&blocker.release);
+    vlc_sem_destroy(&blocker.started);
+}
+
+static void test_priority_steal(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(2, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    struct blocker blockers[2];
+    struct vlc_runnable blocks[2];
+
+    /* Occupy both threads */
+    for (unsigned i = 0; i < 2; i++)
+    {
+        vlc_sem_init(&blockers[i].started, 0);
+        vlc_sem_init(&blockers[i].release, 0);
+        blocks[i].run = Block;
+        blocks[i].userdata = &blockers[i];
+        blocks[i].priority = VLC_EXECUTOR_PRIORITY_NORMAL;
+        vlc_executor_Submit(executor, &blocks[i]);
+    }
+    for (unsigned i = 0; i < 2; i++)
+        vlc_sem_wait(&blockers[i].started);
+
+    /* Spread over both queues: LOW and HIGH in one, NORMAL in the other */
+    struct order order = { .count = 0 };
+    vlc_sem_init(&order.recorded, 0);
+    static const int priorities[] = {
+        VLC_EXECUTOR_PRIORITY_LOW,
+        VLC_EXECUTOR_PRIORITY_NORMAL,
+        VLC_EXECUTOR_PRIORITY_HIGH,
+    };
+    struct record records[3];
+
+    for (unsigned i = 0; i < 3; i++)
+    {
+        records[i].runnable.run = Record;
+        records[i].runnable.userdata = &records[i];
+        records[i].runnable.priority = priorities[i];
+        records[i].order = &order;
+        vlc_executor_Submit(executor, &records[i].runnable);
+    }
+
+    /* Whichever thread is released, it runs them by priority */
+    vlc_sem_post(&blockers[0].release);
+    for (unsigned i = 0; i < 3; i++)
+        vlc_sem_wait(&order.recorded);
+    vlc_sem_post(&blockers[1].release);
+
+    vlc_executor_Delete(executor);
+
+    assert(order.count == 3);
+    assert(order.values[0] == VLC_EXECUTOR_PRIORITY_HIGH);
+    assert(order.values[1] == VLC_EXECUTOR_PRIORITY_NORMAL);
+    assert(order.values[2] == VLC_EXECUTOR_PRIORITY_LOW);
+    vlc_sem_destroy(&order.recorded);
+
+    for (unsigned i = 0; i < 2; i++)
+    {
+        assert(blockers[i].result == 0);
+        vlc_sem_destroy(&blockers[i].release);
+        vlc_sem_destroy(&blockers[i].started);
+    }
+}
+
+static void test_cancel_reuse(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(1, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    struct blocker blocker;
+    vlc_sem_init(&blocker.started, 0);
+    vlc_sem_init(&blocker.release, 0);
+
+    struct vlc_runnable runnable = {
+        .run = Block, .userdata = &blocker,
+    };
+
+    vlc_executor_Submit(executor, &runnable);
+    vlc_sem_wait(&blocker.started);
+
+    /* The running callback does not use its runnable anymore: it may be
+     * freed, and its memory reused for a new runnable */
+    struct order order = { .count = 0 };
+    vlc_sem_init(&order.recorded, 0);
+    struct record record = { .order = &order };
+
+    runnable.run = Record;
+    runnable.userdata = &record;
+    record.runnable.priority = runnable.priority;
+    vlc_executor_Submit(executor, &runnable);
+
+    /* The new runnable is pending, the running one is left alone */
+    assert(vlc_executor_Cancel(executor, &runnable));
+    vlc_sem_post(&blocker.release);
+
+    vlc_executor_Delete(executor);
+
+    assert(blocker.result == 0);
+    assert(order.count == 0);
+
+    vlc_sem_destroy(&order.recorded);
+    vlc_sem_destroy(&blocker.release);
+    vlc_sem_destroy(&blocker.started);
+}
+
+static void test_on_demand(void)
+{
+    vlc_executor_t *executor = vlc_executor_New(4, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    struct blocker blockers[4];
+    struct vlc_runnable blocks[4];
+
+    /* Each blocking runnable gets a new thread, up to the maximum */
+    for (unsigned i = 0; i < 4; i++)
+    {
+        vlc_sem_init(&blockers[i].started, 0);
+        vlc_sem_init(&blockers[i].release, 0);
+        blocks[i].run = Block;
+        blocks[i].userdata = &blockers[i];
+        blocks[i].priority = VLC_EXECUTOR_PRIORITY_NORMAL;
+        vlc_executor_Submit(executor, &blocks[i]);
+        vlc_sem_wait(&blockers[i].started);
+    }
+
+    /* Beyond the maximum, runnables stay pending */
+    struct order order = { .count = 0 };
+    vlc_sem_init(&order.recorded, 0);
+    struct record record = { .order = &order };
+
+    record.runnable.run = Record;
+    record.runnable.userdata = &record;
+    record.runnable.priority = VLC_EXECUTOR_PRIORITY_NORMAL;
+    vlc_executor_Submit(executor, &record.runnable);
+    assert(vlc_executor_Cancel(executor, &record.runnable));
+
+    for (unsigned i = 0; i < 4; i++)
+        vlc_sem_post(&blockers[i].release);
+
+    vlc_executor_Delete(executor);
+    assert(order.count == 0);
+    vlc_sem_destroy(&order.recorded);
+
+    for (unsigned i = 0; i < 4; i++)
+    {
+        assert(blockers[i].result == 0);
+        vlc_sem_destroy(&blockers[i].release);
+        vlc_sem_destroy(&blockers[i].started);
+    }
+}
+
+static void test_shared(void)
+{
+    vlc_executor_t *a = vlc_executor_Hold();
+    vlc_executor_t *b = vlc_executor_Hold();
+
+    assert(a != NULL && a == b);
+    vlc_executor_Release(b);
+    vlc_executor_Release(a);
+}
+
+int main(void)
+{
+    test_submit(1);
+    test_submit(4);
+    test_submit(16);
+    test_priority_cancel();
+    test_priority_steal();
+    test_cancel_reuse();
+    test_on_demand();
+    test_shared();
+    return 0;
+}
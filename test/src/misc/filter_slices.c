@@ -0,0 +1,119 @@
+/*****************************************************************************
+ * filter_slices.c: test for the slice-parallel filter helper
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdatomic.h>
+
+#include <vlc_common.h>
+#include <vlc_executor.h>
+#include <vlc_filter.h>
+
+#define LINES_MAX 1100
+
+static void test_bounds(void)
+{
+    static const unsigned aligns[] = { 1, 2, 8 };
+
+    for (size_t a = 0; a < ARRAY_SIZE(aligns); a++)
+        for (unsigned lines = 0; lines < 100; lines++)
+            for (unsigned slices = 1; slices <= FILTER_SLICES_MAX; slices++)
+            {
+                unsigned next = 0;
+
+                /* Bands are aligned, contiguous, and cover all the lines */
+                for (unsigned i = 0; i < slices; i++)
+                {
+                    unsigned first, end;
+
+                    filter_GetSliceLines(lines, aligns[a], i, slices,
+                                         &first, &end);
+                    assert(first == next);
+                    assert(first <= end && end <= lines);
+                    assert(first % aligns[a] == 0);
+                    next = end;
+                }
+                assert(next == lines);
+            }
+}
+
+struct lines
+{
+    unsigned count;
+    atomic_uint hits[LINES_MAX];
+};
+
+static void Slice(void *opaque, unsigned slice, unsigned slices)
+{
+    struct lines *l = opaque;
+    unsigned first, end;
+
+    assert(slice < slices);
+    assert(slices <= FILTER_SLICES_MAX);
+
+    filter_GetSliceLines(l->count, 2, slice, slices, &first, &end);
+    for (unsigned y = first; y < end; y++)
+        atomic_fetch_add(&l->hits[y], 1);
+}
+
+static void test_run(vlc_executor_t *executor, unsigned count,
+                     unsigned min_lines)
+{
+    static struct lines l;
+
+    l.count = count;
+    for (unsigned y = 0; y < LINES_MAX; y++)
+        atomic_init(&l.hits[y], 0);
+
+    filter_RunSlices(executor, count, min_lines, Slice, &l);
+
+    /* Every line is processed exactly once */
+    for (unsigned y = 0; y < count; y++)
+        assert(atomic_load(&l.hits[y]) == 1);
+    for (unsigned y = count; y < LINES_MAX; y++)
+        assert(atomic_load(&l.hits[y]) == 0);
+}
+
+int main(void)
+{
+    test_bounds();
+
+    /* Without executor, everything runs on the calling thread */
+    test_run(NULL, 1080, 16);
+
+    vlc_executor_t *executor = vlc_executor_New(4, VLC_THREAD_PRIORITY_LOW);
+    assert(executor != NULL);
+
+    for (unsigned i = 0; i < 200; i++)
+    {
+        test_run(executor, 1080, 16);
+        test_run(executor, 1080, 1);
+        test_run(executor, 7, 1);
+        test_run(executor, 20, 64);
+        test_run(executor, 0, 1);
+    }
+
+    vlc_executor_Delete(executor);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*****************************************************************************
+ * histogram.c: test for the pipeline statistics histograms
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "../src/misc/histogram.c"
+
+#define THREADS 4
+#define COUNT   100000
+
+static void test_buckets(void)
+{
+    vlc_histogram_t h;
+    input_stats_histogram_t out;
+
+    vlc_histogram_Init(&h);
+    vlc_histogram_Add(&h, 0);
+    vlc_histogram_Add(&h, 1);
+    vlc_histogram_Add(&h, 2);
+    vlc_histogram_Add(&h, 3);
+    vlc_histogram_Add(&h, 4);
+    vlc_histogram_Add(&h, 1000);
+    vlc_histogram_Add(&h, UINTMAX_MAX);
+    vlc_histogram_Get(&h, &out);
+
+    assert(out.i_count == 7);
+    assert(out.i_max == UINTMAX_MAX);
+    assert(out.buckets[0] == 1);
+    assert(out.buckets[1] == 1);
+    assert(out.buckets[2] == 2);
+    assert(out.buckets[3] == 1);
+    assert(out.buckets[10] == 1); /* 512 to 1023 */
+    assert(out.buckets[INPUT_STATS_HISTOGRAM_BUCKETS - 1] == 1);
+
+    /* Upper bounds of the buckets */
+    assert(input_stats_histogram_Quantile(&out, 0.) == 0);
+    assert(input_stats_histogram_Quantile(&out, .2) == 1);
+    assert(input_stats_histogram_Quantile(&out, .5) == 3);
+    assert(input_stats_histogram_Quantile(&out, .8) == 1023);
+    assert(input_stats_histogram_Quantile(&out, 1.) == UINTMAX_MAX);
+
+    /* Not beyond the largest value */
+    vlc_histogram_Init(&h);
+    vlc_histogram_Add(&h, 600);
+    vlc_histogram_Get(&h, &out);
+    assert(input_stats_histogram_Quantile(&out, .5) == 600);
+
+    vlc_histogram_Init(&h);
+    vlc_histogram_AddTime(&h, VLC_TICK_FROM_MS(2));
+    vlc_histogram_AddTime(&h, -1);
+    vlc_histogram_Get(&h, &out);
+    assert(out.i_total == 2000);
+    assert(out.buckets[0] == 1);
+}
+
+static void test_move(void)
+{
+    vlc_histogram_t a, b;
+    input_stats_histogram_t out;
+
+    vlc_histogram_Init(&a);
+    vlc_histogram_Init(&b);
+    vlc_histogram_Add(&a, 5);
+    vlc_histogram_Add(&b, 7);
+    vlc_histogram_Add(&b, 100);
+
+    vlc_histogram_Move(&a, &b);
+    vlc_histogram_Get(&b, &out);
+    assert(out.i_count == 0 && out.i_total == 0 && out.i_max == 0);
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS; i++)
+        assert(out.buckets[i] == 0);
+
+    vlc_histogram_Get(&a, &out);
+    assert(out.i_count == 3);
+    assert(out.i_total == 112);
+    assert(out.i_max == 100);
+    assert(out.buckets[3] == 2);
+    assert(out.buckets[7] == 1);
+
+    /* Moving an empty histogram changes nothing */
+    vlc_histogram_Move(&a, &b);
+    vlc_histogram_Get(&a, &out);
+    assert(out.i_count == 3 && out.i_max == 100);
+}
+
+static vlc_histogram_t shared;
+
+static void *Writer(void *data)
+{
+    for (unsigned i = 0; i < COUNT; i++)
+        vlc_histogram_Add(&shared, i);
+    (void) data;
+    return NULL;
+}
+
+static void test_concurrency(void)
+{
+    vlc_thread_t threads[THREADS];
+    vlc_histogram_t total;
+    input_stats_histogram_t out;
+
+    vlc_histogram_Init(&shared);
+    vlc_histogram_Init(&total);
+
+    for (unsigned i = 0; i < THREADS; i++)
+        assert(vlc_clone(&threads[i], Writer, NULL,
+                         VLC_THREAD_PRIORITY_LOW) == 0);
+
+    /* Values are moved while they are added, and none gets lost */
+    for (unsigned i = 0; i < 1000; i++)
+        vlc_histogram_Move(&total, &shared);
+
+    for (unsigned i = 0; i < THREADS; i++)
+        vlc_join(threads[i], NULL);
+    vlc_histogram_Move(&total, &shared);
+
+    vlc_histogram_Get(&total, &out);
+    assert(out.i_count == THREADS * COUNT);
+    assert(out.i_total == THREADS * ((uint64_t)COUNT * (COUNT - 1) / 2));
+    assert(out.i_max == COUNT - 1);
+
+    uint64_t sum = 0;
+    for (unsigned i = 0; i < INPUT_STATS_HISTOGRAM_BUCKETS; i++)
+        sum += out.buckets[i];
+    assert(sum == THREADS * COUNT);
+}
+
+int main(void)
+{
+    test_buckets();
+    test_move();
+    test_concurrency();
+    return 0;
+}
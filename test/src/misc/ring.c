@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * ring.c: test for the lock-free block queue
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+#define COUNT 100000
+
+static void test_bounds(void)
+{
+    block_ring_t *ring = block_RingNew(3);
+    assert(ring != NULL);
+
+    /* Capacity is rounded up to 4 */
+    for (unsigned i = 0; i < 4; i++)
+    {
+        block_t *block = block_Alloc(i + 1);
+        assert(block != NULL);
+        assert(block_RingTryPut(ring, block));
+    }
+
+    block_t *extra = block_Alloc(100);
+    assert(extra != NULL);
+    assert(!block_RingTryPut(ring, extra));
+    assert(block_RingCount(ring) == 4);
+    assert(block_RingSize(ring) == 1 + 2 + 3 + 4);
+
+    block_t *block = block_RingTryGet(ring);
+    assert(block != NULL && block->i_buffer == 1);
+    block_Release(block);
+    assert(block_RingSize(ring) == 2 + 3 + 4);
+
+    assert(block_RingTryPut(ring, extra));
+    assert(block_RingCount(ring) == 4);
+
+    /* Remaining blocks are released with the ring */
+    block_RingRelease(ring);
+
+    ring = block_RingNew(1);
+    assert(ring != NULL);
+    assert(block_RingTryGet(ring) == NULL);
+    assert(block_RingCount(ring) == 0);
+    block_RingRelease(ring);
+}
+
+static void *Producer(void *data)
+{
+    block_ring_t *ring = data;
+
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_Alloc(i % 7);
+        assert(block != NULL);
+        block->i_dts = i;
+        block_RingPut(ring, block);
+    }
+    return NULL;
+}
+
+static void test_transfer(size_t size)
+{
+    block_ring_t *ring = block_RingNew(size);
+    assert(ring != NULL);
+
+    vlc_thread_t th;
+    int val = vlc_clone(&th, Producer, ring, VLC_THREAD_PRIORITY_LOW);
+    assert(val == 0);
+
+    for (unsigned i = 0; i < COUNT; i++)
+    {
+        block_t *block = block_RingGet(ring);
+
+        assert(block->i_dts == (vlc_tick_t)i);
+        assert(block->i_buffer == i % 7);
+        block_Release(block);
+    }
+
+    vlc_join(th, NULL);
+    assert(block_RingCount(ring) == 0);
+    assert(block_RingSize(ring) == 0);
+    block_RingRelease(ring);
+}
+
+int main(void)
+{
+    test_bounds();
+    test_transfer(1);
+    test_transfer(16);
+    test_transfer(4096);
+    return 0;
+}
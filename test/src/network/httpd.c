@@ -0,0 +1,244 @@
+/*****************************************************************************
+ * httpd.c: HTTP server load generator
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Serves one live stream from a local HTTP host to many local clients, and
+ * reports how much CPU time the server side needed per client:
+ *
+ *   test_src_network_httpd [clients] [threads] [seconds] [kbit/s]
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+#include <vlc_httpd.h>
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define TEST_PORT "18081"
+#define TEST_BLOCK (7 * 188)
+
+static const char request[] = "GET /load HTTP/1.0\r\n\r\n";
+
+static double cpu_seconds(clockid_t id)
+{
+    struct timespec ts;
+
+    clock_gettime(id, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+struct feeder
+{
+    httpd_stream_t *stream;
+    unsigned kbps;
+    atomic_bool stop;
+    double cpu;
+};
+
+static void *feed(void *data)
+{
+    struct feeder *f = data;
+    vlc_tick_t interval = VLC_TICK_FROM_SEC(TEST_BLOCK * 8) / (f->kbps * 1000);
+    vlc_tick_t deadline = vlc_tick_now();
+
+    while (!atomic_load(&f->stop))
+    {
+        block_t *block = block_Alloc(TEST_BLOCK);
+        assert(block != NULL);
+        memset(block->p_buffer, 0x47, block->i_buffer);
+        httpd_StreamSend(f->stream, block);
+        block_Release(block);
+
+        deadline += interval;
+        vlc_tick_wait(deadline);
+    }
+
+    f->cpu = cpu_seconds(CLOCK_THREAD_CPUTIME_ID);
+    return NULL;
+}
+
+static int client_connect(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(atoi(TEST_PORT)),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+
+    if (connect(fd, (struct sockaddr *)&addr, sizeof (addr))
+     || write(fd, request, strlen(request)) != (ssize_t)strlen(request))
+    {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned clients = (argc > 1) ? strtoul(argv[1], NULL, 10) : 200;
+    unsigned threads = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1;
+    unsigned seconds = (argc > 3) ? strtoul(argv[3], NULL, 10) : 5;
+    unsigned kbps = (argc > 4) ? strtoul(argv[4], NULL, 10) : 4000;
+
+    if (clients == 0 || threads == 0 || seconds == 0 || kbps == 0)
+    {
+        fprintf(stderr, "Usage: %s [clients] [threads] [seconds] [kbit/s]\n",
+                argv[0]);
+        return 1;
+    }
+
+    char threads_arg[32];
+    snprintf(threads_arg, sizeof (threads_arg), "--http-threads=%u", threads);
+
+    const char *const vlc_argv[] = {
+        "--http-host=127.0.0.1", "--http-port=" TEST_PORT, threads_arg,
+    };
+
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(vlc_argv), vlc_argv);
+    assert(vlc != NULL);
+
+    vlc_object_t *obj = VLC_OBJECT(vlc->p_libvlc_int);
+    httpd_host_t *host = vlc_http_HostNew(obj);
+    assert(host != NULL);
+
+    struct feeder f = { .kbps = kbps };
+    f.stream = httpd_StreamNew(host, "/load", "video/MP2T", NULL, NULL);
+    assert(f.stream != NULL);
+    atomic_init(&f.stop, false);
+
+    struct pollfd *ufd = malloc(clients * sizeof (*ufd));
+    uint64_t *received = calloc(clients, sizeof (*received));
+    assert(ufd != NULL && received != NULL);
+
+    for (unsigned i = 0; i < clients; i++)
+    {
+        ufd[i].fd = client_connect();
+        ufd[i].events = POLLIN;
+        if (ufd[i].fd == -1)
+        {
+            fprintf(stderr, "client %u: cannot connect: %s\n", i,
+                    strerror(errno));
+            return 1;
+        }
+    }
+
+    double cpu_start = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID);
+    double self_start = cpu_seconds(CLOCK_THREAD_CPUTIME_ID);
+
+    vlc_thread_t th;
+    int val = vlc_clone(&th, feed, &f, VLC_THREAD_PRIORITY_INPUT);
+    assert(val == 0);
+
+    vlc_tick_t start = vlc_tick_now();
+    vlc_tick_t end = start + VLC_TICK_FROM_SEC(seconds);
+    static char buf[65536];
+
+    while (vlc_tick_now() < end)
+    {
+        if (poll(ufd, clients, 100) < 0)
+            continue;
+
+        for (unsigned i = 0; i < clients; i++)
+        {
+            if (ufd[i].revents == 0)
+                continue;
+
+            ssize_t len = read(ufd[i].fd, buf, sizeof (buf));
+            if (len > 0)
+                received[i] += len;
+            else if (len == 0 || errno != EAGAIN)
+                ufd[i].events = 0; /* disconnected */
+        }
+    }
+
+    vlc_tick_t elapsed = vlc_tick_now() - start;
+    double self_cpu = cpu_seconds(CLOCK_THREAD_CPUTIME_ID) - self_start;
+
+    atomic_store(&f.stop, true);
+    vlc_join(th, NULL);
+
+    /* Everything but the clients (this thread) and the feeder is the
+     * server: the HTTP host worker threads. */
+    double server_cpu = cpu_seconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start
+                      - self_cpu - f.cpu;
+    double wall = secf_from_vlc_tick(elapsed);
+    uint64_t expected = (uint64_t)kbps * 125 * wall;
+    uint64_t total = 0;
+    unsigned starved = 0, dead = 0;
+
+    for (unsigned i = 0; i < clients; i++)
+    {
+        total += received[i];
+        if (received[i] < expected * 9 / 10)
+            starved++;
+        if (ufd[i].events == 0)
+            dead++;
+        close(ufd[i].fd);
+    }
+
+    if (server_cpu < 0.)
+        server_cpu = 0.;
+
+    printf("clients: %u, threads: %u, stream: %u kbit/s, %.1f s\n",
+           clients, threads, kbps, wall);
+    printf("received: %.1f MiB (%u starved, %u disconnected)\n",
+           total / (1024. * 1024.), starved, dead);
+    printf("server CPU: %.2f s (%.1f%% of one core)\n",
+           server_cpu, 100. * server_cpu / wall);
+    if (server_cpu > 0.)
+        printf("clients per core: %.0f\n", clients * wall / server_cpu);
+
+    free(received);
+    free(ufd);
+    httpd_StreamDelete(f.stream);
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return starved ? 1 : 0;
+}
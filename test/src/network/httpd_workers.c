@@ -0,0 +1,137 @@
+/*****************************************************************************
+ * httpd_workers.c: test for the HTTP server worker threads
+ *****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* Checks that all the workers of a host serve clients once a URL gets
+ * registered, and not only the one woken up first.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#undef NDEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../src/network/httpd.c"
+#include "../../../lib/libvlc_internal.h"
+
+#include <vlc/vlc.h>
+
+#define TEST_PORT "18082"
+#define WORKERS   4
+#define WORKERS_ARG "4"
+#define ATTEMPTS  50
+
+static int client_connect(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(atoi(TEST_PORT)),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(fd != -1);
+    /* No request is sent: the client stays with the worker that took it */
+    if (connect(fd, (struct sockaddr *)&addr, sizeof (addr)))
+    {
+        perror("connect");
+        abort();
+    }
+    return fd;
+}
+
+static size_t worker_clients(httpd_worker_t *worker)
+{
+    vlc_mutex_lock(&worker->lock);
+    size_t count = worker->client_count;
+    vlc_mutex_unlock(&worker->lock);
+    return count;
+}
+
+int main(void)
+{
+    const char *const argv[] = {
+        "--http-host=127.0.0.1", "--http-port=" TEST_PORT,
+        "--http-threads=" WORKERS_ARG,
+    };
+
+    alarm(10);
+    setenv("VLC_PLUGIN_PATH", "../modules", 1);
+
+    libvlc_instance_t *vlc = libvlc_new(ARRAY_SIZE(argv), argv);
+    assert(vlc != NULL);
+
+    httpd_host_t *host = vlc_http_HostNew(VLC_OBJECT(vlc->p_libvlc_int));
+    assert(host != NULL);
+    assert(host->i_workers == WORKERS);
+
+    /* Let all the workers park until a URL is registered */
+    vlc_tick_sleep(VLC_TICK_FROM_MS(100));
+
+    httpd_url_t *url = httpd_UrlNew(host, "/test", NULL, NULL);
+    assert(url != NULL);
+
+    int fds[WORKERS * ATTEMPTS];
+    unsigned nfds = 0;
+
+    for (unsigned i = 0; i < WORKERS; i++)
+    {
+        /* Keep the other workers from accepting, so that the connections
+         * can only go to this one */
+        for (unsigned j = 0; j < WORKERS; j++)
+            if (j != i)
+                vlc_mutex_lock(&host->workers[j].lock);
+
+        /* A locked worker may still take the wake-up of a connection,
+         * hence the extra connections kicking the listening socket */
+        unsigned attempts = 0;
+        do
+        {
+            if (attempts++ == ATTEMPTS)
+            {
+                fprintf(stderr, "worker %u never took a client\n", i);
+                return 1;
+            }
+            fds[nfds++] = client_connect();
+            vlc_tick_sleep(VLC_TICK_FROM_MS(20));
+        }
+        while (worker_clients(&host->workers[i]) == 0);
+
+        for (unsigned j = 0; j < WORKERS; j++)
+            if (j != i)
+                vlc_mutex_unlock(&host->workers[j].lock);
+    }
+
+    for (unsigned i = 0; i < nfds; i++)
+        close(fds[i]);
+
+    httpd_UrlDelete(url);
+    httpd_HostDelete(host);
+    libvlc_release(vlc);
+    return 0;
+}
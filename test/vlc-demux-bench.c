@@ -0,0 +1,90 @@
+/**
+ * @file vlc-demux-bench.c
+ */
+/*****************************************************************************
+ * Copyright (C) 2019 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "src/input/demux-run.h"
+
+/* Demuxes a file several times and reports the demuxer throughput.
+ * Only the demux loop is timed, not the LibVLC and demuxer setup.
+ * Any argument before the file name is passed to LibVLC, ie.
+ *   VLC_TARGET=ts vlc-demux-bench --ts-batch-read=256 samples/test.ts
+ */
+int main(int argc, char *argv[])
+{
+    struct vlc_run_args args;
+    vlc_run_args_init(&args);
+
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: [VLC_TARGET=demux] [RUNS=n] %s "
+                "[LibVLC options] <filename>\n", argv[0]);
+        return 1;
+    }
+
+    const char *filename = argv[argc - 1];
+    args.argc = argc - 2;
+    args.argv = (const char *const *)&argv[1];
+
+    struct stat st;
+    if (stat(filename, &st))
+    {
+        perror(filename);
+        return 1;
+    }
+
+    const char *env = getenv("RUNS");
+    int runs = env ? atoi(env) : 5;
+    if (runs < 1)
+        runs = 1;
+
+    double best = 0.;
+    int64_t demux_time;
+
+    args.demux_time = &demux_time;
+
+    for (int i = 0; i < runs; i++)
+    {
+        if (vlc_demux_process_path(&args, filename))
+        {
+            fprintf(stderr, "Error: cannot demux %s\n", filename);
+            return 1;
+        }
+
+        double secs = demux_time / 1e6;
+        if (secs <= 0.)
+            secs = 1e-6;
+        double rate = st.st_size / secs / (1024. * 1024.);
+
+        printf("run %d: %.3f s, %.1f MiB/s\n", i + 1, secs, rate);
+        if (rate > best)
+            best = rate;
+    }
+
+    printf("best: %.1f MiB/s (%jd bytes)\n", best, (intmax_t)st.st_size);
+    return 0;
+}